@@ -0,0 +1,250 @@
+; tests the asynchronous I/O syscalls 11-13: the completion ring, submit, and wait
+; build with oia:    oia aiooi
+; run with oios:     oios aiooi
+; leaves aiooi.txt behind
+
+define syscall_exit           0
+define syscall_print_string   1
+define syscall_print_integer  2
+define syscall_open           4
+define syscall_read           5
+define syscall_write          6
+define syscall_close          7
+define syscall_aio_ring       11
+define syscall_aio_submit     12
+define syscall_aio_wait       13
+
+define mode_read              0
+define mode_write             1
+define mode_append            2
+define mode_update            3
+define op_read                0
+define op_write               1
+define ring_entries           4
+
+.data
+    string  str_name "aiooi.txt"
+    string  str_text "abcdefgh"
+    string  str_patch "XY"
+    string  str_done "aiooi done\n"
+    string  str_nl "\n"
+    string  str_failure "aiooi failure in test "
+    image_t g_fd
+    image_t g_offset
+    image_t g_ring[ 10 ]                  ; head, tail, then ring_entries * { tag, result }
+    image_t g_request[ 6 ]                ; op, fd, buffer, length, offset, tag
+    byte    g_buffer[ 8 ]
+.dataend
+
+.code
+start:
+    ldi     rarg1, str_name
+    ldi     rarg2, mode_write
+    syscall syscall_open
+    ldi     rtmp, -1
+    j       rres, rtmp, eq, test_fail_1
+    st      [g_fd], rres
+    mov     rarg1, rres
+    ldi     rarg2, str_text
+    ldi     rres, 8
+    syscall syscall_write
+    ld      rarg1, [g_fd]
+    syscall syscall_close
+
+    ldi     rarg1, str_name
+    ldi     rarg2, mode_update
+    syscall syscall_open
+    ldi     rtmp, -1
+    j       rres, rtmp, eq, test_fail_1
+    st      [g_fd], rres
+
+    ldi     rarg1, g_ring                 ; the entry count must be a power of 2
+    ldi     rarg2, 3
+    syscall syscall_aio_ring
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_2
+    ldi     rarg1, g_ring
+    ldi     rarg2, ring_entries
+    syscall syscall_aio_ring
+    j       rres, rzero, ne, test_fail_3
+
+    ldi     rarg1, op_read                ; read 4 bytes at offset 2 with tag 11
+    ldi     rarg2, g_buffer
+    ldi     rres, 4
+    ldi     rtmp, 2
+    st      [g_offset], rtmp
+    ldi     rtmp, 11
+    call    submit
+    j       rres, rzero, ne, test_fail_4
+
+    ldi     rarg1, op_write               ; and write 2 bytes at offset 0 with tag 22
+    ldi     rarg2, str_patch
+    ldi     rres, 2
+    st      [g_offset], rzero
+    ldi     rtmp, 22
+    call    submit
+    j       rres, rzero, ne, test_fail_5
+
+    ldi     rarg1, 2
+    syscall syscall_aio_wait
+    ldi     rtmp, 2
+    j       rres, rtmp, ne, test_fail_6
+
+    ldi     rarg2, g_ring                 ; nothing consumed, two appended
+    ld      rtmp, [rarg2]
+    j       rtmp, rzero, ne, test_fail_7
+    addimgw rarg2
+    ld      rtmp, [rarg2]
+    ldi     rarg1, 2
+    j       rtmp, rarg1, ne, test_fail_7
+
+    addimgw rarg2                         ; the completions can come in either order,
+    ld      rtmp, [rarg2]                 ; so add up their tags and results
+    addimgw rarg2
+    ld      rres, [rarg2]
+    addimgw rarg2
+    ld      rarg1, [rarg2]
+    add     rtmp, rarg1
+    addimgw rarg2
+    ld      rarg1, [rarg2]
+    add     rres, rarg1
+    ldi     rarg1, 33
+    j       rtmp, rarg1, ne, test_fail_8
+    ldi     rarg1, 6
+    j       rres, rarg1, ne, test_fail_9
+
+    ldi     rarg1, g_buffer               ; the read got "cdef"
+    ldb     rtmp, [rarg1]
+    ldi     rarg2, 99
+    j       rtmp, rarg2, ne, test_fail_10
+    ldi     rtmp, 3
+    add     rarg1, rtmp
+    ldb     rtmp, [rarg1]
+    ldi     rarg2, 102
+    j       rtmp, rarg2, ne, test_fail_10
+
+    ldi     rtmp, 2                       ; consume both. with nothing in flight, a wait returns at once
+    st      [g_ring], rtmp
+    ldi     rarg1, 1
+    syscall syscall_aio_wait
+    j       rres, rzero, ne, test_fail_11
+
+    ld      rarg1, [g_fd]
+    syscall syscall_close
+
+    ldi     rarg1, str_name               ; the write went to the file
+    ldi     rarg2, mode_read
+    syscall syscall_open
+    st      [g_fd], rres
+    mov     rarg1, rres
+    ldi     rarg2, g_buffer
+    ldi     rres, 8
+    syscall syscall_read
+    ldi     rtmp, 8
+    j       rres, rtmp, ne, test_fail_12
+    ldi     rarg1, g_buffer
+    ldb     rtmp, [rarg1]
+    ldi     rarg2, 88
+    j       rtmp, rarg2, ne, test_fail_12
+    ld      rarg1, [g_fd]
+    syscall syscall_close
+
+    ldi     rarg1, str_name               ; writes to a file opened for append fail, since they'd ignore the offset
+    ldi     rarg2, mode_append
+    syscall syscall_open
+    ldi     rtmp, -1
+    j       rres, rtmp, eq, test_fail_13
+    st      [g_fd], rres
+    ldi     rarg1, op_write
+    ldi     rarg2, str_patch
+    ldi     rres, 2
+    ldi     rtmp, 33
+    call    submit
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_13
+    ld      rarg1, [g_fd]
+    syscall syscall_close
+
+    ldi     rarg1, str_done
+    syscall syscall_print_string
+    ret
+
+submit:                                   ; op in rarg1, buffer in rarg2, length in rres, offset in g_offset, tag in rtmp
+    push    rtmp
+    ldi     rtmp, g_request
+    stinc   [rtmp], rarg1
+    ld      rarg1, [g_fd]
+    stinc   [rtmp], rarg1
+    stinc   [rtmp], rarg2
+    stinc   [rtmp], rres
+    ld      rarg1, [g_offset]
+    stinc   [rtmp], rarg1
+    pop     rarg1
+    stinc   [rtmp], rarg1
+    ldi     rarg1, g_request
+    syscall syscall_aio_submit
+    ret
+
+test_fail_1:
+    ldi    rarg1, 1
+    jmp    failure
+
+test_fail_2:
+    ldi    rarg1, 2
+    jmp    failure
+
+test_fail_3:
+    ldi    rarg1, 3
+    jmp    failure
+
+test_fail_4:
+    ldi    rarg1, 4
+    jmp    failure
+
+test_fail_5:
+    ldi    rarg1, 5
+    jmp    failure
+
+test_fail_6:
+    ldi    rarg1, 6
+    jmp    failure
+
+test_fail_7:
+    ldi    rarg1, 7
+    jmp    failure
+
+test_fail_8:
+    ldi    rarg1, 8
+    jmp    failure
+
+test_fail_9:
+    ldi    rarg1, 9
+    jmp    failure
+
+test_fail_10:
+    ldi    rarg1, 10
+    jmp    failure
+
+test_fail_11:
+    ldi    rarg1, 11
+    jmp    failure
+
+test_fail_12:
+    ldi    rarg1, 12
+    jmp    failure
+
+test_fail_13:
+    ldi    rarg1, 13
+    jmp    failure
+
+failure:
+    mov    rarg2, rarg1
+    ldi    rarg1, str_failure
+    syscall syscall_print_string
+    mov    rarg1, rarg2
+    syscall syscall_print_integer
+    ldi    rarg1, str_nl
+    syscall syscall_print_string
+
+    syscall syscall_exit
+.codeend
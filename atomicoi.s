@@ -0,0 +1,153 @@
+; tests the atomic instructions cas, xadd, xchg, and fence and their byte forms
+; build with oia:    oia atomicoi
+; run with oios:     oios atomicoi
+
+define syscall_exit           0
+define syscall_print_string   1
+define syscall_print_integer  2
+
+.data
+    string  str_done "atomicoi done\n"
+    string  str_nl "\n"
+    string  str_failure "atomicoi failure in test "
+    image_t g_value
+    byte    g_byte
+.dataend
+
+.code
+start:
+    ldi     rtmp, 10                      ; xadd adds and returns the old value
+    st      [g_value], rtmp
+    ldi     rarg1, g_value
+    ldi     rtmp, 5
+    xadd    [rarg1], rtmp
+    ldi     rarg2, 10
+    j       rtmp, rarg2, ne, test_fail_1
+    ld      rtmp, [g_value]
+    ldi     rarg2, 15
+    j       rtmp, rarg2, ne, test_fail_2
+
+    ldi     rarg1, g_value                ; cas stores when the word is rres and returns the old value
+    ldi     rres, 15
+    ldi     rtmp, 42
+    cas     [rarg1], rtmp
+    ldi     rarg2, 15
+    j       rres, rarg2, ne, test_fail_3
+    ld      rtmp, [g_value]
+    ldi     rarg2, 42
+    j       rtmp, rarg2, ne, test_fail_4
+
+    ldi     rarg1, g_value                ; and otherwise leaves it alone
+    ldi     rres, 15
+    ldi     rtmp, 99
+    cas     [rarg1], rtmp
+    ldi     rarg2, 42
+    j       rres, rarg2, ne, test_fail_5
+    ld      rtmp, [g_value]
+    j       rtmp, rarg2, ne, test_fail_6
+
+    ldi     rarg1, g_value                ; xchg swaps
+    ldi     rtmp, 7
+    xchg    [rarg1], rtmp
+    fence
+    ldi     rarg2, 42
+    j       rtmp, rarg2, ne, test_fail_7
+    ld      rtmp, [g_value]
+    ldi     rarg2, 7
+    j       rtmp, rarg2, ne, test_fail_8
+
+    ldi     rarg1, g_byte                 ; the byte forms wrap at 8 bits
+    ldi     rtmp, 250
+    stb     [rarg1], rtmp
+    ldi     rtmp, 10
+    xaddb   [rarg1], rtmp
+    ldi     rarg2, 250
+    j       rtmp, rarg2, ne, test_fail_9
+    ldi     rarg1, g_byte
+    ldb     rtmp, [rarg1]
+    ldi     rarg2, 4
+    j       rtmp, rarg2, ne, test_fail_10
+
+    ldi     rarg1, g_byte
+    ldi     rres, 4
+    ldi     rtmp, 200
+    casb    [rarg1], rtmp
+    ldi     rarg2, 4
+    j       rres, rarg2, ne, test_fail_11
+    ldi     rarg1, g_byte
+    ldi     rtmp, 17
+    xchgb   [rarg1], rtmp
+    ldi     rarg2, 200
+    j       rtmp, rarg2, ne, test_fail_12
+    ldi     rarg1, g_byte
+    ldb     rtmp, [rarg1]
+    ldi     rarg2, 17
+    j       rtmp, rarg2, ne, test_fail_13
+
+    ldi     rarg1, str_done
+    syscall syscall_print_string
+    ret
+
+test_fail_1:
+    ldi    rarg1, 1
+    jmp    failure
+
+test_fail_2:
+    ldi    rarg1, 2
+    jmp    failure
+
+test_fail_3:
+    ldi    rarg1, 3
+    jmp    failure
+
+test_fail_4:
+    ldi    rarg1, 4
+    jmp    failure
+
+test_fail_5:
+    ldi    rarg1, 5
+    jmp    failure
+
+test_fail_6:
+    ldi    rarg1, 6
+    jmp    failure
+
+test_fail_7:
+    ldi    rarg1, 7
+    jmp    failure
+
+test_fail_8:
+    ldi    rarg1, 8
+    jmp    failure
+
+test_fail_9:
+    ldi    rarg1, 9
+    jmp    failure
+
+test_fail_10:
+    ldi    rarg1, 10
+    jmp    failure
+
+test_fail_11:
+    ldi    rarg1, 11
+    jmp    failure
+
+test_fail_12:
+    ldi    rarg1, 12
+    jmp    failure
+
+test_fail_13:
+    ldi    rarg1, 13
+    jmp    failure
+
+failure:
+    mov    rarg2, rarg1
+    ldi    rarg1, str_failure
+    syscall syscall_print_string
+    mov    rarg1, rarg2
+    syscall syscall_print_integer
+    ldi    rarg1, str_nl
+    syscall syscall_print_string
+
+    syscall syscall_exit
+.codeend
@@ -0,0 +1,197 @@
+; tests the file syscalls 4-8: open, read, write, close, and seek
+; build with oia:    oia fileoi
+; run with oios:     oios fileoi
+; leaves fileoi.txt behind
+
+define syscall_exit           0
+define syscall_print_string   1
+define syscall_print_integer  2
+define syscall_open           4
+define syscall_read           5
+define syscall_write          6
+define syscall_close          7
+define syscall_seek           8
+
+define mode_read              0
+define mode_write             1
+define mode_append            2
+
+.data
+    string  str_name "fileoi.txt"
+    string  str_missing "fileoi_missing.txt"
+    string  str_text "hello, world"
+    string  str_more "!"
+    string  str_done "fileoi done\n"
+    string  str_nl "\n"
+    string  str_failure "fileoi failure in test "
+    image_t g_fd
+    byte    buffer[ 16 ]
+.dataend
+
+.code
+start:
+    ldi     rarg1, str_name
+    ldi     rarg2, mode_write
+    syscall syscall_open
+    ldi     rtmp, -1
+    j       rres, rtmp, eq, test_fail_1
+    st      [g_fd], rres
+
+    ld      rarg1, [g_fd]
+    ldi     rarg2, str_text
+    ldi     rres, 12
+    syscall syscall_write
+    ldi     rtmp, 12
+    j       rres, rtmp, ne, test_fail_2
+
+    ld      rarg1, [g_fd]
+    syscall syscall_close
+    j       rres, rzero, ne, test_fail_3
+
+    ld      rarg1, [g_fd]
+    syscall syscall_close                 ; closing it again is an error
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_4
+
+    ldi     rarg1, str_name
+    ldi     rarg2, mode_append
+    syscall syscall_open
+    st      [g_fd], rres
+    mov     rarg1, rres
+    ldi     rarg2, str_more
+    ldi     rres, 1
+    syscall syscall_write
+    ld      rarg1, [g_fd]
+    syscall syscall_close
+
+    ldi     rarg1, str_name
+    ldi     rarg2, mode_read
+    syscall syscall_open
+    ldi     rtmp, -1
+    j       rres, rtmp, eq, test_fail_5
+    st      [g_fd], rres
+
+    ld      rarg1, [g_fd]                 ; the end of the file is 13 bytes in
+    zero    rarg2
+    ldi     rres, 2
+    syscall syscall_seek
+    ldi     rtmp, 13
+    j       rres, rtmp, ne, test_fail_6
+
+    ld      rarg1, [g_fd]
+    ldi     rarg2, 7
+    zero    rres
+    syscall syscall_seek
+    ldi     rtmp, 7
+    j       rres, rtmp, ne, test_fail_7
+
+    ld      rarg1, [g_fd]                 ; asking for 16 gets the 6 that are left
+    ldi     rarg2, buffer
+    ldi     rres, 16
+    syscall syscall_read
+    ldi     rtmp, 6
+    j       rres, rtmp, ne, test_fail_8
+
+    ldi     rarg1, buffer
+    ldb     rtmp, [rarg1]
+    ldi     rarg2, 119                    ; 'w'
+    j       rtmp, rarg2, ne, test_fail_9
+    ldi     rarg1, buffer
+    ldi     rarg2, 5
+    add     rarg1, rarg2
+    ldb     rtmp, [rarg1]
+    ldi     rarg2, 33                     ; '!'
+    j       rtmp, rarg2, ne, test_fail_10
+
+    ld      rarg1, [g_fd]                 ; at the end of the file a read returns 0
+    ldi     rarg2, buffer
+    ldi     rres, 16
+    syscall syscall_read
+    j       rres, rzero, ne, test_fail_11
+
+    ld      rarg1, [g_fd]
+    syscall syscall_close
+    j       rres, rzero, ne, test_fail_12
+
+    ldi     rarg1, str_missing
+    ldi     rarg2, mode_read
+    syscall syscall_open
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_13
+
+    ldi     rarg1, 1                      ; fd 1 is the console
+    ldi     rarg2, str_done
+    ldi     rres, 12
+    syscall syscall_write
+    ldi     rtmp, 12
+    j       rres, rtmp, ne, test_fail_14
+
+    ret
+
+test_fail_1:
+    ldi    rarg1, 1
+    jmp    failure
+
+test_fail_2:
+    ldi    rarg1, 2
+    jmp    failure
+
+test_fail_3:
+    ldi    rarg1, 3
+    jmp    failure
+
+test_fail_4:
+    ldi    rarg1, 4
+    jmp    failure
+
+test_fail_5:
+    ldi    rarg1, 5
+    jmp    failure
+
+test_fail_6:
+    ldi    rarg1, 6
+    jmp    failure
+
+test_fail_7:
+    ldi    rarg1, 7
+    jmp    failure
+
+test_fail_8:
+    ldi    rarg1, 8
+    jmp    failure
+
+test_fail_9:
+    ldi    rarg1, 9
+    jmp    failure
+
+test_fail_10:
+    ldi    rarg1, 10
+    jmp    failure
+
+test_fail_11:
+    ldi    rarg1, 11
+    jmp    failure
+
+test_fail_12:
+    ldi    rarg1, 12
+    jmp    failure
+
+test_fail_13:
+    ldi    rarg1, 13
+    jmp    failure
+
+test_fail_14:
+    ldi    rarg1, 14
+    jmp    failure
+
+failure:
+    mov    rarg2, rarg1
+    ldi    rarg1, str_failure
+    syscall syscall_print_string
+    mov    rarg1, rarg2
+    syscall syscall_print_integer
+    ldi    rarg1, str_nl
+    syscall syscall_print_string
+
+    syscall syscall_exit
+.codeend
@@ -0,0 +1,38 @@
+; tests oios -g: a load, or with any argument a store, far outside guest RAM
+; build with oia:    oia -w:8 guardoi
+; run with oios:     oios -g guardoi [store]
+; oios reports the faulting instruction's address and disassembly, which runall compares to a baseline
+
+define syscall_exit           0
+define syscall_print_string   1
+
+define far_address 360000000
+
+.data
+    string  str_load "guardoi load\n"
+    string  str_store "guardoi store\n"
+.dataend
+
+.code
+start:
+    ldf     rtmp, 0
+    ldi     rarg1, far_address
+    ldi     rarg2, 1
+    j       rtmp, rarg2, ne, _store
+
+    push    rarg1
+    ldi     rarg1, str_load
+    syscall syscall_print_string
+    pop     rarg1
+    ld      rres, [rarg1]
+    syscall syscall_exit
+
+  _store:
+    push    rarg1
+    ldi     rarg1, str_store
+    syscall syscall_print_string
+    pop     rarg1
+    st      [rarg1], rtmp
+    syscall syscall_exit
+.codeend
+
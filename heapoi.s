@@ -0,0 +1,236 @@
+; tests the heap syscalls 14-18: brk, sbrk, malloc, free, and realloc
+; build with oia:    oia heapoi
+; run with oios:     oios heapoi
+
+define syscall_exit           0
+define syscall_print_string   1
+define syscall_print_integer  2
+define syscall_brk            14
+define syscall_sbrk           15
+define syscall_malloc         16
+define syscall_free           17
+define syscall_realloc        18
+
+.data
+    string  str_done "heapoi done\n"
+    string  str_nl "\n"
+    string  str_failure "heapoi failure in test "
+    image_t g_a
+    image_t g_b
+    image_t g_c
+    image_t g_brk
+.dataend
+
+.code
+start:
+    ldi     rarg1, 100                    ; a small block is reused once freed
+    syscall syscall_malloc
+    j       rres, rzero, eq, test_fail_1
+    st      [g_a], rres
+    ldi     rtmp, 12345
+    st      [rres], rtmp
+    ldi     rarg1, 100
+    syscall syscall_malloc
+    j       rres, rzero, eq, test_fail_2
+    st      [g_b], rres
+    ld      rtmp, [g_a]
+    j       rres, rtmp, eq, test_fail_2
+
+    ld      rarg1, [g_a]                  ; realloc keeps the contents
+    ldi     rarg2, 5000
+    syscall syscall_realloc
+    j       rres, rzero, eq, test_fail_3
+    st      [g_c], rres
+    ld      rtmp, [rres]
+    ldi     rarg1, 12345
+    j       rtmp, rarg1, ne, test_fail_3
+
+    ld      rarg1, [g_a]                  ; realloc freed the old block
+    syscall syscall_free
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_4
+
+    ld      rarg1, [g_b]
+    syscall syscall_free
+    j       rres, rzero, ne, test_fail_5
+    ld      rarg1, [g_b]                  ; a double free is an error
+    syscall syscall_free
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_6
+
+    ld      rarg1, [g_c]                  ; and so is freeing inside a block
+    inc     rarg1
+    syscall syscall_free
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_7
+
+    ld      rarg1, [g_c]
+    syscall syscall_free
+    j       rres, rzero, ne, test_fail_8
+    ld      rarg1, [g_c]
+    syscall syscall_free
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_9
+
+    zero    rarg1                         ; free( 0 ) does nothing
+    syscall syscall_free
+    j       rres, rzero, ne, test_fail_10
+
+    ldi     rarg1, 9000                   ; three adjacent large blocks
+    syscall syscall_malloc
+    j       rres, rzero, eq, test_fail_11
+    st      [g_a], rres
+    ldi     rarg1, 9000
+    syscall syscall_malloc
+    j       rres, rzero, eq, test_fail_11
+    st      [g_b], rres
+    ldi     rarg1, 9000
+    syscall syscall_malloc
+    j       rres, rzero, eq, test_fail_11
+    st      [g_c], rres
+    ldi     rarg1, 16                     ; keeps the runs away from the break
+    syscall syscall_malloc
+
+    ld      rarg1, [g_a]                  ; freed out of order, they coalesce into one run
+    syscall syscall_free
+    ld      rarg1, [g_c]
+    syscall syscall_free
+    ld      rarg1, [g_b]
+    syscall syscall_free
+    zero    rarg1                         ; so a block of all three fits without moving the break
+    syscall syscall_brk
+    st      [g_brk], rres
+    ldi     rarg1, 27000
+    syscall syscall_malloc
+    j       rres, rzero, eq, test_fail_12
+    mov     rarg1, rres
+    syscall syscall_free
+    zero    rarg1
+    syscall syscall_brk
+    ld      rtmp, [g_brk]
+    j       rres, rtmp, ne, test_fail_12
+
+    ldi     rtmp, 2000                    ; churn shouldn't leak
+    st      [g_c], rtmp
+  _churn:
+    ldi     rarg1, 9000
+    syscall syscall_malloc
+    j       rres, rzero, eq, test_fail_13
+    mov     rarg1, rres
+    syscall syscall_free
+    ldi     rarg1, 40
+    syscall syscall_malloc
+    j       rres, rzero, eq, test_fail_13
+    mov     rarg1, rres
+    syscall syscall_free
+    ld      rtmp, [g_c]
+    dec     rtmp
+    st      [g_c], rtmp
+    j       rtmp, rzero, ne, _churn
+
+    zero    rarg1                         ; sbrk returns the old break and brk( 0 ) the new one
+    syscall syscall_brk
+    st      [g_brk], rres
+    ldi     rarg1, 256
+    syscall syscall_sbrk
+    ld      rtmp, [g_brk]
+    j       rres, rtmp, ne, test_fail_14
+    zero    rarg1
+    syscall syscall_brk
+    ld      rtmp, [g_brk]
+    sub     rres, rtmp
+    ldi     rtmp, 256
+    j       rres, rtmp, ne, test_fail_15
+
+    ld      rarg1, [g_brk]                ; the break can't go below the allocator's spans
+    syscall syscall_brk
+    ldi     rtmp, -1
+    j       rres, rtmp, eq, test_fail_16
+    ldi     rarg1, 16
+    syscall syscall_brk
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_17
+
+    ldi     rarg1, str_done
+    syscall syscall_print_string
+    ret
+
+test_fail_1:
+    ldi    rarg1, 1
+    jmp    failure
+
+test_fail_2:
+    ldi    rarg1, 2
+    jmp    failure
+
+test_fail_3:
+    ldi    rarg1, 3
+    jmp    failure
+
+test_fail_4:
+    ldi    rarg1, 4
+    jmp    failure
+
+test_fail_5:
+    ldi    rarg1, 5
+    jmp    failure
+
+test_fail_6:
+    ldi    rarg1, 6
+    jmp    failure
+
+test_fail_7:
+    ldi    rarg1, 7
+    jmp    failure
+
+test_fail_8:
+    ldi    rarg1, 8
+    jmp    failure
+
+test_fail_9:
+    ldi    rarg1, 9
+    jmp    failure
+
+test_fail_10:
+    ldi    rarg1, 10
+    jmp    failure
+
+test_fail_11:
+    ldi    rarg1, 11
+    jmp    failure
+
+test_fail_12:
+    ldi    rarg1, 12
+    jmp    failure
+
+test_fail_13:
+    ldi    rarg1, 13
+    jmp    failure
+
+test_fail_14:
+    ldi    rarg1, 14
+    jmp    failure
+
+test_fail_15:
+    ldi    rarg1, 15
+    jmp    failure
+
+test_fail_16:
+    ldi    rarg1, 16
+    jmp    failure
+
+test_fail_17:
+    ldi    rarg1, 17
+    jmp    failure
+
+failure:
+    mov    rarg2, rarg1
+    ldi    rarg1, str_failure
+    syscall syscall_print_string
+    mov    rarg1, rarg2
+    syscall syscall_print_integer
+    ldi    rarg1, str_nl
+    syscall syscall_print_string
+
+    syscall syscall_exit
+.codeend
@@ -0,0 +1,182 @@
+; tests the file mapping syscalls 9 and 10. only 8-byte images have room for mappings; the others get -1
+; build with oia:    oia -w:8 mapoi
+; run with oios:     oios mapoi
+; leaves mapoi.txt behind
+
+define syscall_exit           0
+define syscall_print_string   1
+define syscall_print_integer  2
+define syscall_open           4
+define syscall_write          6
+define syscall_close          7
+define syscall_map            9
+define syscall_unmap          10
+
+define mode_read              0
+define mode_write             1
+define map_read               0
+define map_private_write      1
+
+.data
+    string  str_name "mapoi.txt"
+    string  str_text "hello, world"
+    string  str_done "mapoi done\n"
+    string  str_nl "\n"
+    string  str_failure "mapoi failure in test "
+    image_t g_fd
+    image_t g_map
+    image_t g_map2
+.dataend
+
+.code
+start:
+    ldi     rarg1, str_name
+    ldi     rarg2, mode_write
+    syscall syscall_open
+    ldi     rtmp, -1
+    j       rres, rtmp, eq, test_fail_1
+    st      [g_fd], rres
+    mov     rarg1, rres
+    ldi     rarg2, str_text
+    ldi     rres, 12
+    syscall syscall_write
+    ld      rarg1, [g_fd]
+    syscall syscall_close
+
+    ldi     rarg1, str_name               ; mmap needs a file that's open for reading
+    ldi     rarg2, mode_read
+    syscall syscall_open
+    ldi     rtmp, -1
+    j       rres, rtmp, eq, test_fail_1
+    st      [g_fd], rres
+
+    ld      rarg1, [g_fd]                 ; the whole file, read-only
+    zero    rarg2
+    zero    rres
+    ldi     rtmp, map_read
+    syscall syscall_map
+    st      [g_map], rres
+
+    zero    rtmp
+    addimgw rtmp
+    ldi     rarg1, 8
+    j       rtmp, rarg1, eq, _mapped
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_2
+    jmp     _done
+
+  _mapped:
+    ldi     rtmp, -1
+    j       rres, rtmp, eq, test_fail_3
+    ldb     rtmp, [rres]
+    ldi     rarg2, 104                    ; 'h'
+    j       rtmp, rarg2, ne, test_fail_4
+
+    ld      rarg1, [g_fd]                 ; 5 bytes from an unaligned offset, writable but private
+    ldi     rarg2, 7
+    ldi     rres, 5
+    ldi     rtmp, map_private_write
+    syscall syscall_map
+    ldi     rtmp, -1
+    j       rres, rtmp, eq, test_fail_5
+    st      [g_map2], rres
+    ldb     rtmp, [rres]
+    ldi     rarg2, 119                    ; 'w'
+    j       rtmp, rarg2, ne, test_fail_6
+    ldi     rtmp, 87                      ; 'W'
+    stb     [rres], rtmp
+    ldb     rtmp, [rres]
+    ldi     rarg2, 87
+    j       rtmp, rarg2, ne, test_fail_7
+    ld      rarg1, [g_map]                ; the other mapping doesn't see the private write
+    ldi     rtmp, 7
+    add     rarg1, rtmp
+    ldb     rtmp, [rarg1]
+    ldi     rarg2, 119
+    j       rtmp, rarg2, ne, test_fail_8
+
+    ld      rarg1, [g_map2]
+    syscall syscall_unmap
+    j       rres, rzero, ne, test_fail_9
+    ld      rarg1, [g_map]
+    syscall syscall_unmap
+    j       rres, rzero, ne, test_fail_10
+    ld      rarg1, [g_map]                ; unmapping twice is an error
+    syscall syscall_unmap
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_11
+
+    ldi     rarg1, 1                      ; the console can't be mapped
+    zero    rarg2
+    zero    rres
+    ldi     rtmp, map_read
+    syscall syscall_map
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_12
+
+  _done:
+    ld      rarg1, [g_fd]
+    syscall syscall_close
+    ldi     rarg1, str_done
+    syscall syscall_print_string
+    ret
+
+test_fail_1:
+    ldi    rarg1, 1
+    jmp    failure
+
+test_fail_2:
+    ldi    rarg1, 2
+    jmp    failure
+
+test_fail_3:
+    ldi    rarg1, 3
+    jmp    failure
+
+test_fail_4:
+    ldi    rarg1, 4
+    jmp    failure
+
+test_fail_5:
+    ldi    rarg1, 5
+    jmp    failure
+
+test_fail_6:
+    ldi    rarg1, 6
+    jmp    failure
+
+test_fail_7:
+    ldi    rarg1, 7
+    jmp    failure
+
+test_fail_8:
+    ldi    rarg1, 8
+    jmp    failure
+
+test_fail_9:
+    ldi    rarg1, 9
+    jmp    failure
+
+test_fail_10:
+    ldi    rarg1, 10
+    jmp    failure
+
+test_fail_11:
+    ldi    rarg1, 11
+    jmp    failure
+
+test_fail_12:
+    ldi    rarg1, 12
+    jmp    failure
+
+failure:
+    mov    rarg2, rarg1
+    ldi    rarg1, str_failure
+    syscall syscall_print_string
+    mov    rarg1, rarg2
+    syscall syscall_print_integer
+    ldi    rarg1, str_nl
+    syscall syscall_print_string
+
+    syscall syscall_exit
+.codeend
@@ -10,3 +10,5 @@ if [[ "$OS" != 'darwin' ]]; then
 fi
 
 g++ -Wno-deprecated -ggdb -Ofast -fno-builtin -D FORCETRACING -D NDEBUG -I . oia.c oidis.c -o oia $staticflag
+g++ -Wno-deprecated -ggdb -Ofast -fno-builtin -D FORCETRACING -D NDEBUG -I . oi2c.c oidis.c -o oi2c $staticflag
+g++ -Wno-deprecated -ggdb -Ofast -fno-builtin -D NDEBUG -I . oib.c -o oib $staticflag
@@ -0,0 +1,3 @@
+@echo off
+cl /W4 /wd4206 /wd4127 /wd4702 /wd4996 /nologo /jumptablerdata /I. /EHsc /DOI8 /DOI_MULTIWIDTH /DNDEBUG /GS- /GL /Ot /Ox /Ob3 /Oi /Qpar /Zi /Fa /FAsc oios.c oi.c trace.c oidis.c /Feoios.exe /link /OPT:REF user32.lib
+
@@ -4,4 +4,4 @@ if [[ "$OS" != 'darwin' ]]; then
     staticflag=-static
 fi
 
-g++ -Wno-tautological-constant-out-of-range-compare -Wno-deprecated -Wno-return-type -ggdb -Ofast -fno-builtin -D OI2 -D NDEBUG -I . oios.c oi.c trace.c oidis.c -o oios2 $staticflag
+g++ -Wno-tautological-constant-out-of-range-compare -Wno-deprecated -Wno-return-type -ggdb -Ofast -fno-builtin -D OI2 -D NDEBUG -I . oios.c oi.c trace.c oidis.c -o oios2 -pthread $staticflag
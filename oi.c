@@ -141,6 +141,10 @@
                    - 1 funct: ld r0dst, [r1src]
                    - 2 funct: pushtwo  r0, r1
                    - 3 funct: poptwo   r0, r1
+                   - 4 funct: cas [r0], r1      atomic: if [r0] == rres then [r0] = r1. rres = the old [r0]
+                   - 5 funct: xadd [r0], r1     atomic: [r0] += r1. r1 = the old [r0]
+                   - 6 funct: xchg [r0], r1     atomic: swap [r0] and r1
+                   - 7 funct: fence             full memory barrier. r0, r1, and the width are ignored
                 6: mov r0dst, r1src.   unconditional. in addition to cmov for faster perf
                    exceptions:      overridden
                      c1 UNUSED     -- mov rzero, ...
@@ -224,6 +228,22 @@
         - With the 8-bit compilers I can only get OI2 builds to work
         - With the 16-bit compilers only OI2 and OI4 work.
         - With 32-bit and 64-bit compilers all widths work.
+        - gcc and clang release builds dispatch with computed goto. Define OI_NO_THREADED to use the switch loop.
+        - gcc and clang release builds also have a decode cache (OI_PREDECODE). The host enables it with
+          EnableDecodeCacheOI() once the image is loaded. Define OI_NO_PREDECODE to leave it out.
+          Common instruction pairs run as superinstructions. EnableProfileOI() turns them off and counts the
+          instructions, pairs, and triples that run instead; ShowProfileOI() prints them (oios -s).
+        - Define OI_MULTIWIDTH with OI8 to build one engine per image width from oiengine.h (see mr.sh).
+          Each runs 2, 4, or 8 byte images with the width as a constant instead of checking it per instruction.
+        - OI8 release builds with gcc or clang on x86-64 (but not Windows) have a JIT (OI_JIT) that compiles hot
+          functions and loops to native code. The host enables it with EnableJitOI(). Define OI_NO_JIT to leave it out.
+        - gcc and clang builds keep guest state in thread-local globals and have OIContext (OI_CONTEXT) so a host
+          can run a guest per thread. Define OI_NO_CONTEXT to leave it out.
+        - gcc and clang builds on unix-like systems reserve guest RAM with mmap (OI_MMAP) sized from the image
+          header instead of using a static array. Define OI_NO_MMAP to leave it out.
+        - gcc and clang builds have a cache and branch predictor simulator (OI_SIM). The host enables it with
+          EnableSimOI(), runs ExecuteSimOI() in place of ExecuteOI(), and prints the results with ShowSimOI()
+          (oios -sim). Define OI_NO_SIM to leave it out.
 */
 
 #include <stdio.h>
@@ -241,12 +261,36 @@
 #include "oi.h"
 #include "trace.h"
 
+#ifdef OI_PREDECODE
+#include <stdlib.h>
+#endif /* OI_PREDECODE */
+
+#ifdef OI_CONTEXT
+#include <stdlib.h>
+#endif /* OI_CONTEXT */
+
+#ifdef OI_SIM
+#include <stdlib.h>
+#endif /* OI_SIM */
+
+#ifdef OI_JIT
+#include <sys/mman.h>
+#else
+#ifdef OI_MMAP
+#include <sys/mman.h>
+#endif /* OI_MMAP */
+#endif /* OI_JIT */
+
+#ifdef OI_MMAP
+#include <signal.h>
+#endif /* OI_MMAP */
+
 #define true 1
 #define false 0
 
 #define OI_FLAG_TRACE_INSTRUCTIONS 1
 
-struct OneImage g_oi;
+oi_tls struct OneImage g_oi;
 
 #ifdef OLDCPU /* CP/M machines with 64k or less total ram */
 static uint8_t ram[ 32767 ];
@@ -257,12 +301,29 @@ static uint8_t ram[ 60000 ];
 #ifdef WATCOM
 static uint8_t ram[ 60000 ];
 #else /* WATCOM */
+#ifdef OI_MMAP
+static oi_tls uint8_t * ram = 0;            /* mapped by ReserveRamOI() */
+static oi_tls uint64_t g_ram_size = 0;      /* bytes mapped at ram */
+static oi_tls uint8_t * g_ram_base = 0;     /* start of the reservation that holds ram */
+static oi_tls uint64_t g_ram_reserved = 0;  /* bytes reserved for ram including any guard regions */
+static oi_tls uint8_t * g_code_lo = 0;      /* pages in [g_code_lo, g_code_hi) hold only code mapped by MapCodeOI() */
+static oi_tls uint8_t * g_code_hi = 0;
+static oi_tls bool g_ram_fresh = false;     /* true until ResetOI() runs on RAM the kernel just zero-filled */
+static oi_tls uint8_t * g_dirty = 0;        /* TrackDirtyPagesOI() bit per page from the page holding ram[ 0 ] */
+static oi_tls uint64_t g_map_size = 0;      /* bytes at the end of the reservation for MapFileOI() */
+#else
+#ifdef OI_CONTEXT
+static uint8_t g_ram[ 8 * 1024 * 1024 ]; /* arbitrary. used by threads that don't select a context */
+static oi_tls uint8_t * ram = g_ram;
+#else
 static uint8_t ram[ 8 * 1024 * 1024 ]; /* arbitrary */
+#endif /* OI_CONTEXT */
+#endif /* OI_MMAP */
 #endif /* WATCOM */
 #endif /* OLDCPU */
 
 #ifndef NDEBUG
-static uint8_t g_OIState = 0;
+static oi_tls uint8_t g_OIState = 0;
 #ifdef OLDCPU
 void TraceInstructionsOI( t ) bool t;
 #else
@@ -291,6 +352,8 @@ void TraceInstructionsOI( bool t )
 #define IMAGE_WIDTH g_oi.image_width
 #endif
 
+#define IMAGE_SHIFT g_oi.image_shift
+
 #define get_byte( address ) ( access_ram( address ) )
 #define set_byte( address, val ) ( access_ram( address ) = val )
 
@@ -329,6 +392,49 @@ void TraceInstructionsOI( bool t )
 #define inc_reg_from_op( op ) ( ( * get_preg_from_op( op ) )++ )
 #define dec_reg_from_op( op ) ( ( * get_preg_from_op( op ) )-- )
 
+/* memf, stadd, and fzero work on a range of guest memory. the cache simulator's copy of the engine sees the range */
+
+#define ram_range( address ) ram_address( address )
+#define sim_range( p, length, write )
+
+/* cas, xadd, and xchg are atomic with respect to other guest threads. without gcc there's only one thread */
+
+#ifdef __GNUC__
+#define atomic_cas( p, expected, value ) { __atomic_compare_exchange_n( p, & expected, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ); }
+#define atomic_xadd( p, value, old ) { old = __atomic_fetch_add( p, value, __ATOMIC_SEQ_CST ); }
+#define atomic_xchg( p, value, old ) { old = __atomic_exchange_n( p, value, __ATOMIC_SEQ_CST ); }
+#define atomic_fence() __atomic_thread_fence( __ATOMIC_SEQ_CST )
+#else
+#define atomic_cas( p, expected, value ) { if ( * ( p ) == expected ) * ( p ) = value; else expected = * ( p ); }
+#define atomic_xadd( p, value, old ) { old = * ( p ); * ( p ) = old + value; }
+#define atomic_xchg( p, value, old ) { old = * ( p ); * ( p ) = value; }
+#define atomic_fence()
+#endif /* __GNUC__ */
+
+/* cas leaves the old value in rres, xadd and xchg leave it in r1. the block declares p, value, and old for the width */
+
+#define atomic_op( type, funct, address, preg1 ) \
+{ \
+    type * p, value, old; \
+    p = (type *) ram_address( address ); \
+    value = (type) * ( preg1 ); \
+    if ( 4 == funct ) \
+    { \
+        old = (type) g_oi.rres; \
+        atomic_cas( p, old, value ) \
+        g_oi.rres = (oi_t) old; \
+    } \
+    else \
+    { \
+        if ( 5 == funct ) \
+            atomic_xadd( p, value, old ) \
+        else \
+            atomic_xchg( p, value, old ) \
+        if ( ( preg1 ) != & g_oi.rzero ) \
+            * ( preg1 ) = (oi_t) old; \
+    } \
+}
+
 #define get_op() ( get_byte( g_oi.rpc ) )
 #define get_op1() ( get_byte( g_oi.rpc + 1 ) )
 #define get_op2() ( get_byte( g_oi.rpc + 2 ) )
@@ -391,8 +497,16 @@ void set_imgqword( oi_t address, oi_t value )
 } /* set_imgqword */
 #endif /* OI8 */
 
-t_pget_imgword * pget_imgword;
-t_pset_imgword * pset_imgword;
+oi_tls t_pget_imgword * pget_imgword;
+oi_tls t_pset_imgword * pset_imgword;
+
+#ifdef OI_MULTIWIDTH
+typedef uint32_t t_pexecute_oi( void );
+uint32_t ExecuteOI_w2( void );
+uint32_t ExecuteOI_w4( void );
+uint32_t ExecuteOI_w8( void );
+oi_tls t_pexecute_oi * pexecute_oi;
+#endif /* OI_MULTIWIDTH */
 
 #ifdef OI2
 #define if_1_is_width
@@ -410,6 +524,292 @@ t_pset_imgword * pset_imgword;
 #define if_2_is_width if ( 2 == width )
 #endif /* OI4 */
 
+#ifdef OI_CONTEXT
+
+/*  Contexts. A guest's registers, RAM, and decode cache are thread-local globals, so each thread can run its own
+    guest. An OIContext owns one guest's registers and RAM. OISelect() makes it the guest of the calling thread:
+    the previous context's state is saved in it and the new one's is loaded, so ResetOI(), ExecuteOI(), and the
+    rest then act on that context. Threads that never select a context use the static RAM. The JIT and profiling
+    settings are still one per process. With OI_MMAP a context's RAM is reserved when its image is loaded,
+    and selecting a context releases the RAM of a guest the thread ran without one.
+
+    OIThread() makes a context for a guest thread. It shares the RAM of the calling thread's guest but has its
+    own registers and decode cache.
+*/
+
+struct OIContext
+{
+    struct OneImage oi;
+    uint8_t * ram;
+    uint64_t ram_size;
+#ifdef OI_MMAP
+    uint8_t * ram_base;
+    uint64_t ram_reserved;
+    uint8_t * code_lo;
+    uint8_t * code_hi;
+    bool ram_fresh;
+    uint64_t map_size;
+#endif /* OI_MMAP */
+    t_pget_imgword * pget_imgword;
+    t_pset_imgword * pset_imgword;
+#ifdef OI_MULTIWIDTH
+    t_pexecute_oi * pexecute_oi;
+#endif /* OI_MULTIWIDTH */
+#ifdef OI_PREDECODE
+    struct OIDecoded * pdecoded;
+    oi_t code_limit;
+    struct OneImage * decoded_for;  /* the g_oi of the thread whose register addresses are in pdecoded */
+    uint64_t retired;
+#endif /* OI_PREDECODE */
+    bool thread;                    /* the RAM belongs to the guest that called OIThread() */
+};
+
+static oi_tls struct OIContext * g_context = 0;
+
+#endif /* OI_CONTEXT */
+
+#ifdef OI_MMAP
+
+/*  Guest RAM is an anonymous mapping sized from the image header, so OI8 images can have more than the old 8MB
+    and a small image only pays for the pages it touches. The kernel zero-fills the pages, so ResetOI() skips
+    the memset on freshly mapped RAM. At least OI_MIN_RAM is reserved (but not committed) so images built for
+    the static array see the same top of stack. EnableHugePagesOI() hints that reservations of OI_HUGE_RAM or
+    more should get transparent huge pages.
+
+    After EnableGuardPagesOI() the RAM is bracketed by inaccessible guard regions of OI_GUARD_SIZE bytes. For 4
+    and 8-byte images the upper one runs to at least the end of the first 4GB of guest addresses. A load or store
+    outside the RAM then faults instead of reading or corrupting memory, and FaultOI() reports the guest pc. To
+    keep g_oi.rpc exact the decode cache runs every record through h_guard, which stores the record's pc, and
+    leaves off superinstructions and the JIT. -r writes to the code are reported the same way. The
+    RAM is still at least OI_MIN_RAM (64k for 2-byte images, which can't address more) so the heap between the
+    data and the stack has the same room as without guard pages. Accesses past what the image needs but
+    within that size don't fault, as oios -g's usage says.
+
+    For 8-byte images the reservation ends with OI_MAP_SPACE bytes of inaccessible address space past the RAM and
+    any upper guard region, where MapFileOI() maps host files. It's clear of the data, the heap, and the stack
+    at the top of RAM, and the kernel doesn't commit any of it.
+*/
+
+#define OI_MIN_RAM ( (uint64_t) 8 * 1024 * 1024 )
+#define OI_HUGE_RAM ( (uint64_t) 64 * 1024 * 1024 )
+#define OI_PAGE_SIZE ( (uint64_t) 4096 )
+#define OI_GUARD_SIZE ( (uint64_t) 1024 * 1024 )
+#define OI_MAP_SPACE ( (uint64_t) 64 * 1024 * 1024 * 1024 )
+
+static void InstallFaultHandlerOI( void );
+
+static bool g_huge_pages = false;
+static bool g_guard_pages = false;
+static bool g_fault_pc = false;           /* decoded records keep g_oi.rpc current for FaultOI() */
+static bool g_shared_code = false;
+static bool g_code_read_only = false;
+
+void EnableHugePagesOI()
+{
+    g_huge_pages = true;
+} /* EnableHugePagesOI */
+
+static void ReleaseRamOI()
+{
+    if ( 0 != ram )
+        munmap( g_ram_base, (size_t) g_ram_reserved );
+    ram = 0;
+    g_ram_size = 0;
+    g_ram_base = 0;
+    g_ram_reserved = 0;
+    g_code_lo = 0;
+    g_code_hi = 0;
+    g_ram_fresh = false;
+    free( g_dirty );
+    g_dirty = 0;
+    g_map_size = 0;
+} /* ReleaseRamOI */
+
+/* replaces the calling thread's guest RAM with a new zeroed mapping. returns the bytes the image can use or 0 */
+
+uint64_t ReserveRamOI( uint64_t required, uint8_t ** ppRam, uint8_t imageWidth )
+{
+    uint64_t size, low, high, map, reserved, available;
+    uint8_t * p;
+    int protection;
+
+    * ppRam = 0;
+    size = ( g_guard_pages && ( 2 == imageWidth ) ) ? 65536 : OI_MIN_RAM;
+    if ( size < required )
+        size = required;
+    size = ( size + OI_PAGE_SIZE - 1 ) & ~ ( OI_PAGE_SIZE - 1 );
+
+    low = 0;
+    high = 0;
+    protection = PROT_READ | PROT_WRITE;
+    if ( g_guard_pages )
+    {
+        low = OI_GUARD_SIZE;
+        high = OI_GUARD_SIZE;
+        if ( ( 2 != imageWidth ) && ( size < 0x100000000 ) )
+            high += 0x100000000 - size;
+        protection = PROT_NONE;
+    }
+
+    /* MapCodeOI() moves ram down into this page to line the code up with its offset in the image file */
+    if ( g_shared_code )
+        low += OI_PAGE_SIZE;
+
+    map = 0;
+    if ( ( 8 == imageWidth ) && ( sizeof( size_t ) >= 8 ) )
+    {
+        map = OI_MAP_SPACE;
+        protection = PROT_NONE;
+    }
+
+    reserved = low + size + high + map;
+
+    if ( (uint64_t) (size_t) reserved != reserved )
+        return 0;
+
+    ReleaseRamOI();
+
+#ifdef MAP_NORESERVE
+    p = (uint8_t *) mmap( 0, (size_t) reserved, protection, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+#else
+    p = (uint8_t *) mmap( 0, (size_t) reserved, protection, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+#endif
+    if ( (uint8_t *) MAP_FAILED == p )
+        return 0;
+
+    /* without guard pages, everything below the map space is accessible */
+    if ( ( PROT_NONE == protection ) &&
+         ( 0 != mprotect( g_guard_pages ? p + low : p, (size_t) ( g_guard_pages ? size : low + size ), PROT_READ | PROT_WRITE ) ) )
+    {
+        munmap( p, (size_t) reserved );
+        return 0;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if ( g_huge_pages && ( size >= OI_HUGE_RAM ) )
+        madvise( p + low, (size_t) size, MADV_HUGEPAGE );
+#endif
+
+    g_ram_base = p;
+    ram = p + low;
+    g_ram_size = size;
+    g_ram_reserved = reserved;
+    g_ram_fresh = true;
+    g_map_size = map;
+
+    /* addresses wrap at the image width, so the rest of a larger mapping is just slack */
+    available = size;
+    if ( ( 2 == imageWidth ) && ( available > 65536 ) )
+        available = 65536;
+    else if ( ( 4 == imageWidth ) && ( available > 0xffffffff ) )
+        available = 0xffffffff;
+
+    if ( available >= required )
+        * ppRam = ram;
+    return available;
+} /* ReserveRamOI */
+
+/*  Shared code. After EnableSharedCodeOI() the host calls MapCodeOI() instead of reading the code and initialized
+    data into RAM. They're mapped copy-on-write from the image file, so every guest running the same image shares
+    the page cache's physical pages until it writes one. Pages that hold only code are also write-protected.
+    A write to one of them either unshares that page (a private copy is made and the write goes ahead) or, if
+    the code is read-only, stops the app with a report like the guard page one. Version 2 images have the code
+    at a page-aligned offset, so they're always mapped, without moving ram.
+*/
+
+/*  after ReserveRamOI(), maps code_size bytes of code and then data_size bytes of initialized data from offset in
+    the file fd to address 0 of guest RAM. ram moves by less than a page, so * ppRam is updated. returns false on
+    failure, in which case RAM is unchanged and the caller can read the image instead.
+*/
+
+bool MapCodeOI( int fd, uint64_t offset, uint64_t code_size, uint64_t data_size, uint8_t ** ppRam )
+{
+    uint64_t delta, length;
+    uint8_t * p, * new_ram;
+
+    /* the page offset of the code in the file has to match the page offset of ram. if it doesn't, ram moves down
+       into the page ReserveRamOI() reserves below it for shared code */
+    delta = offset % OI_PAGE_SIZE;
+    if ( ( 0 == ram ) || ( code_size + data_size > g_ram_size ) || ( ( 0 != delta ) && !g_shared_code ) )
+        return false;
+
+    p = ( 0 == delta ) ? ram : ram - OI_PAGE_SIZE;
+    new_ram = p + delta;
+    length = ( delta + code_size + data_size + OI_PAGE_SIZE - 1 ) & ~ ( OI_PAGE_SIZE - 1 );
+
+    if ( (uint8_t *) MAP_FAILED == (uint8_t *) mmap( p, (size_t) length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                                                     fd, (off_t) ( offset - delta ) ) )
+        return false;
+
+    /* the page with the end of the code usually has the start of the data too, so it stays writable */
+    g_code_lo = p;
+    g_code_hi = p + ( ( delta + code_size ) & ~ ( OI_PAGE_SIZE - 1 ) );
+    if ( g_code_hi > g_code_lo )
+    {
+        InstallFaultHandlerOI();
+        mprotect( g_code_lo, (size_t) ( g_code_hi - g_code_lo ), PROT_READ );
+    }
+
+    ram = new_ram;
+    * ppRam = ram;
+    return true;
+} /* MapCodeOI */
+
+/* sets the guest address and length of the space for file mappings. returns false if there is none */
+
+bool MapSpaceOI( uint64_t * paddress, uint64_t * plength )
+{
+    if ( 0 == g_map_size )
+        return false;
+
+    * paddress = (uint64_t) ( g_ram_base + g_ram_reserved - g_map_size - ram );
+    * plength = g_map_size;
+    return true;
+} /* MapSpaceOI */
+
+/* true if [address, address + length) is page-aligned and in the map space */
+
+static bool InMapSpaceOI( uint64_t address, uint64_t length )
+{
+    uint8_t * p;
+
+    p = ram + address;
+    return ( 0 != g_map_size ) && ( 0 != length ) && ( 0 == ( (uint64_t) p % OI_PAGE_SIZE ) ) && ( 0 == ( length % OI_PAGE_SIZE ) ) &&
+           ( p >= g_ram_base + g_ram_reserved - g_map_size ) && ( length <= (uint64_t) ( g_ram_base + g_ram_reserved - p ) );
+} /* InMapSpaceOI */
+
+/*  maps length bytes of file fd from offset to guest address, which the host picks from the space MapSpaceOI()
+    returns. offset, address, and length are page-aligned. the pages are read-only or, if writable, copy-on-write.
+*/
+
+bool MapFileOI( int fd, uint64_t offset, uint64_t address, uint64_t length, bool writable )
+{
+    if ( !InMapSpaceOI( address, length ) || ( 0 != ( offset % OI_PAGE_SIZE ) ) )
+        return false;
+
+    if ( (uint8_t *) MAP_FAILED != (uint8_t *) mmap( ram + address, (size_t) length, writable ? ( PROT_READ | PROT_WRITE ) : PROT_READ,
+                                                     MAP_PRIVATE | MAP_FIXED, fd, (off_t) offset ) )
+        return true;
+
+    /* a failed fixed mapping can leave a hole, so reserve the range again */
+    UnmapFileOI( address, length );
+    return false;
+} /* MapFileOI */
+
+void UnmapFileOI( uint64_t address, uint64_t length )
+{
+    if ( !InMapSpaceOI( address, length ) )
+        return;
+
+#ifdef MAP_NORESERVE
+    mmap( ram + address, (size_t) length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0 );
+#else
+    mmap( ram + address, (size_t) length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0 );
+#endif
+} /* UnmapFileOI */
+
+#endif /* OI_MMAP */
+
 #ifdef OLDCPU
 void ResetOI( memSize, pc, sp, imageWidth ) oi_t memSize; oi_t pc; oi_t sp; uint8_t imageWidth;
 #else
@@ -417,6 +817,11 @@ void ResetOI( oi_t memSize, oi_t pc, oi_t sp, uint8_t imageWidth )
 #endif
 {
     memset( &g_oi, 0, sizeof( g_oi ) );
+#ifdef OI_MMAP
+    if ( g_ram_fresh )
+        g_ram_fresh = false;
+    else
+#endif /* OI_MMAP */
     memset( ram, 0, (size_t) memSize );
     g_oi.rpc = pc;
     g_oi.rsp = sp;
@@ -434,6 +839,9 @@ void ResetOI( oi_t memSize, oi_t pc, oi_t sp, uint8_t imageWidth )
         pset_imgword = set_imgword;
         g_oi.address_mask = 0xffff;
 #endif /* OI2 */
+#ifdef OI_MULTIWIDTH
+        pexecute_oi = ExecuteOI_w2;
+#endif /* OI_MULTIWIDTH */
 
     }
 #ifndef OI2
@@ -443,6 +851,9 @@ void ResetOI( oi_t memSize, oi_t pc, oi_t sp, uint8_t imageWidth )
         pget_imgword = get_imgdword;
         pset_imgword = set_imgdword;
         g_oi.address_mask = 0xffffffff;
+#ifdef OI_MULTIWIDTH
+        pexecute_oi = ExecuteOI_w4;
+#endif /* OI_MULTIWIDTH */
     }
 #endif /* OI2 */
 #ifdef OI8
@@ -452,6 +863,9 @@ void ResetOI( oi_t memSize, oi_t pc, oi_t sp, uint8_t imageWidth )
         pget_imgword = get_imgqword;
         pset_imgword = set_imgqword;
         g_oi.address_mask = 0xffffffffffffffff;
+#ifdef OI_MULTIWIDTH
+        pexecute_oi = ExecuteOI_w8;
+#endif /* OI_MULTIWIDTH */
     }
 #endif /* OI8 */
 
@@ -466,9 +880,19 @@ uint32_t RamInformationOI( required, ppRam, imageWidth ) uint32_t required; uint
 uint32_t RamInformationOI( uint32_t required, uint8_t ** ppRam, uint8_t imageWidth )
 #endif
 {
+#ifdef OI_MMAP
+    uint64_t reserved;
+
+    reserved = ReserveRamOI( required, ppRam, imageWidth );
+    return ( reserved > 0xffffffff ) ? 0xffffffff : (uint32_t) reserved;
+#else
     uint32_t available;
 
+#ifdef OI_CONTEXT
+    available = ( 0 != g_context ) ? (uint32_t) g_context->ram_size : (uint32_t) sizeof( g_ram );
+#else
     available = (uint32_t) sizeof( ram );
+#endif /* OI_CONTEXT */
     if ( ( 2 == imageWidth ) && ( available > 65536 ) )
         available = 65536;
 
@@ -477,88 +901,9 @@ uint32_t RamInformationOI( uint32_t required, uint8_t ** ppRam, uint8_t imageWid
     else
         *ppRam = 0;
     return available;
+#endif /* OI_MMAP */
 } /* RamInformationOI */
 
-#ifdef OLDCPU
-static bool CheckRelation( l, r, relation ) ioi_t l; ioi_t r; uint8_t relation;
-#else
-static bool CheckRelation( ioi_t l, ioi_t r, uint8_t relation )
-#endif
-{
-    __assume( relation <= 7 );
-
-#ifdef OI2
-    switch ( relation )
-    {
-        case 0: { return ( l > r ); }
-        case 1: { return ( l < r ); }
-        case 2: { return ( l == r ); }
-        case 3: { return ( l != r ); }
-        case 4: { return ( l >= r ); }
-        case 5: { return ( l <= r ); }
-        case 6: { return ( (bool) !( l & (ioi_t) 1 ) ); }
-        case 7: { return ( (bool) ( l & (ioi_t) 1 ) ); }
-        default: { __assume( false ); }
-    }
-#else /* OI2 */
-    if ( 2 == g_oi.image_width )
-    {
-        switch ( relation )
-        {
-            case 0: { return ( (int16_t) l > (int16_t) r ); }
-            case 1: { return ( (int16_t) l < (int16_t) r ); }
-            case 2: { return ( (int16_t) l == (int16_t) r ); }
-            case 3: { return ( (int16_t) l != (int16_t) r ); }
-            case 4: { return ( (int16_t) l >= (int16_t) r ); }
-            case 5: { return ( (int16_t) l <= (int16_t) r ); }
-            case 6: { return ( (bool) !( l & (ioi_t) 1 ) ); }
-            case 7: { return ( (bool) ( l & (ioi_t) 1 ) ); }
-            default: { __assume( false ); }
-        }
-    }
-    else if ( 4 == g_oi.image_width )
-    {
-        switch ( relation )
-        {
-            case 0: { return ( (int32_t) l > (int32_t) r ); }
-            case 1: { return ( (int32_t) l < (int32_t) r ); }
-            case 2: { return ( (int32_t) l == (int32_t) r ); }
-            case 3: { return ( (int32_t) l != (int32_t) r ); }
-            case 4: { return ( (int32_t) l >= (int32_t) r ); }
-            case 5: { return ( (int32_t) l <= (int32_t) r ); }
-            case 6: { return ( (bool) !( l & (ioi_t) 1 ) ); }
-            case 7: { return ( (bool) ( l & (ioi_t) 1 ) ); }
-            default: { __assume( false ); }
-        }
-    }
-#ifdef OI8
-    else if ( 8 == g_oi.image_width )
-    {
-        switch ( relation )
-        {
-            case 0: { return ( l > r ); }
-            case 1: { return ( l < r ); }
-            case 2: { return ( l == r ); }
-            case 3: { return ( l != r ); }
-            case 4: { return ( l >= r ); }
-            case 5: { return ( l <= r ); }
-            case 6: { return ( (bool) !( l & (ioi_t) 1 ) ); }
-            case 7: { return ( (bool) ( l & (ioi_t) 1 ) ); }
-            default: { __assume( false ); }
-        }
-    }
-#endif /* OI8 */
-    else
-        return false;
-#endif /* OI2 */
-
-    assert( false );
-
-#ifdef WATCOM
-    return false;
-#endif /* WATCOM */
-} /* CheckRelation */
-
 #ifdef OLDCPU
 static oi_t Math( l, r, math ) oi_t l; oi_t r; uint8_t math;
 #else
@@ -629,6 +974,7 @@ void TraceStateOI()
 
 void illegal_instruction( size_t op, size_t op1 )
 {
+    OIFlushOutput();
     printf( "illegal instruction. op %02x, op1 %02x\n", (uint8_t) op, (uint8_t) op1 );
     TraceStateOI();
     OIHardTermination();
@@ -673,1150 +1019,2674 @@ static void TraceState()
 } /* TraceState */
 #endif /* NDEBUG */
 
-/* memf: rarg1 = array address, rarg2 = # of items (based on width) to fill. rtmp = value to copy. rres = first element to fill */
+/*  Dispatch. The portable build decodes every instruction through one switch statement and computes the
+    instruction length at the bottom of the loop. With gcc and clang the same handlers are also reachable through
+    a 256-entry table of label addresses (computed goto), and each handler advances rpc by its own constant length
+    and jumps directly to the handler of the next instruction. That gives every handler its own indirect branch,
+    which predicts far better than the single shared one in the switch. The switch remains in place for debug
+    builds (tracing and instruction counting happen at the top of the loop) and for compilers without the extension.
+    OI_THREADED is set in oi.h; define OI_NO_THREADED to force the switch loop with gcc and clang.
+*/
+
+#ifdef OI2
+#define THREE_BYTE_LEN 3
+#else
+#define THREE_BYTE_LEN g_oi.three_byte_len
+#endif /* OI2 */
+
+#ifdef OI_THREADED
+#define op_label( name ) name:
+#define dispatch_jump() { op = get_op(); goto * dispatch_table[ op ]; }
+#define dispatch_next( len ) { g_oi.rpc += (oi_t) ( len ); dispatch_jump(); }
+#else
+#define op_label( name )
+#define dispatch_jump() continue
+#define dispatch_next( len ) break
+#endif /* OI_THREADED */
+
+#ifdef OI_PREDECODE
+
+/*  Decode cache. ExecuteOI() re-reads op/op1/op2 from guest RAM for every instruction it runs and extracts the
+    register, function, and width fields each time. The decode cache does that work once. There is one record
+    per byte of the code range (indexed by guest pc), and a record holds everything its handler needs: the
+    handler's label address, pointers to the registers it uses, sign-extended immediates, absolute addresses,
+    and a pointer to the record of a branch target when that's known at decode time.
+
+    Records start out pointing at h_decode. The first time execution reaches one, the basic block starting
+    there is decoded up to and including its first control transfer. Blocks are linked to their successors
+    directly: fall-through is the record at pd + length and direct branches and calls store the record of their
+    target, which decodes itself on first use. Only returns, syscalls, and register-relative jumps and calls go
+    through the guest pc.
+
+    Writes that land in the code range reset the records of every instruction that might overlap the written
+    bytes. Stack pushes aren't checked; the stack lives at the top of RAM above all code and data.
+    If execution leaves the code range, ExecuteOI() takes over at that pc until the app halts.
+*/
 
-static void memfb_do()
+struct OIDecoded
 {
-    memset( ram_address( g_oi.rarg1 + g_oi.rres ), (uint8_t) g_oi.rtmp, (size_t) g_oi.rarg2 );
-} /* memfb_do */
+    const void * handler;          /* label address of the handler in ExecuteDecodedOI() */
+    oi_t * preg0;                  /* register from op */
+    oi_t * preg1;                  /* register from op1, or a constant for ji */
+    oi_t * preg2;                  /* register from op2 */
+    oi_t imm;                      /* sign-extended immediate, absolute address, or precomputed offset */
+    struct OIDecoded * ptarget;    /* record of a branch or call target if known at decode time */
+    oi_t pc;                       /* guest address of this instruction */
+    uint8_t op;                    /* raw opcode bytes for handlers that call helpers */
+    uint8_t op1;
+    uint8_t x;                     /* width, math, relation, or syscall id depending on the handler */
+    uint8_t y;                     /* second small operand depending on the handler */
+    uint8_t h;                     /* enum OIHandler of the instruction, whatever handler runs it */
+    uint8_t len;                   /* instruction length, or 0 if it ends a basic block */
+};
 
-static void memfw_do()
+enum OIHandler
+{
+    H_DECODE, H_LEAVE, H_ILLEGAL, H_HALT, H_INC, H_DEC, H_PUSH, H_POP, H_POPRZERO, H_ZERO, H_SHL, H_SHR, H_INV,
+    H_RET0, H_RET0NF, H_RETNF, H_RET, H_IMULST, H_SUBST, H_ADDST, H_IDIVST, H_ANDST, H_SHLIMG, H_SHRIMG,
+    H_IMGWID, H_NATWID,
+    H_ADD, H_SUB, H_IMUL, H_IDIV, H_OR, H_XOR, H_AND, H_CMP, H_CMOV, H_MOV, H_CMPST, H_MATHST,
+    H_LDF, H_STF, H_RETX, H_LDIB, H_SIGNEX, H_MEMF, H_STADD, H_MODDIV,
+    H_SYSCALL, H_PUSHF, H_STST, H_ADDCONST, H_STINCR, H_SWAP, H_NOP2,
+    H_STR, H_LDR, H_PUSHTWO, H_POPTWO, H_ATOMIC,
+    H_LD, H_LDI, H_ST, H_JMP, H_JMPR, H_INCM, H_DECM, H_LDAE, H_CALL, H_CALLR,
+    H_J_GT, H_J_LT, H_J_EQ, H_J_NE, H_J_GE, H_J_LE, H_J_EVEN, H_J_ODD, H_JFAR, H_JRELB, H_JREL,
+    H_STINC, H_LDINC, H_CALLT, H_CALLNFT, H_CALLNF, H_CALLNFR, H_STO, H_LDO, H_LDOINC, H_LDIW, H_CPUINFO,
+    H_LDM, H_STI, H_MATH3, H_CMP3, H_C0, H_CSTF, H_NOP4,
+    H_PROFILE, /* decoding produces the handlers before this one */
+    H_RETIRE, H_GUARD,
+    H_INC_JLE, H_LDO_JEQ, H_MATH3_JGT, H_ADD_ADD, H_LDIB_ADD, H_INCM_INC,
+    H_INC_LDIW, H_LDIW_C0, H_C0_JGT, H_INCM_JLT, H_PUSH_PUSHF, H_POP_STO, H_LDIB_STO, H_PUSHF_PUSHF, H_PUSHF_CALL,
+    H_STO_PUSH, H_STO_JEQ, H_LDIW_CALLNFT, H_LDF_JGE, H_LDF_JLE,
+    H_DEC_LDO, H_IMUL_MATHST, H_MATHST_JNE, H_MODDIV_STO, H_STO_DEC, H_LDO_LDIW, H_LDIW_IMUL,
+    H_COUNT
+};
+
+/* which of preg0, preg1, and preg2 (bits 0..2) each handler reads or writes as a register */
+
+static const uint8_t g_handler_regs[ H_COUNT ] =
 {
-    uint16_t * pw, * pbeyond, val;
-    pw = (uint16_t *) ram_address( g_oi.rarg1 );
-    pw += g_oi.rres;
-    pbeyond = pw + g_oi.rarg2;
-    val = (uint16_t) g_oi.rtmp;
-    while ( pw != pbeyond )
-        *pw++ = val;
-} /* memfw_do */
+    0, 0, 0, 0, 1, 1, 1, 1, 0, 1, 1, 1, 1,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    1, 1, 0, 1, 1, 0, 0, 3,
+    0, 0, 1, 1, 3, 3, 0,
+    3, 3, 3, 3, 3,
+    1, 1, 1, 0, 1, 1, 1, 1, 0, 1,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    1, 3, 1, 1, 0, 1, 3, 3, 3, 1, 0,
+    1, 0, 7, 7, 7, 3, 0
+};
+
+static oi_tls struct OIDecoded * g_pdecoded = 0;
+static oi_tls oi_t g_code_limit = 0;
+static oi_tls const void * const * g_handlers = 0; /* ExecuteDecodedOI()'s static table, indexed by OIHandler */
+static oi_tls volatile bool g_stop_requested = false;
+static bool g_counting = false;             /* see RetiredOI() */
+static oi_tls uint64_t g_retired = 0;
+static oi_t g_small_constants[ 9 ] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+
+#ifdef OI_JIT
+static void JitFlushOI( void );
+#endif /* OI_JIT */
 
-#ifndef OI2
+#ifdef OI2
+#define code_address( address ) ( address )
+#else
+#define code_address( address ) ( ( address ) & g_oi.address_mask )
+#endif /* OI2 */
 
-static void memfdw_do()
+/* stores that may land in the code range reset the affected records */
+#define code_write_check( address, length ) if ( code_address( address ) < g_code_limit ) InvalidateCodeOI( address, length )
+
+void EnableDecodeCacheOI( oi_t code_size )
 {
-    uint32_t * p, * pbeyond, val;
-    p = (uint32_t *) ram_address( g_oi.rarg1 );
-    p += g_oi.rres;
-    pbeyond = p + g_oi.rarg2;
-    val = (uint32_t) g_oi.rtmp;
-    while ( p != pbeyond )
-        *p++ = val;
-} /* memfdw_do */
+    if ( 0 != g_pdecoded )
+    {
+        free( g_pdecoded );
+        g_pdecoded = 0;
+    }
 
-#ifdef OI8
+    /* the cache is allocated on first use in ExecuteDecodedOI() once the handler addresses are known */
+    g_code_limit = code_size;
+    g_retired = 0;
+} /* EnableDecodeCacheOI */
 
-static void memfqw_do()
+void InvalidateCodeOI( oi_t address, oi_t length )
 {
-    uint64_t * p, * pbeyond, val;
-    p = (uint64_t *) ram_address( g_oi.rarg1 );
-    p += g_oi.rres;
-    pbeyond = p + g_oi.rarg2;
-    val = g_oi.rtmp;
-    while ( p != pbeyond )
-        *p++ = val;
-} /* memfqw_do */
+    oi_t pc, end;
 
-#endif /* OI8 */
-#endif /* OI2 */
+    if ( 0 == g_pdecoded )
+        return;
 
-static void staddb_do()
-{
-    uint8_t * pb, * pend;
-    oi_t tadd;
-    pb = ram_address( g_oi.rtmp + g_oi.rarg1 );
-    pend = pb + ( g_oi.rres - g_oi.rtmp );
-    tadd = g_oi.rarg2;
+    address = code_address( address );
+    if ( address >= g_code_limit )
+        return;
 
-    do
-    {
-        *pb = 0;
-        pb += tadd;
-    } while ( pb <= pend );
-} /* staddb_do */
-
-static void staddw_do()
-{
-    uint16_t * pw;
-    oi_t cur;
-    cur = g_oi.rtmp;
-    pw = (uint16_t *) ram_address( ( sizeof( uint16_t ) * cur ) + g_oi.rarg1 );
-    do
-    {
-        *pw = 0;
-        pw += g_oi.rarg2;
-        cur += g_oi.rarg2;
-    } while ( cur <= g_oi.rres );
-} /* staddw_do */
+    end = address + length;
+    if ( end > g_code_limit || end < address )
+        end = g_code_limit;
 
-#ifndef OI2
+    /* instructions are at most 1 + 8 bytes, so a superinstruction starting up to 17 bytes earlier may overlap */
+    pc = ( address > (oi_t) 17 ) ? ( address - (oi_t) 17 ) : (oi_t) 0;
+    for ( ; pc < end; pc++ )
+        g_pdecoded[ pc ].handler = g_handlers[ H_DECODE ];
 
-static void stadddw_do()
-{
-    uint32_t * pw;
-    oi_t cur;
-    cur = g_oi.rtmp;
-    pw = (uint32_t *) ram_address( ( sizeof( uint32_t ) * cur ) + g_oi.rarg1 );
-    do
-    {
-        *pw = 0;
-        pw += g_oi.rarg2;
-        cur += g_oi.rarg2;
-    } while ( cur <= g_oi.rres );
-} /* stadddw_do */
+#ifdef OI_JIT
+    JitFlushOI();
+#endif /* OI_JIT */
+} /* InvalidateCodeOI */
 
-#ifdef OI8
+/* the records past the end of the code range catch execution falling off the end and leave the cache */
+
+#define DECODE_TAIL 16
 
-static void staddqw_do()
+static bool AllocateDecodeCache( const void * const * handlers )
 {
-    uint64_t * pw;
-    oi_t cur;
-    cur = g_oi.rtmp;
-    pw = (uint64_t *) ram_address( ( sizeof( uint64_t ) * cur ) + g_oi.rarg1 );
-    do
-    {
-        *pw = 0;
-        pw += g_oi.rarg2;
-        cur += g_oi.rarg2;
-    } while ( cur <= g_oi.rres );
-} /* staddqw_do */
+    size_t i;
 
-#endif /* OI8 */
-#endif /* OI2 */
+    g_pdecoded = (struct OIDecoded *) calloc( (size_t) g_code_limit + DECODE_TAIL, sizeof( struct OIDecoded ) );
+    if ( 0 == g_pdecoded )
+        return false;
 
-#ifdef OLDCPU
-static void moddiv_do( op, op1 ) size_t op; size_t op1;
-#else
-__forceinline static void moddiv_do( size_t op, size_t op1 )
-#endif
-{
-    oi_t x, y;
-    y = get_reg_from_op( op1 );
-    if ( (oi_t) 0 == y )
+    g_handlers = handlers;
+    for ( i = 0; i < (size_t) g_code_limit + DECODE_TAIL; i++ )
     {
-        push( 0 ); /* when they exist, an exception should be raised */
-        return;
+        g_pdecoded[ i ].handler = handlers[ ( i < (size_t) g_code_limit ) ? H_DECODE : H_LEAVE ];
+        g_pdecoded[ i ].pc = (oi_t) i;
     }
+    return true;
+} /* AllocateDecodeCache */
+
+/*  StopOI() asks ExecuteOI() to return to the host before the next instruction the decode cache runs, as it does
+    when the app halts but without halting it. It's safe to call from a signal handler on the thread running the
+    guest: it points every record at h_leave, and h_decode checks too in case a block was being decoded.
+    h_leave then calls StoppedOI() to put the records back. The plain interpreter (oios -d) doesn't stop, and
+    code compiled by the JIT runs until it returns to the decode cache.
+*/
 
-    x = get_reg_from_op( op );
-    set_reg_from_op( op, x % y );
-    push( x / y );
-} /* moddiv_do */
-
-#ifdef OLDCPU
-static oi_t frame_offset( offset ) ioi_t offset;
-#else
-__forceinline static oi_t frame_offset( ioi_t offset )
-#endif
+void StopOI()
 {
-    return g_oi.rframe + ( sizeof( oi_t ) * ( offset + ( ( offset >= 0 ) ? 3 : 1 ) ) );
-} /* frame_offset */
+    oi_t pc;
 
-#ifdef OLDCPU
-void cstf_do( op ) opcode_t op;
-#else
-__forceinline void cstf_do( opcode_t op )
-#endif
+    g_stop_requested = true;
+    if ( 0 == g_pdecoded )
+        return;
+
+    for ( pc = 0; pc < g_code_limit; pc++ )
+        g_pdecoded[ pc ].handler = g_handlers[ H_LEAVE ];
+} /* StopOI */
+
+static void StoppedOI()
 {
-    oi_t val;
-    uint8_t op1;
+    oi_t pc;
 
-    val = get_reg_from_op( op );
-    op1 = get_op1();
-    if ( CheckRelation( val, get_reg_from_op( op1 ), funct_from_op( op1 ) ) )
-        set_oiword( frame_offset( (ioi_t) reg_from_op( get_byte( g_oi.rpc + 2 ) ) ), val );
-} /* cstf_do */
+    g_stop_requested = false;
+    for ( pc = 0; pc < g_code_limit; pc++ )
+        g_pdecoded[ pc ].handler = g_handlers[ H_DECODE ];
+} /* StoppedOI */
 
-#ifdef OLDCPU
-static void jump_return( ival ) ioi_t ival;
-#else
-__forceinline static void jump_return( ioi_t ival )
-#endif
+static struct OIDecoded * decoded_target( oi_t address )
 {
-    /* jump relative <= 3 means return: 0=ret, 1=retnf, 2=ret0, 3=ret0nf */
-    assert( ival >= 0 && ival <= 3 );
-    pop( g_oi.rpc );
-    if ( (ioi_t) 0 == ( ival & 1 ) )
-        pop( g_oi.rframe );
-    if ( ival >= (ioi_t) 2 )
-        g_oi.rres = 0;
-} /* jump_return */
+    if ( address < g_code_limit )
+        return g_pdecoded + address;
+    return 0;
+} /* decoded_target */
 
-#ifdef OLDCPU
-static bool jrel_do( op, op1 ) opcode_t op, op1;
-#else
-__forceinline static bool jrel_do( opcode_t op, opcode_t op1 )
-#endif
+#define decoded_dispatch() goto * pd->handler
+#define decoded_next( len ) { pd += ( len ); decoded_dispatch(); }
+#define decoded_link() { pd = pd->ptarget; decoded_dispatch(); }
+#define decoded_jump( address ) { val = ( address ); if ( val >= g_code_limit ) goto _left_code; pd = g_pdecoded + val; decoded_dispatch(); }
+
+#define decoded_j( relation ) \
+    if ( CheckRelation( * pd->preg0, * pd->preg1, relation ) ) \
+        decoded_link(); \
+    decoded_next( 4 );
+
+/*  Pair profile. After EnableProfileOI(), every record decodes to h_profile, which counts the instruction's
+    handler and each pair and triple of handlers that ran one after another with no branch between them, then
+    runs the real handler. ShowProfileOI() lists the most frequent. The superinstructions below came from this.
+*/
+
+static bool g_profile = false;
+static uint64_t * g_profile_singles = 0;    /* [ H_PROFILE ] */
+static uint64_t * g_profile_pairs = 0;      /* [ H_PROFILE * H_PROFILE ] */
+static uint64_t * g_profile_triples = 0;    /* [ H_PROFILE * H_PROFILE * H_PROFILE ] */
+static struct OIDecoded * g_profile_prev = 0;
+static struct OIDecoded * g_profile_prev2 = 0;
+
+static const char * g_handler_names[ H_PROFILE ] =
 {
-    ioi_t ival;
-    if ( CheckRelation( get_reg_from_op( op ), read_imgword( get_reg_from_op( op1 ) + get_byte( g_oi.rpc + 2 ) ), funct_from_op( op1 ) ) )
-    {
-        ival = (ioi_t) (int8_t) get_byte( g_oi.rpc + 3 );
-        if ( (oi_t) ival <= (oi_t) 3 )
-            jump_return( ival );
-        else
-            g_oi.rpc += ival;
-        return true;
-    }
-    return false;
-} /* jrel_do */
+    "decode", "leave", "illegal", "halt", "inc", "dec", "push", "pop", "pop rzero", "zero", "shl", "shr", "inv",
+    "ret0", "ret0nf", "retnf", "ret", "imulst", "subst", "addst", "idivst", "andst", "shlimg", "shrimg",
+    "imgwid", "natwid",
+    "add", "sub", "imul", "idiv", "or", "xor", "and", "cmp", "cmov", "mov", "cmpst", "mathst",
+    "ldf", "stf", "retx", "ldib", "signex", "memf", "stadd", "moddiv",
+    "syscall", "pushf", "stst", "addimgw/natw", "stinc reg", "swap", "nop2",
+    "st [reg]", "ld [reg]", "pushtwo", "poptwo", "atomic",
+    "ld", "ldi", "st", "jmp", "jmp reg", "inc [mem]", "dec [mem]", "ldae", "call", "call reg",
+    "j gt", "j lt", "j eq", "j ne", "j ge", "j le", "j even", "j odd", "j far", "jrelb", "jrel",
+    "stinc", "ldinc", "call table", "callnf table", "callnf", "callnf reg", "sto", "ldo", "ldoinc", "ldiw", "cpuinfo",
+    "ld [mem]", "sti", "math3", "cmp3", "fzero/stoi/stor/ldor", "cstf", "nop4"
+};
+
+void EnableProfileOI()
+{
+    g_profile_singles = (uint64_t *) calloc( H_PROFILE, sizeof( uint64_t ) );
+    g_profile_pairs = (uint64_t *) calloc( H_PROFILE * H_PROFILE, sizeof( uint64_t ) );
+    g_profile_triples = (uint64_t *) calloc( H_PROFILE * H_PROFILE * H_PROFILE, sizeof( uint64_t ) );
+    g_profile = ( 0 != g_profile_singles ) && ( 0 != g_profile_pairs ) && ( 0 != g_profile_triples );
+} /* EnableProfileOI */
+
+/*  Retired instructions, for apps that time themselves. After EnableRetiredCountOI() every record decodes to
+    h_retire, which counts the instruction and runs its handler, and superinstructions and the JIT
+    stay off so each instruction is counted once. h_profile counts them too. The count starts with the app,
+    and each thread has its own. RetiredOI() returns false when nothing is counted: without EnableRetiredCountOI(), or when the decode
+    cache isn't running the app (oios -d), since the plain interpreter doesn't count. Instructions it runs after
+    execution leaves the code range aren't counted either.
+*/
 
-#ifdef OLDCPU
-static void stinc_do( op ) opcode_t op;
-#else
-__forceinline static void stinc_do( opcode_t op )
-#endif
+void EnableRetiredCountOI()
 {
-    uint8_t width;
-    int16_t val;
-    oi_t inc_amount;
+    g_counting = true;
+} /* EnableRetiredCountOI */
 
-    val = (int16_t) get_word( g_oi.rpc + 2 );
-    width = (uint8_t) width_from_op( get_op1() );
-    if ( 0 == width )
-        set_byte( get_reg_from_op( op ), (uint8_t) ( val & 0xff ) );
-    else if_1_is_width
-        set_word( get_reg_from_op( op ), (uint16_t) val );
-#ifndef OI2
-    else if_2_is_width
-        set_dword( get_reg_from_op( op ), (uint32_t) (int32_t) val );
-#ifdef OI8
-    else /* 3 == width */
-        set_qword( get_reg_from_op( op ), (uint64_t) (int64_t) val );
-#endif /* OI8 */
-#endif /* OI2 */
+bool RetiredOI( uint64_t * pcount )
+{
+    if ( ( 0 == g_code_limit ) || !( g_counting || g_profile ) )
+        return false;
 
-    inc_amount = (oi_t) ( 1 << width );
-    add_reg_from_op( op, inc_amount );
-} /* stinc_do */
+    * pcount = g_retired;
+    return true;
+} /* RetiredOI */
 
-#ifdef OLDCPU
-static void op_a0_b0_do( op ) opcode_t op;
-#else
-__forceinline static void op_a0_b0_do( opcode_t op )
-#endif
+static void ProfileStepOI( struct OIDecoded * pd )
 {
-    opcode_t op1, width;
-    oi_t val;
-    uint8_t funct1;
-    op1 = get_op1();
-    width = width_from_op( op1 );
-    funct1 = funct_from_op( op1 );
+    struct OIDecoded * prev;
+
+    g_profile_singles[ pd->h ]++;
+    g_retired++;
 
-    switch ( funct1 )
+    /* only count instructions that fell through from the one before */
+    prev = g_profile_prev;
+    if ( ( 0 != prev ) && ( 0 != prev->len ) && ( prev + prev->len == pd ) )
     {
-        case 0: /* st */
-        {
-            if ( 0 == width )
-                set_byte( get_reg_from_op( op ), (uint8_t) ( 0xff & get_reg_from_op( op1 ) ) );
-            else if_1_is_width
-                set_word( get_reg_from_op( op ), (uint16_t) get_reg_from_op( op1 ) );
-#ifndef OI2
-            else if_2_is_width
-                set_dword( get_reg_from_op( op ), (uint32_t) get_reg_from_op( op1 ) );
-#ifdef OI8
-            else /* 3 == width */
-                set_qword( get_reg_from_op( op ), get_reg_from_op( op1 ) );
-#endif /* OI8 */
-#endif /* OI2 */
-            break;
-        }
-        case 1: /* ld */
-        {
-            if ( 0 == width )
-                set_reg_from_op( op, get_byte( get_reg_from_op( op1 ) ) );
-            else if_1_is_width
-                set_reg_from_op( op, get_word( get_reg_from_op( op1 ) ) );
-#ifndef OI2
-            else if_2_is_width
-                set_reg_from_op( op, get_dword( get_reg_from_op( op1 ) ) );
-#ifdef OI8
-            else /* 3 == width */
-                set_reg_from_op( op, get_qword( get_reg_from_op( op1 ) ) );
-#endif /* OI8 */
-#endif /* OI2 */
-            break;
-        }
-        case 2: /* pushtwo */
-        {
-            push( get_reg_from_op( op ) );
-            push( get_reg_from_op( op1 ) );
-            break;
-        }
-        default: /* ( 3 == funct1 ) poptwo */
-        {
-            pop( val );
-            set_reg_from_op( op, val );
-            pop( val );
-            set_reg_from_op( op1, val );
-            break;
-        }
+        g_profile_pairs[ prev->h * H_PROFILE + pd->h ]++;
+        if ( 0 != g_profile_prev2 )
+            g_profile_triples[ ( g_profile_prev2->h * H_PROFILE + prev->h ) * H_PROFILE + pd->h ]++;
     }
-} /* ld_st_reg_reg_do */
+    else
+        prev = 0;
 
-#ifdef OLDCPU
-static bool op_80_90_do( op ) opcode_t op;
-#else
-__forceinline static bool op_80_90_do( opcode_t op )
-#endif
+    g_profile_prev2 = prev;
+    g_profile_prev = pd;
+} /* ProfileStepOI */
+
+/* prints the count largest entries of counts and zeroes them */
+
+static void ShowTopCounts( uint64_t * counts, size_t length, size_t count, uint64_t total, size_t tuple )
 {
-    opcode_t op1, width;
-    oi_t val;
+    size_t i, j, best;
+    uint64_t n;
 
-    op1 = get_op1();
-    switch( funct_from_op( op1 ) ) 
+    for ( i = 0; i < count; i++ )
     {
-        case 0: /* syscall */
-        {
-            val = g_oi.rpc;
-            OISyscall( ( ( op << 1 ) & 0x38 ) | ( ( op1 >> 2 ) & 7 ) );
-            if ( g_oi.rpc != val )
-                return true;
-            break;
-        }
-        case 1: /* pushf offset */
-        {
-            push( get_oiword( frame_offset( (int16_t) reg_from_op( op1 ) ) ) );
-            break;
-        }
-        case 2: /* stst [reg0] */
-        {
-            pop( val );
-            write_imgword( val, get_reg_from_op( op ) );
-            break;
-        }
-        case 3: /* addimgw reg0 if width=0, subimgw if width=1 */
-        {
-            width = width_from_op( op1 );
-            if ( 0 == width )
-                set_reg_from_op( op, get_reg_from_op( op ) + (oi_t) IMAGE_WIDTH );
-            else if ( 1 == width )
-                set_reg_from_op( op, get_reg_from_op( op ) - (oi_t) IMAGE_WIDTH );
+        best = 0;
+        for ( j = 1; j < length; j++ )
+            if ( counts[ j ] > counts[ best ] )
+                best = j;
+
+        n = counts[ best ];
+        if ( 0 == n )
             break;
-        }
-        case 4: /* stinc [reg0], reg1  -- then increment reg0 by width of store */
-        {
-            op1 = get_op1();
-            val = get_reg_from_op( op1 );
-            width = (uint8_t) width_from_op( get_op1() );
-            if ( 0 == width )
-                set_byte( get_reg_from_op( op ), (uint8_t) val );
-            else if_1_is_width
-                set_word( get_reg_from_op( op ), (uint16_t) val );
-#ifndef OI2
-            else if_2_is_width
-                set_dword( get_reg_from_op( op ), (uint32_t) val );
-#ifdef OI8
-            else /* 3 == width */
-                set_qword( get_reg_from_op( op ), val );
-#endif /* OI8 */
-#endif /* OI2 */
+        counts[ best ] = 0;
+
+        printf( "  %14llu %6.2f%%  ", (unsigned long long) n, 100.0 * (double) n / (double) total );
+        if ( 3 == tuple )
+            printf( "%s + ", g_handler_names[ best / ( H_PROFILE * H_PROFILE ) ] );
+        if ( tuple >= 2 )
+            printf( "%s + ", g_handler_names[ ( best / H_PROFILE ) % H_PROFILE ] );
+        printf( "%s\n", g_handler_names[ best % H_PROFILE ] );
+    }
+} /* ShowTopCounts */
 
-            if ( width > 0 )
-                val = (oi_t) ( 1 << width );
-            else
-                val = (oi_t) 1;
-            add_reg_from_op( op, val );
-            break;
-        }
-        case 5: /* swap reg0, reg1 */
-        {
-            val = get_reg_from_op( op );
-            set_reg_from_op( op, get_reg_from_op( op1 ) );
-            set_reg_from_op( op1, val );
-            break;
-        }
-        case 6: /* addnatw reg0 if width=0, subnatw if width=1 */
+void ShowProfileOI()
+{
+    uint64_t total;
+    size_t i;
+
+    if ( !g_profile )
+        return;
+
+    total = 0;
+    for ( i = 0; i < H_PROFILE; i++ )
+        total += g_profile_singles[ i ];
+    if ( 0 == total )
+        return;
+
+    printf( "decoded instructions executed: %llu\n", (unsigned long long) total );
+    printf( "most frequent instructions:\n" );
+    ShowTopCounts( g_profile_singles, H_PROFILE, 20, total, 1 );
+    printf( "most frequent pairs:\n" );
+    ShowTopCounts( g_profile_pairs, H_PROFILE * H_PROFILE, 30, total, 2 );
+    printf( "most frequent triples:\n" );
+    ShowTopCounts( g_profile_triples, H_PROFILE * H_PROFILE * H_PROFILE, 20, total, 3 );
+} /* ShowProfileOI */
+
+/*  Superinstructions. The pairs that ran most often in the pair profiles of ttt, sieve, and e get a handler
+    that does the first instruction and then goes straight to the second's handler, saving an indirect dispatch.
+    When a block is decoded the first record of each such pair gets the fused handler. The second record keeps
+    its own handler for code that branches to it.
+*/
+
+static const uint8_t g_fusions[][ 3 ] =
+{
+    { H_INC, H_J_LE, H_INC_JLE },           /* sieve */
+    { H_LDO, H_J_EQ, H_LDO_JEQ },
+    { H_MATH3, H_J_GT, H_MATH3_JGT },
+    { H_ADD, H_ADD, H_ADD_ADD },
+    { H_LDIB, H_ADD, H_LDIB_ADD },
+    { H_INCM, H_INC, H_INCM_INC },
+    { H_INC, H_LDIW, H_INC_LDIW },          /* ttt */
+    { H_LDIW, H_C0, H_LDIW_C0 },
+    { H_C0, H_J_GT, H_C0_JGT },
+    { H_INCM, H_J_LT, H_INCM_JLT },
+    { H_PUSH, H_PUSHF, H_PUSH_PUSHF },
+    { H_POP, H_STO, H_POP_STO },
+    { H_LDIB, H_STO, H_LDIB_STO },
+    { H_PUSHF, H_PUSHF, H_PUSHF_PUSHF },
+    { H_PUSHF, H_CALL, H_PUSHF_CALL },
+    { H_STO, H_PUSH, H_STO_PUSH },
+    { H_STO, H_J_EQ, H_STO_JEQ },
+    { H_LDIW, H_CALLNFT, H_LDIW_CALLNFT },
+    { H_LDF, H_J_GE, H_LDF_JGE },
+    { H_LDF, H_J_LE, H_LDF_JLE },
+    { H_DEC, H_LDO, H_DEC_LDO },            /* e */
+    { H_IMUL, H_MATHST, H_IMUL_MATHST },
+    { H_MATHST, H_J_NE, H_MATHST_JNE },
+    { H_MODDIV, H_STO, H_MODDIV_STO },
+    { H_STO, H_DEC, H_STO_DEC },
+    { H_LDO, H_LDIW, H_LDO_LDIW },
+    { H_LDIW, H_IMUL, H_LDIW_IMUL }
+};
+
+/* pd is the first record of a block that was just decoded and pend is its last record or the decoded record after it */
+
+static void FuseBlockOI( struct OIDecoded * pd, struct OIDecoded * pend, const void * const * handlers )
+{
+    struct OIDecoded * pnext;
+    size_t i;
+
+    if ( g_profile || g_counting )
+        return;
+#ifdef OI_MMAP
+    if ( g_fault_pc )
+        return;
+#endif /* OI_MMAP */
+
+    while ( pd < pend )
+    {
+        pnext = pd + pd->len;
+        if ( handlers[ H_DECODE ] != pnext->handler )
         {
-            width = width_from_op( op1 );
-            if ( 0 == width )
-                set_reg_from_op( op, get_reg_from_op( op ) + (oi_t) sizeof( oi_t ) );
-            else if ( 1 == width )
-                set_reg_from_op( op, get_reg_from_op( op ) - (oi_t) sizeof( oi_t ) );
-            break;
+            for ( i = 0; i < sizeof( g_fusions ) / sizeof( g_fusions[ 0 ] ); i++ )
+            {
+                if ( ( g_fusions[ i ][ 0 ] == pd->h ) && ( g_fusions[ i ][ 1 ] == pnext->h ) )
+                {
+                    pd->handler = handlers[ g_fusions[ i ][ 2 ] ];
+                    break;
+                }
+            }
         }
+        pd = pnext;
     }
+} /* FuseBlockOI */
 
-    return false;
-} /* op_80_90_do */
+/* the handler bodies shared with superinstructions must be inlined like the rest of ExecuteDecodedOI() */
 
-#ifdef OLDCPU
-static void ldinc_do( op ) opcode_t op;
+#define decoded_inline __attribute__(( always_inline )) inline
+
+/* gcc's global cse merges the handlers' dispatch jumps and spills pd across them once the superinstructions are added */
+
+#ifdef __clang__
+#define decoded_engine
 #else
-__forceinline static void ldinc_do( opcode_t op )
+#define decoded_engine __attribute__(( optimize( "no-gcse" ) ))
 #endif
+
+/* move to the second record of a superinstruction and run its handler. a first instruction that stores may have reset it */
+
+#define fused_next( len, label ) { pd += ( len ); goto label; }
+#define fused_store_next( len, label ) { pd += ( len ); if ( handlers[ H_DECODE ] == pd->handler ) decoded_dispatch(); goto label; }
+
+#endif /* OI_PREDECODE */
+
+#ifdef OI_JIT
+
+/*  JIT. Hot functions and loops are compiled to x86-64 code and run natively. Call targets and the targets of
+    backward conditional branches have counters. When one reaches JIT_THRESHOLD, the region reachable from that
+    address is compiled: control flow is followed from the entry through conditional branches, direct jumps, and
+    calls until every path ends in a return, a jump through a register, or an instruction the JIT leaves to the
+    interpreter (syscalls, halt, illegal instructions, and a few of the rarely used ones). Those end with an exit
+    that returns the guest pc to the interpreter, which continues from there.
+
+    Guest registers live in host registers that the C calling convention preserves:
+        rsp => rbx, rframe => rbp, rarg1 => r12, rarg2 => r13, rres => r14, rtmp => r15
+    rzero is a constant and rpc isn't needed. rsi holds the base of guest RAM. Everything else is scratch;
+    guest memory accesses put the address in rax and the value in rcx.
+
+    Each region is a host function that returns the next guest pc in rax. A guest ret pops the guest return address
+    and frame from guest RAM as usual and then does a host ret. Guest calls push the guest return address, call
+    the target's entry in g_jit_entry (indexed by guest pc), and compare the pc that comes back with the return
+    address. If they differ, something in the callee left native code (or returned elsewhere) and the pc is passed
+    up to the interpreter. Targets that aren't compiled yet point at a resolver that counts the call, compiles the
+    target if it's hot, and otherwise hands the target pc back the same way.
+
+    Native code doesn't store into the code range. It exits just before such a store so the interpreter does it,
+    which resets the decode cache and throws away all compiled code.
+*/
+
+#ifndef JIT_THRESHOLD
+#define JIT_THRESHOLD 64                 /* calls or back edges before an address is compiled */
+#endif /* JIT_THRESHOLD */
+#define JIT_MAX_REGION 1024              /* guest instructions compiled per region */
+#define JIT_CODE_SIZE ( 16 * 1024 * 1024 )
+#define JIT_INSTRUCTION_ROOM 192         /* more than the longest native code for one guest instruction */
+#define JIT_JMP 16                       /* jit_branch() condition for an unconditional jump */
+
+/* host registers */
+#define HR_RAX 0
+#define HR_RCX 1
+#define HR_RDX 2
+#define HR_RBX 3
+#define HR_RBP 5
+#define HR_RSI 6
+#define HR_RDI 7
+#define HR_R14 14
+#define HR_R15 15
+
+#define jit_seq( s ) jit_bytes( (const uint8_t *) s, sizeof( s ) - 1 )
+
+typedef void t_jit_enter( const uint8_t * entry );
+
+static bool g_jit_enabled = false;
+static uint8_t * g_jit_code = 0;          /* executable buffer */
+static size_t g_jit_used = 0;             /* bytes of g_jit_code in use */
+static size_t g_jit_base = 0;             /* bytes used by the trampoline and resolver */
+static uint8_t * g_jit_p = 0;             /* where the next byte is emitted */
+static t_jit_enter * g_jit_enter = 0;     /* loads guest registers, runs native code, stores them and rpc back */
+static const uint8_t * g_jit_resolver = 0;
+static const uint8_t ** g_jit_entry = 0;  /* per guest pc: native entry or g_jit_resolver */
+static uint16_t * g_jit_counts = 0;       /* per guest pc: calls and back edges seen so far */
+static uint8_t ** g_jit_native = 0;       /* per guest pc: native code in the region being compiled */
+
+static oi_t g_jit_work[ JIT_MAX_REGION + 1 ];   /* addresses to compile in this region */
+static oi_t g_jit_done[ JIT_MAX_REGION ];       /* addresses compiled so far in this region */
+static uint8_t * g_jit_fixup_at[ JIT_MAX_REGION ]; /* rel32 fields of branches to patch at the end */
+static oi_t g_jit_fixup_pc[ JIT_MAX_REGION ];
+static size_t g_jit_work_count, g_jit_done_count, g_jit_fixup_count;
+
+/* guest register id to host register. rzero and rpc don't have one */
+static const uint8_t g_jit_hreg[ 8 ] = { 0, 0, HR_RBX, HR_RBP, 12, 13, HR_R14, HR_R15 };
+
+static void jit_byte( size_t b )
+{
+    * g_jit_p++ = (uint8_t) b;
+} /* jit_byte */
+
+static void jit_bytes( const uint8_t * p, size_t len )
+{
+    memcpy( g_jit_p, p, len );
+    g_jit_p += len;
+} /* jit_bytes */
+
+static void jit_dword( uint32_t d )
+{
+    memcpy( g_jit_p, & d, sizeof( d ) );
+    g_jit_p += sizeof( d );
+} /* jit_dword */
+
+static void jit_qword( uint64_t q )
+{
+    memcpy( g_jit_p, & q, sizeof( q ) );
+    g_jit_p += sizeof( q );
+} /* jit_qword */
+
+/* 64-bit op r/m, reg with two registers: mov 89, add 01, sub 29, and 21, or 09, xor 31, cmp 39, test 85 */
+
+static void jit_rr( size_t opcode, size_t rm, size_t reg )
+{
+    jit_byte( 0x48 | ( ( reg >> 3 ) << 2 ) | ( rm >> 3 ) );
+    jit_byte( opcode );
+    jit_byte( 0xc0 | ( ( reg & 7 ) << 3 ) | ( rm & 7 ) );
+} /* jit_rr */
+
+/* 64-bit opcode /ext on a register: inc ff /0, dec ff /1, shl 1 d1 /4, shr 1 d1 /5, shl imm c1 /4, shr imm c1 /5 */
+
+static void jit_ext( size_t opcode, size_t ext, size_t rm )
+{
+    jit_byte( 0x48 | ( rm >> 3 ) );
+    jit_byte( opcode );
+    jit_byte( 0xc0 | ( ext << 3 ) | ( rm & 7 ) );
+} /* jit_ext */
+
+/* add /0, and /4, sub /5, cmp /7 with a sign-extended immediate */
+
+static void jit_alu_imm( size_t ext, size_t rm, int32_t imm )
+{
+    if ( imm >= -128 && imm <= 127 )
+    {
+        jit_ext( 0x83, ext, rm );
+        jit_byte( (uint8_t) imm );
+    }
+    else
+    {
+        jit_ext( 0x81, ext, rm );
+        jit_dword( (uint32_t) imm );
+    }
+} /* jit_alu_imm */
+
+static void jit_shl( size_t rm, size_t count )
+{
+    if ( 0 != count )
+    {
+        jit_ext( 0xc1, 4, rm );
+        jit_byte( count );
+    }
+} /* jit_shl */
+
+static void jit_mov_imm( size_t reg, oi_t value )
+{
+    if ( 0 == value )
+    {
+        if ( reg >= 8 )
+            jit_byte( 0x45 );
+        jit_byte( 0x31 );
+        jit_byte( 0xc0 | ( ( reg & 7 ) << 3 ) | ( reg & 7 ) );
+    }
+    else if ( value <= (oi_t) 0xffffffff )
+    {
+        if ( reg >= 8 )
+            jit_byte( 0x41 );
+        jit_byte( 0xb8 + ( reg & 7 ) );
+        jit_dword( (uint32_t) value );
+    }
+    else if ( (ioi_t) value >= (ioi_t) INT32_MIN && (ioi_t) value <= (ioi_t) INT32_MAX )
+    {
+        jit_ext( 0xc7, 0, reg );
+        jit_dword( (uint32_t) value );
+    }
+    else
+    {
+        jit_byte( 0x48 | ( reg >> 3 ) );
+        jit_byte( 0xb8 + ( reg & 7 ) );
+        jit_qword( value );
+    }
+} /* jit_mov_imm */
+
+static void jit_add_imm( size_t reg, oi_t value )
+{
+    if ( (ioi_t) value >= (ioi_t) INT32_MIN && (ioi_t) value <= (ioi_t) INT32_MAX )
+    {
+        if ( 0 != value )
+            jit_alu_imm( 0, reg, (int32_t) value );
+    }
+    else
+    {
+        jit_mov_imm( HR_RDX, value );
+        jit_rr( 0x01, reg, HR_RDX );
+    }
+} /* jit_add_imm */
+
+static void jit_get( size_t host, size_t guest )
+{
+    if ( 0 == guest )
+        jit_mov_imm( host, 0 );
+    else
+        jit_rr( 0x89, host, g_jit_hreg[ guest ] );
+} /* jit_get */
+
+static void jit_put( size_t guest, size_t host )
+{
+    jit_rr( 0x89, g_jit_hreg[ guest ], host );
+} /* jit_put */
+
+/* short forward jumps within the code for one instruction */
+
+static uint8_t * jit_jcc8( size_t cc )
 {
-    uint8_t op1, width;
-    oi_t val;
+    jit_byte( 0x70 + cc );
+    jit_byte( 0 );
+    return g_jit_p - 1;
+} /* jit_jcc8 */
 
-    op1 = get_op1();
-    val = get_reg_from_op( op1 ) + g_oi.rpc + (ioi_t) (int16_t) get_word( g_oi.rpc + 2 );
-    width = (uint8_t) width_from_op( op1 );
+static uint8_t * jit_jmp8()
+{
+    jit_byte( 0xeb );
+    jit_byte( 0 );
+    return g_jit_p - 1;
+} /* jit_jmp8 */
+
+static void jit_patch8( uint8_t * p )
+{
+    * p = (uint8_t) ( g_jit_p - ( p + 1 ) );
+} /* jit_patch8 */
+
+static void jit_patch32( uint8_t * p, const uint8_t * target )
+{
+    int32_t rel;
+    rel = (int32_t) ( target - ( p + 4 ) );
+    memcpy( p, & rel, sizeof( rel ) );
+} /* jit_patch32 */
+
+/* leave native code. the interpreter continues at pc */
+
+static void jit_exit( oi_t pc )
+{
+    jit_mov_imm( HR_RAX, pc );
+    jit_byte( 0xc3 );
+} /* jit_exit */
+
+/* instruction widths beyond the image width act like the image width, as in the OI_MULTIWIDTH engines */
+
+static size_t jit_width( size_t width )
+{
+    return ( width > g_oi.image_shift ) ? g_oi.image_shift : width;
+} /* jit_width */
+
+static void jit_mask_rax()
+{
+    if ( 2 == g_oi.image_width )
+        jit_seq( "\x0f\xb7\xc0" );                 /* movzx eax, ax */
+    else if ( 4 == g_oi.image_width )
+        jit_seq( "\x89\xc0" );                     /* mov eax, eax */
+} /* jit_mask_rax */
+
+/* rcx = [ ram + rax ] zero extended */
+
+static void jit_load( size_t width )
+{
     if ( 0 == width )
-        set_reg_from_op( op, get_byte( val ) );
-    else if_1_is_width
-        set_reg_from_op( op, get_word( val ) );
-#ifndef OI2
-    else if_2_is_width
-        set_reg_from_op( op, get_dword( val ) );
-#ifdef OI8
-    else /* 3 == width */
-        set_reg_from_op( op, get_qword( val ) );
-#endif /* OI8 */
-#endif /* OI2 */
-    val = (oi_t) ( 1 << width );
-    add_reg_from_op( op1, val );
-} /* ldinc_do */
+        jit_seq( "\x0f\xb6\x0c\x06" );             /* movzx ecx, byte [ rsi + rax ] */
+    else if ( 1 == width )
+        jit_seq( "\x0f\xb7\x0c\x06" );             /* movzx ecx, word [ rsi + rax ] */
+    else if ( 2 == width )
+        jit_seq( "\x8b\x0c\x06" );                 /* mov ecx, [ rsi + rax ] */
+    else
+        jit_seq( "\x48\x8b\x0c\x06" );             /* mov rcx, [ rsi + rax ] */
+} /* jit_load */
 
-#ifdef OLDCPU
-static void cmov_do( op ) opcode_t op;
-#else
-__forceinline static void cmov_do( opcode_t op )
-#endif
+/* rcx = [ ram + rax ] sign extended */
+
+static void jit_load_signed( size_t width )
 {
-    uint8_t op1;
-    op1 = get_op1();
-    if ( ( (uint8_t) 3 == funct_from_op( op1 ) ) || /* shortcut for NE */
-         ( CheckRelation( get_reg_from_op( op ), get_reg_from_op( op1 ), funct_from_op( op1 ) ) ) )
-        set_reg_from_op( op, get_reg_from_op( op1 ) );
-} /* cmov_do */
+    if ( 0 == width )
+        jit_seq( "\x48\x0f\xbe\x0c\x06" );         /* movsx rcx, byte [ rsi + rax ] */
+    else if ( 1 == width )
+        jit_seq( "\x48\x0f\xbf\x0c\x06" );         /* movsx rcx, word [ rsi + rax ] */
+    else if ( 2 == width )
+        jit_seq( "\x48\x63\x0c\x06" );             /* movsxd rcx, [ rsi + rax ] */
+    else
+        jit_load( 3 );
+} /* jit_load_signed */
 
-#ifdef OLDCPU
-static void signex_do( op ) opcode_t op;
-#else
-__forceinline static void signex_do( opcode_t op )
-#endif
+/* [ ram + rax ] = rcx */
+
+static void jit_store( size_t width )
 {
-    opcode_t width;
-    width = width_from_op( get_op1() );
     if ( 0 == width )
-#ifdef AZTECCPM
-        set_reg_from_op( op, sign_extend_oi( get_reg_from_op( op ), 7 ) ); /* the casts below don't work with Aztec C */
-#else
-        set_reg_from_op( op, (oi_t) (ioi_t) (int8_t) get_reg_from_op( op ) );
-#endif
-    else if_1_is_width
-        set_reg_from_op( op, (oi_t) (ioi_t) (int16_t) get_reg_from_op( op ) );
-#ifndef OI2
-    else if_2_is_width
-        set_reg_from_op( op, (oi_t) (ioi_t) (int32_t) get_reg_from_op( op ) );
-#endif /* OI2 */
-} /* signex_do */
+        jit_seq( "\x88\x0c\x06" );
+    else if ( 1 == width )
+        jit_seq( "\x66\x89\x0c\x06" );
+    else if ( 2 == width )
+        jit_seq( "\x89\x0c\x06" );
+    else
+        jit_seq( "\x48\x89\x0c\x06" );
+} /* jit_store */
 
-#ifdef OLDCPU
-static void op_c0_d0_do( op ) opcode_t op;
-#else
-__forceinline static void op_c0_d0_do( opcode_t op )
-#endif
+/* exit before the store at pc if the masked address in rax is in the code range */
+
+static void jit_code_check( oi_t pc )
 {
-    opcode_t op1, op2, width;
-    oi_t val;
-    ioi_t ival;
-    uint8_t * pb;
-    uint16_t * pw, val16;
-    oi_t index, limit;
-#ifndef OI2
-    uint32_t * pdw;
-#ifdef OI8
-    uint64_t * pqw;
-#endif /* OI8 */
-#endif /* OI2 */
+    uint8_t * p;
+    jit_alu_imm( 7, HR_RAX, (int32_t) g_code_limit );
+    p = jit_jcc8( 0x3 );                           /* jae */
+    jit_exit( pc );
+    jit_patch8( p );
+} /* jit_code_check */
+
+/* rax = frame slot address for ldf, stf, pushf, and cstf */
+
+static void jit_frame_address( size_t reg )
+{
+    jit_rr( 0x89, HR_RAX, HR_RBP );
+    jit_add_imm( HR_RAX, (oi_t) ( sizeof( oi_t ) * ( reg + 3 ) ) );
+    jit_mask_rax();
+} /* jit_frame_address */
+
+/* guest push is split so the value can be read after rsp is decremented, like push() */
 
-    op1 = get_op1();
-    switch( funct_from_op( op1 ) )
+static void jit_push_begin()
+{
+    jit_alu_imm( 5, HR_RBX, sizeof( oi_t ) );
+} /* jit_push_begin */
+
+static void jit_push_end() /* the value is in rcx */
+{
+    jit_rr( 0x89, HR_RAX, HR_RBX );
+    jit_mask_rax();
+    jit_store( 3 );
+} /* jit_push_end */
+
+static void jit_pop_rcx()
+{
+    jit_rr( 0x89, HR_RAX, HR_RBX );
+    jit_mask_rax();
+    jit_load( 3 );
+    jit_alu_imm( 0, HR_RBX, sizeof( oi_t ) );
+} /* jit_pop_rcx */
+
+/* return to the guest caller: pop rpc, optionally rframe, zero rres, and drop more items */
+
+static void jit_return( bool pop_frame, bool zero_res, oi_t extra )
+{
+    if ( zero_res )
+        jit_mov_imm( HR_R14, 0 );
+    jit_pop_rcx();
+    jit_rr( 0x89, HR_RDX, HR_RCX );
+    if ( pop_frame )
     {
-        case 0:  /* ld / ldb rdst, [address] */
-        {
-            if ( 0 == reg_from_op( op ) ) /* can't write to rzero */
-                break;
+        jit_pop_rcx();
+        jit_rr( 0x89, HR_RBP, HR_RCX );
+    }
+    jit_add_imm( HR_RBX, extra );
+    jit_rr( 0x89, HR_RAX, HR_RDX );
+    jit_byte( 0xc3 );
+} /* jit_return */
 
-            val = g_oi.rpc + (int16_t) get_word( g_oi.rpc + 2 );
-            width = width_from_op( op1 );
-            if ( 0 == width )
-                set_reg_from_op( op, get_byte( val ) );
-            else if_1_is_width
-                set_reg_from_op( op, get_word( val ) );
-#ifndef OI2
-             else if_2_is_width
-                 set_reg_from_op( op, get_dword( val ) );
-#ifdef OI8
-             else /* 3 == width */
-                 set_reg_from_op( op, get_qword( val ) );
-#endif /* OI8 */
-#endif /* OI2 */
-                break;
-        }
-        case 1: /* sti / stib [address] constant -8..7 stored in r1 */
-        {
-            val = g_oi.rpc + (int16_t) get_word( g_oi.rpc + 2 );
-
-            /* r0 has high 3 bits and r1 has low 3 bits of CONSTANT */
-            ival = sign_extend_oi( ( ( op << 1 ) & 0x38 ) | reg_from_op( op1 ), 5 );
-            width = width_from_op( op1 );
-            if ( 0 == width )
-                set_byte( val, (uint8_t) ival );
-            else if_1_is_width
-                set_word( val, (uint16_t) ival );
-#ifndef OI2
-            else if_2_is_width
-                set_dword( val, (uint32_t) ival );
-#ifdef OI8
-            else /* 3 == width */
-                set_qword( val, (uint64_t) ival );
-#endif /* OI8 */
-#endif /* OI2 */
-            break;
-        }
-        case 2: /* math r0dst, r1left, r2right, funct2MATH */
-        {
-            if ( 0 == reg_from_op( op ) ) /* can't write to rzero */
-                break;
+/* compare rax with rcx and return the x86 condition code that's set when the relation holds */
 
-            op2 = get_op2();
-            set_reg_from_op( op, Math( get_reg_from_op( op1 ), get_reg_from_op( op2 ), funct_from_op( op2 ) ) );
-            break;
-        }
-        case 3: /* cmp r0dst, r1left, r2right, funct2RELATION */
-        {
-            if ( 0 == reg_from_op( op ) ) /* can't write to rzero */
-                break;
+static size_t jit_relation( size_t relation )
+{
+    static const uint8_t conditions[ 8 ] = { 0xf, 0xc, 0x4, 0x5, 0xd, 0xe, 0x4, 0x5 };
 
-            op2 = get_op2();
-            set_reg_from_op( op, (oi_t) CheckRelation( get_reg_from_op( op1 ), get_reg_from_op( op2 ), funct_from_op( op2 ) ) );
-            break;
-        }
-        case 4: /* fzero r0index, r1array, MAX 0..65535 */
-        {
-            /* while index < MAX, look for a 0 at each index in the array */
-            limit = get_word( g_oi.rpc + 2 );
-            index = (oi_t) get_reg_from_op( op );
-            width = width_from_op( op1 );
-            if ( 0 == width )
-            {
-                pb = ram_address( get_reg_from_op( op1 ) );
-                while ( ( index < limit ) && ( 0 != pb[ index ] ) )
-                    index++;
-            }
-            else if_1_is_width
-            {
-                pw = (uint16_t *) ram_address( get_reg_from_op( op1 ) );
-                while ( ( index < limit ) && ( 0 != pw[ index ] ) )
-                    index++;
-            }
-#ifndef OI2
-            else if_2_is_width
-            {
-                pdw = (uint32_t *) ram_address( get_reg_from_op( op1 ) );
-                while ( ( index < limit ) && ( (uint32_t) 0 != pdw[ index ] ) )
-                    index++;
-            }
-#ifdef OI8
-            else /* 3 == width */
-            {
-                pqw = (uint64_t *) ram_address( get_reg_from_op( op1 ) );
-                while ( ( index < limit ) && ( 0 != pqw[ index ] ) )
-                    index++;
-            }
-#endif /* OI8 */
-#endif /* OI2 */
+    if ( relation >= 6 )
+        jit_seq( "\xa8\x01" );                     /* test al, 1 */
+    else if ( 2 == g_oi.image_width )
+        jit_seq( "\x66\x39\xc8" );                 /* cmp ax, cx */
+    else if ( 4 == g_oi.image_width )
+        jit_seq( "\x39\xc8" );                     /* cmp eax, ecx */
+    else
+        jit_seq( "\x48\x39\xc8" );                 /* cmp rax, rcx */
+    return conditions[ relation ];
+} /* jit_relation */
 
-            set_reg_from_op( op, index );
-            break;
-        }
-        case 5: /* stoi r0address[ r1index ], 2-byte sign-extended constant */
-        {
-            val16 = get_word( g_oi.rpc + 2 );
-            index = (oi_t) get_reg_from_op( op1 );
-            val = get_reg_from_op( op );
-            width = width_from_op( op1 );
-            if ( 0 == width )
-                set_byte( val + index, (uint8_t) val16 );
-            else if_1_is_width
-                set_word( val + 2 * index, val16 );
-#ifndef OI2
-            else if_2_is_width
-                set_dword( val + 4 * index, (int32_t) (int16_t) val16 );
-#ifdef OI8
-            else /* 3 == width */
-                set_qword( val + 8 * index, (int64_t) (int16_t) val16 );
-#endif /* OI8 */
-#endif /* OI2 */
-        }
-        case 6: /* stor r0address[ r1index ], r2value */
+static void jit_setcc( size_t cc )
+{
+    jit_byte( 0x0f );
+    jit_byte( 0x90 + cc );
+    jit_byte( 0xc0 );
+    jit_seq( "\x0f\xb6\xc0" );                     /* movzx eax, al */
+} /* jit_setcc */
+
+/* rax = rax math rcx */
+
+static void jit_math( size_t math )
+{
+    switch ( math )
+    {
+        case 0: { jit_rr( 0x01, HR_RAX, HR_RCX ); break; }
+        case 1: { jit_rr( 0x29, HR_RAX, HR_RCX ); break; }
+        case 2: { jit_seq( "\x48\x0f\xaf\xc1" ); break; }             /* imul rax, rcx */
+        case 3: { jit_seq( "\x48\x99\x48\xf7\xf9" ); break; }         /* cqo, idiv rcx */
+        case 4: { jit_rr( 0x09, HR_RAX, HR_RCX ); break; }
+        case 5: { jit_rr( 0x31, HR_RAX, HR_RCX ); break; }
+        case 6: { jit_rr( 0x21, HR_RAX, HR_RCX ); break; }
+        default: { jit_rr( 0x39, HR_RAX, HR_RCX ); jit_setcc( 0x5 ); break; }
+    }
+} /* jit_math */
+
+/* jump to a guest address in this region, or to an exit if it doesn't get compiled */
+
+static void jit_branch( size_t cc, oi_t target )
+{
+    if ( JIT_JMP == cc )
+        jit_byte( 0xe9 );
+    else
+    {
+        jit_byte( 0x0f );
+        jit_byte( 0x80 + cc );
+    }
+
+    jit_dword( 0 );
+    if ( ( target < g_code_limit ) && ( 0 != g_jit_native[ target ] ) )
+        jit_patch32( g_jit_p - 4, g_jit_native[ target ] );
+    else
+    {
+        g_jit_fixup_at[ g_jit_fixup_count ] = g_jit_p - 4;
+        g_jit_fixup_pc[ g_jit_fixup_count++ ] = target;
+        if ( target < g_code_limit )
+            g_jit_work[ g_jit_work_count++ ] = target;
+    }
+} /* jit_branch */
+
+/* call the guest address in rdi. the caller has done the pushes */
+
+static void jit_call( oi_t return_pc )
+{
+    jit_alu_imm( 7, HR_RDI, (int32_t) g_code_limit );
+    jit_seq( "\x72\x04\x48\x89\xf8\xc3" );         /* jb past; mov rax, rdi; ret */
+    jit_byte( 0x48 );                              /* mov rax, g_jit_entry */
+    jit_byte( 0xb8 );
+    jit_qword( (uint64_t) (size_t) g_jit_entry );
+    jit_seq( "\xff\x14\xf8" );                     /* call [ rax + rdi * 8 ] */
+    jit_byte( 0x48 );                              /* cmp rax, return_pc */
+    jit_byte( 0x3d );
+    jit_dword( (uint32_t) return_pc );
+    jit_seq( "\x74\x01\xc3" );                     /* je past; ret */
+} /* jit_call */
+
+/* push rframe and the return address and point rframe at the first local, like call */
+
+static void jit_call_frame( oi_t return_pc )
+{
+    jit_push_begin();
+    jit_rr( 0x89, HR_RCX, HR_RBP );
+    jit_push_end();
+    jit_push_begin();
+    jit_mov_imm( HR_RCX, return_pc );
+    jit_push_end();
+    jit_rr( 0x89, HR_RBP, HR_RBX );
+    jit_alu_imm( 5, HR_RBP, sizeof( oi_t ) );
+} /* jit_call_frame */
+
+static void jit_push_pc( oi_t return_pc )
+{
+    jit_push_begin();
+    jit_mov_imm( HR_RCX, return_pc );
+    jit_push_end();
+} /* jit_push_pc */
+
+/* the JitOp functions emit code for one instruction and return its length, or 0 to leave it to the interpreter */
+
+static opcode_t JitOp1( opcode_t op, bool * pends )
+{
+    opcode_t g;
+    size_t hr;
+
+    switch ( op )
+    {
+        case 0x08: { jit_return( true, true, 0 ); * pends = true; return 1; }   /* ret0 */
+        case 0x48: { jit_return( false, true, 0 ); * pends = true; return 1; }  /* ret0nf */
+        case 0x68: { jit_return( false, false, 0 ); * pends = true; return 1; } /* retnf */
+        case 0xc0: { jit_return( true, false, 0 ); * pends = true; return 1; }  /* ret */
+        case 0x20: { jit_pop_rcx(); jit_seq( "\x49\x0f\xaf\xce" ); jit_rr( 0x89, HR_R14, HR_RCX ); return 1; } /* imulst */
+        case 0x28: { jit_shl( HR_R14, g_oi.image_shift ); return 1; }          /* shlimg */
+        case 0x60: { jit_alu_imm( 0, HR_RBX, sizeof( oi_t ) ); return 1; }     /* pop rzero */
+        case 0x80: { jit_pop_rcx(); jit_rr( 0x29, HR_RCX, HR_R14 ); jit_rr( 0x89, HR_R14, HR_RCX ); return 1; } /* subst */
+        case 0x84: { jit_mov_imm( HR_R14, g_oi.image_width ); return 1; }      /* imgwid */
+        case 0x88: { jit_ext( 0xc1, 5, HR_R14 ); jit_byte( g_oi.image_shift ); return 1; } /* shrimg */
+        case 0xa0: { jit_pop_rcx(); jit_rr( 0x01, HR_R14, HR_RCX ); return 1; } /* addst */
+        case 0xa8: /* idivst */
         {
-            index = (oi_t) get_reg_from_op( op1 );
-            val = get_reg_from_op( op );
-            width = width_from_op( op1 );
-            if ( 0 == width )
-                set_byte( val + index, (uint8_t) get_reg_from_op( get_op2() ) );
-            else if_1_is_width
-                set_word( val + 2 * index, (uint16_t) get_reg_from_op( get_op2() ) );
-#ifndef OI2
-            else if_2_is_width
-                set_dword( val + 4 * index, (uint32_t) get_reg_from_op( get_op2() ) );
-#ifdef OI8
-            else /* 3 == width */
-                set_qword( val + 8 * index, get_reg_from_op( get_op2() ) );
-#endif /* OI8 */
-#endif /* OI2 */
+            jit_pop_rcx();
+            jit_rr( 0x89, HR_RAX, HR_RCX );
+            jit_seq( "\x48\x99\x49\xf7\xfe" );     /* cqo, idiv r14 */
+            jit_rr( 0x89, HR_R14, HR_RAX );
+            return 1;
         }
-        case 7: /* ldor r0destination, r1address[ r2index ] */
+        case 0xc8: { jit_mov_imm( HR_R14, sizeof( oi_t ) ); return 1; }        /* natwid */
+        case 0xe0: { jit_pop_rcx(); jit_rr( 0x21, HR_R14, HR_RCX ); return 1; } /* andst */
+        case 0x00: case 0xa4: case 0xc4: case 0xe4: case 0xe8: { return 0; }   /* halt and illegal */
+    }
+
+    g = reg_from_op( op );
+    if ( 1 == g )
+        return 0;
+    hr = g_jit_hreg[ g ];
+
+    switch ( funct_from_op( op ) )
+    {
+        case 0: { jit_ext( 0xff, 0, hr ); break; }
+        case 1: { jit_ext( 0xff, 1, hr ); break; }
+        case 2: { jit_push_begin(); jit_get( HR_RCX, g ); jit_push_end(); break; }
+        case 3: { jit_pop_rcx(); jit_put( g, HR_RCX ); break; }
+        case 4: { jit_mov_imm( hr, 0 ); break; }
+        case 5: { jit_ext( 0xd1, 4, hr ); break; }
+        case 6: { jit_ext( 0xd1, 5, hr ); break; }
+        default: /* inv */
         {
-            index = (oi_t) get_reg_from_op( get_op2() );
-            val = get_reg_from_op( op1 );
-            width = width_from_op( op1 );
-            if ( 0 == width )
-                set_reg_from_op( op, (int8_t) get_byte( val + index ) );
-            else if_1_is_width
-                set_reg_from_op( op, (int16_t) get_word( val + 2 * index ) );
-#ifndef OI2
-            else if_2_is_width
-                set_reg_from_op( op, (int32_t) get_dword( val + 4 * index ) );
-#ifdef OI8
-            else /* 3 == width */
-                set_reg_from_op( op, get_qword( val + 8 * index ) );
-#endif /* OI8 */
-#endif /* OI2 */
+            jit_rr( 0x85, hr, hr );
+            jit_setcc( 0x4 );
+            jit_put( g, HR_RAX );
+            break;
         }
     }
-} /* op_c0_d0_do */
+    return 1;
+} /* JitOp1 */
 
-uint32_t ExecuteOI()
+static opcode_t JitOp2( oi_t pc, opcode_t op, opcode_t op1, bool * pends )
 {
-#ifndef OI2
-    opcode_t byte_len;
-#endif /* OI2 */
-    opcode_t op, op1, width;
-    oi_t val;
-    ioi_t ival;
-    uint32_t instruction_count;
+    opcode_t g0, g1, funct1, raw_width;
+    size_t width, cc;
+    uint8_t * p, * pdone;
 
-    uint8_t funct1;
-    oi_t reg1;
-
-    instruction_count = 0;
+    g0 = reg_from_op( op );
+    g1 = reg_from_op( op1 );
+    funct1 = funct_from_op( op1 );
+    raw_width = width_from_op( op1 );
+    width = jit_width( raw_width );
 
-    do
+    switch ( funct_from_op( op ) )
     {
-#ifndef NDEBUG
-        assert( (oi_t) 0 == g_oi.rzero );
-        assert( (oi_t) 0 == read_imgword( 0 ) );
-
-        if ( g_OIState )
+        case 0: /* math */
         {
-            if ( g_OIState & OI_FLAG_TRACE_INSTRUCTIONS )
-                TraceState();
+            if ( g0 <= 1 || 1 == g1 )
+                return 0;
+            jit_get( HR_RAX, g0 );
+            jit_get( HR_RCX, g1 );
+            jit_math( funct1 );
+            jit_put( g0, HR_RAX );
+            return 2;
         }
-        instruction_count++;
-#endif /* NDEBUG */
-        op = get_op();
-        switch( op )
+        case 1: /* cmov and mov */
+        case 6:
         {
-            case 0x00: { OIHalt(); goto _all_done; } /* halt */
-            case 0x04: case 0x0c: case 0x10: case 0x14: case 0x18: case 0x1c: /* inc r */
-            {
-                inc_reg_from_op( op );
-                break;
-            }
-            case 0x08: /* ret0: move 0 to rres and return */
-            {
-                g_oi.rres = 0;
-                pop( g_oi.rpc );
-                pop( g_oi.rframe );
-                continue;
-            }
-            case 0x20: /* imulst */
-            {
-                pop( val );
-                g_oi.rres = (ioi_t) val * (ioi_t) g_oi.rres;
-                break;
-            }
-            case 0x24: case 0x2c: case 0x30: case 0x34: case 0x38: case 0x3c: /* dec r */
-            {
-                dec_reg_from_op( op );
-                break;
-            }
-            case 0x28: /* shlimg */
-            {
-                g_oi.rres <<= g_oi.image_shift;
-                break;
-            }
-            case 0x40: case 0x44: case 0x4c: case 0x50: case 0x54: case 0x58: case 0x5c: /* push r */
-            {
-                push( get_reg_from_op( op ) );
-                break;
-            }
-            case 0x48: /* ret0nf */
-            {
-                g_oi.rres = 0;
-                pop( g_oi.rpc );
-                continue;
-            }
-            case 0x60: /* pop rzero */
-            {
-                pop_empty(); /* don't overwrite rzero */
-                break;
-            }
-            case 0x64: case 0x6c: case 0x70: case 0x74: case 0x78: case 0x7c: /* pop r */
-            {
-                pop( val );
-                set_reg_from_op( op, val );
-                break;
-            }
-            case 0x68: /* retnf */
-            {
-                pop( g_oi.rpc );
-                continue;
-            }
-            case 0x80: /* subst */
-            {
-                pop( val );
-                g_oi.rres = val - g_oi.rres;
-                break;
-            }
-            case 0x84: /* imgwid */
-            {
-                g_oi.rres = IMAGE_WIDTH;
-                break;
-            }
-            case 0x8c: case 0x90: case 0x94: case 0x98: case 0x9c: /* zero r */
-            {
-                set_reg_from_op( op, 0 );
-                break;
-            }
-            case 0x88: /* shrimg */
-            {
-                g_oi.rres >>= g_oi.image_shift;
-                break;
-            }
-            case 0xa0: /* addst */
-            {
-                pop( val );
-                g_oi.rres += val;
-                break;
-            }
-            case 0xac: case 0xb0: case 0xb4: case 0xb8: case 0xbc: /* shl r */
-            {
-                set_reg_from_op( op, get_reg_from_op( op ) << 1 );
-                break;
-            }
-            case 0xa8: /* idivst */
-            {
-                pop( val );
-                g_oi.rres = (ioi_t) val / (ioi_t) g_oi.rres;
-                break;
-            }
-            case 0xc0: /* ret */
-            {
-                pop( g_oi.rpc );
-                pop( g_oi.rframe );
-                continue;
-            }
-            case 0xc8: /* natwid */
+            if ( g0 <= 1 || 1 == g1 )
+                return 0;
+            jit_get( HR_RCX, g1 );
+            if ( 1 == funct_from_op( op ) && 3 != funct1 )
             {
-                g_oi.rres = sizeof( oi_t );
-                break;
+                jit_get( HR_RAX, g0 );
+                p = jit_jcc8( jit_relation( funct1 ) ^ 1 );
+                jit_put( g0, HR_RCX );
+                jit_patch8( p );
             }
-            case 0xcc: case 0xd0: case 0xd4: case 0xd8: case 0xdc: /* shr r */
+            else
+                jit_put( g0, HR_RCX );
+            return 2;
+        }
+        case 2: /* cmpst */
+        case 7: /* mathst */
+        {
+            if ( g0 <= 1 || 1 == g1 )
+                return 0;
+            jit_pop_rcx();
+            jit_rr( 0x89, HR_RAX, HR_RCX );
+            jit_get( HR_RCX, g1 );
+            if ( 2 == funct_from_op( op ) )
+                jit_setcc( jit_relation( funct1 ) );
+            else
+                jit_math( funct1 );
+            jit_put( g0, HR_RAX );
+            return 2;
+        }
+        case 3:
+        {
+            switch ( funct1 )
             {
-                set_reg_from_op( op, get_reg_from_op( op ) >> 1 );
-                break;
+                case 0: /* ldf */
+                {
+                    if ( g0 <= 1 )
+                        return 0;
+                    jit_frame_address( g1 );
+                    jit_load( 3 );
+                    jit_put( g0, HR_RCX );
+                    return 2;
+                }
+                case 1: /* stf */
+                {
+                    if ( 1 == g0 )
+                        return 0;
+                    jit_frame_address( g1 );
+                    jit_get( HR_RCX, g0 );
+                    jit_store( 3 );
+                    return 2;
+                }
+                case 2: /* ret x */
+                {
+                    jit_return( true, false, (oi_t) ( sizeof( oi_t ) * ( 1 + g1 ) ) );
+                    * pends = true;
+                    return 2;
+                }
+                case 3: /* ldib */
+                {
+                    if ( g0 <= 1 )
+                        return 0;
+                    jit_mov_imm( g_jit_hreg[ g0 ], sign_extend_oi( ( op1 & 0x1f ), 4 ) );
+                    return 2;
+                }
+                case 4: /* signex */
+                {
+                    if ( g0 <= 1 )
+                        return 0;
+                    jit_get( HR_RAX, g0 );
+                    if ( 0 == width )
+                        jit_seq( "\x48\x0f\xbe\xc0" );     /* movsx rax, al */
+                    else if ( 1 == width )
+                        jit_seq( "\x48\x0f\xbf\xc0" );     /* movsx rax, ax */
+                    else if ( 2 == width )
+                        jit_seq( "\x48\x63\xc0" );         /* movsxd rax, eax */
+                    jit_put( g0, HR_RAX );
+                    return 2;
+                }
+                case 5: /* memf */
+                {
+                    if ( 0 == width )
+                    {
+                        jit_rr( 0x89, HR_RAX, 12 );
+                        jit_rr( 0x01, HR_RAX, HR_R14 );
+                        jit_mask_rax();
+                    }
+                    else
+                    {
+                        jit_rr( 0x89, HR_RAX, 12 );
+                        jit_mask_rax();
+                        jit_rr( 0x89, HR_RDX, HR_R14 );
+                        jit_shl( HR_RDX, width );
+                        jit_rr( 0x01, HR_RAX, HR_RDX );
+                    }
+                    jit_code_check( pc );
+                    jit_seq( "\x48\x8d\x3c\x06" );         /* lea rdi, [ rsi + rax ] */
+                    jit_rr( 0x89, HR_RCX, 13 );
+                    jit_rr( 0x89, HR_RAX, HR_R15 );
+                    if ( 0 == width )
+                        jit_seq( "\xf3\xaa" );             /* rep stosb */
+                    else if ( 1 == width )
+                        jit_seq( "\x66\xf3\xab" );         /* rep stosw */
+                    else if ( 2 == width )
+                        jit_seq( "\xf3\xab" );             /* rep stosd */
+                    else
+                        jit_seq( "\xf3\x48\xab" );         /* rep stosq */
+                    return 2;
+                }
+                case 6: /* stadd. only the byte form, which is what sieves use */
+                {
+                    if ( 0 != raw_width )
+                        return 0;
+                    jit_rr( 0x89, HR_RAX, HR_R15 );
+                    jit_rr( 0x01, HR_RAX, 12 );
+                    jit_mask_rax();
+                    jit_code_check( pc );
+                    jit_seq( "\x48\x8d\x04\x06" );         /* lea rax, [ rsi + rax ] */
+                    jit_rr( 0x89, HR_RCX, HR_R14 );
+                    jit_rr( 0x29, HR_RCX, HR_R15 );
+                    jit_rr( 0x01, HR_RCX, HR_RAX );        /* rcx = last byte that may be cleared */
+                    p = g_jit_p;
+                    jit_seq( "\xc6\x00\x00" );             /* mov byte [ rax ], 0 */
+                    jit_rr( 0x01, HR_RAX, 13 );
+                    jit_rr( 0x39, HR_RAX, HR_RCX );
+                    jit_byte( 0x76 );                      /* jbe */
+                    jit_byte( (uint8_t) ( p - ( g_jit_p + 1 ) ) );
+                    return 2;
+                }
+                default: /* moddiv */
+                {
+                    if ( g0 <= 1 || 1 == g1 )
+                        return 0;
+                    jit_get( HR_RCX, g1 );
+                    jit_rr( 0x85, HR_RCX, HR_RCX );
+                    p = jit_jcc8( 0x5 );
+                    jit_push_begin();
+                    jit_push_end();                        /* rcx is 0 */
+                    pdone = jit_jmp8();
+                    jit_patch8( p );
+                    jit_get( HR_RAX, g0 );
+                    jit_seq( "\x31\xd2\x48\xf7\xf1" );     /* xor edx, edx; div rcx */
+                    jit_put( g0, HR_RDX );
+                    jit_rr( 0x89, HR_RCX, HR_RAX );
+                    jit_push_begin();
+                    jit_push_end();
+                    jit_patch8( pdone );
+                    return 2;
+                }
             }
-            case 0xec: case 0xf0: case 0xf4: case 0xf8: case 0xfc: /* inv r */
+        }
+        case 4:
+        {
+            switch ( funct1 )
             {
-                set_reg_from_op( op, ! get_reg_from_op( op ) );
-                break;
+                case 1: /* pushf */
+                {
+                    jit_frame_address( g1 );
+                    jit_load( 3 );
+                    jit_push_begin();
+                    jit_push_end();
+                    return 2;
+                }
+                case 2: /* stst. check the address before the pop so an exit leaves the stack alone */
+                {
+                    if ( 1 == g0 )
+                        return 0;
+                    jit_rr( 0x89, HR_RAX, HR_RBX );
+                    jit_mask_rax();
+                    jit_load( 3 );
+                    jit_rr( 0x89, HR_RAX, HR_RCX );
+                    jit_mask_rax();
+                    jit_code_check( pc );
+                    jit_alu_imm( 0, HR_RBX, sizeof( oi_t ) );
+                    jit_get( HR_RCX, g0 );
+                    jit_store( g_oi.image_shift );
+                    return 2;
+                }
+                case 3: /* addimgw and subimgw */
+                case 6: /* addnatw and subnatw */
+                {
+                    if ( raw_width < 2 )
+                    {
+                        if ( g0 <= 1 )
+                            return 0;
+                        cc = ( 3 == funct1 ) ? g_oi.image_width : sizeof( oi_t );
+                        jit_alu_imm( ( 0 == raw_width ) ? 0 : 5, g_jit_hreg[ g0 ], (int32_t) cc );
+                    }
+                    return 2;
+                }
+                case 4: /* stinc [reg0], reg1 */
+                {
+                    if ( g0 <= 1 || 1 == g1 )
+                        return 0;
+                    jit_rr( 0x89, HR_RAX, g_jit_hreg[ g0 ] );
+                    jit_mask_rax();
+                    jit_code_check( pc );
+                    jit_get( HR_RCX, g1 );
+                    jit_store( width );
+                    jit_alu_imm( 0, g_jit_hreg[ g0 ], 1 << raw_width );
+                    return 2;
+                }
+                case 5: /* swap */
+                {
+                    if ( g0 <= 1 || g1 <= 1 )
+                        return 0;
+                    jit_rr( 0x89, HR_RAX, g_jit_hreg[ g0 ] );
+                    jit_rr( 0x89, g_jit_hreg[ g0 ], g_jit_hreg[ g1 ] );
+                    jit_rr( 0x89, g_jit_hreg[ g1 ], HR_RAX );
+                    return 2;
+                }
+                case 7: { return 2; }
+                default: { return 0; } /* syscall */
             }
-            case 0xe0: /* andst */
+        }
+        default: /* 5 */
+        {
+            switch ( funct1 )
             {
-                pop( val );
-                g_oi.rres &= val;
-                break;
+                case 0: /* st [reg0], reg1 */
+                {
+                    if ( 1 == g0 || 1 == g1 )
+                        return 0;
+                    jit_get( HR_RAX, g0 );
+                    jit_mask_rax();
+                    jit_code_check( pc );
+                    jit_get( HR_RCX, g1 );
+                    jit_store( width );
+                    return 2;
+                }
+                case 1: /* ld reg0, [reg1] */
+                {
+                    if ( g0 <= 1 || 1 == g1 )
+                        return 0;
+                    jit_get( HR_RAX, g1 );
+                    jit_mask_rax();
+                    jit_load( width );
+                    jit_put( g0, HR_RCX );
+                    return 2;
+                }
+                case 2: /* pushtwo */
+                {
+                    if ( 1 == g0 || 1 == g1 )
+                        return 0;
+                    jit_push_begin();
+                    jit_get( HR_RCX, g0 );
+                    jit_push_end();
+                    jit_push_begin();
+                    jit_get( HR_RCX, g1 );
+                    jit_push_end();
+                    return 2;
+                }
+                case 3: /* poptwo */
+                {
+                    if ( g0 <= 1 || g1 <= 1 )
+                        return 0;
+                    jit_pop_rcx();
+                    jit_put( g0, HR_RCX );
+                    jit_pop_rcx();
+                    jit_put( g1, HR_RCX );
+                    return 2;
+                }
+                default: { return 0; } /* cas, xadd, xchg, and fence */
             }
-            case 0x06: case 0x0a: case 0x0e: /* ld r, [address] */
-            case 0x12: case 0x16: case 0x1a: case 0x1e:
+        }
+    }
+} /* JitOp2 */
+
+static opcode_t JitOp3( oi_t pc, opcode_t op, bool * pends )
+{
+    opcode_t g0, len;
+    oi_t imm;
+
+    g0 = reg_from_op( op );
+    len = g_oi.three_byte_len;
+    imm = read_imgword( pc + 1 );
+
+    if ( 1 == g0 )
+        return 0;
+
+    switch ( funct_from_op( op ) )
+    {
+        case 0: /* ld */
+        {
+            if ( 0 == g0 )
+                return 0;
+            jit_mov_imm( HR_RAX, imm );
+            jit_mask_rax();
+            jit_load_signed( g_oi.image_shift );
+            jit_put( g0, HR_RCX );
+            break;
+        }
+        case 1: /* ldi */
+        {
+            if ( 0 == g0 )
+                return 0;
+            jit_mov_imm( g_jit_hreg[ g0 ], imm );
+            break;
+        }
+        case 2: /* st */
+        {
+            if ( code_address( imm ) < g_code_limit )
+                return 0;
+            jit_mov_imm( HR_RAX, imm );
+            jit_mask_rax();
+            jit_get( HR_RCX, g0 );
+            jit_store( g_oi.image_shift );
+            break;
+        }
+        case 3: /* jmp */
+        {
+            * pends = true;
+            if ( 0 == g0 )
+                jit_branch( JIT_JMP, imm );
+            else
             {
-                set_reg_from_op( op, read_imgword( read_imgword( g_oi.rpc + 1 ) ) );
-                break;
+                jit_get( HR_RAX, g0 );
+                jit_shl( HR_RAX, 3 );
+                jit_add_imm( HR_RAX, imm );
+                jit_byte( 0xc3 );
             }
-            case 0x26: case 0x2a: case 0x2e: /* ldi r, value */
-            case 0x32: case 0x36: case 0x3a: case 0x3e:
+            break;
+        }
+        case 4: /* inc [address + reg0] */
+        case 5: /* dec [address + reg0] */
+        {
+            jit_get( HR_RAX, g0 );
+            jit_add_imm( HR_RAX, imm );
+            jit_mask_rax();
+            jit_code_check( pc );
+            if ( 2 == g_oi.image_width )
+                jit_byte( 0x66 );
+            else if ( 8 == g_oi.image_width )
+                jit_byte( 0x48 );
+            jit_byte( 0xff );
+            jit_byte( ( 4 == funct_from_op( op ) ) ? 0x04 : 0x0c );
+            jit_byte( 0x06 );
+            break;
+        }
+        case 6: /* ldae */
+        {
+            jit_get( HR_RAX, g0 );
+            jit_shl( HR_RAX, g_oi.image_shift );
+            jit_add_imm( HR_RAX, imm );
+            jit_mask_rax();
+            jit_load_signed( g_oi.image_shift );
+            jit_rr( 0x89, HR_R14, HR_RCX );
+            break;
+        }
+        default: /* call */
+        {
+            jit_call_frame( pc + len );
+            jit_get( HR_RDI, g0 );
+            jit_shl( HR_RDI, g_oi.image_shift );
+            jit_add_imm( HR_RDI, imm );
+            jit_call( pc + len );
+            break;
+        }
+    }
+    return len;
+} /* JitOp3 */
+
+static opcode_t JitOp4( oi_t pc, opcode_t op, opcode_t op1, opcode_t op2, bool * pends )
+{
+    opcode_t g0, g1, g2, funct1, raw_width;
+    size_t width, cc;
+    ioi_t ival;
+    oi_t address;
+    uint8_t * p, * ploop;
+
+    g0 = reg_from_op( op );
+    g1 = reg_from_op( op1 );
+    g2 = reg_from_op( op2 );
+    funct1 = funct_from_op( op1 );
+    raw_width = width_from_op( op1 );
+    width = jit_width( raw_width );
+    ival = (ioi_t) (int16_t) get_word( pc + 2 );
+    address = pc + ival;
+
+    if ( 1 == g0 )
+        return 0;
+
+    switch ( funct_from_op( op ) )
+    {
+        case 0: /* j, ji, jrelb, jrel */
+        {
+            if ( 1 != raw_width && 1 == g1 )
+                return 0;
+            if ( 0 == raw_width )
+                jit_get( HR_RCX, g1 );
+            else if ( 1 == raw_width )
+                jit_mov_imm( HR_RCX, 1 + g1 );
+            else
             {
-                set_reg_from_op( op, read_imgword( g_oi.rpc + 1 ) );
-                break;
+                jit_get( HR_RAX, g1 );
+                jit_add_imm( HR_RAX, op2 );
+                jit_mask_rax();
+                if ( 2 == raw_width )
+                    jit_load( 0 );
+                else
+                    jit_load_signed( g_oi.image_shift );
+                ival = (ioi_t) (int8_t) get_byte( pc + 3 );
+                address = pc + ival;
             }
-            case 0x42: case 0x46: case 0x4a: case 0x4e: /* st [address], r */
-            case 0x52: case 0x56: case 0x5a: case 0x5e:
+            /* j reg, reg with eq, ge, or le is an unconditional jump or return */
+            * pends = ( 0 == raw_width ) && ( g0 == g1 ) && ( 2 == funct1 || 4 == funct1 || 5 == funct1 );
+            p = 0;
+            cc = JIT_JMP;
+            if ( ! * pends )
             {
-                write_imgword( read_imgword( g_oi.rpc + 1 ), get_reg_from_op( op ) );
-                break;
+                jit_get( HR_RAX, g0 );
+                cc = jit_relation( funct1 );
             }
-            case 0x62: case 0x66: case 0x6a: case 0x6e: /* jmp address */
-            case 0x72: case 0x76: case 0x7a: case 0x7e:
+
+            if ( (oi_t) ival <= (oi_t) 3 )
             {
-                g_oi.rpc = read_imgword( g_oi.rpc + 1 ) + ( sizeof( oi_t ) * get_reg_from_op( op ) );
-                continue;
+                if ( ! * pends )
+                    p = jit_jcc8( cc ^ 1 );
+                jit_return( 0 == ( ival & 1 ), ival >= 2, 0 );
+                if ( 0 != p )
+                    jit_patch8( p );
             }
-            case 0x82: case 0x86: case 0x8a: case 0x8e: /* inc [address] */
-            case 0x92: case 0x96: case 0x9a: case 0x9e:
+            else
+                jit_branch( cc, address );
+            return 4;
+        }
+        case 1: /* stinc [reg0], constant */
+        {
+            if ( 0 == g0 )
+                return 0;
+            jit_rr( 0x89, HR_RAX, g_jit_hreg[ g0 ] );
+            jit_mask_rax();
+            jit_code_check( pc );
+            jit_mov_imm( HR_RCX, (oi_t) ival );
+            jit_store( width );
+            jit_alu_imm( 0, g_jit_hreg[ g0 ], 1 << raw_width );
+            return 4;
+        }
+        case 2: /* ldinc */
+        {
+            if ( g0 <= 1 || g1 <= 1 )
+                return 0;
+            jit_rr( 0x89, HR_RAX, g_jit_hreg[ g1 ] );
+            jit_add_imm( HR_RAX, address );
+            jit_mask_rax();
+            jit_load( width );
+            jit_put( g0, HR_RCX );
+            jit_alu_imm( 0, g_jit_hreg[ g1 ], 1 << raw_width );
+            return 4;
+        }
+        case 3: /* callt, callnft, callnf */
+        {
+            if ( 0 == funct1 )
+                jit_call_frame( pc + 4 );
+            else
+                jit_push_pc( pc + 4 );
+            jit_get( HR_RAX, g0 );
+            jit_shl( HR_RAX, g_oi.image_shift );
+            jit_add_imm( HR_RAX, address );
+            if ( funct1 < 2 )
             {
-#ifdef OI2
-                ( * (oi_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )++;
-#else
-                if ( 2 == g_oi.image_width )
-                    ( * (uint16_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )++;
-                else if ( 4 == g_oi.image_width )
-                    ( * (uint32_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )++;
-#ifdef OI8
-                else if ( 8 == g_oi.image_width )
-                    ( * (uint64_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )++;
-#endif /* OI8 */
-#endif /* OI2 */
-                break;
+                jit_mask_rax();
+                jit_load_signed( g_oi.image_shift );
+                jit_rr( 0x89, HR_RDI, HR_RCX );
             }
-            case 0xa2: case 0xa6: case 0xaa: case 0xae: /* dec [address] */
-            case 0xb2: case 0xb6: case 0xba: case 0xbe: 
+            else
+                jit_rr( 0x89, HR_RDI, HR_RAX );
+            jit_call( pc + 4 );
+            return 4;
+        }
+        case 4: /* sto */
+        {
+            if ( 1 == g1 )
+                return 0;
+            jit_get( HR_RAX, g1 );
+            jit_shl( HR_RAX, width );
+            jit_add_imm( HR_RAX, address );
+            jit_mask_rax();
+            jit_code_check( pc );
+            jit_get( HR_RCX, g0 );
+            jit_store( width );
+            return 4;
+        }
+        case 5:
+        {
+            if ( 0xa3 == op ) /* cpuinfo */
             {
-#ifdef OI2
-                ( * (oi_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )--;
-#else
-                if ( 2 == g_oi.image_width )
-                    ( * (uint16_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )--;
-                else if ( 4 == g_oi.image_width )
-                    ( * (uint32_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )--;
-#ifdef OI8
-                else if ( 8 == g_oi.image_width )
-                    ( * (uint64_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )--;
-#endif /* OI8 */
-#endif /* OI2 */
-                break;
+                jit_mov_imm( HR_R14, 1 );
+                jit_mov_imm( HR_R15, 'd' + ( 'l' << 8 ) );
+                return 4;
             }
-            case 0xc2: case 0xc6: case 0xca: case 0xce: /* ldae rres (implied), address[ r ] */
-            case 0xd2: case 0xd6: case 0xda: case 0xde: 
+            if ( 0 == g0 || 1 == g1 )
+                return 0;
+            if ( 2 == funct1 ) /* ldiw */
             {
-                val = get_reg_from_op( op ); /* separate statement needed for HiSoft C on CP/M */
-                g_oi.rres = read_imgword( read_imgword( g_oi.rpc + 1 ) + ( IMAGE_WIDTH * val ) );
-                break;
+                jit_mov_imm( g_jit_hreg[ g0 ], (oi_t) ival );
+                return 4;
             }
-            case 0xe2: case 0xe6: case 0xea: case 0xee: /* call address / call reg0 + address */
-            case 0xf2: case 0xf6: case 0xfa: case 0xfe: 
+            if ( 1 == funct1 ) /* ldoinc */
             {
-                push( g_oi.rframe );
-                push( g_oi.rpc + 1 + IMAGE_WIDTH );
-                g_oi.rframe = g_oi.rsp - sizeof( oi_t ); /* point at first local variable (if any) */
-                g_oi.rpc = read_imgword( g_oi.rpc + 1 ) + ( IMAGE_WIDTH * get_reg_from_op( op ) );
-                continue;
+                if ( 0 == g1 )
+                    return 0;
+                jit_ext( 0xff, 0, g_jit_hreg[ g1 ] );
             }
-            case 0x03: case 0x07: case 0x0b: case 0x0f: /* j / ji / jrelb / jrel */
-            case 0x13: case 0x17: case 0x1b: case 0x1f:
+            jit_get( HR_RAX, g1 );
+            jit_shl( HR_RAX, width );
+            jit_add_imm( HR_RAX, address );
+            jit_mask_rax();
+            jit_load( width );
+            jit_put( g0, HR_RCX );
+            return 4;
+        }
+        case 6:
+        {
+            switch ( funct1 )
             {
-                op1 = get_op1();
-                switch( width_from_op( op1 ) )
+                case 0: /* ld reg0, [address] */
                 {
-                    case 0: /* j rleft, rright, relation, offset. */
-                    {
-                        if ( CheckRelation( get_reg_from_op( op ), get_reg_from_op( op1 ), funct_from_op( op1 ) ) )
-                        {
-                            ival = (int16_t) get_word( g_oi.rpc + 2 );
-                            if ( (oi_t) ival <= (oi_t) 3 )
-                                jump_return( ival );
-                            else
-                                g_oi.rpc += ival;
-                            continue;
-                        }
-                        break;
-                    }
-                    case 1: /* ji rleft, rrightCONSTANT, relation, offset. always native bit width. address extended to native width */
-                    {
-                        if ( CheckRelation( get_reg_from_op( op ), 1 + reg_from_op( op1 ), funct_from_op( op1 ) ) )
-                        {
-                            ival = (int16_t) get_word( g_oi.rpc + 2 );
-                            if ( (oi_t) ival <= (oi_t) 3 )
-                                jump_return( ival );
-                            else
-                                g_oi.rpc += ival;
-                            continue;
-                        }
-                        break;
-                    }
-                    case 2: /* jrelb r0left, r1rightADDRESS, offset (from r1right), RELATION, (-128..127 pc offset) */
+                    if ( 0 != g0 )
                     {
-                        if ( CheckRelation( get_reg_from_op( op ), get_byte( get_reg_from_op( op1 ) + get_byte( g_oi.rpc + 2 ) ), funct_from_op( op1 ) ) )
-                        {
-                            ival = (ioi_t) (int8_t) get_byte( g_oi.rpc + 3 );
-                            if ( (oi_t) ival <= (oi_t) 3 )
-                                jump_return( ival );
-                            else
-                                g_oi.rpc += ival;
-                            continue;
-                        }
-                        break;
-                    }
-                    default: /* case 3: */ /* jrel r0left, r1rightADDRESS, offset (from r1right), RELATION, (-128..127 pc offset) */
-                    {
-                        if ( jrel_do( op, op1 ) )
-                            continue;
-                        break;
+                        jit_mov_imm( HR_RAX, address );
+                        jit_mask_rax();
+                        jit_load( width );
+                        jit_put( g0, HR_RCX );
                     }
+                    return 4;
                 }
-                break;
-            }
-            case 0x23: case 0x27: case 0x2b: case 0x2f: /* stinc */
-            case 0x33: case 0x37: case 0x3b: case 0x3f:
-            {
-                stinc_do( op );
-                break;
-            }
-            case 0x47: case 0x4b: case 0x4f: /* ldinc reg0dst reg1offinc pc-relative-offset */
-            case 0x53: case 0x57: case 0x5b: case 0x5f:
-            {
-                ldinc_do( op );
-                break;
-            }
-            case 0x63: case 0x67: case 0x6b: case 0x6f: /* call through function pointer table and callnf variants */
-            case 0x73: case 0x77: case 0x7b: case 0x7f:
-            {
-                op1 = get_op1();
-                ival = (ioi_t) (int16_t) get_word( g_oi.rpc + 2 );
-                switch( funct_from_op( op1 ) )
+                case 1: /* sti */
                 {
-                    case 0: /* call address[ r0 ] */
-                    {
-                        push( g_oi.rframe );
-                        push( g_oi.rpc + 4 );
-                        g_oi.rframe = g_oi.rsp - sizeof( oi_t ); /* point at first local variable (if any) */
-                        val = get_reg_from_op( op );
-                        g_oi.rpc = read_imgword( g_oi.rpc + ival + ( IMAGE_WIDTH * val ) );
-                        continue;
-                    }
-                    case 1: /* callnf address[ r0 ] */
-                    {
-                        push( g_oi.rpc + 4 );
-                        val = get_reg_from_op( op );
-                        g_oi.rpc = read_imgword( g_oi.rpc + ival + ( IMAGE_WIDTH * val ) );
-                        continue;
-                    }
-                    default: /* case 2: */ /* callnf address */
-                    {
-                        push( g_oi.rpc + 4 );
-                        g_oi.rpc = g_oi.rpc + ival + ( IMAGE_WIDTH * get_reg_from_op( op ) );
-                        continue;
-                    }
+                    if ( code_address( address ) < g_code_limit )
+                        return 0;
+                    jit_mov_imm( HR_RAX, address );
+                    jit_mask_rax();
+                    jit_mov_imm( HR_RCX, sign_extend_oi( ( ( op << 1 ) & 0x38 ) | g1, 5 ) );
+                    jit_store( width );
+                    return 4;
                 }
-            }
-            case 0x83: case 0x87: case 0x8b: case 0x8f: /* sto address[ r1 ], r0 -- address is signed and pc-relative */
-            case 0x93: case 0x97: case 0x9b: case 0x9f:
-            {
-                op1 = get_op1();
-                width = width_from_op( op1 );
-                val = g_oi.rpc + (ioi_t) (int16_t) get_word( g_oi.rpc + 2 );
-                if ( 0 == width )
-                    set_byte( val + get_reg_from_op( op1 ), (uint8_t) get_reg_from_op( op ) );
-                else if_1_is_width
-                    set_word( val + ( get_reg_from_op( op1 ) << 1 ), (uint16_t) get_reg_from_op( op ) );
-#ifndef OI2
-                else if_2_is_width
-                    set_dword( val + ( get_reg_from_op( op1 ) << 2 ), (uint32_t) get_reg_from_op( op ) );
-#ifdef OI8
-                else /* 3 == width */
-                    set_qword( val + ( get_reg_from_op( op1 ) << 3 ), get_reg_from_op( op ) );
-#endif /* OI8 */
-#endif /* OI2 */
-                break;
-            }
-            case 0xa7: case 0xab: case 0xaf: /* ldo / ldob / ldoinc / ldoincb / ldiw */
-            case 0xb3: case 0xb7: case 0xbb: case 0xbf:
-            {
-                ival = (ioi_t) (int16_t) get_word( g_oi.rpc + 2 );
-                op1 = get_op1();
-                funct1 = funct_from_op( op1 );
-            
-                if ( 2 == funct1 )
-                    set_reg_from_op( op, (oi_t) ival ); /* ldiw */
-                else /* funct1 is 0 or 1 for ldo variants */
+                case 2: /* math r0, r1, r2 */
+                case 3: /* cmp r0, r1, r2 */
                 {
-                    if ( 1 == funct1 ) /* pre-increment register for ldoinc variants */
-                        inc_reg_from_op( op1 );
-                
-                    width = (uint8_t) width_from_op( op1 );
-                
-                    if ( (oi_t) 0 == width )
-                        set_reg_from_op( op, get_byte( g_oi.rpc + ival + get_reg_from_op( op1 ) ) ); /* ldob */
-                    else if_1_is_width
-                    {
-                        reg1 = get_reg_from_op( op1 ); /* separate statement required for HiSoft C on CP/M */
-                        set_reg_from_op( op, get_word( g_oi.rpc + ival + ( reg1 << 1 ) ) ); /* ldow */
-                    }
-#ifndef OI2
-                    else if_2_is_width
-                        set_reg_from_op( op, get_dword( g_oi.rpc + ival + ( get_reg_from_op( op1 ) << 2 ) ) ); /* ldodw */
-#ifdef OI8
+                    if ( 0 == g0 )
+                        return 4;
+                    if ( 1 == g1 || 1 == g2 )
+                        return 0;
+                    jit_get( HR_RAX, g1 );
+                    jit_get( HR_RCX, g2 );
+                    if ( 2 == funct1 )
+                        jit_math( funct_from_op( op2 ) );
                     else
-                        set_reg_from_op( op, get_qword( g_oi.rpc + ival + ( get_reg_from_op( op1 ) << 3 ) ) ); /* ldoqw */
-#endif /* OI8 */
-#endif /* OI2 */
+                        jit_setcc( jit_relation( funct_from_op( op2 ) ) );
+                    jit_put( g0, HR_RAX );
+                    return 4;
                 }
-                break;
+                case 4: /* fzero */
+                {
+                    if ( 0 == g0 || 1 == g1 )
+                        return 0;
+                    jit_get( HR_RAX, g1 );
+                    jit_mask_rax();
+                    jit_seq( "\x48\x8d\x14\x06" );         /* lea rdx, [ rsi + rax ] */
+                    jit_get( HR_RCX, g0 );
+                    ploop = g_jit_p;
+                    jit_alu_imm( 7, HR_RCX, (int32_t) (uint16_t) ival );
+                    p = jit_jcc8( 0x3 );                   /* jae done */
+                    if ( 0 == width )
+                        jit_seq( "\x80\x3c\x0a\x00" );     /* cmp byte [ rdx + rcx ], 0 */
+                    else if ( 1 == width )
+                        jit_seq( "\x66\x83\x3c\x4a\x00" ); /* cmp word [ rdx + rcx * 2 ], 0 */
+                    else if ( 2 == width )
+                        jit_seq( "\x83\x3c\x8a\x00" );     /* cmp dword [ rdx + rcx * 4 ], 0 */
+                    else
+                        jit_seq( "\x48\x83\x3c\xca\x00" ); /* cmp qword [ rdx + rcx * 8 ], 0 */
+                    jit_seq( "\x74\x05" );                 /* je done */
+                    jit_ext( 0xff, 0, HR_RCX );
+                    jit_byte( 0xeb );                      /* jmp loop */
+                    jit_byte( (uint8_t) ( ploop - ( g_jit_p + 1 ) ) );
+                    jit_patch8( p );
+                    jit_put( g0, HR_RCX );
+                    return 4;
+                }
+                case 7: /* ldor */
+                {
+                    if ( g0 <= 1 || 1 == g1 || 1 == g2 )
+                        return 0;
+                    jit_get( HR_RAX, g2 );
+                    jit_shl( HR_RAX, width );
+                    jit_get( HR_RCX, g1 );
+                    jit_rr( 0x01, HR_RAX, HR_RCX );
+                    jit_mask_rax();
+                    jit_load_signed( width );
+                    jit_put( g0, HR_RCX );
+                    return 4;
+                }
+                default: { return 0; } /* stoi and stor */
             }
-            case 0xc3: case 0xc7: case 0xcb: case 0xcf: /* ld / sti / stib / math / fzero / stoi / stor / ldor */
-            case 0xd3: case 0xd7: case 0xdb: case 0xdf:
+        }
+        default: /* cstf */
+        {
+            if ( 1 == g1 )
+                return 0;
+            jit_get( HR_RAX, g0 );
+            jit_get( HR_RCX, g1 );
+            p = jit_jcc8( jit_relation( funct1 ) ^ 1 );
+            jit_rr( 0x89, HR_RCX, HR_RAX );
+            jit_frame_address( g2 );
+            jit_store( 3 );
+            jit_patch8( p );
+            return 4;
+        }
+    }
+} /* JitOp4 */
+
+static opcode_t JitInstructionOI( oi_t pc, bool * pends )
+{
+    opcode_t op;
+    op = get_byte( pc );
+    * pends = false;
+
+    switch ( op & 3 )
+    {
+        case 0: { return JitOp1( op, pends ); }
+        case 1: { return JitOp2( pc, op, get_byte( pc + 1 ), pends ); }
+        case 2: { return JitOp3( pc, op, pends ); }
+        default: { return JitOp4( pc, op, get_byte( pc + 1 ), get_byte( pc + 2 ), pends ); }
+    }
+} /* JitInstructionOI */
+
+/* compile the region reachable from entry. returns false if nothing could be compiled or the buffer is full */
+
+static bool JitCompileOI( oi_t entry )
+{
+    oi_t pc;
+    opcode_t len;
+    size_t i, translated;
+    uint8_t * start;
+    bool ends;
+
+    if ( g_jit_used + ( JIT_MAX_REGION * ( JIT_INSTRUCTION_ROOM + 16 ) ) > JIT_CODE_SIZE )
+        return false;
+
+    start = g_jit_code + g_jit_used;
+    g_jit_p = start;
+    g_jit_work_count = 0;
+    g_jit_done_count = 0;
+    g_jit_fixup_count = 0;
+    translated = 0;
+    g_jit_work[ g_jit_work_count++ ] = entry;
+
+    while ( 0 != g_jit_work_count )
+    {
+        pc = g_jit_work[ --g_jit_work_count ];
+        if ( 0 != g_jit_native[ pc ] )
+            continue;
+
+        /* compile straight-line code until it ends or runs into code compiled already */
+        do
+        {
+            if ( pc >= g_code_limit )
             {
-                op_c0_d0_do( op );
+                jit_exit( pc );
                 break;
             }
-            case 0xe3: case 0xe7: case 0xeb: case 0xef: /* cstf r0left, r1right, funct1REL, reg2FRAMEOFFSET */
-            case 0xf3: case 0xf7: case 0xfb: case 0xff: /* fourth byte is currently unused */
+            if ( 0 != g_jit_native[ pc ] )
             {
-                cstf_do( op );
+                jit_branch( JIT_JMP, pc );
                 break;
             }
-            case 0x01: case 0x05: case 0x09: case 0x0d: /* math rdst/rleft, rright */
-            case 0x11: case 0x15: case 0x19: case 0x1d:
+            if ( g_jit_done_count >= JIT_MAX_REGION )
             {
-                op1 = get_op1();
-                set_reg_from_op( op, Math( get_reg_from_op( op ), get_reg_from_op( op1 ), funct_from_op( op1 ) ) );
+                jit_exit( pc );
                 break;
             }
-            case 0x25: case 0x29: case 0x2d: /* cmov r0dst, r1src, funct1REL */
-            case 0x31: case 0x35: case 0x39: case 0x3d:
+
+            g_jit_native[ pc ] = g_jit_p;
+            g_jit_done[ g_jit_done_count++ ] = pc;
+            len = JitInstructionOI( pc, & ends );
+            if ( 0 == len )
             {
-                cmov_do( op );
+                jit_exit( pc );
                 break;
             }
-            case 0x41: case 0x45: case 0x49: case 0x4d: /* cmpst rdst, rright, relation */
-            case 0x51: case 0x55: case 0x59: case 0x5d:
+            translated++;
+            pc += len;
+        } while ( !ends );
+    }
+
+    /* branches to addresses that weren't compiled exit to the interpreter */
+    for ( i = 0; i < g_jit_fixup_count; i++ )
+    {
+        pc = g_jit_fixup_pc[ i ];
+        if ( ( pc < g_code_limit ) && ( 0 != g_jit_native[ pc ] ) )
+            jit_patch32( g_jit_fixup_at[ i ], g_jit_native[ pc ] );
+        else
+        {
+            jit_patch32( g_jit_fixup_at[ i ], g_jit_p );
+            jit_exit( pc );
+        }
+    }
+
+    for ( i = 0; i < g_jit_done_count; i++ )
+        g_jit_native[ g_jit_done[ i ] ] = 0;
+
+    if ( 0 == translated )
+        return false;
+
+    g_jit_entry[ entry ] = start;
+    g_jit_used = (size_t) ( g_jit_p - g_jit_code );
+    return true;
+} /* JitCompileOI */
+
+/* count a call or back edge to address. returns the native entry once there is one */
+
+static const uint8_t * JitResolveOI( oi_t address )
+{
+    if ( g_jit_counts[ address ] >= JIT_THRESHOLD )
+        return 0; /* it didn't compile */
+
+    g_jit_counts[ address ]++;
+    if ( ( g_jit_counts[ address ] < JIT_THRESHOLD ) || !JitCompileOI( address ) )
+        return 0;
+    return g_jit_entry[ address ];
+} /* JitResolveOI */
+
+/* called by the interpreter for calls and back edges. returns true if native code ran and set g_oi.rpc */
+
+static bool JitProbeOI( oi_t address )
+{
+    const uint8_t * entry;
+
+    if ( address >= g_code_limit )
+        return false;
+
+    entry = g_jit_entry[ address ];
+    if ( g_jit_resolver == entry )
+    {
+        entry = JitResolveOI( address );
+        if ( 0 == entry )
+            return false;
+    }
+
+    ( * g_jit_enter )( entry );
+    return true;
+} /* JitProbeOI */
+
+/* mov between a host register and a guest register in g_oi. base is rax or rcx */
+
+static void jit_state( size_t opcode, size_t reg, size_t base, size_t guest )
+{
+    jit_byte( 0x48 | ( ( reg >> 3 ) << 2 ) );
+    jit_byte( opcode );
+    jit_byte( 0x40 | ( ( reg & 7 ) << 3 ) | base );
+    jit_byte( (uint8_t *) get_preg_from_op( guest << 2 ) - (uint8_t *) & g_oi );
+} /* jit_state */
+
+/* g_jit_enter( entry ): save the host's registers, load the guest's, call entry, and store them back with rpc */
+
+static void JitTrampoline()
+{
+    size_t g;
+
+    jit_seq( "\x53\x55\x41\x54\x41\x55\x41\x56\x41\x57" ); /* push rbx, rbp, r12, r13, r14, r15 */
+    jit_seq( "\x48\x83\xec\x08" );                         /* sub rsp, 8 to align the stack */
+    jit_byte( 0x48 );                                      /* mov rax, & g_oi */
+    jit_byte( 0xb8 );
+    jit_qword( (uint64_t) (size_t) & g_oi );
+    for ( g = 2; g < 8; g++ )
+        jit_state( 0x8b, g_jit_hreg[ g ], HR_RAX, g );
+    jit_byte( 0x48 );                                      /* mov rsi, ram */
+    jit_byte( 0xbe );
+    jit_qword( (uint64_t) (size_t) ram );
+    jit_seq( "\xff\xd7" );                                 /* call rdi */
+    jit_byte( 0x48 );                                      /* mov rcx, & g_oi */
+    jit_byte( 0xb9 );
+    jit_qword( (uint64_t) (size_t) & g_oi );
+    jit_state( 0x89, HR_RAX, HR_RCX, 1 );                  /* rpc */
+    for ( g = 2; g < 8; g++ )
+        jit_state( 0x89, g_jit_hreg[ g ], HR_RCX, g );
+    jit_seq( "\x48\x83\xc4\x08" );                         /* add rsp, 8 */
+    jit_seq( "\x41\x5f\x41\x5e\x41\x5d\x41\x5c\x5d\x5b" ); /* pop r15, r14, r13, r12, rbp, rbx */
+    jit_byte( 0xc3 );
+} /* JitTrampoline */
+
+/* the g_jit_entry of addresses without native code. rdi is the target guest pc */
+
+static void JitResolver()
+{
+    jit_seq( "\x48\x89\xe1" );                             /* mov rcx, rsp */
+    jit_seq( "\x48\x83\xe4\xf0" );                         /* and rsp, -16 */
+    jit_seq( "\x51\x57" );                                 /* push rcx, push rdi */
+    jit_byte( 0x48 );                                      /* mov rax, JitResolveOI */
+    jit_byte( 0xb8 );
+    jit_qword( (uint64_t) (size_t) JitResolveOI );
+    jit_seq( "\xff\xd0" );                                 /* call rax */
+    jit_seq( "\x5f\x5c" );                                 /* pop rdi, pop rsp */
+    jit_byte( 0x48 );                                      /* mov rsi, ram */
+    jit_byte( 0xbe );
+    jit_qword( (uint64_t) (size_t) ram );
+    jit_seq( "\x48\x85\xc0\x74\x02\xff\xe0" );             /* test rax, rax; jz past; jmp rax */
+    jit_seq( "\x48\x89\xf8\xc3" );                         /* mov rax, rdi; ret */
+} /* JitResolver */
+
+/* throw away all native code. called when the app writes to its code */
+
+static void JitFlushOI()
+{
+    size_t i;
+
+    if ( !g_jit_enabled )
+        return;
+
+    for ( i = 0; i < (size_t) g_code_limit; i++ )
+    {
+        g_jit_entry[ i ] = g_jit_resolver;
+        g_jit_counts[ i ] = 0;
+    }
+    g_jit_used = g_jit_base;
+} /* JitFlushOI */
+
+/* call after EnableDecodeCacheOI(). if executable memory isn't available the JIT just stays off */
+
+void EnableJitOI()
+{
+    void * p;
+
+    if ( ( 0 == g_code_limit ) || g_jit_enabled || g_counting )
+        return;
+#ifdef OI_MMAP
+    if ( g_fault_pc )
+        return;
+#endif /* OI_MMAP */
+
+    g_jit_entry = (const uint8_t **) malloc( (size_t) g_code_limit * sizeof( uint8_t * ) );
+    g_jit_counts = (uint16_t *) calloc( (size_t) g_code_limit, sizeof( uint16_t ) );
+    g_jit_native = (uint8_t **) calloc( (size_t) g_code_limit, sizeof( uint8_t * ) );
+    p = mmap( 0, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( ( 0 == g_jit_entry ) || ( 0 == g_jit_counts ) || ( 0 == g_jit_native ) || ( MAP_FAILED == p ) )
+        return;
+
+    g_jit_code = (uint8_t *) p;
+    g_jit_p = g_jit_code;
+    g_jit_enter = (t_jit_enter *) (size_t) g_jit_p;
+    JitTrampoline();
+    g_jit_resolver = g_jit_p;
+    JitResolver();
+    g_jit_base = (size_t) ( g_jit_p - g_jit_code );
+
+    g_jit_enabled = true;
+    JitFlushOI();
+} /* EnableJitOI */
+
+#define jit_probe( address ) if ( g_jit_enabled && JitProbeOI( address ) ) decoded_jump( g_oi.rpc )
+
+#else /* OI_JIT */
+
+#define jit_probe( address )
+
+#endif /* OI_JIT */
+
+#ifndef OI_MULTIWIDTH
+
+#include "oiengine.h"
+
+#endif /* OI_MULTIWIDTH */
+
+/* OI_ENGINE_NAMES stands for OI_MULTIWIDTH or OI_SIM, since older compilers have no defined() */
+
+#ifdef OI_MULTIWIDTH
+#define OI_ENGINE_NAMES
+#endif /* OI_MULTIWIDTH */
+#ifdef OI_SIM
+#ifndef OI_ENGINE_NAMES
+#define OI_ENGINE_NAMES
+#endif /* OI_ENGINE_NAMES */
+#endif /* OI_SIM */
+
+#ifdef OI_ENGINE_NAMES
+
+/* each extra copy of the engine gets OI_ENGINE appended to its function names: CheckRelation_w2, ExecuteOI_sim, ... */
+
+#define engine_paste( name, suffix ) name##_##suffix
+#define engine_name( name, suffix ) engine_paste( name, suffix )
+
+#define CheckRelation engine_name( CheckRelation, OI_ENGINE )
+#define memfb_do engine_name( memfb_do, OI_ENGINE )
+#define memfw_do engine_name( memfw_do, OI_ENGINE )
+#define memfdw_do engine_name( memfdw_do, OI_ENGINE )
+#define memfqw_do engine_name( memfqw_do, OI_ENGINE )
+#define staddb_do engine_name( staddb_do, OI_ENGINE )
+#define staddw_do engine_name( staddw_do, OI_ENGINE )
+#define stadddw_do engine_name( stadddw_do, OI_ENGINE )
+#define staddqw_do engine_name( staddqw_do, OI_ENGINE )
+#define moddiv_do engine_name( moddiv_do, OI_ENGINE )
+#define frame_offset engine_name( frame_offset, OI_ENGINE )
+#define cstf_do engine_name( cstf_do, OI_ENGINE )
+#define jump_return engine_name( jump_return, OI_ENGINE )
+#define jrel_do engine_name( jrel_do, OI_ENGINE )
+#define stinc_do engine_name( stinc_do, OI_ENGINE )
+#define op_a0_b0_do engine_name( op_a0_b0_do, OI_ENGINE )
+#define atomic_do engine_name( atomic_do, OI_ENGINE )
+#define op_80_90_do engine_name( op_80_90_do, OI_ENGINE )
+#define ldinc_do engine_name( ldinc_do, OI_ENGINE )
+#define cmov_do engine_name( cmov_do, OI_ENGINE )
+#define signex_do engine_name( signex_do, OI_ENGINE )
+#define op_c0_d0_do engine_name( op_c0_d0_do, OI_ENGINE )
+#define decoded_sto_do engine_name( decoded_sto_do, OI_ENGINE )
+#define decoded_ldo_do engine_name( decoded_ldo_do, OI_ENGINE )
+#define decoded_incm_do engine_name( decoded_incm_do, OI_ENGINE )
+#define decoded_c0_do engine_name( decoded_c0_do, OI_ENGINE )
+#define DecodeOneOI engine_name( DecodeOneOI, OI_ENGINE )
+#define DecodeBlockOI engine_name( DecodeBlockOI, OI_ENGINE )
+#define ExecuteDecodedOI engine_name( ExecuteDecodedOI, OI_ENGINE )
+#define ExecuteOI engine_name( ExecuteOI, OI_ENGINE )
+
+#endif /* OI_ENGINE_NAMES */
+
+#ifdef OI_SIM
+
+/*  Cache simulator. EnableSimOI() sets up models of an L1 instruction cache, an L1 data cache, and a unified
+    L2, each set-associative with LRU replacement and allocation on both loads and stores, plus a branch
+    predictor with a 2-bit counter per pc. ExecuteSimOI() runs ExecuteOI_sim, a copy of the plain interpreter
+    with hooks in its memory access macros. Each instruction is fetched whole through the L1I when its opcode is
+    read; other loads and stores go through the L1D, and L1 misses go to the L2. The normal engines don't have the
+    hooks, so the simulator costs nothing when it's not in use. ShowSimOI() reports the misses, bytes fetched per
+    instruction, and how well the conditional branches were predicted (oios -sim).
+
+    Run an app built for each image width to compare them. Stack slots are the host's oi_t, so use the oios
+    build for that width (oios2, oios4, oios8) to see the stack traffic that width would have.
+*/
+
+struct OICacheSim
+{
+    const char * name;
+    uint64_t * tags;       /* [ sets * ways ] line number + 1, or 0 for an empty way */
+    uint64_t * stamps;     /* [ sets * ways ] when each way was last used */
+    uint64_t size;
+    uint64_t sets;
+    uint32_t ways;
+    uint32_t line_shift;
+    uint64_t accesses;
+    uint64_t misses;
+};
+
+#define OI_SIM_PREDICTORS 4096
+
+static struct OICacheSim g_sim_l1i, g_sim_l1d, g_sim_l2;
+static uint64_t g_sim_clock = 0;
+static uint64_t g_sim_instructions = 0;
+static uint64_t g_sim_fetch_bytes = 0;
+static uint64_t g_sim_loads = 0;
+static uint64_t g_sim_stores = 0;
+static uint64_t g_sim_branches = 0;
+static uint64_t g_sim_taken = 0;
+static uint64_t g_sim_mispredicts = 0;
+static oi_t g_sim_pc = 0;                   /* the running instruction */
+static oi_t g_sim_len = 0;
+static oi_t g_sim_branch_pc = 0;            /* a conditional branch waiting for the next fetch to resolve it */
+static bool g_sim_branch_pending = false;
+static uint8_t g_sim_counters[ OI_SIM_PREDICTORS ];
+
+static bool SimCacheOI( struct OICacheSim * cache, uint64_t line )
+{
+    uint64_t * tags, * stamps;
+    uint32_t i, victim;
+
+    cache->accesses++;
+    g_sim_clock++;
+    tags = cache->tags + ( line & ( cache->sets - 1 ) ) * cache->ways;
+    stamps = cache->stamps + ( tags - cache->tags );
+    victim = 0;
+
+    for ( i = 0; i < cache->ways; i++ )
+    {
+        if ( tags[ i ] == line + 1 )
+        {
+            stamps[ i ] = g_sim_clock;
+            return true;
+        }
+        if ( stamps[ i ] < stamps[ victim ] )
+            victim = i;
+    }
+
+    cache->misses++;
+    tags[ victim ] = line + 1;
+    stamps[ victim ] = g_sim_clock;
+    return false;
+} /* SimCacheOI */
+
+/* offset is from the start of guest RAM. every L1 line the access touches is looked up, and misses go to the L2 */
+
+static void SimAccessOI( struct OICacheSim * l1, uint64_t offset, uint64_t length )
+{
+    uint64_t line, last;
+
+    last = ( offset + length - 1 ) >> l1->line_shift;
+    for ( line = offset >> l1->line_shift; line <= last; line++ )
+        if ( !SimCacheOI( l1, line ) )
+            SimCacheOI( & g_sim_l2, ( line << l1->line_shift ) >> g_sim_l2.line_shift );
+} /* SimAccessOI */
+
+/* called for each instruction in place of get_op() */
+
+static uint8_t SimFetchOI()
+{
+    oi_t pc;
+    uint8_t op, * pcounter;
+    bool taken;
+
+    pc = g_oi.rpc;
+
+    if ( g_sim_branch_pending )
+    {
+        g_sim_branch_pending = false;
+        pcounter = & g_sim_counters[ g_sim_branch_pc & ( OI_SIM_PREDICTORS - 1 ) ];
+        taken = ( pc != (oi_t) ( g_sim_branch_pc + 4 ) );
+        if ( taken != ( * pcounter >= 2 ) )
+            g_sim_mispredicts++;
+        if ( taken )
+        {
+            g_sim_taken++;
+            if ( * pcounter < 3 )
+                ( * pcounter )++;
+        }
+        else if ( * pcounter > 0 )
+            ( * pcounter )--;
+    }
+
+    op = get_byte( pc );
+    g_sim_len = (oi_t) ( 1 + byte_len_from_op( op ) );
+    if ( 3 == g_sim_len )
+        g_sim_len = THREE_BYTE_LEN;
+    g_sim_pc = pc;
+    g_sim_instructions++;
+    g_sim_fetch_bytes += g_sim_len;
+    SimAccessOI( & g_sim_l1i, (uint64_t) ( ram_address( pc ) - ram ), g_sim_len );
+
+    /* j, ji, jrelb, and jrel */
+    if ( 0x03 == ( op & 0xe3 ) )
+    {
+        g_sim_branches++;
+        g_sim_branch_pc = pc;
+        g_sim_branch_pending = true;
+    }
+
+    return op;
+} /* SimFetchOI */
+
+/* called for each load and store. returns the host address */
+
+static uint8_t * SimDataOI( oi_t address, size_t size, bool write )
+{
+    uint8_t * p;
+
+    p = ram_address( address );
+
+    /* reads of the running instruction's own bytes were counted when it was fetched */
+    if ( write || ( (oi_t) ( address - g_sim_pc ) >= g_sim_len ) )
+    {
+        if ( write )
+            g_sim_stores++;
+        else
+            g_sim_loads++;
+        SimAccessOI( & g_sim_l1d, (uint64_t) ( p - ram ), size );
+    }
+
+    return p;
+} /* SimDataOI */
+
+static uint8_t * SimRawOI( oi_t address )
+{
+    return ram_address( address );
+} /* SimRawOI */
+
+static void SimRangeOI( uint8_t * p, uint64_t length, bool write )
+{
+    if ( 0 == length )
+        return;
+
+    if ( write )
+        g_sim_stores++;
+    else
+        g_sim_loads++;
+    SimAccessOI( & g_sim_l1d, (uint64_t) ( p - ram ), length );
+} /* SimRangeOI */
+
+#ifndef OI2
+static oi_t SimReadImgwordOI( oi_t address )
+{
+    SimDataOI( address, IMAGE_WIDTH, false );
+    return ( * pget_imgword )( address );
+} /* SimReadImgwordOI */
+
+static void SimWriteImgwordOI( oi_t address, oi_t value )
+{
+    SimDataOI( address, IMAGE_WIDTH, true );
+    ( * pset_imgword )( address, value );
+} /* SimWriteImgwordOI */
+#endif /* OI2 */
+
+/* parses a number with an optional k or m suffix. returns the character after it, or 0 if there isn't one */
+
+static const char * SimNumberOI( const char * p, uint64_t * pvalue )
+{
+    char * end;
+
+    * pvalue = strtoull( p, & end, 10 );
+    if ( end == p )
+        return 0;
+    if ( 'k' == * end || 'K' == * end )
+    {
+        * pvalue *= 1024;
+        end++;
+    }
+    else if ( 'm' == * end || 'M' == * end )
+    {
+        * pvalue *= 1024 * 1024;
+        end++;
+    }
+
+    return end;
+} /* SimNumberOI */
+
+static bool SimCacheInitOI( struct OICacheSim * cache, const char * name, uint64_t size, uint64_t ways, uint64_t line )
+{
+    if ( 0 == line || 0 != ( line & ( line - 1 ) ) || 0 == ways || ways > 64 || 0 != ( size % ( ways * line ) ) )
+        return false;
+
+    memset( cache, 0, sizeof( * cache ) );
+    cache->name = name;
+    cache->size = size;
+    cache->ways = (uint32_t) ways;
+    cache->sets = size / ( ways * line );
+    if ( 0 == cache->sets || 0 != ( cache->sets & ( cache->sets - 1 ) ) )
+        return false;
+    while ( ( (uint64_t) 1 << cache->line_shift ) < line )
+        cache->line_shift++;
+
+    cache->tags = (uint64_t *) calloc( (size_t) ( cache->sets * ways ), sizeof( uint64_t ) );
+    cache->stamps = (uint64_t *) calloc( (size_t) ( cache->sets * ways ), sizeof( uint64_t ) );
+    return ( 0 != cache->tags ) && ( 0 != cache->stamps );
+} /* SimCacheInitOI */
+
+/*  config is 0 for the defaults, or up to three caches in the order L1I, L1D, L2 separated by commas, each
+    size/ways/line in bytes, with k or m allowed on the size. e.g. 16k/4/32,16k/4/32,256k/8/64. sizes must
+    make a power of 2 number of sets. returns false if config isn't valid or the memory isn't available.
+*/
+
+bool EnableSimOI( const char * config )
+{
+    static const char * names[ 3 ] = { "L1I", "L1D", "L2 " };
+    static const uint64_t defaults[ 3 ][ 3 ] = { { 32768, 8, 64 }, { 32768, 8, 64 }, { 1048576, 16, 64 } };
+    struct OICacheSim * caches[ 3 ];
+    uint64_t values[ 3 ];
+    int i, j;
+
+    caches[ 0 ] = & g_sim_l1i;
+    caches[ 1 ] = & g_sim_l1d;
+    caches[ 2 ] = & g_sim_l2;
+
+    for ( i = 0; i < 3; i++ )
+    {
+        for ( j = 0; j < 3; j++ )
+            values[ j ] = defaults[ i ][ j ];
+
+        if ( ( 0 != config ) && ( 0 != * config ) )
+        {
+            for ( j = 0; j < 3; j++ )
             {
-                /* set rdst to boolean of ( pop() RELATION rright ) */
-                op1 = get_op1();
-                pop( val );
-                set_reg_from_op( op, (oi_t) CheckRelation( val, get_reg_from_op( op1 ), funct_from_op( op1 ) ) );
-                break;
+                config = SimNumberOI( config, & values[ j ] );
+                if ( ( 0 == config ) || ( ( j < 2 ) && ( '/' != * config++ ) ) )
+                    return false;
             }
-            case 0x61: case 0x65: case 0x69: case 0x6d: /* ldf / stf / ret x / ldib / signex / memf / stadd / moddiv */
-            case 0x71: case 0x75: case 0x79: case 0x7d:
-            {
-                op1 = get_op1();
-                switch( funct_from_op( op1 ) )
-                {
-                    case 0: /* ldf rdst, offset ( -4..3 ) */
-                    {
-                        set_reg_from_op( op, get_oiword( frame_offset( ( (int16_t) reg_from_op( op1 ) ) ) ) );
-                        break;
-                    }
-                    case 1: /* stf rdst, offset ( -4..3 ) */
-                    {
-                        set_oiword( frame_offset( (int16_t) reg_from_op( op1 ) ), get_reg_from_op( op ) );
-                        break;
-                    }
-                    case 2: /* ret x */
-                    {
-                        pop( g_oi.rpc );
-                        pop( g_oi.rframe );
-                        g_oi.rsp += ( sizeof( oi_t ) * ( 1 + reg_from_op( op1 ) ) );
-                        continue;
-                    }
-                    case 3: /* ldib rdst x */
-                    {
-                        set_reg_from_op( op, sign_extend_oi( ( op1 & 0x1f ), 4 ) );
-                        break;
-                    }
-                    case 4: /* signex */
-                    {
-                        signex_do( op );
-                        break;
-                    }
-                    case 5: /* memf: memfill address in rarg1 with rtmp for rarg2 iterations (bytes or words ) */
-                    {
-                        width = width_from_op( op1 );
-                        if ( 0 == width )
-                            memfb_do();
-                        else if_1_is_width
-                            memfw_do();
-#ifndef OI2
-                        else if_2_is_width
-                            memfdw_do();
+            if ( ',' == * config )
+                config++;
+            else if ( 0 != * config )
+                return false;
+        }
+
+        if ( !SimCacheInitOI( caches[ i ], names[ i ], values[ 0 ], values[ 1 ], values[ 2 ] ) )
+            return false;
+    }
+
+    return ( ( 0 == config ) || ( 0 == * config ) );
+} /* EnableSimOI */
+
+static void SimShowCacheOI( struct OICacheSim * cache )
+{
+    printf( "  %s %6lluk %2u-way %3u-byte lines: %14llu accesses %12llu misses %6.2f%%  %8.4f bytes/instruction from %s\n",
+            cache->name, (unsigned long long) ( cache->size / 1024 ), cache->ways, 1u << cache->line_shift,
+            (unsigned long long) cache->accesses, (unsigned long long) cache->misses,
+            ( 0 == cache->accesses ) ? 0.0 : 100.0 * (double) cache->misses / (double) cache->accesses,
+            (double) ( cache->misses << cache->line_shift ) / (double) g_sim_instructions,
+            ( cache == & g_sim_l2 ) ? "memory" : "L2" );
+} /* SimShowCacheOI */
+
+void ShowSimOI()
+{
+    if ( ( 0 == g_sim_l2.tags ) || ( 0 == g_sim_instructions ) )
+        return;
+
+    printf( "simulated image width %u: %llu instructions, %.4f instruction bytes each, %llu loads, %llu stores\n",
+            (unsigned) IMAGE_WIDTH, (unsigned long long) g_sim_instructions,
+            (double) g_sim_fetch_bytes / (double) g_sim_instructions,
+            (unsigned long long) g_sim_loads, (unsigned long long) g_sim_stores );
+    SimShowCacheOI( & g_sim_l1i );
+    SimShowCacheOI( & g_sim_l1d );
+    SimShowCacheOI( & g_sim_l2 );
+    printf( "  conditional branches: %llu, %.2f%% taken, %.2f%% predicted by %d 2-bit counters\n",
+            (unsigned long long) g_sim_branches,
+            ( 0 == g_sim_branches ) ? 0.0 : 100.0 * (double) g_sim_taken / (double) g_sim_branches,
+            ( 0 == g_sim_branches ) ? 0.0 :
+                100.0 * (double) ( g_sim_branches - g_sim_mispredicts ) / (double) g_sim_branches,
+            OI_SIM_PREDICTORS );
+} /* ShowSimOI */
+
+#endif /* OI_SIM */
+
+#ifdef OI_SIM
+
+/* the simulator's copy of the engine. it checks the image width at runtime, so it comes before the OI_IW copies */
+
+#pragma push_macro( "access_ram" )
+#pragma push_macro( "ram_address" )
+#pragma push_macro( "ram_range" )
+#pragma push_macro( "sim_range" )
+#pragma push_macro( "set_byte" )
+#pragma push_macro( "get_word" )
+#pragma push_macro( "set_word" )
+#pragma push_macro( "get_oiword" )
+#pragma push_macro( "set_oiword" )
+#pragma push_macro( "get_dword" )
+#pragma push_macro( "set_dword" )
+#pragma push_macro( "get_qword" )
+#pragma push_macro( "set_qword" )
+#pragma push_macro( "get_op" )
+#pragma push_macro( "read_imgword" )
+#pragma push_macro( "write_imgword" )
+
+#undef access_ram
+#undef ram_address
+#undef ram_range
+#undef sim_range
+#undef set_byte
+#undef get_word
+#undef set_word
+#undef get_oiword
+#undef set_oiword
+#undef get_dword
+#undef set_dword
+#undef get_qword
+#undef set_qword
+#undef get_op
+
+/* get_byte goes through access_ram. inc and dec [mem] and the atomics are the only other users of ram_address, so it's a store */
+
+#define access_ram( address ) ( * SimDataOI( address, 1, false ) )
+#define ram_address( address ) SimDataOI( address, IMAGE_WIDTH, true )
+#define ram_range( address ) SimRawOI( address )
+#define sim_range( p, length, write ) SimRangeOI( (uint8_t *) ( p ), (uint64_t) ( length ), write )
+#define set_byte( address, val ) ( * SimDataOI( address, 1, true ) = val )
+#define get_word( address ) ( * (uint16_t *) SimDataOI( address, 2, false ) )
+#define set_word( address, val ) ( * (uint16_t *) SimDataOI( address, 2, true ) = val )
+#define get_oiword( address ) ( * (oi_t *) SimDataOI( address, sizeof( oi_t ), false ) )
+#define set_oiword( address, val ) ( * (oi_t *) SimDataOI( address, sizeof( oi_t ), true ) = val )
+#define get_dword( address ) ( * (uint32_t *) SimDataOI( address, 4, false ) )
+#define set_dword( address, val ) ( * (uint32_t *) SimDataOI( address, 4, true ) = val )
 #ifdef OI8
-                        else /* 3 == width */
-                            memfqw_do();
+#define get_qword( address ) ( * (uint64_t *) SimDataOI( address, 8, false ) )
+#define set_qword( address, val ) ( * (uint64_t *) SimDataOI( address, 8, true ) = val )
 #endif /* OI8 */
-#endif /* OI2 */
-                        break;
-                    }
-                    case 6: /* stadd: stb [ rtmp + rarg1 ] = 0. add rtmp, rarg2. loop if rtmp le rres */
-                    {
-                        width = width_from_op( op1 );
-                        if ( 0 == width )
-                            staddb_do();
-                        else if_1_is_width
-                            staddw_do();
+#define get_op() SimFetchOI()
 #ifndef OI2
-                        else if_2_is_width
-                            stadddw_do();
-#ifdef OI8
-                        else /* 3 == width */
-                            staddqw_do();
-#endif /* OI8 */
+#undef read_imgword
+#undef write_imgword
+#define read_imgword( address ) SimReadImgwordOI( address )
+#define write_imgword( address, value ) SimWriteImgwordOI( address, value )
 #endif /* OI2 */
-                        break;
-                    }
-                    case 7: /* moddiv: push( r0 / r1 ). r0 = r0 % r1. */
-                    {
-                        moddiv_do( op, op1 );
-                        break;
-                    }
-                }
-                break;
-            }
-            case 0x81: case 0x85: case 0x89: case 0x8d: /* syscall, pushf, stst, addimgw, subimgw, addnatw, subnatw */
-            case 0x91: case 0x95: case 0x99: case 0x9d:
-            {
-                if ( op_80_90_do( op ) )
-                    continue;
-                break;
-            }
-            case 0xa1: case 0xa5: case 0xa9: case 0xad: /* st [r0dst] r1src / ld r0dst [r1src] / pushtwo r0, r1 / poptwo r0, r1 */
-            case 0xb1: case 0xb5: case 0xb9: case 0xbd:
-            {
-                op_a0_b0_do( op );
-                break;
-            }
-            case 0xa3: /* cpuinfo */
-            {
-                g_oi.rres = 1; /* version 1 */
-                g_oi.rtmp = 'd' + ( 'l' << 8 ); /* ID */
-                break;
-            }
-            case 0xc5: case 0xc9: case 0xcd: /* mov r0dst r1src */
-            case 0xd1: case 0xd5: case 0xd9: case 0xdd:
-            {
-                set_reg_from_op( op, get_reg_from_op( get_op1() ) );
-                break;
-            }
-            case 0xe1: case 0xe5: case 0xe9: case 0xed: /* mathst r0dst, r1src, Math */
-            case 0xf1: case 0xf5: case 0xf9: case 0xfd:
-            {
-                op1 = get_op1();
-                pop( val );
-                set_reg_from_op( op, Math( val, get_reg_from_op( op1 ), funct_from_op( op1 ) ) );
-                break;
-            }
-            default:
-                illegal_instruction( op, get_op1() );
+
+#define OI_ENGINE sim
+#define OI_SIM_ENGINE
+#include "oiengine.h"
+#undef OI_SIM_ENGINE
+#undef OI_ENGINE
+
+#pragma pop_macro( "access_ram" )
+#pragma pop_macro( "ram_address" )
+#pragma pop_macro( "ram_range" )
+#pragma pop_macro( "sim_range" )
+#pragma pop_macro( "set_byte" )
+#pragma pop_macro( "get_word" )
+#pragma pop_macro( "set_word" )
+#pragma pop_macro( "get_oiword" )
+#pragma pop_macro( "set_oiword" )
+#pragma pop_macro( "get_dword" )
+#pragma pop_macro( "set_dword" )
+#pragma pop_macro( "get_qword" )
+#pragma pop_macro( "set_qword" )
+#pragma pop_macro( "get_op" )
+#pragma pop_macro( "read_imgword" )
+#pragma pop_macro( "write_imgword" )
+
+uint32_t ExecuteSimOI()
+{
+    return ExecuteOI_sim();
+} /* ExecuteSimOI */
+
+#endif /* OI_SIM */
+
+#ifdef OI_MULTIWIDTH
+
+#define OI_ENGINE w2
+#define OI_IW 2
+#define OI_IW_MASK 0xffff
+#include "oiengine.h"
+#undef OI_IW
+#undef OI_IW_MASK
+#undef OI_ENGINE
+
+#define OI_ENGINE w4
+#define OI_IW 4
+#define OI_IW_MASK 0xffffffff
+#include "oiengine.h"
+#undef OI_IW
+#undef OI_IW_MASK
+#undef OI_ENGINE
+
+#define OI_ENGINE w8
+#define OI_IW 8
+#define OI_IW_MASK 0xffffffffffffffff
+#include "oiengine.h"
+#undef OI_IW
+#undef OI_IW_MASK
+#undef OI_ENGINE
+
+#undef ExecuteOI
+
+uint32_t ExecuteOI()
+{
+    return ( * pexecute_oi )();
+} /* ExecuteOI */
+
+#endif /* OI_MULTIWIDTH */
+
+#ifdef OI_MMAP
+
+/*  SIGSEGV and SIGBUS handler for guard pages and shared code. A write to shared code either unshares the page
+    and returns so the write is retried, or is reported. Faults outside the calling thread's reservation get the
+    default action.
+*/
+
+static void FaultOI( int sig, siginfo_t * info, void * context )
+{
+    uint8_t * p, * page;
+    const char * what;
+
+    (void) context;
+    p = (uint8_t *) info->si_addr;
+    if ( ( 0 == ram ) || ( p < g_ram_base ) || ( p >= g_ram_base + g_ram_reserved ) )
+    {
+        signal( sig, SIG_DFL ); /* returning re-runs the access, which now takes the default action */
+        return;
+    }
+
+    what = "guest memory access out of range";
+    page = g_ram_base + ( ( p - g_ram_base ) & ~ ( OI_PAGE_SIZE - 1 ) );
+
+    /* a write to a page TrackDirtyPagesOI() protected, unless it's read-only code */
+    if ( ( 0 != g_dirty ) && ( p >= ram ) && ( p < ram + g_ram_size ) &&
+         !( g_code_read_only && ( p >= g_code_lo ) && ( p < g_code_hi ) ) )
+    {
+        MarkDirtyOI( (uint64_t) ( p - ram ), 1 );
+        return;
+    }
+
+    if ( ( p >= g_code_lo ) && ( p < g_code_hi ) )
+    {
+        if ( !g_code_read_only )
+        {
+            if ( 0 == mprotect( page, (size_t) OI_PAGE_SIZE, PROT_READ | PROT_WRITE ) )
+                return;
         }
+        what = "guest write to read-only code";
+    }
 
-#ifdef OI2
-        g_oi.rpc += ( 1 + byte_len_from_op( op ) );
+    OIFlushOutput();
+    fflush( stdout );
+    printf( "%s. address %lld, pc %llx: %s\n", what, (long long) ( p - ram ), (unsigned long long) g_oi.rpc,
+            ( g_oi.rpc < g_ram_size ) ? DisassembleOI( ram + g_oi.rpc, g_oi.rpc, g_oi.image_width ) : "?" );
+    fflush( stdout );
+    OIHardTermination();
+} /* FaultOI */
+
+static void InstallFaultHandlerOI()
+{
+    struct sigaction sa;
+
+    memset( & sa, 0, sizeof( sa ) );
+    sa.sa_sigaction = FaultOI;
+    sa.sa_flags = SA_SIGINFO;
+    sigemptyset( & sa.sa_mask );
+    sigaction( SIGSEGV, & sa, 0 );
+    sigaction( SIGBUS, & sa, 0 );
+} /* InstallFaultHandlerOI */
+
+/* call before loading images. guest RAM gets guard regions and faults in them are reported and end the app */
+
+void EnableGuardPagesOI()
+{
+    g_guard_pages = true;
+    g_fault_pc = true;
+    InstallFaultHandlerOI();
+} /* EnableGuardPagesOI */
+
+/* call before loading images. read_only makes writes to the code an error instead of unsharing the page */
+
+void EnableSharedCodeOI( bool read_only )
+{
+    g_shared_code = true;
+    g_code_read_only = read_only;
+    g_fault_pc = g_fault_pc || read_only;
+    InstallFaultHandlerOI();
+} /* EnableSharedCodeOI */
+
+/*  Dirty pages, for checkpoints. TrackDirtyPagesOI() write-protects guest RAM and forgets which pages were
+    written. The first write to a page after that faults, and FaultOI() marks it dirty and makes it writable.
+    Pages are host pages counted from the one that holds ram[ 0 ]. Host code that has the kernel write guest RAM
+    (read() into it, say) must call MarkDirtyOI() first, since the kernel fails the call instead of faulting.
+*/
+
+static uint8_t * DirtyLowOI()
+{
+    return g_ram_base + ( ( ram - g_ram_base ) & ~ ( OI_PAGE_SIZE - 1 ) );
+} /* DirtyLowOI */
+
+static uint64_t DirtyPagesOI()
+{
+    return ( (uint64_t) ( ram + g_ram_size - DirtyLowOI() ) + OI_PAGE_SIZE - 1 ) / OI_PAGE_SIZE;
+} /* DirtyPagesOI */
+
+/* call after the image is loaded and after each checkpoint is written. returns false if out of memory */
+
+bool TrackDirtyPagesOI()
+{
+    uint64_t pages;
+
+    pages = DirtyPagesOI();
+    if ( 0 == g_dirty )
+    {
+        g_dirty = (uint8_t *) calloc( (size_t) ( pages + 7 ) / 8, 1 );
+        if ( 0 == g_dirty )
+            return false;
+        InstallFaultHandlerOI();
+    }
+    else
+        memset( g_dirty, 0, (size_t) ( pages + 7 ) / 8 );
+
+    return ( 0 == mprotect( DirtyLowOI(), (size_t) ( pages * OI_PAGE_SIZE ), PROT_READ ) );
+} /* TrackDirtyPagesOI */
+
+/* marks the pages holding ram[ offset ] .. ram[ offset + length - 1 ] dirty and makes them writable */
+
+void MarkDirtyOI( uint64_t offset, uint64_t length )
+{
+    uint64_t first, last, page;
+
+    if ( ( 0 == g_dirty ) || ( 0 == length ) )
+        return;
+
+    first = (uint64_t) ( ram + offset - DirtyLowOI() ) / OI_PAGE_SIZE;
+    last = (uint64_t) ( ram + offset + length - 1 - DirtyLowOI() ) / OI_PAGE_SIZE;
+    for ( page = first; page <= last; page++ )
+        g_dirty[ page / 8 ] |= (uint8_t) ( 1 << ( page % 8 ) );
+
+    mprotect( DirtyLowOI() + first * OI_PAGE_SIZE, (size_t) ( ( last - first + 1 ) * OI_PAGE_SIZE ), PROT_READ | PROT_WRITE );
+    if ( g_code_read_only && ( g_code_hi > g_code_lo ) )
+        mprotect( g_code_lo, (size_t) ( g_code_hi - g_code_lo ), PROT_READ );
+} /* MarkDirtyOI */
+
+/* returns false past the last page. otherwise sets the part of RAM the page holds, with length 0 if it's clean */
+
+bool DirtyPageOI( uint64_t page, uint64_t * poffset, uint64_t * plength )
+{
+    uint8_t * lo, * hi;
+
+    if ( ( 0 == g_dirty ) || ( page >= DirtyPagesOI() ) )
+        return false;
+
+    lo = DirtyLowOI() + page * OI_PAGE_SIZE;
+    hi = lo + OI_PAGE_SIZE;
+    if ( lo < ram )
+        lo = ram;
+    if ( hi > ram + g_ram_size )
+        hi = ram + g_ram_size;
+
+    * poffset = (uint64_t) ( lo - ram );
+    * plength = ( g_dirty[ page / 8 ] & ( 1 << ( page % 8 ) ) ) ? (uint64_t) ( hi - lo ) : 0;
+    return true;
+} /* DirtyPageOI */
+
+#endif /* OI_MMAP */
+
+#ifdef OI_CONTEXT
+
+/*  returns a context with ram_size bytes of zeroed RAM (0 for the size of the static RAM) or 0 if out of memory.
+    with OI_MMAP ram_size is ignored and the RAM is reserved when an image is loaded into the context.
+*/
+
+struct OIContext * OICreate( uint32_t ram_size )
+{
+    struct OIContext * context;
+
+    context = (struct OIContext *) calloc( 1, sizeof( struct OIContext ) );
+    if ( 0 == context )
+        return 0;
+
+#ifdef OI_MMAP
+    (void) ram_size;
+    return context;
 #else
-        byte_len = 1 + byte_len_from_op( op );
-        if ( 3 == byte_len )
-            byte_len = g_oi.three_byte_len;
-        g_oi.rpc += (oi_t) byte_len;
-#endif /* OI2 */
+    if ( 0 == ram_size )
+        ram_size = (uint32_t) sizeof( g_ram );
 
-        continue; /* old compilers otherwise evaluate (true) each loop */
-    } while ( true );
+    context->ram = (uint8_t *) calloc( 1, ram_size );
+    if ( 0 == context->ram )
+    {
+        free( context );
+        return 0;
+    }
 
-_all_done:
-    return instruction_count;
-} /* ExecuteOI */
+    context->ram_size = ram_size;
+    return context;
+#endif /* OI_MMAP */
+} /* OICreate */
+
+/*  returns a context for a guest thread that starts at pc with rarg1 = arg and the stack at sp, or 0 if out of
+    memory. Like ResetOI(), it returns to address 0 and halts. Another host thread selects the context and calls
+    ExecuteOI(). Stores into the code by one guest thread don't reset the decode caches of the others, and the
+    JIT's native code isn't thread-safe, so it's turned off for the rest of the process. That's safe because the
+    first guest thread can only come from the main thread's syscall 22, and syscalls leave native code first.
+    Nothing else runs native code then, and later threads see the JIT already off without writing the flag.
+*/
+
+struct OIContext * OIThread( oi_t pc, oi_t sp, oi_t arg )
+{
+    struct OIContext * context;
+
+    context = (struct OIContext *) calloc( 1, sizeof( struct OIContext ) );
+    if ( 0 == context )
+        return 0;
+
+    context->thread = true;
+    context->ram = ram;
+#ifdef OI_MMAP
+    context->ram_size = g_ram_size;
+    context->ram_base = g_ram_base;
+    context->ram_reserved = g_ram_reserved;
+    context->code_lo = g_code_lo;
+    context->code_hi = g_code_hi;
+    context->map_size = g_map_size;
+#endif /* OI_MMAP */
+    context->pget_imgword = pget_imgword;
+    context->pset_imgword = pset_imgword;
+#ifdef OI_MULTIWIDTH
+    context->pexecute_oi = pexecute_oi;
+#endif /* OI_MULTIWIDTH */
+#ifdef OI_PREDECODE
+    context->code_limit = g_code_limit; /* the new thread allocates its own records */
+#endif /* OI_PREDECODE */
+#ifdef OI_JIT
+    if ( g_jit_enabled )
+        g_jit_enabled = false;
+#endif /* OI_JIT */
+
+    context->oi = g_oi;
+    context->oi.rpc = pc;
+    context->oi.rarg1 = arg;
+    context->oi.rarg2 = 0;
+    context->oi.rres = 0;
+    context->oi.rtmp = 0;
+    sp -= 2 * sizeof( oi_t );
+    memset( ram + sp, 0, 2 * sizeof( oi_t ) ); /* the return address and rframe */
+    context->oi.rsp = sp;
+    context->oi.rframe = sp - sizeof( oi_t );
+    return context;
+} /* OIThread */
+
+/* makes context (or none if 0) the guest of the calling thread */
+
+void OISelect( struct OIContext * context )
+{
+    struct OIContext * previous;
+
+    previous = g_context;
+    if ( 0 != previous )
+    {
+        previous->oi = g_oi;
+#ifdef OI_MMAP
+        previous->ram = ram;
+        previous->ram_size = g_ram_size;
+        previous->ram_base = g_ram_base;
+        previous->ram_reserved = g_ram_reserved;
+        previous->code_lo = g_code_lo;
+        previous->code_hi = g_code_hi;
+        previous->ram_fresh = g_ram_fresh;
+        previous->map_size = g_map_size;
+#endif /* OI_MMAP */
+        previous->pget_imgword = pget_imgword;
+        previous->pset_imgword = pset_imgword;
+#ifdef OI_MULTIWIDTH
+        previous->pexecute_oi = pexecute_oi;
+#endif /* OI_MULTIWIDTH */
+#ifdef OI_PREDECODE
+        previous->pdecoded = g_pdecoded;
+        previous->code_limit = g_code_limit;
+        previous->decoded_for = & g_oi;
+        previous->retired = g_retired;
+#endif /* OI_PREDECODE */
+    }
+#ifdef OI_MMAP
+    else
+        ReleaseRamOI();
+#endif /* OI_MMAP */
+
+    g_context = context;
+    if ( 0 == context )
+    {
+#ifdef OI_MMAP
+        ram = 0;
+        g_ram_size = 0;
+        g_ram_base = 0;
+        g_ram_reserved = 0;
+        g_code_lo = 0;
+        g_code_hi = 0;
+        g_ram_fresh = false;
+        g_map_size = 0;
+#else
+        ram = g_ram;
+#endif /* OI_MMAP */
+#ifdef OI_PREDECODE
+        g_pdecoded = 0;
+        g_code_limit = 0;
+        g_retired = 0;
+#endif /* OI_PREDECODE */
+        return;
+    }
+
+    ram = context->ram;
+#ifdef OI_MMAP
+    g_ram_size = context->ram_size;
+    g_ram_base = context->ram_base;
+    g_ram_reserved = context->ram_reserved;
+    g_code_lo = context->code_lo;
+    g_code_hi = context->code_hi;
+    g_ram_fresh = context->ram_fresh;
+    g_map_size = context->map_size;
+#endif /* OI_MMAP */
+    g_oi = context->oi;
+    pget_imgword = context->pget_imgword;
+    pset_imgword = context->pset_imgword;
+#ifdef OI_MULTIWIDTH
+    pexecute_oi = context->pexecute_oi;
+#endif /* OI_MULTIWIDTH */
+#ifdef OI_PREDECODE
+    /* records point at the registers of the thread that decoded them, so another thread starts over */
+    if ( ( 0 != context->pdecoded ) && ( & g_oi != context->decoded_for ) )
+    {
+        free( context->pdecoded );
+        context->pdecoded = 0;
+    }
+    g_pdecoded = context->pdecoded;
+    g_code_limit = context->code_limit;
+    g_retired = context->retired;
+#endif /* OI_PREDECODE */
+} /* OISelect */
+
+void OIDestroy( struct OIContext * context )
+{
+    if ( 0 == context )
+        return;
+
+    if ( g_context == context )
+        OISelect( 0 );
+
+    if ( !context->thread )
+    {
+#ifdef OI_MMAP
+        if ( 0 != context->ram )
+            munmap( context->ram_base, (size_t) context->ram_reserved );
+#else
+        free( context->ram );
+#endif /* OI_MMAP */
+    }
+#ifdef OI_PREDECODE
+    free( context->pdecoded );
+#endif /* OI_PREDECODE */
+    free( context );
+} /* OIDestroy */
 
+#endif /* OI_CONTEXT */
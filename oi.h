@@ -108,7 +108,70 @@
     typedef size_t bool;
 #endif /* __GNUC__ */
 
-extern struct OneImage g_oi;
+/* oi2c's translated apps replace oi.c and only implement the basic API, so their builds turn the engine features off */
+
+#ifdef OI2C
+#define OI_NO_PREDECODE
+#define OI_NO_CONTEXT
+#define OI_NO_MMAP
+#define OI_NO_SIM
+#endif /* OI2C */
+
+/* gcc and clang release builds get computed-goto dispatch and the decode cache, and OI8 builds for x86-64 a JIT. see oi.c */
+
+#ifdef __GNUC__
+#ifdef NDEBUG
+#ifndef OI_NO_THREADED
+#define OI_THREADED
+#endif /* OI_NO_THREADED */
+#ifndef OI_NO_PREDECODE
+#define OI_PREDECODE
+#ifdef OI8
+#ifdef __x86_64__
+#ifndef _WIN32
+#ifndef OI_NO_JIT
+#define OI_JIT
+#endif /* OI_NO_JIT */
+#endif /* _WIN32 */
+#endif /* __x86_64__ */
+#endif /* OI8 */
+#endif /* OI_NO_PREDECODE */
+#endif /* NDEBUG */
+#endif /* __GNUC__ */
+
+/* gcc and clang builds can run a guest per thread, each in its own OIContext. see oi.c */
+
+#ifdef __GNUC__
+#ifndef OI_NO_CONTEXT
+#define OI_CONTEXT
+#endif /* OI_NO_CONTEXT */
+#endif /* __GNUC__ */
+
+/* gcc and clang builds on unix-like systems map guest RAM with mmap, sized from the image header. see oi.c */
+
+#ifdef __GNUC__
+#ifndef _WIN32
+#ifndef OI_NO_MMAP
+#define OI_MMAP
+#endif /* OI_NO_MMAP */
+#endif /* _WIN32 */
+#endif /* __GNUC__ */
+
+/* gcc and clang builds have a cache and branch predictor simulator for comparing image widths. see oi.c */
+
+#ifdef __GNUC__
+#ifndef OI_NO_SIM
+#define OI_SIM
+#endif /* OI_NO_SIM */
+#endif /* __GNUC__ */
+
+#ifdef OI_CONTEXT
+#define oi_tls __thread
+#else
+#define oi_tls
+#endif /* OI_CONTEXT */
+
+extern oi_tls struct OneImage g_oi;
 
 #ifdef HISOFTCPM
     extern uint32_t RamInformationOI( uint32_t, uint8_t **, uint8_t );
@@ -120,6 +183,7 @@ extern struct OneImage g_oi;
     extern void OISyscall( size_t );
     extern void OIHalt( void );
     extern void OIHardTermination( void );
+    extern void OIFlushOutput( void );
 #else /* HISOFTCPM */
 #ifdef AZTECCPM
     extern uint32_t RamInformationOI();
@@ -131,6 +195,7 @@ extern struct OneImage g_oi;
     extern void OISyscall();
     extern void OIHalt();
     extern void OIHardTermination();
+    extern void OIFlushOutput();
 #else
     extern uint32_t RamInformationOI( uint32_t required, uint8_t ** ppRam, uint8_t image_width );
     extern void ResetOI( oi_t mem_size, oi_t pc, oi_t sp, uint8_t image_width );
@@ -141,6 +206,44 @@ extern struct OneImage g_oi;
     extern void OISyscall( size_t function );
     extern void OIHalt( void );
     extern void OIHardTermination( void );
+    extern void OIFlushOutput( void ); /* the host writes any console output it's holding before the engine prints an error */
+#ifdef OI_PREDECODE
+    extern void EnableDecodeCacheOI( oi_t code_size );
+    extern void InvalidateCodeOI( oi_t address, oi_t length );
+    extern void EnableProfileOI( void );
+    extern void ShowProfileOI( void );
+    extern void StopOI( void );
+    extern void EnableRetiredCountOI( void );
+    extern bool RetiredOI( uint64_t * pcount );
+#endif /* OI_PREDECODE */
+#ifdef OI_JIT
+    extern void EnableJitOI( void );
+#endif /* OI_JIT */
+#ifdef OI_MMAP
+    extern uint64_t ReserveRamOI( uint64_t required, uint8_t ** ppRam, uint8_t image_width );
+    extern void EnableHugePagesOI( void );
+    extern void EnableGuardPagesOI( void );
+    extern void EnableSharedCodeOI( bool read_only );
+    extern bool MapCodeOI( int fd, uint64_t offset, uint64_t code_size, uint64_t data_size, uint8_t ** ppRam );
+    extern bool TrackDirtyPagesOI( void );
+    extern void MarkDirtyOI( uint64_t offset, uint64_t length );
+    extern bool DirtyPageOI( uint64_t page, uint64_t * poffset, uint64_t * plength );
+    extern bool MapSpaceOI( uint64_t * paddress, uint64_t * plength );
+    extern bool MapFileOI( int fd, uint64_t offset, uint64_t address, uint64_t length, bool writable );
+    extern void UnmapFileOI( uint64_t address, uint64_t length );
+#endif /* OI_MMAP */
+#ifdef OI_CONTEXT
+    struct OIContext;
+    extern struct OIContext * OICreate( uint32_t ram_size );
+    extern void OISelect( struct OIContext * context );
+    extern void OIDestroy( struct OIContext * context );
+    extern struct OIContext * OIThread( oi_t pc, oi_t sp, oi_t arg );
+#endif /* OI_CONTEXT */
+#ifdef OI_SIM
+    extern bool EnableSimOI( const char * config );
+    extern uint32_t ExecuteSimOI( void );
+    extern void ShowSimOI( void );
+#endif /* OI_SIM */
 #endif /* AZTECCPM */
 #endif /* HISOFTCPM */
 
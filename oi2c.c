@@ -0,0 +1,1146 @@
+/*
+    OneImage to C translator
+    Reads an .oi image and writes a C file with one function per guest function. Guest registers are locals in
+    those functions and guest RAM is a byte array. The C file takes the place of oi.c in an oios build, so the
+    result loads and runs that one image with the usual syscalls and arguments:
+
+        oi2c tttoi
+        g++ -O2 -fno-strict-aliasing -D OI8 -D OI2C -D NDEBUG -I . oios.c tttoi.c trace.c oidis.c -o tttoi
+        tttoi tttoi.oi 1000
+
+    Functions are found from the initial pc, direct call targets, and code addresses loaded with ldi/ldiw or stored
+    in initialized data (function pointer tables). Each function contains the code reachable from its entry without
+    following calls. Calls through registers or tables, jmp through a register, and returns to somewhere other than
+    the caller go through dispatch switches over the known labels. An address that isn't a known label is reported
+    and the app is terminated. Images that write to their own code and instructions that write rpc aren't supported.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <ctype.h>
+
+#ifndef MSC6
+#include <stdint.h>
+#endif
+
+#include <string.h>
+
+#include "oi.h"
+#include "oios.h"
+
+#define true 1
+#define false 0
+
+#define MAX_INSTRUCTION_TEXT 4096
+#define MAX_TARGETS 260
+#define MAX_JUMP_TABLE 256
+
+static uint8_t * g_image = 0;      /* code then initialized data, with zeros after so operands can be read */
+static uint32_t g_code_size = 0;
+static uint32_t g_image_size = 0;
+static uint8_t g_width = 2;        /* image width */
+static uint8_t g_shift = 1;        /* log2 of the image width */
+
+static uint8_t * g_start = 0;      /* per address: an instruction starts here in a linear sweep of the code */
+static uint8_t * g_entry = 0;      /* per address: a function starts here */
+static uint8_t * g_reach = 0;      /* per address: reachable in the function being translated */
+static uint8_t * g_label = 0;      /* per address: a label in the function being translated */
+static uint32_t * g_owner = 0;     /* per address: 1 + the entry of the first function with this label */
+
+static char g_text[ MAX_INSTRUCTION_TEXT ];    /* C for the instruction being translated */
+static size_t g_text_len = 0;
+static char g_pc_text[ 40 ];                   /* what reads of rpc see: the current instruction's address */
+static bool g_ends = false;                    /* the instruction doesn't continue with the next one */
+static bool g_call = false;                    /* the instruction calls, so the next one is a return address */
+static bool g_unsupported = false;             /* the instruction writes rpc */
+static bool g_jmpr = false;                    /* the function needs its dispatch switch for jmp through a register */
+static uint32_t g_targets[ MAX_TARGETS ];      /* addresses in the code the instruction may branch to */
+static size_t g_target_count = 0;
+
+static const char * reg_names[] = { "rzero", "rpc", "rsp", "rframe", "rarg1", "rarg2", "rres", "rtmp" };
+static const char * mem_names[] = { "B", "W", "DW", "QW" };
+static const char * mem_types[] = { "uint8_t", "uint16_t", "uint32_t", "uint64_t" };
+static const char * signed_types[] = { "int8_t", "int16_t", "int32_t", "int64_t" };
+static const char * relation_ops[] = { ">", "<", "==", "!=", ">=", "<=" };
+static const char * math_ops[] = { "+", "-", "*", "/", "|", "^", "&" };
+
+void usage()
+{
+    printf( "usage: oi2c <appname.oi>\n" );
+    printf( "  OneImage to C translator. produces <appname>.c, which replaces oi.c in an oios build.\n" );
+    exit( 1 );
+} /* usage */
+
+static uint8_t get_byte( uint32_t address )
+{
+    return ( address < g_image_size ) ? g_image[ address ] : 0;
+} /* get_byte */
+
+static int16_t get_word( uint32_t address )
+{
+    return (int16_t) ( get_byte( address ) | ( get_byte( address + 1 ) << 8 ) );
+} /* get_word */
+
+/* image words are sign-extended to 64 bits like the interpreter's read_imgword */
+
+static int64_t get_imgword( uint32_t address )
+{
+    uint64_t val;
+    int i;
+
+    val = 0;
+    for ( i = g_width - 1; i >= 0; i-- )
+        val = ( val << 8 ) | get_byte( address + i );
+
+    if ( 2 == g_width )
+        return (int16_t) val;
+    if ( 4 == g_width )
+        return (int32_t) val;
+    return (int64_t) val;
+} /* get_imgword */
+
+static uint32_t instruction_length( uint8_t op )
+{
+    uint32_t len;
+    len = 1 + byte_len_from_op( op );
+    if ( 3 == len )
+        len = 1 + g_width;
+    return len;
+} /* instruction_length */
+
+static bool in_code( int64_t address )
+{
+    return ( address >= 0 ) && ( address < (int64_t) g_code_size );
+} /* in_code */
+
+static void out( const char * fmt, ... )
+{
+    va_list args;
+    int len;
+
+    va_start( args, fmt );
+    len = vsnprintf( g_text + g_text_len, sizeof( g_text ) - g_text_len, fmt, args );
+    va_end( args );
+
+    if ( len > 0 )
+        g_text_len += (size_t) len;
+    if ( g_text_len >= sizeof( g_text ) )
+    {
+        printf( "internal error: instruction text is too long\n" );
+        exit( 1 );
+    }
+} /* out */
+
+/* a C constant that converts to the same oi_t as the interpreter's ( oi_t ) of value */
+
+static const char * constant( int64_t value )
+{
+    static char bufs[ 4 ][ 40 ];
+    static int next = 0;
+    char * p;
+
+    p = bufs[ next ];
+    next = ( next + 1 ) % 4;
+
+    if ( value >= -32768 && value <= 65535 )
+        sprintf( p, "(oi_t) %d", (int) value );
+    else
+        sprintf( p, "(oi_t) 0x%llxULL", (unsigned long long) value );
+    return p;
+} /* constant */
+
+static const char * rd( uint8_t op )
+{
+    uint8_t r;
+    r = reg_from_op( op );
+    if ( 0 == r )
+        return "(oi_t) 0";
+    if ( 1 == r )
+        return g_pc_text;
+    return reg_names[ r ];
+} /* rd */
+
+static const char * wr( uint8_t op )
+{
+    uint8_t r;
+    r = reg_from_op( op );
+    if ( 1 == r )
+        g_unsupported = true;
+    if ( r < 2 )
+        return "rdiscard";
+    return reg_names[ r ];
+} /* wr */
+
+static const char * relation( uint8_t rel, const char * left, const char * right )
+{
+    static char bufs[ 2 ][ 200 ];
+    static int next = 0;
+    char * p;
+
+    p = bufs[ next ];
+    next = ( next + 1 ) % 2;
+
+    if ( 6 == rel )
+        sprintf( p, "( 0 == ( ( %s ) & 1 ) )", left );
+    else if ( 7 == rel )
+        sprintf( p, "( 0 != ( ( %s ) & 1 ) )", left );
+    else
+        sprintf( p, "( S( %s ) %s S( %s ) )", left, relation_ops[ rel ], right );
+    return p;
+} /* relation */
+
+static const char * math( uint8_t m, const char * left, const char * right )
+{
+    static char buf[ 200 ];
+
+    if ( 2 == m || 3 == m )
+        sprintf( buf, "(ioi_t) ( %s ) %s (ioi_t) ( %s )", left, math_ops[ m ], right );
+    else if ( 7 == m )
+        sprintf( buf, "(oi_t) ( ( %s ) != ( %s ) )", left, right );
+    else
+        sprintf( buf, "( %s ) %s ( %s )", left, math_ops[ m ], right );
+    return buf;
+} /* math */
+
+/* instruction widths beyond the image width act like the image width, as in the OI_MULTIWIDTH engines */
+
+static uint8_t clamp_width( uint8_t width )
+{
+    return ( width > g_shift ) ? g_shift : width;
+} /* clamp_width */
+
+static void store( uint8_t width, const char * address, const char * value )
+{
+    out( "    %s( %s ) = (%s) ( %s );\n", mem_names[ width ], address, mem_types[ width ], value );
+} /* store */
+
+static void load( const char * dst, uint8_t width, const char * address )
+{
+    out( "    %s = (oi_t) %s( %s );\n", dst, mem_names[ width ], address );
+} /* load */
+
+static void load_signed( const char * dst, uint8_t width, const char * address )
+{
+    out( "    %s = (oi_t) (ioi_t) (%s) %s( %s );\n", dst, signed_types[ width ], mem_names[ width ], address );
+} /* load_signed */
+
+static void add_target( int64_t address )
+{
+    if ( in_code( address ) && ( g_target_count < MAX_TARGETS ) )
+        g_targets[ g_target_count++ ] = (uint32_t) address;
+} /* add_target */
+
+static void branch( int64_t address )
+{
+    if ( in_code( address ) )
+    {
+        add_target( address );
+        out( "        goto L_%llx;\n", (unsigned long long) address );
+    }
+    else
+        out( "        leave( %s );\n", constant( address ) );
+} /* branch */
+
+/* the pc offsets 0..3 of j instructions return: 0=ret, 1=retnf, 2=ret0, 3=ret0nf */
+
+static void jump_return( int64_t offset )
+{
+    out( "        POP( t );\n" );
+    if ( 0 == ( offset & 1 ) )
+        out( "        POP( rframe );\n" );
+    if ( offset >= 2 )
+        out( "        rres = 0;\n" );
+    out( "        leave( t );\n" );
+} /* jump_return */
+
+/* guest pushes are done. target is known when the call has no register */
+
+static void call( uint32_t pc, uint32_t len, const char * target, int64_t known )
+{
+    out( "    SAVE();\n" );
+    if ( in_code( known ) && g_entry[ known ] )
+        out( "    t = fn_%llx( %s );\n", (unsigned long long) known, target );
+    else
+        out( "    t = oi2c_run( %s );\n", target );
+    out( "    LOAD();\n" );
+    out( "    if ( %s != t )\n", constant( pc + len ) );
+    out( "        return t;\n" );
+    g_call = true;
+} /* call */
+
+static void call_frame( uint32_t pc, uint32_t len )
+{
+    out( "    PUSH( rframe );\n" );
+    out( "    PUSH( %s );\n", constant( pc + len ) );
+    out( "    rframe = rsp - sizeof( oi_t );\n" );
+} /* call_frame */
+
+static void translate_1( uint32_t pc, uint8_t op )
+{
+    const char * r;
+
+    switch ( op )
+    {
+        case 0x00: { out( "    g_oi.rpc = %s;\n    OIHalt();\n    leave( OI2C_HALTED );\n", g_pc_text ); g_ends = true; return; }
+        case 0x08: { out( "    rres = 0;\n    POP( t );\n    POP( rframe );\n    leave( t );\n" ); g_ends = true; return; }
+        case 0x20: { out( "    POP( t );\n    rres = (ioi_t) t * (ioi_t) rres;\n" ); return; }
+        case 0x28: { out( "    rres <<= %u;\n", g_shift ); return; }
+        case 0x48: { out( "    rres = 0;\n    POP( t );\n    leave( t );\n" ); g_ends = true; return; }
+        case 0x60: { out( "    rsp += sizeof( oi_t );\n" ); return; }
+        case 0x68: { out( "    POP( t );\n    leave( t );\n" ); g_ends = true; return; }
+        case 0x80: { out( "    POP( t );\n    rres = t - rres;\n" ); return; }
+        case 0x84: { out( "    rres = %u;\n", g_width ); return; }
+        case 0x88: { out( "    rres >>= %u;\n", g_shift ); return; }
+        case 0xa0: { out( "    POP( t );\n    rres += t;\n" ); return; }
+        case 0xa8: { out( "    POP( t );\n    rres = (ioi_t) t / (ioi_t) rres;\n" ); return; }
+        case 0xc0: { out( "    POP( t );\n    POP( rframe );\n    leave( t );\n" ); g_ends = true; return; }
+        case 0xc8: { out( "    rres = sizeof( oi_t );\n" ); return; }
+        case 0xe0: { out( "    POP( t );\n    rres &= t;\n" ); return; }
+        case 0xa4: case 0xc4: case 0xe4: case 0xe8: { out( "    /* illegal instruction */\n" ); return; }
+    }
+
+    switch ( funct_from_op( op ) )
+    {
+        case 0: { out( "    %s++;\n", wr( op ) ); break; }
+        case 1: { out( "    %s--;\n", wr( op ) ); break; }
+        case 2: { out( "    PUSH( %s );\n", rd( op ) ); break; }
+        case 3: { out( "    POP( t );\n    %s = t;\n", wr( op ) ); break; }
+        case 4: { out( "    %s = 0;\n", wr( op ) ); break; }
+        case 5: { r = wr( op ); out( "    %s = %s << 1;\n", r, r ); break; }
+        case 6: { r = wr( op ); out( "    %s = %s >> 1;\n", r, r ); break; }
+        default: { r = wr( op ); out( "    %s = ! %s;\n", r, r ); break; }
+    }
+} /* translate_1 */
+
+static void translate_2( uint32_t pc, uint8_t op, uint8_t op1 )
+{
+    uint8_t funct1, width, w;
+    char address[ 200 ], value[ 200 ];
+    const char * t;
+
+    funct1 = funct_from_op( op1 );
+    width = width_from_op( op1 );
+    w = clamp_width( width );
+
+    switch ( funct_from_op( op ) )
+    {
+        case 0: /* math */
+        {
+            out( "    %s = %s;\n", wr( op ), math( funct1, rd( op ), rd( op1 ) ) );
+            break;
+        }
+        case 1: /* cmov */
+        {
+            if ( 0x21 == op )
+                out( "    /* illegal instruction */\n" );
+            else if ( 3 == funct1 ) /* ne always moves */
+                out( "    %s = %s;\n", wr( op ), rd( op1 ) );
+            else
+                out( "    if %s\n        %s = %s;\n", relation( funct1, rd( op ), rd( op1 ) ), wr( op ), rd( op1 ) );
+            break;
+        }
+        case 2: /* cmpst */
+        {
+            out( "    POP( t );\n    %s = (oi_t) %s;\n", wr( op ), relation( funct1, "t", rd( op1 ) ) );
+            break;
+        }
+        case 3:
+        {
+            sprintf( address, "rframe + sizeof( oi_t ) * %u", reg_from_op( op1 ) + 3 );
+            switch ( funct1 )
+            {
+                case 0: { out( "    %s = OW( %s );\n", wr( op ), address ); break; }
+                case 1: { out( "    OW( %s ) = %s;\n", address, rd( op ) ); break; }
+                case 2: /* ret x */
+                {
+                    out( "    POP( t );\n    POP( rframe );\n    rsp += sizeof( oi_t ) * %u;\n    leave( t );\n", 1 + reg_from_op( op1 ) );
+                    g_ends = true;
+                    break;
+                }
+                case 3: { out( "    %s = %s;\n", wr( op ), constant( (int64_t) ( ( op1 & 0x1f ) ^ 0x10 ) - 0x10 ) ); break; }
+                case 4: /* signex */
+                {
+                    if ( w < 3 )
+                    {
+                        t = wr( op );
+                        out( "    %s = (oi_t) (ioi_t) (%s) %s;\n", t, signed_types[ w ], t );
+                    }
+                    break;
+                }
+                case 5: /* memf */
+                {
+                    if ( 0 == w )
+                        out( "    memset( & B( rarg1 + rres ), (uint8_t) rtmp, (size_t) rarg2 );\n" );
+                    else
+                        out( "    for ( t = 0; t != rarg2; t++ )\n        ( (%s *) & B( rarg1 ) )[ rres + t ] = (%s) rtmp;\n",
+                             mem_types[ w ], mem_types[ w ] );
+                    break;
+                }
+                case 6: /* stadd */
+                {
+                    if ( 0 == w )
+                    {
+                        out( "    {\n        uint8_t * pb, * pend;\n" );
+                        out( "        pb = & B( rtmp + rarg1 );\n        pend = pb + ( rres - rtmp );\n" );
+                        out( "        do\n        {\n            * pb = 0;\n            pb += rarg2;\n        } while ( pb <= pend );\n    }\n" );
+                    }
+                    else
+                    {
+                        out( "    {\n        %s * pw;\n", mem_types[ w ] );
+                        out( "        pw = (%s *) & B( ( sizeof( %s ) * rtmp ) + rarg1 );\n", mem_types[ w ], mem_types[ w ] );
+                        out( "        t = rtmp;\n" );
+                        out( "        do\n        {\n            * pw = 0;\n            pw += rarg2;\n            t += rarg2;\n" );
+                        out( "        } while ( t <= rres );\n    }\n" );
+                    }
+                    break;
+                }
+                default: /* moddiv */
+                {
+                    out( "    t2 = %s;\n    if ( 0 == t2 )\n        PUSH( 0 )\n    else\n    {\n", rd( op1 ) );
+                    out( "        t = %s;\n        %s = t %% t2;\n        PUSH( t / t2 );\n    }\n", rd( op ), wr( op ) );
+                    break;
+                }
+            }
+            break;
+        }
+        case 4:
+        {
+            switch ( funct1 )
+            {
+                case 0: /* syscall */
+                {
+                    out( "    SAVE();\n    g_oi.rpc = %s;\n    OISyscall( %u );\n    LOAD();\n", g_pc_text,
+                         ( ( op << 1 ) & 0x38 ) | ( ( op1 >> 2 ) & 7 ) );
+                    out( "    if ( %s != g_oi.rpc )\n        return g_oi.rpc;\n", g_pc_text );
+                    g_call = true;
+                    break;
+                }
+                case 1: { out( "    PUSH( OW( rframe + sizeof( oi_t ) * %u ) );\n", reg_from_op( op1 ) + 3 ); break; }
+                case 2: { out( "    POP( t );\n    SETIMG( t, %s );\n", rd( op ) ); break; }
+                case 3: /* addimgw and subimgw */
+                case 6: /* addnatw and subnatw */
+                {
+                    if ( width < 2 )
+                        out( "    %s %s= %s;\n", wr( op ), ( 0 == width ) ? "+" : "-", ( 3 == funct1 ) ? "IMAGE_WIDTH" : "sizeof( oi_t )" );
+                    break;
+                }
+                case 4: /* stinc */
+                {
+                    store( w, rd( op ), rd( op1 ) );
+                    out( "    %s += %u;\n", wr( op ), 1 << width );
+                    break;
+                }
+                case 5: /* swap */
+                {
+                    out( "    t = %s;\n    %s = %s;\n    %s = t;\n", rd( op ), wr( op ), rd( op1 ), wr( op1 ) );
+                    break;
+                }
+                default: { break; }
+            }
+            break;
+        }
+        case 5:
+        {
+            switch ( funct1 )
+            {
+                case 0: { store( w, rd( op ), rd( op1 ) ); break; }
+                case 1: { load( wr( op ), w, rd( op1 ) ); break; }
+                case 2: { out( "    PUSH( %s );\n    PUSH( %s );\n", rd( op ), rd( op1 ) ); break; }
+                case 3: { out( "    POP( t );\n    %s = t;\n    POP( t );\n    %s = t;\n", wr( op ), wr( op1 ) ); break; }
+                case 7: { break; } /* fence. translated programs have one thread */
+                default: /* cas, xadd, xchg */
+                {
+                    out( "    t = %s;\n", rd( op ) );
+                    load( "t2", w, "t" );
+                    if ( 4 == funct1 )
+                    {
+                        out( "    if ( (%s) t2 == (%s) rres )\n    ", mem_types[ w ], mem_types[ w ] );
+                        store( w, "t", rd( op1 ) );
+                        out( "    rres = t2;\n" );
+                    }
+                    else
+                    {
+                        store( w, "t", ( 5 == funct1 ) ? math( 0, "t2", rd( op1 ) ) : rd( op1 ) );
+                        out( "    %s = t2;\n", wr( op1 ) );
+                    }
+                    break;
+                }
+            }
+            break;
+        }
+        case 6: /* mov */
+        {
+            if ( 0xc1 == op )
+                out( "    /* illegal instruction */\n" );
+            else
+                out( "    %s = %s;\n", wr( op ), rd( op1 ) );
+            break;
+        }
+        default: /* mathst */
+        {
+            strcpy( value, math( funct1, "t", rd( op1 ) ) );
+            out( "    POP( t );\n    %s = %s;\n", wr( op ), value );
+            break;
+        }
+    }
+} /* translate_2 */
+
+static void translate_3( uint32_t pc, uint8_t op )
+{
+    int64_t imm, k;
+    uint32_t len;
+    char address[ 200 ];
+
+    imm = get_imgword( pc + 1 );
+    len = 1 + g_width;
+
+    switch ( funct_from_op( op ) )
+    {
+        case 0: /* ld */
+        {
+            if ( 0x02 == op )
+                out( "    /* illegal instruction */\n" );
+            else
+                out( "    %s = IMG( %s );\n", wr( op ), constant( imm ) );
+            break;
+        }
+        case 1: /* ldi */
+        {
+            if ( 0x22 == op )
+                out( "    /* illegal instruction */\n" );
+            else
+                out( "    %s = %s;\n", wr( op ), constant( imm ) );
+            break;
+        }
+        case 2: { out( "    SETIMG( %s, %s );\n", constant( imm ), rd( op ) ); break; }
+        case 3: /* jmp */
+        {
+            g_ends = true;
+            if ( 0 == reg_from_op( op ) )
+            {
+                out( "    {\n" );
+                branch( imm );
+                out( "    }\n" );
+            }
+            else
+            {
+                /* guess that the table is a run of instructions at native-width intervals */
+                for ( k = 0; k < MAX_JUMP_TABLE; k++ )
+                {
+                    if ( !in_code( imm + 8 * k ) || !g_start[ imm + 8 * k ] )
+                        break;
+                    add_target( imm + 8 * k );
+                }
+                out( "    pc = %s + sizeof( oi_t ) * %s;\n    goto dispatch;\n", constant( imm ), rd( op ) );
+                g_jmpr = true;
+            }
+            break;
+        }
+        case 4: { out( "    %s( %s + %s )++;\n", mem_names[ g_shift ], constant( imm ), rd( op ) ); break; }
+        case 5: { out( "    %s( %s + %s )--;\n", mem_names[ g_shift ], constant( imm ), rd( op ) ); break; }
+        case 6: { out( "    rres = IMG( %s + IMAGE_WIDTH * %s );\n", constant( imm ), rd( op ) ); break; }
+        default: /* call */
+        {
+            call_frame( pc, len );
+            if ( 0 == reg_from_op( op ) )
+                call( pc, len, constant( imm ), imm );
+            else
+            {
+                sprintf( address, "%s + IMAGE_WIDTH * %s", constant( imm ), rd( op ) );
+                call( pc, len, address, -1 );
+            }
+            break;
+        }
+    }
+} /* translate_3 */
+
+static void translate_4( uint32_t pc, uint8_t op, uint8_t op1, uint8_t op2 )
+{
+    uint8_t funct1, width, w;
+    int64_t ival, address;
+    char right[ 200 ], where[ 200 ], value[ 200 ];
+    bool always;
+
+    funct1 = funct_from_op( op1 );
+    width = width_from_op( op1 );
+    w = clamp_width( width );
+    ival = get_word( pc + 2 );
+    address = (int64_t) pc + ival;
+
+    switch ( funct_from_op( op ) )
+    {
+        case 0: /* j, ji, jrelb, jrel */
+        {
+            if ( 0 == width )
+                strcpy( right, rd( op1 ) );
+            else if ( 1 == width )
+                strcpy( right, constant( 1 + reg_from_op( op1 ) ) );
+            else
+            {
+                if ( 2 == width )
+                    sprintf( right, "(oi_t) B( %s + %u )", rd( op1 ), op2 );
+                else
+                    sprintf( right, "IMG( %s + %u )", rd( op1 ), op2 );
+                ival = (int8_t) get_byte( pc + 3 );
+                address = (int64_t) pc + ival;
+            }
+
+            /* j reg, reg with eq, ge, or le always jumps */
+            always = ( 0 == width ) && ( reg_from_op( op ) == reg_from_op( op1 ) ) && ( 2 == funct1 || 4 == funct1 || 5 == funct1 );
+            if ( !always )
+                out( "    if %s\n", relation( funct1, rd( op ), right ) );
+            out( "    {\n" );
+            if ( ival >= 0 && ival <= 3 )
+                jump_return( ival );
+            else
+                branch( address );
+            out( "    }\n" );
+            g_ends = always;
+            break;
+        }
+        case 1: /* stinc [reg0], constant */
+        {
+            store( w, rd( op ), constant( ival ) );
+            out( "    %s += %u;\n", wr( op ), 1 << width );
+            break;
+        }
+        case 2: /* ldinc */
+        {
+            if ( 0x43 == op )
+                out( "    /* illegal instruction */\n" );
+            else
+            {
+                sprintf( where, "%s + %s", rd( op1 ), constant( address ) );
+                load( wr( op ), w, where );
+                out( "    %s += %u;\n", wr( op1 ), 1 << width );
+            }
+            break;
+        }
+        case 3: /* call address[ reg0 ], callnf address[ reg0 ], callnf address */
+        {
+            if ( 0 == funct1 )
+                call_frame( pc, 4 );
+            else
+                out( "    PUSH( %s );\n", constant( pc + 4 ) );
+
+            if ( funct1 < 2 )
+            {
+                out( "    t2 = IMG( %s + IMAGE_WIDTH * %s );\n", constant( address ), rd( op ) );
+                call( pc, 4, "t2", -1 );
+            }
+            else if ( 0 == reg_from_op( op ) )
+                call( pc, 4, constant( address ), address );
+            else
+            {
+                sprintf( where, "%s + IMAGE_WIDTH * %s", constant( address ), rd( op ) );
+                call( pc, 4, where, -1 );
+            }
+            break;
+        }
+        case 4: /* sto */
+        {
+            sprintf( where, "%s + ( %s << %u )", constant( address ), rd( op1 ), w );
+            store( w, where, rd( op ) );
+            break;
+        }
+        case 5:
+        {
+            if ( 0xa3 == op ) /* cpuinfo */
+                out( "    rres = 1;\n    rtmp = 'd' + ( 'l' << 8 );\n" );
+            else if ( 2 == funct1 ) /* ldiw */
+                out( "    %s = %s;\n", wr( op ), constant( ival ) );
+            else
+            {
+                if ( 1 == funct1 ) /* ldoinc increments first */
+                    out( "    %s++;\n", wr( op1 ) );
+                sprintf( where, "%s + ( %s << %u )", constant( address ), rd( op1 ), w );
+                load( wr( op ), w, where );
+            }
+            break;
+        }
+        case 6:
+        {
+            switch ( funct1 )
+            {
+                case 0: /* ld */
+                {
+                    if ( 0 != reg_from_op( op ) )
+                        load( wr( op ), w, constant( address ) );
+                    break;
+                }
+                case 1: /* sti */
+                {
+                    store( w, constant( address ), constant( (int64_t) ( ( ( ( op << 1 ) & 0x38 ) | reg_from_op( op1 ) ) ^ 0x20 ) - 0x20 ) );
+                    break;
+                }
+                case 2: /* math */
+                {
+                    if ( 0 != reg_from_op( op ) )
+                        out( "    %s = %s;\n", wr( op ), math( funct_from_op( op2 ), rd( op1 ), rd( op2 ) ) );
+                    break;
+                }
+                case 3: /* cmp */
+                {
+                    if ( 0 != reg_from_op( op ) )
+                        out( "    %s = (oi_t) %s;\n", wr( op ), relation( funct_from_op( op2 ), rd( op1 ), rd( op2 ) ) );
+                    break;
+                }
+                case 4: /* fzero */
+                {
+                    out( "    t = %s;\n", rd( op ) );
+                    out( "    while ( ( t < %u ) && ( 0 != ( (%s *) & B( %s ) )[ t ] ) )\n        t++;\n",
+                         (uint16_t) ival, mem_types[ w ], rd( op1 ) );
+                    out( "    %s = t;\n", wr( op ) );
+                    break;
+                }
+                default:
+                {
+                    /* like the interpreter, stoi continues with stor, and stor continues with ldor */
+                    sprintf( where, "%s + ( %s << %u )", rd( op ), rd( op1 ), w );
+                    if ( 5 == funct1 )
+                        store( w, where, constant( ival ) );
+                    if ( funct1 <= 6 )
+                        store( w, where, rd( op2 ) );
+                    sprintf( where, "%s + ( %s << %u )", rd( op1 ), rd( op2 ), w );
+                    strcpy( value, wr( op ) );
+                    load_signed( value, w, where );
+                    break;
+                }
+            }
+            break;
+        }
+        default: /* cstf */
+        {
+            out( "    if %s\n", relation( funct1, rd( op ), rd( op1 ) ) );
+            out( "        OW( rframe + sizeof( oi_t ) * %u ) = %s;\n", reg_from_op( op2 ) + 3, rd( op ) );
+            break;
+        }
+    }
+} /* translate_4 */
+
+/* translate the instruction at pc into g_text and note where it goes next. returns its length */
+
+static uint32_t translate( uint32_t pc )
+{
+    uint8_t op;
+
+    op = get_byte( pc );
+    g_text_len = 0;
+    g_text[ 0 ] = 0;
+    g_ends = false;
+    g_call = false;
+    g_unsupported = false;
+    g_target_count = 0;
+    sprintf( g_pc_text, "(oi_t) 0x%x", pc );
+
+    switch ( op & 3 )
+    {
+        case 0: { translate_1( pc, op ); break; }
+        case 1: { translate_2( pc, op, get_byte( pc + 1 ) ); break; }
+        case 2: { translate_3( pc, op ); break; }
+        default: { translate_4( pc, op, get_byte( pc + 1 ), get_byte( pc + 2 ) ); break; }
+    }
+
+    if ( g_unsupported )
+    {
+        g_text_len = 0;
+        out( "    oi2c_unsupported( %s );\n", g_pc_text );
+        g_ends = true;
+        g_call = false;
+        g_target_count = 0;
+    }
+
+    return instruction_length( op );
+} /* translate */
+
+static void add_entry( int64_t address )
+{
+    if ( in_code( address ) && g_start[ address ] )
+        g_entry[ address ] = true;
+} /* add_entry */
+
+/* linear sweep of the code for instruction starts, then look for function entries */
+
+static void find_entries( uint32_t initial_pc )
+{
+    uint32_t pc, len, a;
+    uint8_t op, op1;
+    int64_t imm;
+
+    for ( pc = 0; pc < g_code_size; pc += len )
+    {
+        g_start[ pc ] = true;
+        len = instruction_length( get_byte( pc ) );
+    }
+
+    add_entry( 0 ); /* the halt that returning from the initial function reaches */
+    add_entry( initial_pc );
+
+    for ( pc = 0; pc < g_code_size; pc += len )
+    {
+        op = get_byte( pc );
+        op1 = get_byte( pc + 1 );
+        len = instruction_length( op );
+
+        if ( 2 == ( op & 3 ) )
+        {
+            imm = get_imgword( pc + 1 );
+            if ( 0xe2 == op || 1 == funct_from_op( op ) ) /* call and ldi */
+                add_entry( imm );
+        }
+        else if ( 3 == ( op & 3 ) )
+        {
+            imm = get_word( pc + 2 );
+            if ( 0x63 == op && funct_from_op( op1 ) >= 2 ) /* callnf address */
+                add_entry( pc + imm );
+            else if ( 5 == funct_from_op( op ) && 2 == funct_from_op( op1 ) ) /* ldiw */
+                add_entry( imm );
+        }
+    }
+
+    /* function pointer tables in initialized data */
+    for ( a = g_code_size; a + g_width <= g_image_size; a += g_width )
+        add_entry( get_imgword( a ) );
+} /* find_entries */
+
+/* mark what's reachable from entry and its labels */
+
+static void follow( uint32_t entry )
+{
+    static uint32_t work[ 65536 ];
+    size_t count, i;
+    uint32_t pc, len, next, prev;
+
+    memset( g_reach, 0, g_code_size );
+    memset( g_label, 0, g_code_size );
+    g_jmpr = false;
+
+    count = 0;
+    work[ count++ ] = entry;
+    g_label[ entry ] = true;
+
+    while ( 0 != count )
+    {
+        pc = work[ --count ];
+        while ( in_code( pc ) && !g_reach[ pc ] )
+        {
+            g_reach[ pc ] = true;
+            len = translate( pc );
+            for ( i = 0; i < g_target_count; i++ )
+            {
+                g_label[ g_targets[ i ] ] = true;
+                if ( !g_reach[ g_targets[ i ] ] && ( count < ( sizeof( work ) / sizeof( work[ 0 ] ) ) ) )
+                    work[ count++ ] = g_targets[ i ];
+            }
+            if ( g_call && in_code( pc + len ) )
+                g_label[ pc + len ] = true;
+            if ( g_ends )
+                break;
+            pc += len;
+        }
+    }
+
+    /* falling through to code that isn't next in address order (overlapping instructions) needs a goto */
+    prev = g_code_size;
+    for ( pc = 0; pc < g_code_size; pc++ )
+    {
+        if ( !g_reach[ pc ] )
+            continue;
+        if ( prev < g_code_size )
+        {
+            len = translate( prev );
+            next = prev + len;
+            if ( !g_ends && ( next != pc ) && in_code( next ) )
+                g_label[ next ] = true;
+        }
+        prev = pc;
+    }
+} /* follow */
+
+static void write_function( FILE * fp, uint32_t entry )
+{
+    uint32_t pc, len, next, following;
+    const char * dis;
+
+    follow( entry );
+
+    fprintf( fp, "static oi_t fn_%x( oi_t pc )\n{\n", entry );
+    fprintf( fp, "    oi_t rsp, rframe, rarg1, rarg2, rres, rtmp, t, t2;\n\n" );
+    fprintf( fp, "    LOAD();\n" );
+    fprintf( fp, "    if ( 0x%x == pc )\n        goto L_%x;\n\n", entry, entry );
+    if ( g_jmpr )
+        fprintf( fp, "  dispatch:\n" );
+    fprintf( fp, "    switch ( pc )\n    {\n" );
+    for ( pc = 0; pc < g_code_size; pc++ )
+        if ( g_label[ pc ] && g_reach[ pc ] )
+            fprintf( fp, "        case 0x%x: goto L_%x;\n", pc, pc );
+    fprintf( fp, "        default: leave( pc );\n    }\n" );
+
+    for ( pc = 0; pc < g_code_size; pc++ )
+    {
+        if ( !g_reach[ pc ] )
+            continue;
+
+        fprintf( fp, "\n" );
+        if ( g_label[ pc ] )
+            fprintf( fp, "  L_%x:\n", pc );
+        dis = DisassembleOI( g_image + pc, (oi_t) pc, g_width );
+        fprintf( fp, "    /* %04x %s */\n", pc, dis );
+        len = translate( pc );
+        fputs( g_text, fp );
+
+        /* the next reachable address may not be where this instruction continues */
+        next = pc + len;
+        if ( !g_ends )
+        {
+            following = pc + 1;
+            while ( ( following < g_code_size ) && !g_reach[ following ] )
+                following++;
+
+            if ( !in_code( next ) )
+                fprintf( fp, "    leave( (oi_t) 0x%x );\n", next );
+            else if ( following != next )
+                fprintf( fp, "    goto L_%x;\n", next );
+        }
+    }
+
+    fprintf( fp, "} /* fn_%x */\n\n", entry );
+} /* write_function */
+
+static void write_prologue( FILE * fp, const char * appname, uint32_t checksum )
+{
+    fprintf( fp, "/*\n    %s translated to C by oi2c. build it in place of oi.c:\n", appname );
+    fprintf( fp, "        g++ -O2 -fno-strict-aliasing -D OI8 -D OI2C -D NDEBUG -I . oios.c <this file> trace.c oidis.c -o <app>\n" );
+    fprintf( fp, "    and run it with the image like oios: <app> %s [args]\n*/\n\n", appname );
+
+    fprintf( fp, "#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n#include <stdint.h>\n\n" );
+    fprintf( fp, "#include \"oi.h\"\n\n" );
+    fprintf( fp, "#ifndef OI2C\n#error build oios.c and this file with -D OI2C\n#endif\n\n" );
+    fprintf( fp, "#define true 1\n#define false 0\n\n" );
+
+    if ( g_width > 2 )
+        fprintf( fp, "#ifdef OI2\n#error this image needs a build with registers at least %u bytes wide\n#endif\n", g_width );
+    if ( g_width > 4 )
+        fprintf( fp, "#ifdef OI4\n#error this image needs a build with registers at least %u bytes wide\n#endif\n", g_width );
+    if ( g_width > 2 )
+        fprintf( fp, "\n" );
+
+    fprintf( fp, "#define IMAGE_WIDTH %u\n", g_width );
+    fprintf( fp, "#define IMAGE_SHIFT %u\n", g_shift );
+    fprintf( fp, "#define CODE_SIZE %u\n", g_code_size );
+    fprintf( fp, "#define CODE_CHECKSUM 0x%x\n", checksum );
+    fprintf( fp, "#define OI2C_HALTED ( (oi_t) -1 )\n\n" );
+
+    if ( 2 == g_width )
+    {
+        fprintf( fp, "#define RAM_SIZE 65536\n" );
+        fprintf( fp, "#define MASK( a ) ( (oi_t) ( a ) & 0xffff )\n" );
+        fprintf( fp, "#define S( x ) ( (int16_t) ( x ) )\n" );
+        fprintf( fp, "#define IMG( a ) ( (oi_t) (ioi_t) (int16_t) W( a ) )\n" );
+        fprintf( fp, "#define SETIMG( a, v ) ( W( a ) = (uint16_t) ( v ) )\n" );
+    }
+    else if ( 4 == g_width )
+    {
+        fprintf( fp, "#define RAM_SIZE ( 8 * 1024 * 1024 )\n" );
+        fprintf( fp, "#define MASK( a ) ( (oi_t) ( a ) & 0xffffffff )\n" );
+        fprintf( fp, "#define S( x ) ( (int32_t) ( x ) )\n" );
+        fprintf( fp, "#define IMG( a ) ( (oi_t) (ioi_t) (int32_t) DW( a ) )\n" );
+        fprintf( fp, "#define SETIMG( a, v ) ( DW( a ) = (uint32_t) ( v ) )\n" );
+    }
+    else
+    {
+        fprintf( fp, "#define RAM_SIZE ( 8 * 1024 * 1024 )\n" );
+        fprintf( fp, "#define MASK( a ) ( (oi_t) ( a ) )\n" );
+        fprintf( fp, "#define S( x ) ( (ioi_t) ( x ) )\n" );
+        fprintf( fp, "#define IMG( a ) ( (oi_t) QW( a ) )\n" );
+        fprintf( fp, "#define SETIMG( a, v ) ( QW( a ) = (uint64_t) ( v ) )\n" );
+    }
+
+    fprintf( fp, "\n/* guest RAM. addresses wrap at the image width like they do in oi.c */\n\n" );
+    fprintf( fp, "#define B( a ) ( ram[ MASK( a ) ] )\n" );
+    fprintf( fp, "#define W( a ) ( * (uint16_t *) ( ram + MASK( a ) ) )\n" );
+    fprintf( fp, "#define DW( a ) ( * (uint32_t *) ( ram + MASK( a ) ) )\n" );
+    fprintf( fp, "#define QW( a ) ( * (uint64_t *) ( ram + MASK( a ) ) )\n" );
+    fprintf( fp, "#define OW( a ) ( * (oi_t *) ( ram + MASK( a ) ) )\n\n" );
+
+    fprintf( fp, "/* guest registers are locals in each function and are in g_oi across calls and syscalls */\n\n" );
+    fprintf( fp, "#define LOAD() rsp = g_oi.rsp, rframe = g_oi.rframe, rarg1 = g_oi.rarg1, rarg2 = g_oi.rarg2, rres = g_oi.rres, rtmp = g_oi.rtmp\n" );
+    fprintf( fp, "#define SAVE() g_oi.rsp = rsp, g_oi.rframe = rframe, g_oi.rarg1 = rarg1, g_oi.rarg2 = rarg2, g_oi.rres = rres, g_oi.rtmp = rtmp\n" );
+    fprintf( fp, "#define leave( address ) { SAVE(); return ( address ); }\n" );
+    fprintf( fp, "#define PUSH( v ) { rsp -= sizeof( oi_t ); OW( rsp ) = ( v ); }\n" );
+    fprintf( fp, "#define POP( r ) { r = OW( rsp ); rsp += sizeof( oi_t ); }\n\n" );
+
+    fprintf( fp, "#if RAM_SIZE > 65536\nstatic uint8_t ram[ RAM_SIZE ];\n#else\nstatic uint8_t ram[ RAM_SIZE + 8 ];\n#endif\n\n" );
+    fprintf( fp, "struct OneImage g_oi;\n" );
+    fprintf( fp, "static oi_t rdiscard; /* writes to rzero */\n\n" );
+
+    fprintf( fp, "static oi_t oi2c_run( oi_t pc );\n\n" );
+
+    fprintf( fp, "static void oi2c_unsupported( oi_t pc )\n{\n" );
+    fprintf( fp, "    printf( \"oi2c: the instruction at %%llx writes rpc, which isn't supported\\n\", (unsigned long long) pc );\n" );
+    fprintf( fp, "    OIHardTermination();\n} /* oi2c_unsupported */\n\n" );
+} /* write_prologue */
+
+static void write_epilogue( FILE * fp )
+{
+    uint32_t pc;
+
+    fprintf( fp, "/* run the function with the label at pc. returns where the guest continues */\n\n" );
+    fprintf( fp, "static oi_t oi2c_run( oi_t pc )\n{\n    switch ( pc )\n    {\n" );
+    for ( pc = 0; pc < g_code_size; pc++ )
+        if ( 0 != g_owner[ pc ] )
+            fprintf( fp, "        case 0x%x: return fn_%x( pc );\n", pc, g_owner[ pc ] - 1 );
+    fprintf( fp, "    }\n\n" );
+    fprintf( fp, "    printf( \"oi2c: no translated code for address %%llx\\n\", (unsigned long long) pc );\n" );
+    fprintf( fp, "    OIHardTermination();\n    return OI2C_HALTED;\n} /* oi2c_run */\n\n" );
+
+    fprintf( fp, "void ResetOI( oi_t memSize, oi_t pc, oi_t sp, uint8_t imageWidth )\n{\n" );
+    fprintf( fp, "    oi_t rsp;\n\n" );
+    fprintf( fp, "    memset( &g_oi, 0, sizeof( g_oi ) );\n" );
+    fprintf( fp, "    memset( ram, 0, (size_t) memSize );\n" );
+    fprintf( fp, "    g_oi.rpc = pc;\n" );
+    fprintf( fp, "    g_oi.image_width = imageWidth;\n" );
+    fprintf( fp, "    g_oi.image_shift = IMAGE_SHIFT;\n" );
+    fprintf( fp, "    g_oi.three_byte_len = (uint8_t) 1 + imageWidth;\n" );
+    fprintf( fp, "#ifndef OI2\n    g_oi.address_mask = MASK( ~ (oi_t) 0 );\n#endif\n\n" );
+    fprintf( fp, "    rsp = sp;\n" );
+    fprintf( fp, "    PUSH( 0 ); /* rframe */\n" );
+    fprintf( fp, "    PUSH( 0 ); /* return address is 0, which has a halt instruction */\n" );
+    fprintf( fp, "    g_oi.rsp = rsp;\n" );
+    fprintf( fp, "    g_oi.rframe = rsp - sizeof( oi_t );\n" );
+    fprintf( fp, "} /* ResetOI */\n\n" );
+
+    fprintf( fp, "uint32_t RamInformationOI( uint32_t required, uint8_t ** ppRam, uint8_t imageWidth )\n{\n" );
+    fprintf( fp, "    uint32_t available;\n\n" );
+    fprintf( fp, "    available = RAM_SIZE;\n" );
+    fprintf( fp, "    if ( ( IMAGE_WIDTH != imageWidth ) || ( available < required ) )\n        *ppRam = 0;\n" );
+    fprintf( fp, "    else\n        *ppRam = ram;\n" );
+    fprintf( fp, "    return available;\n} /* RamInformationOI */\n\n" );
+
+    fprintf( fp, "uint32_t ExecuteOI()\n{\n" );
+    fprintf( fp, "    oi_t pc;\n    uint32_t sum, i;\n\n" );
+    fprintf( fp, "    sum = 0;\n    for ( i = 0; i < CODE_SIZE; i++ )\n        sum = ( sum * 31 ) + ram[ i ];\n" );
+    fprintf( fp, "    if ( CODE_CHECKSUM != sum )\n    {\n" );
+    fprintf( fp, "        printf( \"oi2c: the image's code doesn't match the code that was translated\\n\" );\n" );
+    fprintf( fp, "        OIHardTermination();\n    }\n\n" );
+    fprintf( fp, "    pc = g_oi.rpc;\n" );
+    fprintf( fp, "    do\n        pc = oi2c_run( pc );\n    while ( OI2C_HALTED != pc );\n\n" );
+    fprintf( fp, "    return 0;\n} /* ExecuteOI */\n\n" );
+
+    fprintf( fp, "void TraceInstructionsOI( bool t )\n{\n    (void) t;\n} /* TraceInstructionsOI */\n\n" );
+    fprintf( fp, "#ifdef OI_PREDECODE\n" );
+    fprintf( fp, "void EnableDecodeCacheOI( oi_t code_size )\n{\n    (void) code_size;\n} /* EnableDecodeCacheOI */\n\n" );
+    fprintf( fp, "void InvalidateCodeOI( oi_t address, oi_t length )\n{\n    (void) address;\n    (void) length;\n} /* InvalidateCodeOI */\n" );
+    fprintf( fp, "#endif /* OI_PREDECODE */\n" );
+    fprintf( fp, "#ifdef OI_JIT\n\nvoid EnableJitOI()\n{\n} /* EnableJitOI */\n\n#endif /* OI_JIT */\n" );
+} /* write_epilogue */
+
+int cdecl main( int argc, char * argv[] )
+{
+    FILE * fp;
+    struct OIHeader h;
+    static char appname[ 80 ];
+    static char outname[ 80 ];
+    char * p;
+    uint32_t pc, a, checksum, count;
+
+    if ( 2 != argc || '-' == argv[ 1 ][ 0 ] || strlen( argv[ 1 ] ) > 70 )
+        usage();
+
+    strcpy( appname, argv[ 1 ] );
+    p = strchr( appname, '.' );
+    if ( !p )
+        strcat( appname, ".oi" );
+
+    fp = fopen( appname, "rb" );
+    if ( !fp )
+    {
+        printf( "can't open image file '%s'\n", appname );
+        usage();
+    }
+
+    if ( 1 != fread( &h, sizeof( h ), 1, fp ) || 'O' != h.sig0 || 'I' != h.sig1 || ( h.flags & OI_FLAG_WIDTH ) > 2 )
+    {
+        printf( "image file header is malformed\n" );
+        exit( 1 );
+    }
+
+    if ( h.flags & OI_FLAG_COMPRESSED )
+    {
+        printf( "compressed images aren't supported. assemble without oia -z\n" );
+        exit( 1 );
+    }
+    fseek( fp, (long) oi_code_offset( h ), SEEK_SET );
+
+    g_width = (uint8_t) ( 2 << ( h.flags & OI_FLAG_WIDTH ) );
+    g_shift = (uint8_t) ( 1 + ( h.flags & OI_FLAG_WIDTH ) );
+    g_code_size = h.cbCode;
+    g_image_size = h.cbCode + h.cbInitializedData;
+    g_image = (uint8_t *) calloc( g_image_size + 16, 1 );
+    g_start = (uint8_t *) calloc( g_code_size + 1, 1 );
+    g_entry = (uint8_t *) calloc( g_code_size + 1, 1 );
+    g_reach = (uint8_t *) calloc( g_code_size + 1, 1 );
+    g_label = (uint8_t *) calloc( g_code_size + 1, 1 );
+    g_owner = (uint32_t *) calloc( g_code_size + 1, sizeof( uint32_t ) );
+    if ( !g_image || !g_start || !g_entry || !g_reach || !g_label || !g_owner )
+    {
+        printf( "out of memory\n" );
+        exit( 1 );
+    }
+
+    if ( 0 != g_image_size && 1 != fread( g_image, g_image_size, 1, fp ) )
+    {
+        printf( "can't read image file\n" );
+        exit( 1 );
+    }
+    fclose( fp );
+
+    checksum = 0;
+    for ( pc = 0; pc < g_code_size; pc++ )
+        checksum = ( checksum * 31 ) + g_image[ pc ];
+
+    find_entries( h.loInitialPC );
+
+    /* the first function with a label runs it when the guest gets there through a dispatch */
+    count = 0;
+    for ( pc = 0; pc < g_code_size; pc++ )
+    {
+        if ( !g_entry[ pc ] )
+            continue;
+        count++;
+        follow( pc );
+        for ( a = 0; a < g_code_size; a++ )
+            if ( g_label[ a ] && g_reach[ a ] && ( 0 == g_owner[ a ] ) )
+                g_owner[ a ] = pc + 1;
+    }
+
+    strcpy( outname, appname );
+    p = strchr( outname, '.' );
+    strcpy( p, ".c" );
+
+    fp = fopen( outname, "w" );
+    if ( !fp )
+    {
+        printf( "can't create output file '%s'\n", outname );
+        exit( 1 );
+    }
+
+    write_prologue( fp, appname, checksum );
+
+    for ( pc = 0; pc < g_code_size; pc++ )
+        if ( g_entry[ pc ] )
+            fprintf( fp, "static oi_t fn_%x( oi_t pc );\n", pc );
+    fprintf( fp, "\n" );
+
+    for ( pc = 0; pc < g_code_size; pc++ )
+        if ( g_entry[ pc ] )
+            write_function( fp, pc );
+
+    write_epilogue( fp );
+    fclose( fp );
+
+    printf( "translated %u functions from %s to %s\n", count, appname, outname );
+    return 0;
+} /* main */
@@ -59,6 +59,7 @@ enum TokenTypes
     T_MOV, T_CMOV, T_RET, T_RET0, T_RETNF, T_RET0NF, T_INV,
     T_CSTF, T_MATHST, T_MATH, T_PLUS, T_IMGWID, T_ADDIMGW, T_SUBIMGW, T_ADDNATW, T_SUBNATW, T_NATWID,
     T_SIGNEXB, T_SIGNEXW, T_SIGNEXDW, T_SWAP,
+    T_CAS, T_CASB, T_XADD, T_XADDB, T_XCHG, T_XCHGB, T_FENCE,
     T_FZERO, T_FZEROB, T_CPUINFO, T_CALLNF, T_CALL
 };
 
@@ -77,6 +78,7 @@ static const char * TokenSet[] =
     "MOV", "CMOV", "RET", "RET0", "RETNF", "RET0NF", "INV",
     "CSTF", "MATHST", "MATH", "+", "IMGWID", "ADDIMGW", "SUBIMGW", "ADDNATW", "SUBNATW", "NATWID",
     "SIGNEXB", "SIGNEXW", "SIGNEXDW", "SWAP",
+    "CAS", "CASB", "XADD", "XADDB", "XCHG", "XCHGB", "FENCE",
     "FZERO", "FZEROB", "CPUINFO", "CALLNF", "CALL"
 };
 
@@ -319,8 +321,10 @@ void usage()
     printf( "  flags:\n" );
     printf( "      -i          show information about the generated image\n" );
     printf( "      -l          create listing file <source>.lst\n" );
+    printf( "      -p          page-align the code and data (a version 2 image) so oios can map them\n" );
     printf( "      -t          show verbose tracing as assembly happens\n" );
     printf( "      -w:X        image width: 2, 4, or 8 bytes. Default is 2.\n" );
+    printf( "      -z          compress the code and data (a version 1 image). can't be used with -p\n" );
     exit( 1 );
 } /* usage */
 
@@ -473,6 +477,63 @@ width_t round_up( width_t x, width_t multiple )
     return x + multiple - remainder;
 } /* round_up */
 
+/* LZSS compression for -z. see OI_FLAG_COMPRESSED in oios.h for the format. returns the compressed size */
+
+#define LZ_WINDOW 4095
+#define LZ_MIN 3
+#define LZ_MAX 18
+
+#ifdef OLDCPU
+size_t write_compressed( fp, p, length ) FILE * fp; uint8_t * p; size_t length;
+#else
+size_t write_compressed( FILE * fp, uint8_t * p, size_t length )
+#endif
+{
+    uint8_t items[ 16 ];
+    size_t i, j, k, best, distance, count, written;
+    int bit, flags;
+
+    i = 0;
+    written = 0;
+    while ( i < length )
+    {
+        flags = 0;
+        count = 0;
+        for ( bit = 0; ( bit < 8 ) && ( i < length ); bit++ )
+        {
+            /* the longest match in the window. it may overlap i, which makes runs cheap */
+            best = 0;
+            distance = 0;
+            for ( j = ( i > LZ_WINDOW ) ? ( i - LZ_WINDOW ) : 0; j < i; j++ )
+            {
+                for ( k = 0; ( k < LZ_MAX ) && ( i + k < length ) && ( p[ j + k ] == p[ i + k ] ); k++ )
+                    continue;
+                if ( k > best )
+                {
+                    best = k;
+                    distance = i - j;
+                }
+            }
+
+            if ( best >= LZ_MIN )
+            {
+                flags |= ( 1 << bit );
+                items[ count++ ] = (uint8_t) distance;
+                items[ count++ ] = (uint8_t) ( ( ( distance >> 4 ) & 0xf0 ) | ( best - LZ_MIN ) );
+                i += best;
+            }
+            else
+                items[ count++ ] = p[ i++ ];
+        }
+
+        fputc( flags, fp );
+        fwrite( items, count, 1, fp );
+        written += 1 + count;
+    }
+
+    return written;
+} /* write_compressed */
+
 #ifdef OLDCPU
 void check_if_in_i16_range( val ) iwidth_t val;
 #else
@@ -549,12 +610,14 @@ int cdecl main( int argc, char * argv[] )
     int i, data_mode, code_mode, token_count;
     width_t initialized_data_so_far, total_zeroed_data, code_so_far, total_initialized_data, total_code;
     width_t initialized_data_offset, zeroed_data_offset;
-    bool is_register, show_image_info, show_verbose_tracing, create_listing;
+    bool is_register, show_image_info, show_verbose_tracing, create_listing, page_align, compress;
     struct LabelItem * plabel;
     struct DefineItem * pdefine;
     struct OIHeader h;
 
     create_listing = false;
+    page_align = false;
+    compress = false;
     show_image_info = false;
     show_verbose_tracing = false;
     input = 0;
@@ -585,6 +648,10 @@ int cdecl main( int argc, char * argv[] )
                 show_image_info = true;
             else if ( 'l' == ca )
                 create_listing = true;
+            else if ( 'p' == ca )
+                page_align = true;
+            else if ( 'z' == ca )
+                compress = true;
             else if ( 't' == ca )
                 show_verbose_tracing= true;
             else if ( 'w' == ca )
@@ -615,6 +682,13 @@ int cdecl main( int argc, char * argv[] )
         usage();
     }
 
+    /* a compressed image can't be mapped, so page alignment would just make it bigger */
+    if ( page_align && compress )
+    {
+        printf( "-p and -z can't be used together\n" );
+        usage();
+    }
+
     strcpy( acfile, input);
     p = strstr( acfile, ".s" );
     if ( !p )
@@ -1003,6 +1077,36 @@ int cdecl main( int argc, char * argv[] )
                 code[ code_so_far++ ] = compose_op( 3, reg_from_token( t2 ), g_byte_len );
                 break;
             }
+            case T_CAS:
+            case T_CASB:
+            case T_XADD:
+            case T_XADDB:
+            case T_XCHG:
+            case T_XCHGB:
+            {
+                if ( 3 != token_count )
+                    show_error( "cas, xadd, and xchg require two register arguments. e.g. xadd [rarg1], rtmp\n" );
+
+                t1 = find_token( tokens[ 1 ] );
+                t2 = find_token( tokens[ 2 ] );
+                if ( !is_reg( t1 ) || !is_reg( t2 ) )
+                    show_error( "cas, xadd, and xchg require two register arguments. e.g. xadd [rarg1], rtmp\n" );
+
+                code[ code_so_far++ ] = compose_op( 5, reg_from_token( t1 ), 1 );
+                code[ code_so_far++ ] = compose_op( ( T_CAS == t || T_CASB == t ) ? 4 : ( T_XADD == t || T_XADDB == t ) ? 5 : 6,
+                                                    reg_from_token( t2 ),
+                                                    ( T_CASB == t || T_XADDB == t || T_XCHGB == t ) ? 0 : g_byte_len );
+                break;
+            }
+            case T_FENCE:
+            {
+                if ( 1 != token_count )
+                    show_error( "fence takes no arguments\n" );
+
+                code[ code_so_far++ ] = compose_op( 5, 0, 1 );
+                code[ code_so_far++ ] = compose_op( 7, 0, 0 );
+                break;
+            }
             case T_PUSHF:
             {
                 if ( 2 != token_count )
@@ -2117,10 +2221,12 @@ int cdecl main( int argc, char * argv[] )
 
     /* second pass: append data and patch addresses */
 
-    /* align code and initialized data to native width */
+    /* align code and initialized data to native width. a page-aligned image pads the code to a page */
 
-    code_so_far = round_up( code_so_far, g_image_width );
+    code_so_far = round_up( code_so_far, page_align ? (width_t) OI_V2_ALIGN : (width_t) g_image_width );
     initialized_data_so_far = round_up( initialized_data_so_far, g_image_width );
+    if ( page_align && ( code_so_far + initialized_data_so_far > sizeof( code ) ) )
+        show_error( "the code and data are too large for a page-aligned image" );
 
     data_mode = 0;
     code_mode = 0;
@@ -2662,6 +2768,13 @@ int cdecl main( int argc, char * argv[] )
             case T_SWAP:
             case T_PUSHTWO:
             case T_POPTWO:
+            case T_CAS:
+            case T_CASB:
+            case T_XADD:
+            case T_XADDB:
+            case T_XCHG:
+            case T_XCHGB:
+            case T_FENCE:
             {
                 code_so_far += 2;
                 break;
@@ -2814,12 +2927,14 @@ int cdecl main( int argc, char * argv[] )
     memset( &h, 0, sizeof( h ) );
     h.sig0 = 'O';
     h.sig1 = 'I';
-    h.version = 1;
+    h.version = page_align ? 2 : 1;
     h.flags = 0;
     if ( 4 == g_image_width )
         h.flags |= 1;
     else if ( 8 == g_image_width )
         h.flags |= 2;
+    if ( compress )
+        h.flags |= OI_FLAG_COMPRESSED;
     h.unused = 0;
     h.cbCode = (uint32_t) total_code;
     h.cbInitializedData = (uint32_t) total_initialized_data;
@@ -2829,7 +2944,14 @@ int cdecl main( int argc, char * argv[] )
     h.loInitialPC = g_image_width; /* first image width is the address of the syscall function or 0/halt */
     fwrite( &h, sizeof( h ), 1, fp );
 
-    fwrite( code, (int) ( total_code + total_initialized_data ), 1, fp );
+    /* version 2 code starts at oi_code_offset() */
+    for ( l = sizeof( h ); l < oi_code_offset( h ); l++ )
+        fputc( 0, fp );
+
+    if ( compress )
+        l = write_compressed( fp, code, (size_t) ( total_code + total_initialized_data ) );
+    else
+        fwrite( code, (int) ( total_code + total_initialized_data ), 1, fp );
     fclose( fp );
 
     if ( show_image_info )
@@ -2844,6 +2966,8 @@ int cdecl main( int argc, char * argv[] )
         printf( "  zero-filled data size:    %u\n", h.cbZeroFilledData );
         printf( "  stack size:               %u\n", h.cbStack );
         printf( "  initial PC:               %u\n", h.loInitialPC );
+        if ( compress )
+            printf( "  compressed size:          %u\n", (uint32_t) l );
     }
 
     return 0;
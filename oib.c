@@ -0,0 +1,267 @@
+/*
+    OneImage bundle tool
+    Packs many .oi images into one bundle file and lists bundles. Services that run thousands of small images
+    then open one file instead of thousands, and oios runs an entry directly:
+
+        oib -c apps.oib sieveoi.oi eoi.oi tttoi.oi
+        oib -l apps.oib
+        oios apps.oib:tttoi 1000
+
+    See OIBundleHeader in oios.h for the format.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef MSC6
+#include <stdint.h>
+#endif
+
+#include <string.h>
+
+#include "oi.h"
+#include "oios.h"
+
+#define true 1
+#define false 0
+
+struct BundleItem
+{
+    struct OIBundleEntry entry;
+    char * path;
+};
+
+static void usage()
+{
+    printf( "usage: oib [flags] <bundle.oib> [image.oi ...]\n" );
+    printf( "  OneImage bundle tool. run an image in a bundle with oios bundle.oib:name\n" );
+    printf( "  flags:\n" );
+    printf( "      -c          create the bundle from the images\n" );
+    printf( "      -l          list the images in the bundle\n" );
+    exit( 1 );
+} /* usage */
+
+#ifdef OLDCPU
+static long round_up( x, multiple ) long x; long multiple;
+#else
+static long round_up( long x, long multiple )
+#endif
+{
+    return ( ( x + multiple - 1 ) / multiple ) * multiple;
+} /* round_up */
+
+#ifdef OLDCPU
+static int compare_items( a, b ) char * a; char * b;
+#else
+static int compare_items( const void * a, const void * b )
+#endif
+{
+    return strcmp( ( (struct BundleItem *) a )->entry.name, ( (struct BundleItem *) b )->entry.name );
+} /* compare_items */
+
+/* the entry name is the file name without its directory or extension */
+
+#ifdef OLDCPU
+static bool set_name( item, path ) struct BundleItem * item; char * path;
+#else
+static bool set_name( struct BundleItem * item, char * path )
+#endif
+{
+    char * p, * dot;
+    size_t len;
+
+    for ( p = path + strlen( path ); p > path; p-- )
+        if ( '/' == p[ -1 ] || '\\' == p[ -1 ] || ':' == p[ -1 ] )
+            break;
+
+    dot = strrchr( p, '.' );
+    len = ( 0 != dot ) ? (size_t) ( dot - p ) : strlen( p );
+    if ( ( 0 == len ) || ( len >= sizeof( item->entry.name ) ) )
+        return false;
+
+    memcpy( item->entry.name, p, len );
+    item->entry.name[ len ] = 0;
+    return true;
+} /* set_name */
+
+#ifdef OLDCPU
+static int create_bundle( bundle, count, paths ) char * bundle; int count; char * paths[];
+#else
+static int create_bundle( char * bundle, int count, char * paths[] )
+#endif
+{
+    struct OIBundleHeader bh;
+    struct OIHeader h;
+    struct BundleItem * items;
+    FILE * fp, * out;
+    long offset, pos;
+    int i, c;
+
+    items = (struct BundleItem *) calloc( (size_t) count, sizeof( struct BundleItem ) );
+    if ( 0 == items )
+    {
+        printf( "out of memory\n" );
+        return 1;
+    }
+
+    for ( i = 0; i < count; i++ )
+    {
+        items[ i ].path = paths[ i ];
+        if ( !set_name( & items[ i ], paths[ i ] ) )
+        {
+            printf( "image name '%s' is empty or longer than %d characters\n", paths[ i ], (int) sizeof( items[ i ].entry.name ) - 1 );
+            return 1;
+        }
+
+        fp = fopen( paths[ i ], "rb" );
+        if ( !fp )
+        {
+            printf( "can't open image file '%s'\n", paths[ i ] );
+            return 1;
+        }
+
+        if ( ( 1 != fread( & h, sizeof( h ), 1, fp ) ) || ( 'O' != h.sig0 ) || ( 'I' != h.sig1 ) )
+        {
+            printf( "'%s' isn't an OI image\n", paths[ i ] );
+            return 1;
+        }
+
+        fseek( fp, 0, SEEK_END );
+        items[ i ].entry.length = (uint32_t) ftell( fp );
+        fclose( fp );
+    }
+
+    qsort( items, (size_t) count, sizeof( struct BundleItem ), compare_items );
+
+    offset = round_up( (long) ( sizeof( bh ) + count * sizeof( struct OIBundleEntry ) ), OI_V2_ALIGN );
+    for ( i = 0; i < count; i++ )
+    {
+        if ( ( i > 0 ) && !strcmp( items[ i - 1 ].entry.name, items[ i ].entry.name ) )
+        {
+            printf( "two images are named '%s'\n", items[ i ].entry.name );
+            return 1;
+        }
+
+        items[ i ].entry.loOffset = (uint32_t) offset;
+        items[ i ].entry.hiOffset = (uint32_t) ( ( offset >> 16 ) >> 16 );
+        offset = round_up( offset + (long) items[ i ].entry.length, OI_V2_ALIGN );
+    }
+
+#ifdef MSC6 /* w+b doesn't truncate existing files with this compiler */
+    remove( bundle );
+#endif
+
+    out = fopen( bundle, "w+b" );
+    if ( !out )
+    {
+        printf( "can't create bundle file '%s'\n", bundle );
+        return 1;
+    }
+
+    memset( & bh, 0, sizeof( bh ) );
+    bh.sig0 = 'O';
+    bh.sig1 = 'I';
+    bh.sig2 = 'B';
+    bh.version = 1;
+    bh.count = (uint32_t) count;
+    fwrite( & bh, sizeof( bh ), 1, out );
+    for ( i = 0; i < count; i++ )
+        fwrite( & items[ i ].entry, sizeof( struct OIBundleEntry ), 1, out );
+
+    pos = (long) ( sizeof( bh ) + count * sizeof( struct OIBundleEntry ) );
+    for ( i = 0; i < count; i++ )
+    {
+        for ( ; pos < (long) items[ i ].entry.loOffset + ( ( (long) items[ i ].entry.hiOffset << 16 ) << 16 ); pos++ )
+            fputc( 0, out );
+
+        fp = fopen( items[ i ].path, "rb" );
+        if ( !fp )
+        {
+            printf( "can't open image file '%s'\n", items[ i ].path );
+            return 1;
+        }
+
+        while ( EOF != ( c = getc( fp ) ) )
+        {
+            fputc( c, out );
+            pos++;
+        }
+        fclose( fp );
+    }
+
+    if ( 0 != fclose( out ) )
+    {
+        printf( "can't write bundle file '%s'\n", bundle );
+        return 1;
+    }
+
+    free( items );
+    return 0;
+} /* create_bundle */
+
+#ifdef OLDCPU
+static int list_bundle( bundle ) char * bundle;
+#else
+static int list_bundle( char * bundle )
+#endif
+{
+    struct OIBundleHeader bh;
+    struct OIBundleEntry e;
+    struct OIHeader h;
+    FILE * fp;
+    long offset;
+    uint32_t i;
+
+    fp = fopen( bundle, "rb" );
+    if ( !fp )
+    {
+        printf( "can't open bundle file '%s'\n", bundle );
+        return 1;
+    }
+
+    if ( ( 1 != fread( & bh, sizeof( bh ), 1, fp ) ) || ( 'O' != bh.sig0 ) || ( 'I' != bh.sig1 ) || ( 'B' != bh.sig2 ) )
+    {
+        printf( "'%s' isn't an OI bundle\n", bundle );
+        return 1;
+    }
+
+    printf( "%-52s %10s %10s  width  version  compressed\n", "name", "offset", "length" );
+    for ( i = 0; i < bh.count; i++ )
+    {
+        fseek( fp, (long) ( sizeof( bh ) + i * sizeof( e ) ), SEEK_SET );
+        if ( 1 != fread( & e, sizeof( e ), 1, fp ) )
+        {
+            printf( "the bundle's index is truncated\n" );
+            return 1;
+        }
+
+        e.name[ sizeof( e.name ) - 1 ] = 0;
+        offset = (long) e.loOffset + ( ( (long) e.hiOffset << 16 ) << 16 );
+        fseek( fp, offset, SEEK_SET );
+        if ( 1 != fread( & h, sizeof( h ), 1, fp ) )
+            memset( & h, 0, sizeof( h ) );
+
+        printf( "%-52s %10lu %10lu  %5u  %7u  %s\n", e.name, (unsigned long) offset, (unsigned long) e.length,
+                (unsigned) ( 2 << ( h.flags & OI_FLAG_WIDTH ) ), (unsigned) h.version,
+                ( h.flags & OI_FLAG_COMPRESSED ) ? "yes" : "no" );
+    }
+
+    fclose( fp );
+    return 0;
+} /* list_bundle */
+
+#ifdef OLDCPU
+int main( argc, argv ) int argc; char * argv[];
+#else
+int cdecl main( int argc, char * argv[] )
+#endif
+{
+    if ( ( argc >= 4 ) && !strcmp( argv[ 1 ], "-c" ) )
+        return create_bundle( argv[ 2 ], argc - 3, argv + 3 );
+
+    if ( ( 3 == argc ) && !strcmp( argv[ 1 ], "-l" ) )
+        return list_bundle( argv[ 2 ] );
+
+    usage();
+    return 1;
+} /* main */
@@ -15,7 +15,24 @@
 #include "oi.h"
 #include "trace.h"
 
-#if defined( FORCETRACING ) || !defined( NDEBUG )
+/*  OI_DISASSEMBLER stands for FORCETRACING, a debug build, or OI_MMAP, since older compilers have no defined().
+    release builds with OI_MMAP keep the disassembler to report where guard page faults happened */
+
+#ifdef FORCETRACING
+#define OI_DISASSEMBLER
+#endif /* FORCETRACING */
+#ifndef NDEBUG
+#ifndef OI_DISASSEMBLER
+#define OI_DISASSEMBLER
+#endif /* OI_DISASSEMBLER */
+#endif /* NDEBUG */
+#ifdef OI_MMAP
+#ifndef OI_DISASSEMBLER
+#define OI_DISASSEMBLER
+#endif /* OI_DISASSEMBLER */
+#endif /* OI_MMAP */
+
+#ifdef OI_DISASSEMBLER
 
 static const char * reg_strings[] = { "rzero", "rpc", "regsp", "rframe", "rarg1", "rarg2", "rres", "rtmp" };
 
@@ -78,6 +95,8 @@ static const char * SyscallString( uint8_t r )
     return "unknown!";
 } /* SyscallString */
 
+#ifndef NDEBUG /* getbyte() and relative_jump() are unused. release builds with OI_MMAP leave them out */
+
 #ifdef OLDCPU
 static uint8_t getbyte( pop ) uint8_t * pop;
 #else
@@ -87,6 +106,8 @@ static uint8_t getbyte( uint8_t * pop )
     return * pop;
 } /* getbyte */
 
+#endif /* NDEBUG */
+
 #ifdef OLDCPU
 static uint16_t getword( pop ) uint8_t * pop;
 #else
@@ -197,6 +218,8 @@ static const char * ReturnString( uint8_t val )
     return "UNKNOWN";
 } /* ReturnString */
 
+#ifndef NDEBUG /* unused, like getbyte() */
+
 #ifdef OLDCPU
 static const char * relative_jump( pop, rpc, val, width ) uint8_t * pop; oi_t rpc, uint8_t width;
 #else
@@ -217,6 +240,8 @@ static const char * relative_jump( uint8_t * pop, oi_t rpc, uint8_t width )
     return relative_value( pop, rpc, width );
 } /* relative_jump */
 
+#endif /* NDEBUG */
+
 #ifdef OLDCPU
 const char * DisassembleOI( pop, rpc, image_width ) uint8_t * pop; oi_t rpc, uint8_t image_width;
 #else
@@ -356,6 +381,11 @@ const char * DisassembleOI( uint8_t * pop, oi_t rpc, uint8_t image_width )
                         sprintf( buf, "pushtwo %s, %s", RegOpString( op ), RegOpString( op1 ) );
                     else if ( 3 == op1funct )
                         sprintf( buf, "poptwo %s, %s", RegOpString( op ), RegOpString( op1 ) );
+                    else if ( 7 == op1funct )
+                        sprintf( buf, "fence" );
+                    else
+                        sprintf( buf, "%s%s [%s], %s", ( 4 == op1funct ) ? "cas" : ( 5 == op1funct ) ? "xadd" : "xchg",
+                                 WidthSuffix( width ), RegOpString( op ), RegOpString( op1 ) );
                 }
                 else if ( 0xc0 == opOperation ) /* mov r0dst r1src */
                     sprintf( buf, "mov %s, %s", RegOpString( op ), RegOpString( op1 ) );
@@ -517,5 +547,5 @@ const char * DisassembleOI( uint8_t * pop, oi_t rpc, uint8_t image_width )
     return buf;
 } /* DisassembleOI */
 
-#endif
+#endif /* OI_DISASSEMBLER */
 
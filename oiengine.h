@@ -0,0 +1,2287 @@
+/*
+    OneImage instruction engine: relation checks, helpers for the less common instructions, the decode cache's
+    decoder and handlers, and ExecuteOI(). This is only included by oi.c.
+
+    Most builds include it once and the engine checks the image width at runtime. OI_MULTIWIDTH builds of oi.c
+    include it once per image width with OI_IW set to 2, 4, or 8. Each copy has the image width as a constant, so
+    the width checks, address masks, and image word reads and writes compile down to the one case that applies.
+    oi.c renames the functions in each copy (CheckRelation_w2, ExecuteOI_w4, ...) and ResetOI() picks the copy.
+    OI_SIM builds add one more copy, ExecuteOI_sim, with OI_SIM_ENGINE set: the plain interpreter without the
+    decode cache, built with oi.c's cache simulator hooks in the memory access macros.
+*/
+
+#ifdef OI_IW
+
+#undef IMAGE_WIDTH
+#undef IMAGE_SHIFT
+#undef THREE_BYTE_LEN
+#undef access_ram
+#undef ram_address
+#undef code_address
+#undef read_imgword
+#undef write_imgword
+#undef if_1_is_width
+#undef if_2_is_width
+
+#define IMAGE_WIDTH OI_IW
+#define IMAGE_SHIFT ( ( 2 == OI_IW ) ? 1 : ( 4 == OI_IW ) ? 2 : 3 )
+#define THREE_BYTE_LEN ( 1 + OI_IW )
+#define access_ram( address ) ( ram[ ( address ) & OI_IW_MASK ] )
+#define ram_address( address ) ( & ram[ ( address ) & OI_IW_MASK ] )
+#define code_address( address ) ( ( address ) & OI_IW_MASK )
+
+#define read_imgword( address ) ( ( 2 == OI_IW ) ? (oi_t) (ioi_t) (int16_t) get_word( address ) : \
+                                  ( 4 == OI_IW ) ? (oi_t) (ioi_t) (int32_t) get_dword( address ) : \
+                                  (oi_t) get_qword( address ) )
+#define write_imgword( address, value ) ( ( 2 == OI_IW ) ? (void) set_word( address, (uint16_t) ( value ) ) : \
+                                          ( 4 == OI_IW ) ? (void) set_dword( address, (uint32_t) ( value ) ) : \
+                                          (void) set_qword( address, (uint64_t) ( value ) ) )
+
+/* an image can't have values wider than its image width, so these end the width chains like OI2 and OI4 builds do */
+#define if_1_is_width if ( ( 2 == OI_IW ) || ( 1 == width ) )
+#define if_2_is_width if ( ( 4 == OI_IW ) || ( 2 == width ) )
+
+#endif /* OI_IW */
+
+#ifdef OLDCPU
+static bool CheckRelation( l, r, relation ) ioi_t l; ioi_t r; uint8_t relation;
+#else
+static bool CheckRelation( ioi_t l, ioi_t r, uint8_t relation )
+#endif
+{
+    __assume( relation <= 7 );
+
+#ifdef OI2
+    switch ( relation )
+    {
+        case 0: { return ( l > r ); }
+        case 1: { return ( l < r ); }
+        case 2: { return ( l == r ); }
+        case 3: { return ( l != r ); }
+        case 4: { return ( l >= r ); }
+        case 5: { return ( l <= r ); }
+        case 6: { return ( (bool) !( l & (ioi_t) 1 ) ); }
+        case 7: { return ( (bool) ( l & (ioi_t) 1 ) ); }
+        default: { __assume( false ); }
+    }
+#else /* OI2 */
+    if ( 2 == IMAGE_WIDTH )
+    {
+        switch ( relation )
+        {
+            case 0: { return ( (int16_t) l > (int16_t) r ); }
+            case 1: { return ( (int16_t) l < (int16_t) r ); }
+            case 2: { return ( (int16_t) l == (int16_t) r ); }
+            case 3: { return ( (int16_t) l != (int16_t) r ); }
+            case 4: { return ( (int16_t) l >= (int16_t) r ); }
+            case 5: { return ( (int16_t) l <= (int16_t) r ); }
+            case 6: { return ( (bool) !( l & (ioi_t) 1 ) ); }
+            case 7: { return ( (bool) ( l & (ioi_t) 1 ) ); }
+            default: { __assume( false ); }
+        }
+    }
+    else if ( 4 == IMAGE_WIDTH )
+    {
+        switch ( relation )
+        {
+            case 0: { return ( (int32_t) l > (int32_t) r ); }
+            case 1: { return ( (int32_t) l < (int32_t) r ); }
+            case 2: { return ( (int32_t) l == (int32_t) r ); }
+            case 3: { return ( (int32_t) l != (int32_t) r ); }
+            case 4: { return ( (int32_t) l >= (int32_t) r ); }
+            case 5: { return ( (int32_t) l <= (int32_t) r ); }
+            case 6: { return ( (bool) !( l & (ioi_t) 1 ) ); }
+            case 7: { return ( (bool) ( l & (ioi_t) 1 ) ); }
+            default: { __assume( false ); }
+        }
+    }
+#ifdef OI8
+    else if ( 8 == IMAGE_WIDTH )
+    {
+        switch ( relation )
+        {
+            case 0: { return ( l > r ); }
+            case 1: { return ( l < r ); }
+            case 2: { return ( l == r ); }
+            case 3: { return ( l != r ); }
+            case 4: { return ( l >= r ); }
+            case 5: { return ( l <= r ); }
+            case 6: { return ( (bool) !( l & (ioi_t) 1 ) ); }
+            case 7: { return ( (bool) ( l & (ioi_t) 1 ) ); }
+            default: { __assume( false ); }
+        }
+    }
+#endif /* OI8 */
+    else
+        return false;
+#endif /* OI2 */
+
+    assert( false );
+
+#ifdef WATCOM
+    return false;
+#endif /* WATCOM */
+} /* CheckRelation */
+
+/* memf: rarg1 = array address, rarg2 = # of items (based on width) to fill. rtmp = value to copy. rres = first element to fill */
+
+static void memfb_do()
+{
+    uint8_t * pb;
+    pb = ram_range( g_oi.rarg1 + g_oi.rres );
+    sim_range( pb, g_oi.rarg2, true );
+    memset( pb, (uint8_t) g_oi.rtmp, (size_t) g_oi.rarg2 );
+} /* memfb_do */
+
+static void memfw_do()
+{
+    uint16_t * pw, * pbeyond, val;
+    pw = (uint16_t *) ram_range( g_oi.rarg1 );
+    pw += g_oi.rres;
+    pbeyond = pw + g_oi.rarg2;
+    sim_range( pw, g_oi.rarg2 * sizeof( uint16_t ), true );
+    val = (uint16_t) g_oi.rtmp;
+    while ( pw != pbeyond )
+        *pw++ = val;
+} /* memfw_do */
+
+#ifndef OI2
+
+static void memfdw_do()
+{
+    uint32_t * p, * pbeyond, val;
+    p = (uint32_t *) ram_range( g_oi.rarg1 );
+    p += g_oi.rres;
+    pbeyond = p + g_oi.rarg2;
+    sim_range( p, g_oi.rarg2 * sizeof( uint32_t ), true );
+    val = (uint32_t) g_oi.rtmp;
+    while ( p != pbeyond )
+        *p++ = val;
+} /* memfdw_do */
+
+#ifdef OI8
+
+static void memfqw_do()
+{
+    uint64_t * p, * pbeyond, val;
+    p = (uint64_t *) ram_range( g_oi.rarg1 );
+    p += g_oi.rres;
+    pbeyond = p + g_oi.rarg2;
+    sim_range( p, g_oi.rarg2 * sizeof( uint64_t ), true );
+    val = g_oi.rtmp;
+    while ( p != pbeyond )
+        *p++ = val;
+} /* memfqw_do */
+
+#endif /* OI8 */
+#endif /* OI2 */
+
+static void staddb_do()
+{
+    uint8_t * pb, * pend;
+    oi_t tadd;
+    pb = ram_range( g_oi.rtmp + g_oi.rarg1 );
+    pend = pb + ( g_oi.rres - g_oi.rtmp );
+    tadd = g_oi.rarg2;
+
+    do
+    {
+        sim_range( pb, 1, true );
+        *pb = 0;
+        pb += tadd;
+    } while ( pb <= pend );
+} /* staddb_do */
+
+static void staddw_do()
+{
+    uint16_t * pw;
+    oi_t cur;
+    cur = g_oi.rtmp;
+    pw = (uint16_t *) ram_range( ( sizeof( uint16_t ) * cur ) + g_oi.rarg1 );
+    do
+    {
+        sim_range( pw, sizeof( uint16_t ), true );
+        *pw = 0;
+        pw += g_oi.rarg2;
+        cur += g_oi.rarg2;
+    } while ( cur <= g_oi.rres );
+} /* staddw_do */
+
+#ifndef OI2
+
+static void stadddw_do()
+{
+    uint32_t * pw;
+    oi_t cur;
+    cur = g_oi.rtmp;
+    pw = (uint32_t *) ram_range( ( sizeof( uint32_t ) * cur ) + g_oi.rarg1 );
+    do
+    {
+        sim_range( pw, sizeof( uint32_t ), true );
+        *pw = 0;
+        pw += g_oi.rarg2;
+        cur += g_oi.rarg2;
+    } while ( cur <= g_oi.rres );
+} /* stadddw_do */
+
+#ifdef OI8
+
+static void staddqw_do()
+{
+    uint64_t * pw;
+    oi_t cur;
+    cur = g_oi.rtmp;
+    pw = (uint64_t *) ram_range( ( sizeof( uint64_t ) * cur ) + g_oi.rarg1 );
+    do
+    {
+        sim_range( pw, sizeof( uint64_t ), true );
+        *pw = 0;
+        pw += g_oi.rarg2;
+        cur += g_oi.rarg2;
+    } while ( cur <= g_oi.rres );
+} /* staddqw_do */
+
+#endif /* OI8 */
+#endif /* OI2 */
+
+#ifdef OLDCPU
+static void moddiv_do( op, op1 ) size_t op; size_t op1;
+#else
+__forceinline static void moddiv_do( size_t op, size_t op1 )
+#endif
+{
+    oi_t x, y;
+    y = get_reg_from_op( op1 );
+    if ( (oi_t) 0 == y )
+    {
+        push( 0 ); /* when they exist, an exception should be raised */
+        return;
+    }
+
+    x = get_reg_from_op( op );
+    set_reg_from_op( op, x % y );
+    push( x / y );
+} /* moddiv_do */
+
+#ifdef OLDCPU
+static oi_t frame_offset( offset ) ioi_t offset;
+#else
+__forceinline static oi_t frame_offset( ioi_t offset )
+#endif
+{
+    return g_oi.rframe + ( sizeof( oi_t ) * ( offset + ( ( offset >= 0 ) ? 3 : 1 ) ) );
+} /* frame_offset */
+
+#ifdef OLDCPU
+void cstf_do( op ) opcode_t op;
+#else
+__forceinline void cstf_do( opcode_t op )
+#endif
+{
+    oi_t val;
+    uint8_t op1;
+
+    val = get_reg_from_op( op );
+    op1 = get_op1();
+    if ( CheckRelation( val, get_reg_from_op( op1 ), funct_from_op( op1 ) ) )
+        set_oiword( frame_offset( (ioi_t) reg_from_op( get_byte( g_oi.rpc + 2 ) ) ), val );
+} /* cstf_do */
+
+#ifdef OLDCPU
+static void jump_return( ival ) ioi_t ival;
+#else
+__forceinline static void jump_return( ioi_t ival )
+#endif
+{
+    /* jump relative <= 3 means return: 0=ret, 1=retnf, 2=ret0, 3=ret0nf */
+    assert( ival >= 0 && ival <= 3 );
+    pop( g_oi.rpc );
+    if ( (ioi_t) 0 == ( ival & 1 ) )
+        pop( g_oi.rframe );
+    if ( ival >= (ioi_t) 2 )
+        g_oi.rres = 0;
+} /* jump_return */
+
+#ifdef OLDCPU
+static bool jrel_do( op, op1 ) opcode_t op, op1;
+#else
+__forceinline static bool jrel_do( opcode_t op, opcode_t op1 )
+#endif
+{
+    ioi_t ival;
+    if ( CheckRelation( get_reg_from_op( op ), read_imgword( get_reg_from_op( op1 ) + get_byte( g_oi.rpc + 2 ) ), funct_from_op( op1 ) ) )
+    {
+        ival = (ioi_t) (int8_t) get_byte( g_oi.rpc + 3 );
+        if ( (oi_t) ival <= (oi_t) 3 )
+            jump_return( ival );
+        else
+            g_oi.rpc += ival;
+        return true;
+    }
+    return false;
+} /* jrel_do */
+
+#ifdef OLDCPU
+static void stinc_do( op ) opcode_t op;
+#else
+__forceinline static void stinc_do( opcode_t op )
+#endif
+{
+    uint8_t width;
+    int16_t val;
+    oi_t inc_amount;
+
+    val = (int16_t) get_word( g_oi.rpc + 2 );
+    width = (uint8_t) width_from_op( get_op1() );
+    if ( 0 == width )
+        set_byte( get_reg_from_op( op ), (uint8_t) ( val & 0xff ) );
+    else if_1_is_width
+        set_word( get_reg_from_op( op ), (uint16_t) val );
+#ifndef OI2
+    else if_2_is_width
+        set_dword( get_reg_from_op( op ), (uint32_t) (int32_t) val );
+#ifdef OI8
+    else /* 3 == width */
+        set_qword( get_reg_from_op( op ), (uint64_t) (int64_t) val );
+#endif /* OI8 */
+#endif /* OI2 */
+
+    inc_amount = (oi_t) ( 1 << width );
+    add_reg_from_op( op, inc_amount );
+} /* stinc_do */
+
+#ifdef OLDCPU
+static void atomic_do( op, op1 ) opcode_t op; opcode_t op1;
+#else
+static void atomic_do( opcode_t op, opcode_t op1 )
+#endif
+{
+    oi_t address;
+    oi_t * preg1;
+    opcode_t width;
+    uint8_t funct1;
+    funct1 = funct_from_op( op1 );
+
+    if ( 7 == funct1 )
+    {
+        atomic_fence();
+        return;
+    }
+
+    address = get_reg_from_op( op );
+    preg1 = get_preg_from_op( op1 );
+    width = width_from_op( op1 );
+
+    if ( 0 == width )
+        atomic_op( uint8_t, funct1, address, preg1 )
+    else if_1_is_width
+        atomic_op( uint16_t, funct1, address, preg1 )
+#ifndef OI2
+    else if_2_is_width
+        atomic_op( uint32_t, funct1, address, preg1 )
+#ifdef OI8
+    else /* 3 == width */
+        atomic_op( uint64_t, funct1, address, preg1 )
+#endif /* OI8 */
+#endif /* OI2 */
+} /* atomic_do */
+
+#ifdef OLDCPU
+static void op_a0_b0_do( op ) opcode_t op;
+#else
+__forceinline static void op_a0_b0_do( opcode_t op )
+#endif
+{
+    opcode_t op1, width;
+    oi_t val;
+    uint8_t funct1;
+    op1 = get_op1();
+    width = width_from_op( op1 );
+    funct1 = funct_from_op( op1 );
+
+    switch ( funct1 )
+    {
+        case 0: /* st */
+        {
+            if ( 0 == width )
+                set_byte( get_reg_from_op( op ), (uint8_t) ( 0xff & get_reg_from_op( op1 ) ) );
+            else if_1_is_width
+                set_word( get_reg_from_op( op ), (uint16_t) get_reg_from_op( op1 ) );
+#ifndef OI2
+            else if_2_is_width
+                set_dword( get_reg_from_op( op ), (uint32_t) get_reg_from_op( op1 ) );
+#ifdef OI8
+            else /* 3 == width */
+                set_qword( get_reg_from_op( op ), get_reg_from_op( op1 ) );
+#endif /* OI8 */
+#endif /* OI2 */
+            break;
+        }
+        case 1: /* ld */
+        {
+            if ( 0 == width )
+                set_reg_from_op( op, get_byte( get_reg_from_op( op1 ) ) );
+            else if_1_is_width
+                set_reg_from_op( op, get_word( get_reg_from_op( op1 ) ) );
+#ifndef OI2
+            else if_2_is_width
+                set_reg_from_op( op, get_dword( get_reg_from_op( op1 ) ) );
+#ifdef OI8
+            else /* 3 == width */
+                set_reg_from_op( op, get_qword( get_reg_from_op( op1 ) ) );
+#endif /* OI8 */
+#endif /* OI2 */
+            break;
+        }
+        case 2: /* pushtwo */
+        {
+            push( get_reg_from_op( op ) );
+            push( get_reg_from_op( op1 ) );
+            break;
+        }
+        case 3: /* poptwo */
+        {
+            pop( val );
+            set_reg_from_op( op, val );
+            pop( val );
+            set_reg_from_op( op1, val );
+            break;
+        }
+        default: /* cas, xadd, xchg, fence */
+        {
+            atomic_do( op, op1 );
+            break;
+        }
+    }
+} /* ld_st_reg_reg_do */
+
+#ifdef OLDCPU
+static bool op_80_90_do( op ) opcode_t op;
+#else
+__forceinline static bool op_80_90_do( opcode_t op )
+#endif
+{
+    opcode_t op1, width;
+    oi_t val;
+
+    op1 = get_op1();
+    switch( funct_from_op( op1 ) ) 
+    {
+        case 0: /* syscall */
+        {
+            val = g_oi.rpc;
+            OISyscall( ( ( op << 1 ) & 0x38 ) | ( ( op1 >> 2 ) & 7 ) );
+            if ( g_oi.rpc != val )
+                return true;
+            break;
+        }
+        case 1: /* pushf offset */
+        {
+            push( get_oiword( frame_offset( (int16_t) reg_from_op( op1 ) ) ) );
+            break;
+        }
+        case 2: /* stst [reg0] */
+        {
+            pop( val );
+            write_imgword( val, get_reg_from_op( op ) );
+            break;
+        }
+        case 3: /* addimgw reg0 if width=0, subimgw if width=1 */
+        {
+            width = width_from_op( op1 );
+            if ( 0 == width )
+                set_reg_from_op( op, get_reg_from_op( op ) + (oi_t) IMAGE_WIDTH );
+            else if ( 1 == width )
+                set_reg_from_op( op, get_reg_from_op( op ) - (oi_t) IMAGE_WIDTH );
+            break;
+        }
+        case 4: /* stinc [reg0], reg1  -- then increment reg0 by width of store */
+        {
+            op1 = get_op1();
+            val = get_reg_from_op( op1 );
+            width = (uint8_t) width_from_op( get_op1() );
+            if ( 0 == width )
+                set_byte( get_reg_from_op( op ), (uint8_t) val );
+            else if_1_is_width
+                set_word( get_reg_from_op( op ), (uint16_t) val );
+#ifndef OI2
+            else if_2_is_width
+                set_dword( get_reg_from_op( op ), (uint32_t) val );
+#ifdef OI8
+            else /* 3 == width */
+                set_qword( get_reg_from_op( op ), val );
+#endif /* OI8 */
+#endif /* OI2 */
+
+            if ( width > 0 )
+                val = (oi_t) ( 1 << width );
+            else
+                val = (oi_t) 1;
+            add_reg_from_op( op, val );
+            break;
+        }
+        case 5: /* swap reg0, reg1 */
+        {
+            val = get_reg_from_op( op );
+            set_reg_from_op( op, get_reg_from_op( op1 ) );
+            set_reg_from_op( op1, val );
+            break;
+        }
+        case 6: /* addnatw reg0 if width=0, subnatw if width=1 */
+        {
+            width = width_from_op( op1 );
+            if ( 0 == width )
+                set_reg_from_op( op, get_reg_from_op( op ) + (oi_t) sizeof( oi_t ) );
+            else if ( 1 == width )
+                set_reg_from_op( op, get_reg_from_op( op ) - (oi_t) sizeof( oi_t ) );
+            break;
+        }
+    }
+
+    return false;
+} /* op_80_90_do */
+
+#ifdef OLDCPU
+static void ldinc_do( op ) opcode_t op;
+#else
+__forceinline static void ldinc_do( opcode_t op )
+#endif
+{
+    uint8_t op1, width;
+    oi_t val;
+
+    op1 = get_op1();
+    val = get_reg_from_op( op1 ) + g_oi.rpc + (ioi_t) (int16_t) get_word( g_oi.rpc + 2 );
+    width = (uint8_t) width_from_op( op1 );
+    if ( 0 == width )
+        set_reg_from_op( op, get_byte( val ) );
+    else if_1_is_width
+        set_reg_from_op( op, get_word( val ) );
+#ifndef OI2
+    else if_2_is_width
+        set_reg_from_op( op, get_dword( val ) );
+#ifdef OI8
+    else /* 3 == width */
+        set_reg_from_op( op, get_qword( val ) );
+#endif /* OI8 */
+#endif /* OI2 */
+    val = (oi_t) ( 1 << width );
+    add_reg_from_op( op1, val );
+} /* ldinc_do */
+
+#ifdef OLDCPU
+static void cmov_do( op ) opcode_t op;
+#else
+__forceinline static void cmov_do( opcode_t op )
+#endif
+{
+    uint8_t op1;
+    op1 = get_op1();
+    if ( ( (uint8_t) 3 == funct_from_op( op1 ) ) || /* shortcut for NE */
+         ( CheckRelation( get_reg_from_op( op ), get_reg_from_op( op1 ), funct_from_op( op1 ) ) ) )
+        set_reg_from_op( op, get_reg_from_op( op1 ) );
+} /* cmov_do */
+
+#ifdef OLDCPU
+static void signex_do( op ) opcode_t op;
+#else
+__forceinline static void signex_do( opcode_t op )
+#endif
+{
+    opcode_t width;
+    width = width_from_op( get_op1() );
+    if ( 0 == width )
+#ifdef AZTECCPM
+        set_reg_from_op( op, sign_extend_oi( get_reg_from_op( op ), 7 ) ); /* the casts below don't work with Aztec C */
+#else
+        set_reg_from_op( op, (oi_t) (ioi_t) (int8_t) get_reg_from_op( op ) );
+#endif
+    else if_1_is_width
+        set_reg_from_op( op, (oi_t) (ioi_t) (int16_t) get_reg_from_op( op ) );
+#ifndef OI2
+    else if_2_is_width
+        set_reg_from_op( op, (oi_t) (ioi_t) (int32_t) get_reg_from_op( op ) );
+#endif /* OI2 */
+} /* signex_do */
+
+#ifdef OLDCPU
+static void op_c0_d0_do( op ) opcode_t op;
+#else
+__forceinline static void op_c0_d0_do( opcode_t op )
+#endif
+{
+    opcode_t op1, op2, width;
+    oi_t val;
+    ioi_t ival;
+    uint8_t * pb;
+    uint16_t * pw, val16;
+    oi_t index, limit;
+#ifndef OI2
+    uint32_t * pdw;
+#ifdef OI8
+    uint64_t * pqw;
+#endif /* OI8 */
+#endif /* OI2 */
+
+    op1 = get_op1();
+    switch( funct_from_op( op1 ) )
+    {
+        case 0:  /* ld / ldb rdst, [address] */
+        {
+            if ( 0 == reg_from_op( op ) ) /* can't write to rzero */
+                break;
+
+            val = g_oi.rpc + (int16_t) get_word( g_oi.rpc + 2 );
+            width = width_from_op( op1 );
+            if ( 0 == width )
+                set_reg_from_op( op, get_byte( val ) );
+            else if_1_is_width
+                set_reg_from_op( op, get_word( val ) );
+#ifndef OI2
+             else if_2_is_width
+                 set_reg_from_op( op, get_dword( val ) );
+#ifdef OI8
+             else /* 3 == width */
+                 set_reg_from_op( op, get_qword( val ) );
+#endif /* OI8 */
+#endif /* OI2 */
+                break;
+        }
+        case 1: /* sti / stib [address] constant -8..7 stored in r1 */
+        {
+            val = g_oi.rpc + (int16_t) get_word( g_oi.rpc + 2 );
+
+            /* r0 has high 3 bits and r1 has low 3 bits of CONSTANT */
+            ival = sign_extend_oi( ( ( op << 1 ) & 0x38 ) | reg_from_op( op1 ), 5 );
+            width = width_from_op( op1 );
+            if ( 0 == width )
+                set_byte( val, (uint8_t) ival );
+            else if_1_is_width
+                set_word( val, (uint16_t) ival );
+#ifndef OI2
+            else if_2_is_width
+                set_dword( val, (uint32_t) ival );
+#ifdef OI8
+            else /* 3 == width */
+                set_qword( val, (uint64_t) ival );
+#endif /* OI8 */
+#endif /* OI2 */
+            break;
+        }
+        case 2: /* math r0dst, r1left, r2right, funct2MATH */
+        {
+            if ( 0 == reg_from_op( op ) ) /* can't write to rzero */
+                break;
+
+            op2 = get_op2();
+            set_reg_from_op( op, Math( get_reg_from_op( op1 ), get_reg_from_op( op2 ), funct_from_op( op2 ) ) );
+            break;
+        }
+        case 3: /* cmp r0dst, r1left, r2right, funct2RELATION */
+        {
+            if ( 0 == reg_from_op( op ) ) /* can't write to rzero */
+                break;
+
+            op2 = get_op2();
+            set_reg_from_op( op, (oi_t) CheckRelation( get_reg_from_op( op1 ), get_reg_from_op( op2 ), funct_from_op( op2 ) ) );
+            break;
+        }
+        case 4: /* fzero r0index, r1array, MAX 0..65535 */
+        {
+            /* while index < MAX, look for a 0 at each index in the array */
+            limit = get_word( g_oi.rpc + 2 );
+            index = (oi_t) get_reg_from_op( op );
+            width = width_from_op( op1 );
+            if ( 0 == width )
+            {
+                pb = ram_range( get_reg_from_op( op1 ) );
+                while ( ( index < limit ) && ( 0 != pb[ index ] ) )
+                    index++;
+            }
+            else if_1_is_width
+            {
+                pw = (uint16_t *) ram_range( get_reg_from_op( op1 ) );
+                while ( ( index < limit ) && ( 0 != pw[ index ] ) )
+                    index++;
+            }
+#ifndef OI2
+            else if_2_is_width
+            {
+                pdw = (uint32_t *) ram_range( get_reg_from_op( op1 ) );
+                while ( ( index < limit ) && ( (uint32_t) 0 != pdw[ index ] ) )
+                    index++;
+            }
+#ifdef OI8
+            else /* 3 == width */
+            {
+                pqw = (uint64_t *) ram_range( get_reg_from_op( op1 ) );
+                while ( ( index < limit ) && ( 0 != pqw[ index ] ) )
+                    index++;
+            }
+#endif /* OI8 */
+#endif /* OI2 */
+
+            sim_range( ram_range( get_reg_from_op( op1 ) ) + ( get_reg_from_op( op ) << width ),
+                       ( index + ( index < limit ) - get_reg_from_op( op ) ) << width, false );
+            set_reg_from_op( op, index );
+            break;
+        }
+        case 5: /* stoi r0address[ r1index ], 2-byte sign-extended constant */
+        {
+            val16 = get_word( g_oi.rpc + 2 );
+            index = (oi_t) get_reg_from_op( op1 );
+            val = get_reg_from_op( op );
+            width = width_from_op( op1 );
+            if ( 0 == width )
+                set_byte( val + index, (uint8_t) val16 );
+            else if_1_is_width
+                set_word( val + 2 * index, val16 );
+#ifndef OI2
+            else if_2_is_width
+                set_dword( val + 4 * index, (int32_t) (int16_t) val16 );
+#ifdef OI8
+            else /* 3 == width */
+                set_qword( val + 8 * index, (int64_t) (int16_t) val16 );
+#endif /* OI8 */
+#endif /* OI2 */
+        }
+        case 6: /* stor r0address[ r1index ], r2value */
+        {
+            index = (oi_t) get_reg_from_op( op1 );
+            val = get_reg_from_op( op );
+            width = width_from_op( op1 );
+            if ( 0 == width )
+                set_byte( val + index, (uint8_t) get_reg_from_op( get_op2() ) );
+            else if_1_is_width
+                set_word( val + 2 * index, (uint16_t) get_reg_from_op( get_op2() ) );
+#ifndef OI2
+            else if_2_is_width
+                set_dword( val + 4 * index, (uint32_t) get_reg_from_op( get_op2() ) );
+#ifdef OI8
+            else /* 3 == width */
+                set_qword( val + 8 * index, get_reg_from_op( get_op2() ) );
+#endif /* OI8 */
+#endif /* OI2 */
+        }
+        case 7: /* ldor r0destination, r1address[ r2index ] */
+        {
+            index = (oi_t) get_reg_from_op( get_op2() );
+            val = get_reg_from_op( op1 );
+            width = width_from_op( op1 );
+            if ( 0 == width )
+                set_reg_from_op( op, (int8_t) get_byte( val + index ) );
+            else if_1_is_width
+                set_reg_from_op( op, (int16_t) get_word( val + 2 * index ) );
+#ifndef OI2
+            else if_2_is_width
+                set_reg_from_op( op, (int32_t) get_dword( val + 4 * index ) );
+#ifdef OI8
+            else /* 3 == width */
+                set_reg_from_op( op, get_qword( val + 8 * index ) );
+#endif /* OI8 */
+#endif /* OI2 */
+        }
+    }
+} /* op_c0_d0_do */
+
+#ifdef OI_PREDECODE
+#ifndef OI_SIM_ENGINE
+
+/* fill one record. returns the instruction length, or 0 if the instruction ends a basic block */
+
+static opcode_t DecodeOneOI( struct OIDecoded * pd, const void * const * handlers )
+{
+    opcode_t op, op1, op2, funct1, width, len;
+    oi_t pc;
+    ioi_t ival;
+    uint8_t h, regs;
+    bool ends_block;
+
+    pc = pd->pc;
+    op = get_byte( pc );
+    op1 = get_byte( pc + 1 );
+    op2 = get_byte( pc + 2 );
+    funct1 = funct_from_op( op1 );
+    width = width_from_op( op1 );
+
+    pd->op = (uint8_t) op;
+    pd->op1 = (uint8_t) op1;
+    pd->preg0 = get_preg_from_op( op );
+    pd->preg1 = get_preg_from_op( op1 );
+    pd->preg2 = get_preg_from_op( op2 );
+    pd->imm = 0;
+    pd->ptarget = 0;
+    pd->x = (uint8_t) width;
+    pd->y = 0;
+
+    len = 1 + byte_len_from_op( op );
+    if ( 3 == len )
+        len = THREE_BYTE_LEN;
+
+    ends_block = false;
+    h = H_ILLEGAL;
+
+    switch ( op & 3 )
+    {
+        case 0: /* 1-byte operations */
+        {
+            switch ( op )
+            {
+                case 0x00: { h = H_HALT; ends_block = true; break; }
+                case 0x08: { h = H_RET0; ends_block = true; break; }
+                case 0x20: { h = H_IMULST; break; }
+                case 0x28: { h = H_SHLIMG; break; }
+                case 0x48: { h = H_RET0NF; ends_block = true; break; }
+                case 0x60: { h = H_POPRZERO; break; }
+                case 0x68: { h = H_RETNF; ends_block = true; break; }
+                case 0x80: { h = H_SUBST; break; }
+                case 0x84: { h = H_IMGWID; break; }
+                case 0x88: { h = H_SHRIMG; break; }
+                case 0xa0: { h = H_ADDST; break; }
+                case 0xa8: { h = H_IDIVST; break; }
+                case 0xc0: { h = H_RET; ends_block = true; break; }
+                case 0xc8: { h = H_NATWID; break; }
+                case 0xe0: { h = H_ANDST; break; }
+                case 0xa4: case 0xc4: case 0xe4: case 0xe8: { break; }
+                default:
+                {
+                    switch ( funct_from_op( op ) )
+                    {
+                        case 0: { h = H_INC; break; }
+                        case 1: { h = H_DEC; break; }
+                        case 2: { h = H_PUSH; break; }
+                        case 3: { h = H_POP; break; }
+                        case 4: { h = H_ZERO; break; }
+                        case 5: { h = H_SHL; break; }
+                        case 6: { h = H_SHR; break; }
+                        default: { h = H_INV; break; }
+                    }
+                }
+            }
+            break;
+        }
+        case 1: /* 2-byte operations */
+        {
+            switch ( funct_from_op( op ) )
+            {
+                case 0: { h = (uint8_t) ( H_ADD + funct1 ); break; }
+                case 1:
+                {
+                    if ( 0x21 != op )
+                        h = ( 3 == funct1 ) ? H_MOV : H_CMOV;
+                    pd->x = (uint8_t) funct1;
+                    break;
+                }
+                case 2: { h = H_CMPST; pd->x = (uint8_t) funct1; break; }
+                case 3:
+                {
+                    switch ( funct1 )
+                    {
+                        case 0: { h = H_LDF; pd->imm = (oi_t) ( sizeof( oi_t ) * ( reg_from_op( op1 ) + 3 ) ); break; }
+                        case 1: { h = H_STF; pd->imm = (oi_t) ( sizeof( oi_t ) * ( reg_from_op( op1 ) + 3 ) ); break; }
+                        case 2: { h = H_RETX; pd->imm = (oi_t) ( sizeof( oi_t ) * ( 1 + reg_from_op( op1 ) ) ); ends_block = true; break; }
+                        case 3: { h = H_LDIB; pd->imm = sign_extend_oi( ( op1 & 0x1f ), 4 ); break; }
+                        case 4: { h = H_SIGNEX; break; }
+                        case 5: { h = H_MEMF; break; }
+                        case 6: { h = H_STADD; break; }
+                        default: { h = H_MODDIV; break; }
+                    }
+                    break;
+                }
+                case 4:
+                {
+                    switch ( funct1 )
+                    {
+                        case 0: { h = H_SYSCALL; pd->x = (uint8_t) ( ( ( op << 1 ) & 0x38 ) | ( ( op1 >> 2 ) & 7 ) ); ends_block = true; break; }
+                        case 1: { h = H_PUSHF; pd->imm = (oi_t) ( sizeof( oi_t ) * ( reg_from_op( op1 ) + 3 ) ); break; }
+                        case 2: { h = H_STST; break; }
+                        case 3:
+                        case 6:
+                        {
+                            h = H_NOP2;
+                            if ( width < 2 )
+                            {
+                                h = H_ADDCONST;
+                                pd->imm = ( 3 == funct1 ) ? (oi_t) IMAGE_WIDTH : (oi_t) sizeof( oi_t );
+                                if ( 1 == width )
+                                    pd->imm = (oi_t) 0 - pd->imm;
+                            }
+                            break;
+                        }
+                        case 4: { h = H_STINCR; break; }
+                        case 5: { h = H_SWAP; break; }
+                        default: { h = H_NOP2; break; }
+                    }
+                    break;
+                }
+                case 5:
+                {
+                    if ( 0 == funct1 )
+                        h = H_STR;
+                    else if ( 1 == funct1 )
+                        h = H_LDR;
+                    else if ( 2 == funct1 )
+                        h = H_PUSHTWO;
+                    else if ( 3 == funct1 )
+                        h = H_POPTWO;
+                    else
+                        h = H_ATOMIC;
+                    break;
+                }
+                case 6: { if ( 0xc1 != op ) h = H_MOV; break; }
+                default: { h = H_MATHST; pd->x = (uint8_t) funct1; break; }
+            }
+            break;
+        }
+        case 2: /* 3-byte operations with an image-width value */
+        {
+            if ( 0 == reg_from_op( op ) && funct_from_op( op ) < 2 )
+                break; /* ld rzero and ldi rzero are unused */
+
+            pd->imm = read_imgword( pc + 1 );
+            switch ( funct_from_op( op ) )
+            {
+                case 0: { h = H_LD; break; }
+                case 1: { h = H_LDI; break; }
+                case 2: { h = H_ST; break; }
+                case 3:
+                {
+                    ends_block = true;
+                    if ( 0 == reg_from_op( op ) )
+                        pd->ptarget = decoded_target( pd->imm );
+                    h = ( 0 != pd->ptarget ) ? H_JMP : H_JMPR;
+                    break;
+                }
+                case 4: { h = H_INCM; break; }
+                case 5: { h = H_DECM; break; }
+                case 6: { h = H_LDAE; break; }
+                default:
+                {
+                    ends_block = true;
+                    if ( 0 == reg_from_op( op ) )
+                        pd->ptarget = decoded_target( pd->imm );
+                    h = ( 0 != pd->ptarget ) ? H_CALL : H_CALLR;
+                    break;
+                }
+            }
+            break;
+        }
+        default: /* 4-byte operations */
+        {
+            ival = (ioi_t) (int16_t) get_word( pc + 2 );
+            switch ( funct_from_op( op ) )
+            {
+                case 0: /* j / ji / jrelb / jrel */
+                {
+                    ends_block = true;
+                    pd->y = (uint8_t) funct1;
+                    if ( width < 2 )
+                    {
+                        if ( 1 == width )
+                            pd->preg1 = & g_small_constants[ 1 + reg_from_op( op1 ) ];
+                        pd->imm = (oi_t) ival;
+                        if ( (oi_t) ival > (oi_t) 3 )
+                            pd->ptarget = decoded_target( pc + ival );
+                        h = ( 0 != pd->ptarget ) ? (uint8_t) ( H_J_GT + funct1 ) : (uint8_t) H_JFAR;
+                    }
+                    else
+                    {
+                        /* the byte at op2 is an unsigned offset from r1 and op3 is a signed pc offset or a return */
+                        pd->imm = (oi_t) op2;
+                        pd->x = get_byte( pc + 3 );
+                        ival = (ioi_t) (int8_t) pd->x;
+                        if ( (oi_t) ival > (oi_t) 3 )
+                            pd->ptarget = decoded_target( pc + ival );
+                        h = ( 2 == width ) ? H_JRELB : H_JREL;
+                    }
+                    break;
+                }
+                case 1: { h = H_STINC; pd->imm = (oi_t) ival; break; }
+                case 2: { if ( 0x43 != op ) { h = H_LDINC; pd->imm = pc + ival; } break; }
+                case 3:
+                {
+                    ends_block = true;
+                    pd->imm = pc + ival;
+                    if ( 0 == funct1 )
+                        h = H_CALLT;
+                    else if ( 1 == funct1 )
+                        h = H_CALLNFT;
+                    else
+                    {
+                        if ( 0 == reg_from_op( op ) )
+                            pd->ptarget = decoded_target( pd->imm );
+                        h = ( 0 != pd->ptarget ) ? H_CALLNF : H_CALLNFR;
+                    }
+                    break;
+                }
+                case 4: { h = H_STO; pd->imm = pc + ival; break; }
+                case 5:
+                {
+                    if ( 0xa3 == op )
+                        h = H_CPUINFO;
+                    else if ( 2 == funct1 )
+                    {
+                        h = H_LDIW;
+                        pd->imm = (oi_t) ival;
+                    }
+                    else
+                    {
+                        h = ( 1 == funct1 ) ? H_LDOINC : H_LDO;
+                        pd->imm = pc + ival;
+                    }
+                    break;
+                }
+                case 6:
+                {
+                    pd->imm = pc + ival;
+                    switch ( funct1 )
+                    {
+                        case 0: { h = ( 0 == reg_from_op( op ) ) ? H_NOP4 : H_LDM; break; }
+                        case 1: { h = H_STI; pd->y = (uint8_t) sign_extend_oi( ( ( op << 1 ) & 0x38 ) | reg_from_op( op1 ), 5 ); break; }
+                        case 2: { h = ( 0 == reg_from_op( op ) ) ? H_NOP4 : H_MATH3; pd->y = funct_from_op( op2 ); break; }
+                        case 3: { h = ( 0 == reg_from_op( op ) ) ? H_NOP4 : H_CMP3; pd->y = funct_from_op( op2 ); break; }
+                        default: { h = H_C0; break; }
+                    }
+                    break;
+                }
+                default: { h = H_CSTF; break; }
+            }
+            break;
+        }
+    }
+
+#ifdef OI_JIT
+    /* with the JIT on, calls go through the handlers that probe their target and loops end in h_jfar */
+    if ( g_jit_enabled && !g_counting )
+    {
+        if ( H_CALL == h )
+            h = H_CALLR;
+        else if ( H_CALLNF == h )
+            h = H_CALLNFR;
+        else if ( ( h >= H_J_GT ) && ( h <= H_J_ODD ) && ( pd->ptarget < pd ) )
+            h = H_JFAR;
+    }
+#endif /* OI_JIT */
+
+    /* rpc isn't kept up to date while decoded code runs, so instructions using it as a register leave the cache */
+    regs = g_handler_regs[ h ];
+    if ( ( ( regs & 1 ) && ( & g_oi.rpc == pd->preg0 ) ) ||
+         ( ( regs & 2 ) && ( & g_oi.rpc == pd->preg1 ) ) ||
+         ( ( regs & 4 ) && ( & g_oi.rpc == pd->preg2 ) ) )
+        h = H_LEAVE;
+
+    pd->h = h;
+    if ( g_profile )
+        h = H_PROFILE;
+    else if ( g_counting )
+        h = H_RETIRE;
+#ifdef OI_MMAP
+    else if ( g_fault_pc )
+        h = H_GUARD;
+#endif /* OI_MMAP */
+    pd->handler = handlers[ h ];
+
+    if ( ends_block || ( H_ILLEGAL == pd->h ) || ( H_LEAVE == pd->h ) )
+        len = 0;
+    pd->len = (uint8_t) len;
+    return len;
+} /* DecodeOneOI */
+
+static void DecodeBlockOI( struct OIDecoded * pd, const void * const * handlers )
+{
+    opcode_t len;
+    struct OIDecoded * pfirst;
+
+    pfirst = pd;
+    do
+    {
+        len = DecodeOneOI( pd, handlers );
+        pd += len;
+    } while ( ( 0 != len ) && ( handlers[ H_DECODE ] == pd->handler ) );
+
+    FuseBlockOI( pfirst, pd, handlers );
+} /* DecodeBlockOI */
+
+/* handler bodies shared by the plain handlers and the superinstructions that start with them */
+
+decoded_inline static void decoded_sto_do( struct OIDecoded * pd )
+{
+    opcode_t width;
+    oi_t address;
+
+    width = pd->x;
+    if ( 0 == width )
+    {
+        address = pd->imm + * pd->preg1;
+        set_byte( address, (uint8_t) * pd->preg0 );
+    }
+    else if_1_is_width
+    {
+        address = pd->imm + ( * pd->preg1 << 1 );
+        set_word( address, (uint16_t) * pd->preg0 );
+    }
+#ifndef OI2
+    else if_2_is_width
+    {
+        address = pd->imm + ( * pd->preg1 << 2 );
+        set_dword( address, (uint32_t) * pd->preg0 );
+    }
+#ifdef OI8
+    else
+    {
+        address = pd->imm + ( * pd->preg1 << 3 );
+        set_qword( address, * pd->preg0 );
+    }
+#endif /* OI8 */
+#endif /* OI2 */
+    code_write_check( address, 1 << width );
+} /* decoded_sto_do */
+
+decoded_inline static void decoded_ldo_do( struct OIDecoded * pd )
+{
+    opcode_t width;
+
+    width = pd->x;
+    if ( 0 == width )
+        * pd->preg0 = get_byte( pd->imm + * pd->preg1 );
+    else if_1_is_width
+        * pd->preg0 = get_word( pd->imm + ( * pd->preg1 << 1 ) );
+#ifndef OI2
+    else if_2_is_width
+        * pd->preg0 = get_dword( pd->imm + ( * pd->preg1 << 2 ) );
+#ifdef OI8
+    else
+        * pd->preg0 = get_qword( pd->imm + ( * pd->preg1 << 3 ) );
+#endif /* OI8 */
+#endif /* OI2 */
+} /* decoded_ldo_do */
+
+decoded_inline static void decoded_incm_do( struct OIDecoded * pd )
+{
+    oi_t address;
+
+    address = pd->imm + * pd->preg0;
+#ifdef OI2
+    ( * (oi_t *) ( ram_address( address ) ) )++;
+#else
+    if ( 2 == IMAGE_WIDTH )
+        ( * (uint16_t *) ( ram_address( address ) ) )++;
+    else if ( 4 == IMAGE_WIDTH )
+        ( * (uint32_t *) ( ram_address( address ) ) )++;
+#ifdef OI8
+    else
+        ( * (uint64_t *) ( ram_address( address ) ) )++;
+#endif /* OI8 */
+#endif /* OI2 */
+    code_write_check( address, IMAGE_WIDTH );
+} /* decoded_incm_do */
+
+decoded_inline static void decoded_c0_do( struct OIDecoded * pd )
+{
+    opcode_t width;
+    oi_t address;
+
+    /* fzero, stoi, stor, and ldor. stoi and stor store at r0[ r1 ] */
+    width = pd->x;
+    address = * pd->preg0 + ( * pd->preg1 << width );
+    g_oi.rpc = pd->pc;
+    op_c0_d0_do( pd->op );
+    if ( ( 5 == funct_from_op( pd->op1 ) ) || ( 6 == funct_from_op( pd->op1 ) ) )
+        code_write_check( address, 1 << width );
+} /* decoded_c0_do */
+
+/* runs until the app halts or StopOI() is called (returns true) or execution leaves the code range (returns false) */
+
+decoded_engine static bool ExecuteDecodedOI()
+{
+    static const void * const handlers[ H_COUNT ] =
+    {
+        &&h_decode, &&h_leave, &&h_illegal, &&h_halt, &&h_inc, &&h_dec, &&h_push, &&h_pop, &&h_poprzero, &&h_zero, &&h_shl, &&h_shr, &&h_inv,
+        &&h_ret0, &&h_ret0nf, &&h_retnf, &&h_ret, &&h_imulst, &&h_subst, &&h_addst, &&h_idivst, &&h_andst, &&h_shlimg, &&h_shrimg,
+        &&h_imgwid, &&h_natwid,
+        &&h_add, &&h_sub, &&h_imul, &&h_idiv, &&h_or, &&h_xor, &&h_and, &&h_cmp, &&h_cmov, &&h_mov, &&h_cmpst, &&h_mathst,
+        &&h_ldf, &&h_stf, &&h_retx, &&h_ldib, &&h_signex, &&h_memf, &&h_stadd, &&h_moddiv,
+        &&h_syscall, &&h_pushf, &&h_stst, &&h_addconst, &&h_stincr, &&h_swap, &&h_nop2,
+        &&h_str, &&h_ldr, &&h_pushtwo, &&h_poptwo, &&h_atomic,
+        &&h_ld, &&h_ldi, &&h_st, &&h_jmp, &&h_jmpr, &&h_incm, &&h_decm, &&h_ldae, &&h_call, &&h_callr,
+        &&h_j_gt, &&h_j_lt, &&h_j_eq, &&h_j_ne, &&h_j_ge, &&h_j_le, &&h_j_even, &&h_j_odd, &&h_jfar, &&h_jrelb, &&h_jrel,
+        &&h_stinc, &&h_ldinc, &&h_callt, &&h_callnft, &&h_callnf, &&h_callnfr, &&h_sto, &&h_ldo, &&h_ldoinc, &&h_ldiw, &&h_cpuinfo,
+        &&h_ldm, &&h_sti, &&h_math3, &&h_cmp3, &&h_c0, &&h_cstf, &&h_nop4,
+        &&h_profile, &&h_retire, &&h_guard,
+        &&h_inc_jle, &&h_ldo_jeq, &&h_math3_jgt, &&h_add_add, &&h_ldib_add, &&h_incm_inc,
+        &&h_inc_ldiw, &&h_ldiw_c0, &&h_c0_jgt, &&h_incm_jlt, &&h_push_pushf, &&h_pop_sto, &&h_ldib_sto, &&h_pushf_pushf, &&h_pushf_call,
+        &&h_sto_push, &&h_sto_jeq, &&h_ldiw_callnft, &&h_ldf_jge, &&h_ldf_jle,
+        &&h_dec_ldo, &&h_imul_mathst, &&h_mathst_jne, &&h_moddiv_sto, &&h_sto_dec, &&h_ldo_ldiw, &&h_ldiw_imul
+    };
+
+    struct OIDecoded * pd;
+    opcode_t width;
+    oi_t val, address;
+    ioi_t ival;
+
+    if ( 0 == g_pdecoded )
+    {
+        if ( !AllocateDecodeCache( handlers ) )
+            return false;
+    }
+
+    decoded_jump( g_oi.rpc );
+
+    h_decode:
+        DecodeBlockOI( pd, handlers );
+        if ( g_stop_requested )
+            goto h_leave;
+        decoded_dispatch();
+
+    h_leave:
+        g_oi.rpc = pd->pc;
+        if ( g_stop_requested )
+        {
+            StoppedOI();
+            return true;
+        }
+        return false;
+
+    h_illegal:
+        g_oi.rpc = pd->pc;
+        illegal_instruction( pd->op, pd->op1 );
+        val = 1 + byte_len_from_op( pd->op );
+        if ( (oi_t) 3 == val )
+            val = THREE_BYTE_LEN;
+        decoded_jump( pd->pc + val );
+
+    h_halt:
+        g_oi.rpc = pd->pc;
+        OIHalt();
+        return true;
+
+    /* 1-byte operations */
+
+    h_inc: ( * pd->preg0 )++; decoded_next( 1 );
+    h_dec: ( * pd->preg0 )--; decoded_next( 1 );
+    h_push: push( * pd->preg0 ); decoded_next( 1 );
+    h_pop: pop( val ); * pd->preg0 = val; decoded_next( 1 );
+    h_poprzero: pop_empty(); decoded_next( 1 );
+    h_zero: * pd->preg0 = 0; decoded_next( 1 );
+    h_shl: * pd->preg0 = * pd->preg0 << 1; decoded_next( 1 );
+    h_shr: * pd->preg0 = * pd->preg0 >> 1; decoded_next( 1 );
+    h_inv: * pd->preg0 = ! * pd->preg0; decoded_next( 1 );
+    h_ret0: g_oi.rres = 0; pop( g_oi.rpc ); pop( g_oi.rframe ); decoded_jump( g_oi.rpc );
+    h_ret0nf: g_oi.rres = 0; pop( g_oi.rpc ); decoded_jump( g_oi.rpc );
+    h_retnf: pop( g_oi.rpc ); decoded_jump( g_oi.rpc );
+    h_ret: pop( g_oi.rpc ); pop( g_oi.rframe ); decoded_jump( g_oi.rpc );
+    h_imulst: pop( val ); g_oi.rres = (ioi_t) val * (ioi_t) g_oi.rres; decoded_next( 1 );
+    h_subst: pop( val ); g_oi.rres = val - g_oi.rres; decoded_next( 1 );
+    h_addst: pop( val ); g_oi.rres += val; decoded_next( 1 );
+    h_idivst: pop( val ); g_oi.rres = (ioi_t) val / (ioi_t) g_oi.rres; decoded_next( 1 );
+    h_andst: pop( val ); g_oi.rres &= val; decoded_next( 1 );
+    h_shlimg: g_oi.rres <<= IMAGE_SHIFT; decoded_next( 1 );
+    h_shrimg: g_oi.rres >>= IMAGE_SHIFT; decoded_next( 1 );
+    h_imgwid: g_oi.rres = IMAGE_WIDTH; decoded_next( 1 );
+    h_natwid: g_oi.rres = sizeof( oi_t ); decoded_next( 1 );
+
+    /* 2-byte operations */
+
+    h_add: * pd->preg0 = * pd->preg0 + * pd->preg1; decoded_next( 2 );
+    h_sub: * pd->preg0 = * pd->preg0 - * pd->preg1; decoded_next( 2 );
+    h_imul: * pd->preg0 = (ioi_t) * pd->preg0 * (ioi_t) * pd->preg1; decoded_next( 2 );
+    h_idiv: * pd->preg0 = (ioi_t) * pd->preg0 / (ioi_t) * pd->preg1; decoded_next( 2 );
+    h_or: * pd->preg0 = * pd->preg0 | * pd->preg1; decoded_next( 2 );
+    h_xor: * pd->preg0 = * pd->preg0 ^ * pd->preg1; decoded_next( 2 );
+    h_and: * pd->preg0 = * pd->preg0 & * pd->preg1; decoded_next( 2 );
+    h_cmp: * pd->preg0 = ( * pd->preg0 != * pd->preg1 ); decoded_next( 2 );
+    h_cmov:
+        if ( CheckRelation( * pd->preg0, * pd->preg1, pd->x ) )
+            * pd->preg0 = * pd->preg1;
+        decoded_next( 2 );
+    h_mov: * pd->preg0 = * pd->preg1; decoded_next( 2 );
+    h_cmpst: pop( val ); * pd->preg0 = (oi_t) CheckRelation( val, * pd->preg1, pd->x ); decoded_next( 2 );
+    h_mathst: pop( val ); * pd->preg0 = Math( val, * pd->preg1, pd->x ); decoded_next( 2 );
+    h_ldf: * pd->preg0 = get_oiword( g_oi.rframe + pd->imm ); decoded_next( 2 );
+    h_stf: set_oiword( g_oi.rframe + pd->imm, * pd->preg0 ); decoded_next( 2 );
+    h_retx:
+        pop( g_oi.rpc );
+        pop( g_oi.rframe );
+        g_oi.rsp += pd->imm;
+        decoded_jump( g_oi.rpc );
+    h_ldib: * pd->preg0 = pd->imm; decoded_next( 2 );
+    h_signex: g_oi.rpc = pd->pc; signex_do( pd->op ); decoded_next( 2 );
+    h_memf:
+        width = pd->x;
+        address = g_oi.rarg1 + ( g_oi.rres << width );
+        if ( 0 == width )
+            memfb_do();
+        else if_1_is_width
+            memfw_do();
+#ifndef OI2
+        else if_2_is_width
+            memfdw_do();
+#ifdef OI8
+        else
+            memfqw_do();
+#endif /* OI8 */
+#endif /* OI2 */
+        code_write_check( address, g_code_limit );
+        decoded_next( 2 );
+    h_stadd:
+        width = pd->x;
+        address = g_oi.rarg1 + ( g_oi.rtmp << width );
+        if ( 0 == width )
+            staddb_do();
+        else if_1_is_width
+            staddw_do();
+#ifndef OI2
+        else if_2_is_width
+            stadddw_do();
+#ifdef OI8
+        else
+            staddqw_do();
+#endif /* OI8 */
+#endif /* OI2 */
+        code_write_check( address, g_code_limit );
+        decoded_next( 2 );
+    h_moddiv: moddiv_do( pd->op, pd->op1 ); decoded_next( 2 );
+    h_syscall:
+        g_oi.rpc = pd->pc;
+        OISyscall( pd->x );
+        if ( g_oi.rpc != pd->pc )
+            decoded_jump( g_oi.rpc );
+        decoded_next( 2 );
+    h_pushf: push( get_oiword( g_oi.rframe + pd->imm ) ); decoded_next( 2 );
+    h_stst:
+        pop( val );
+        write_imgword( val, * pd->preg0 );
+        code_write_check( val, IMAGE_WIDTH );
+        decoded_next( 2 );
+    h_addconst: * pd->preg0 += pd->imm; decoded_next( 2 );
+    h_stincr:
+        width = pd->x;
+        val = * pd->preg1;
+        address = * pd->preg0;
+        if ( 0 == width )
+            set_byte( address, (uint8_t) val );
+        else if_1_is_width
+            set_word( address, (uint16_t) val );
+#ifndef OI2
+        else if_2_is_width
+            set_dword( address, (uint32_t) val );
+#ifdef OI8
+        else
+            set_qword( address, val );
+#endif /* OI8 */
+#endif /* OI2 */
+        * pd->preg0 += (oi_t) ( 1 << width );
+        code_write_check( address, 1 << width );
+        decoded_next( 2 );
+    h_swap: val = * pd->preg0; * pd->preg0 = * pd->preg1; * pd->preg1 = val; decoded_next( 2 );
+    h_nop2: decoded_next( 2 );
+    h_str:
+        width = pd->x;
+        address = * pd->preg0;
+        if ( 0 == width )
+            set_byte( address, (uint8_t) ( 0xff & * pd->preg1 ) );
+        else if_1_is_width
+            set_word( address, (uint16_t) * pd->preg1 );
+#ifndef OI2
+        else if_2_is_width
+            set_dword( address, (uint32_t) * pd->preg1 );
+#ifdef OI8
+        else
+            set_qword( address, * pd->preg1 );
+#endif /* OI8 */
+#endif /* OI2 */
+        code_write_check( address, 1 << width );
+        decoded_next( 2 );
+    h_ldr:
+        width = pd->x;
+        if ( 0 == width )
+            * pd->preg0 = get_byte( * pd->preg1 );
+        else if_1_is_width
+            * pd->preg0 = get_word( * pd->preg1 );
+#ifndef OI2
+        else if_2_is_width
+            * pd->preg0 = get_dword( * pd->preg1 );
+#ifdef OI8
+        else
+            * pd->preg0 = get_qword( * pd->preg1 );
+#endif /* OI8 */
+#endif /* OI2 */
+        decoded_next( 2 );
+    h_pushtwo: push( * pd->preg0 ); push( * pd->preg1 ); decoded_next( 2 );
+    h_poptwo: pop( val ); * pd->preg0 = val; pop( val ); * pd->preg1 = val; decoded_next( 2 );
+    h_atomic:
+        address = * pd->preg0;
+        atomic_do( pd->op, pd->op1 );
+        if ( 7 != funct_from_op( pd->op1 ) ) /* fence stores nothing */
+            code_write_check( address, 1 << width_from_op( pd->op1 ) );
+        decoded_next( 2 );
+
+    /* 3-byte operations */
+
+    h_ld: * pd->preg0 = read_imgword( pd->imm ); decoded_next( THREE_BYTE_LEN );
+    h_ldi: * pd->preg0 = pd->imm; decoded_next( THREE_BYTE_LEN );
+    h_st:
+        write_imgword( pd->imm, * pd->preg0 );
+        code_write_check( pd->imm, IMAGE_WIDTH );
+        decoded_next( THREE_BYTE_LEN );
+    h_jmp: decoded_link();
+    h_jmpr: decoded_jump( pd->imm + ( sizeof( oi_t ) * * pd->preg0 ) );
+    h_incm: decoded_incm_do( pd ); decoded_next( THREE_BYTE_LEN );
+    h_decm:
+        address = pd->imm + * pd->preg0;
+#ifdef OI2
+        ( * (oi_t *) ( ram_address( address ) ) )--;
+#else
+        if ( 2 == IMAGE_WIDTH )
+            ( * (uint16_t *) ( ram_address( address ) ) )--;
+        else if ( 4 == IMAGE_WIDTH )
+            ( * (uint32_t *) ( ram_address( address ) ) )--;
+#ifdef OI8
+        else
+            ( * (uint64_t *) ( ram_address( address ) ) )--;
+#endif /* OI8 */
+#endif /* OI2 */
+        code_write_check( address, IMAGE_WIDTH );
+        decoded_next( THREE_BYTE_LEN );
+    h_ldae: val = * pd->preg0; g_oi.rres = read_imgword( pd->imm + ( IMAGE_WIDTH * val ) ); decoded_next( THREE_BYTE_LEN );
+    h_call:
+        push( g_oi.rframe );
+        push( pd->pc + THREE_BYTE_LEN );
+        g_oi.rframe = g_oi.rsp - sizeof( oi_t );
+        decoded_link();
+    h_callr:
+        push( g_oi.rframe );
+        push( pd->pc + THREE_BYTE_LEN );
+        g_oi.rframe = g_oi.rsp - sizeof( oi_t );
+        val = pd->imm + ( IMAGE_WIDTH * * pd->preg0 );
+        jit_probe( val );
+        decoded_jump( val );
+
+    /* 4-byte operations */
+
+    h_j_gt: decoded_j( 0 );
+    h_j_lt: decoded_j( 1 );
+    h_j_eq: decoded_j( 2 );
+    h_j_ne: decoded_j( 3 );
+    h_j_ge: decoded_j( 4 );
+    h_j_le: decoded_j( 5 );
+    h_j_even: decoded_j( 6 );
+    h_j_odd: decoded_j( 7 );
+    h_jfar:
+        if ( CheckRelation( * pd->preg0, * pd->preg1, pd->y ) )
+        {
+            ival = (ioi_t) pd->imm;
+#ifdef OI_JIT
+            if ( ival < 0 )
+                jit_probe( pd->pc + ival );
+#endif /* OI_JIT */
+            goto _jump_or_return;
+        }
+        decoded_next( 4 );
+    h_jrelb:
+        if ( CheckRelation( * pd->preg0, get_byte( * pd->preg1 + pd->imm ), pd->y ) )
+        {
+            if ( 0 != pd->ptarget )
+                decoded_link();
+            ival = (ioi_t) (int8_t) pd->x;
+            goto _jump_or_return;
+        }
+        decoded_next( 4 );
+    h_jrel:
+        if ( CheckRelation( * pd->preg0, read_imgword( * pd->preg1 + pd->imm ), pd->y ) )
+        {
+            if ( 0 != pd->ptarget )
+                decoded_link();
+            ival = (ioi_t) (int8_t) pd->x;
+            goto _jump_or_return;
+        }
+        decoded_next( 4 );
+    h_stinc:
+        width = pd->x;
+        address = * pd->preg0;
+        if ( 0 == width )
+            set_byte( address, (uint8_t) ( pd->imm & 0xff ) );
+        else if_1_is_width
+            set_word( address, (uint16_t) pd->imm );
+#ifndef OI2
+        else if_2_is_width
+            set_dword( address, (uint32_t) pd->imm );
+#ifdef OI8
+        else
+            set_qword( address, (uint64_t) pd->imm );
+#endif /* OI8 */
+#endif /* OI2 */
+        * pd->preg0 += (oi_t) ( 1 << width );
+        code_write_check( address, 1 << width );
+        decoded_next( 4 );
+    h_ldinc:
+        width = pd->x;
+        address = * pd->preg1 + pd->imm;
+        if ( 0 == width )
+            * pd->preg0 = get_byte( address );
+        else if_1_is_width
+            * pd->preg0 = get_word( address );
+#ifndef OI2
+        else if_2_is_width
+            * pd->preg0 = get_dword( address );
+#ifdef OI8
+        else
+            * pd->preg0 = get_qword( address );
+#endif /* OI8 */
+#endif /* OI2 */
+        * pd->preg1 += (oi_t) ( 1 << width );
+        decoded_next( 4 );
+    h_callt:
+        push( g_oi.rframe );
+        push( pd->pc + 4 );
+        g_oi.rframe = g_oi.rsp - sizeof( oi_t );
+        val = * pd->preg0;
+        val = read_imgword( pd->imm + ( IMAGE_WIDTH * val ) );
+        jit_probe( val );
+        decoded_jump( val );
+    h_callnft:
+        push( pd->pc + 4 );
+        val = * pd->preg0;
+        val = read_imgword( pd->imm + ( IMAGE_WIDTH * val ) );
+        jit_probe( val );
+        decoded_jump( val );
+    h_callnf:
+        push( pd->pc + 4 );
+        decoded_link();
+    h_callnfr:
+        push( pd->pc + 4 );
+        val = pd->imm + ( IMAGE_WIDTH * * pd->preg0 );
+        jit_probe( val );
+        decoded_jump( val );
+    h_sto: decoded_sto_do( pd ); decoded_next( 4 );
+    h_ldoinc:
+        ( * pd->preg1 )++;
+        /* fall through to ldo */
+    h_ldo: decoded_ldo_do( pd ); decoded_next( 4 );
+    h_ldiw: * pd->preg0 = pd->imm; decoded_next( 4 );
+    h_cpuinfo: g_oi.rres = 1; g_oi.rtmp = 'd' + ( 'l' << 8 ); decoded_next( 4 );
+    h_ldm:
+        width = pd->x;
+        if ( 0 == width )
+            * pd->preg0 = get_byte( pd->imm );
+        else if_1_is_width
+            * pd->preg0 = get_word( pd->imm );
+#ifndef OI2
+        else if_2_is_width
+            * pd->preg0 = get_dword( pd->imm );
+#ifdef OI8
+        else
+            * pd->preg0 = get_qword( pd->imm );
+#endif /* OI8 */
+#endif /* OI2 */
+        decoded_next( 4 );
+    h_sti:
+        width = pd->x;
+        ival = (ioi_t) (int8_t) pd->y;
+        if ( 0 == width )
+            set_byte( pd->imm, (uint8_t) ival );
+        else if_1_is_width
+            set_word( pd->imm, (uint16_t) ival );
+#ifndef OI2
+        else if_2_is_width
+            set_dword( pd->imm, (uint32_t) ival );
+#ifdef OI8
+        else
+            set_qword( pd->imm, (uint64_t) ival );
+#endif /* OI8 */
+#endif /* OI2 */
+        code_write_check( pd->imm, 1 << width );
+        decoded_next( 4 );
+    h_math3: * pd->preg0 = Math( * pd->preg1, * pd->preg2, pd->y ); decoded_next( 4 );
+    h_cmp3: * pd->preg0 = (oi_t) CheckRelation( * pd->preg1, * pd->preg2, pd->y ); decoded_next( 4 );
+    h_c0: decoded_c0_do( pd ); decoded_next( 4 );
+    h_cstf: g_oi.rpc = pd->pc; cstf_do( pd->op ); decoded_next( 4 );
+    h_nop4: decoded_next( 4 );
+
+    h_profile: ProfileStepOI( pd ); goto * handlers[ pd->h ];
+    h_retire: g_retired++; g_oi.rpc = pd->pc; goto * handlers[ pd->h ]; /* rpc as for h_guard */
+    h_guard: g_oi.rpc = pd->pc; goto * handlers[ pd->h ];
+
+    /* superinstructions: the first instruction's work, then the second's handler. see g_fusions */
+
+    h_inc_jle: ( * pd->preg0 )++; fused_next( 1, h_j_le );
+    h_ldo_jeq: decoded_ldo_do( pd ); fused_next( 4, h_j_eq );
+    h_math3_jgt: * pd->preg0 = Math( * pd->preg1, * pd->preg2, pd->y ); fused_next( 4, h_j_gt );
+    h_add_add: * pd->preg0 = * pd->preg0 + * pd->preg1; fused_next( 2, h_add );
+    h_ldib_add: * pd->preg0 = pd->imm; fused_next( 2, h_add );
+    h_incm_inc: decoded_incm_do( pd ); fused_store_next( THREE_BYTE_LEN, h_inc );
+    h_inc_ldiw: ( * pd->preg0 )++; fused_next( 1, h_ldiw );
+    h_ldiw_c0: * pd->preg0 = pd->imm; fused_next( 4, h_c0 );
+    h_c0_jgt: decoded_c0_do( pd ); fused_store_next( 4, h_j_gt );
+    h_incm_jlt: decoded_incm_do( pd ); fused_store_next( THREE_BYTE_LEN, h_j_lt );
+    h_push_pushf: push( * pd->preg0 ); fused_next( 1, h_pushf );
+    h_pop_sto: pop( val ); * pd->preg0 = val; fused_next( 1, h_sto );
+    h_ldib_sto: * pd->preg0 = pd->imm; fused_next( 2, h_sto );
+    h_pushf_pushf: push( get_oiword( g_oi.rframe + pd->imm ) ); fused_next( 2, h_pushf );
+    h_pushf_call: push( get_oiword( g_oi.rframe + pd->imm ) ); fused_next( 2, h_call );
+    h_sto_push: decoded_sto_do( pd ); fused_store_next( 4, h_push );
+    h_sto_jeq: decoded_sto_do( pd ); fused_store_next( 4, h_j_eq );
+    h_ldiw_callnft: * pd->preg0 = pd->imm; fused_next( 4, h_callnft );
+    h_ldf_jge: * pd->preg0 = get_oiword( g_oi.rframe + pd->imm ); fused_next( 2, h_j_ge );
+    h_ldf_jle: * pd->preg0 = get_oiword( g_oi.rframe + pd->imm ); fused_next( 2, h_j_le );
+    h_dec_ldo: ( * pd->preg0 )--; fused_next( 1, h_ldo );
+    h_imul_mathst: * pd->preg0 = (ioi_t) * pd->preg0 * (ioi_t) * pd->preg1; fused_next( 2, h_mathst );
+    h_mathst_jne: pop( val ); * pd->preg0 = Math( val, * pd->preg1, pd->x ); fused_next( 2, h_j_ne );
+    h_moddiv_sto: moddiv_do( pd->op, pd->op1 ); fused_next( 2, h_sto );
+    h_sto_dec: decoded_sto_do( pd ); fused_store_next( 4, h_dec );
+    h_ldo_ldiw: decoded_ldo_do( pd ); fused_next( 4, h_ldiw );
+    h_ldiw_imul: * pd->preg0 = pd->imm; fused_next( 4, h_imul );
+
+    _jump_or_return: /* ival is a signed pc offset, or 0..3 for a return */
+        if ( (oi_t) ival <= (oi_t) 3 )
+        {
+            jump_return( ival );
+            decoded_jump( g_oi.rpc );
+        }
+        decoded_jump( pd->pc + ival );
+
+    _left_code:
+        g_oi.rpc = val;
+        return false;
+} /* ExecuteDecodedOI */
+
+#endif /* OI_SIM_ENGINE */
+#endif /* OI_PREDECODE */
+
+uint32_t ExecuteOI()
+{
+#ifdef OI_THREADED
+    static const void * const dispatch_table[ 256 ] =
+    {
+        &&op_halt, &&op_math, &&op_illegal, &&op_j, &&op_inc, &&op_math, &&op_ld, &&op_j,
+        &&op_ret0, &&op_math, &&op_ld, &&op_j, &&op_inc, &&op_math, &&op_ld, &&op_j,
+        &&op_inc, &&op_math, &&op_ld, &&op_j, &&op_inc, &&op_math, &&op_ld, &&op_j,
+        &&op_inc, &&op_math, &&op_ld, &&op_j, &&op_inc, &&op_math, &&op_ld, &&op_j,
+        &&op_imulst, &&op_illegal, &&op_illegal, &&op_stinc, &&op_dec, &&op_cmov, &&op_ldi, &&op_stinc,
+        &&op_shlimg, &&op_cmov, &&op_ldi, &&op_stinc, &&op_dec, &&op_cmov, &&op_ldi, &&op_stinc,
+        &&op_dec, &&op_cmov, &&op_ldi, &&op_stinc, &&op_dec, &&op_cmov, &&op_ldi, &&op_stinc,
+        &&op_dec, &&op_cmov, &&op_ldi, &&op_stinc, &&op_dec, &&op_cmov, &&op_ldi, &&op_stinc,
+        &&op_push, &&op_cmpst, &&op_st, &&op_illegal, &&op_push, &&op_cmpst, &&op_st, &&op_ldinc,
+        &&op_ret0nf, &&op_cmpst, &&op_st, &&op_ldinc, &&op_push, &&op_cmpst, &&op_st, &&op_ldinc,
+        &&op_push, &&op_cmpst, &&op_st, &&op_ldinc, &&op_push, &&op_cmpst, &&op_st, &&op_ldinc,
+        &&op_push, &&op_cmpst, &&op_st, &&op_ldinc, &&op_push, &&op_cmpst, &&op_st, &&op_ldinc,
+        &&op_poprzero, &&op_60_70, &&op_jmp, &&op_calltable, &&op_pop, &&op_60_70, &&op_jmp, &&op_calltable,
+        &&op_retnf, &&op_60_70, &&op_jmp, &&op_calltable, &&op_pop, &&op_60_70, &&op_jmp, &&op_calltable,
+        &&op_pop, &&op_60_70, &&op_jmp, &&op_calltable, &&op_pop, &&op_60_70, &&op_jmp, &&op_calltable,
+        &&op_pop, &&op_60_70, &&op_jmp, &&op_calltable, &&op_pop, &&op_60_70, &&op_jmp, &&op_calltable,
+        &&op_subst, &&op_80_90, &&op_incmem, &&op_sto, &&op_imgwid, &&op_80_90, &&op_incmem, &&op_sto,
+        &&op_shrimg, &&op_80_90, &&op_incmem, &&op_sto, &&op_zero, &&op_80_90, &&op_incmem, &&op_sto,
+        &&op_zero, &&op_80_90, &&op_incmem, &&op_sto, &&op_zero, &&op_80_90, &&op_incmem, &&op_sto,
+        &&op_zero, &&op_80_90, &&op_incmem, &&op_sto, &&op_zero, &&op_80_90, &&op_incmem, &&op_sto,
+        &&op_addst, &&op_a0_b0, &&op_decmem, &&op_cpuinfo, &&op_illegal, &&op_a0_b0, &&op_decmem, &&op_ldo,
+        &&op_idivst, &&op_a0_b0, &&op_decmem, &&op_ldo, &&op_shl, &&op_a0_b0, &&op_decmem, &&op_ldo,
+        &&op_shl, &&op_a0_b0, &&op_decmem, &&op_ldo, &&op_shl, &&op_a0_b0, &&op_decmem, &&op_ldo,
+        &&op_shl, &&op_a0_b0, &&op_decmem, &&op_ldo, &&op_shl, &&op_a0_b0, &&op_decmem, &&op_ldo,
+        &&op_ret, &&op_illegal, &&op_ldae, &&op_c0_d0, &&op_illegal, &&op_mov, &&op_ldae, &&op_c0_d0,
+        &&op_natwid, &&op_mov, &&op_ldae, &&op_c0_d0, &&op_shr, &&op_mov, &&op_ldae, &&op_c0_d0,
+        &&op_shr, &&op_mov, &&op_ldae, &&op_c0_d0, &&op_shr, &&op_mov, &&op_ldae, &&op_c0_d0,
+        &&op_shr, &&op_mov, &&op_ldae, &&op_c0_d0, &&op_shr, &&op_mov, &&op_ldae, &&op_c0_d0,
+        &&op_andst, &&op_mathst, &&op_call, &&op_cstf, &&op_illegal, &&op_mathst, &&op_call, &&op_cstf,
+        &&op_illegal, &&op_mathst, &&op_call, &&op_cstf, &&op_inv, &&op_mathst, &&op_call, &&op_cstf,
+        &&op_inv, &&op_mathst, &&op_call, &&op_cstf, &&op_inv, &&op_mathst, &&op_call, &&op_cstf,
+        &&op_inv, &&op_mathst, &&op_call, &&op_cstf, &&op_inv, &&op_mathst, &&op_call, &&op_cstf
+    };
+#endif /* OI_THREADED */
+#ifndef OI2
+    opcode_t byte_len;
+#endif /* OI2 */
+    opcode_t op, op1, width;
+    oi_t val;
+    ioi_t ival;
+    uint32_t instruction_count;
+
+    uint8_t funct1;
+    oi_t reg1;
+
+    instruction_count = 0;
+
+#ifdef OI_PREDECODE
+#ifndef OI_SIM_ENGINE
+    if ( 0 != g_code_limit )
+    {
+        if ( ExecuteDecodedOI() )
+            return instruction_count;
+    }
+#endif /* OI_SIM_ENGINE */
+#endif /* OI_PREDECODE */
+
+#ifdef OI_THREADED
+    dispatch_jump();
+#endif /* OI_THREADED */
+
+    do
+    {
+#ifndef NDEBUG
+        assert( (oi_t) 0 == g_oi.rzero );
+        assert( (oi_t) 0 == read_imgword( 0 ) );
+
+        if ( g_OIState )
+        {
+            if ( g_OIState & OI_FLAG_TRACE_INSTRUCTIONS )
+                TraceState();
+        }
+        instruction_count++;
+#endif /* NDEBUG */
+        op = get_op();
+        switch( op )
+        {
+            case 0x00: { op_label( op_halt ) OIHalt(); goto _all_done; } /* halt */
+            case 0x04: case 0x0c: case 0x10: case 0x14: case 0x18: case 0x1c: /* inc r */
+            {
+                op_label( op_inc )
+                inc_reg_from_op( op );
+                dispatch_next( 1 );
+            }
+            case 0x08: /* ret0: move 0 to rres and return */
+            {
+                op_label( op_ret0 )
+                g_oi.rres = 0;
+                pop( g_oi.rpc );
+                pop( g_oi.rframe );
+                dispatch_jump();
+            }
+            case 0x20: /* imulst */
+            {
+                op_label( op_imulst )
+                pop( val );
+                g_oi.rres = (ioi_t) val * (ioi_t) g_oi.rres;
+                dispatch_next( 1 );
+            }
+            case 0x24: case 0x2c: case 0x30: case 0x34: case 0x38: case 0x3c: /* dec r */
+            {
+                op_label( op_dec )
+                dec_reg_from_op( op );
+                dispatch_next( 1 );
+            }
+            case 0x28: /* shlimg */
+            {
+                op_label( op_shlimg )
+                g_oi.rres <<= IMAGE_SHIFT;
+                dispatch_next( 1 );
+            }
+            case 0x40: case 0x44: case 0x4c: case 0x50: case 0x54: case 0x58: case 0x5c: /* push r */
+            {
+                op_label( op_push )
+                push( get_reg_from_op( op ) );
+                dispatch_next( 1 );
+            }
+            case 0x48: /* ret0nf */
+            {
+                op_label( op_ret0nf )
+                g_oi.rres = 0;
+                pop( g_oi.rpc );
+                dispatch_jump();
+            }
+            case 0x60: /* pop rzero */
+            {
+                op_label( op_poprzero )
+                pop_empty(); /* don't overwrite rzero */
+                dispatch_next( 1 );
+            }
+            case 0x64: case 0x6c: case 0x70: case 0x74: case 0x78: case 0x7c: /* pop r */
+            {
+                op_label( op_pop )
+                pop( val );
+                set_reg_from_op( op, val );
+                dispatch_next( 1 );
+            }
+            case 0x68: /* retnf */
+            {
+                op_label( op_retnf )
+                pop( g_oi.rpc );
+                dispatch_jump();
+            }
+            case 0x80: /* subst */
+            {
+                op_label( op_subst )
+                pop( val );
+                g_oi.rres = val - g_oi.rres;
+                dispatch_next( 1 );
+            }
+            case 0x84: /* imgwid */
+            {
+                op_label( op_imgwid )
+                g_oi.rres = IMAGE_WIDTH;
+                dispatch_next( 1 );
+            }
+            case 0x8c: case 0x90: case 0x94: case 0x98: case 0x9c: /* zero r */
+            {
+                op_label( op_zero )
+                set_reg_from_op( op, 0 );
+                dispatch_next( 1 );
+            }
+            case 0x88: /* shrimg */
+            {
+                op_label( op_shrimg )
+                g_oi.rres >>= IMAGE_SHIFT;
+                dispatch_next( 1 );
+            }
+            case 0xa0: /* addst */
+            {
+                op_label( op_addst )
+                pop( val );
+                g_oi.rres += val;
+                dispatch_next( 1 );
+            }
+            case 0xac: case 0xb0: case 0xb4: case 0xb8: case 0xbc: /* shl r */
+            {
+                op_label( op_shl )
+                set_reg_from_op( op, get_reg_from_op( op ) << 1 );
+                dispatch_next( 1 );
+            }
+            case 0xa8: /* idivst */
+            {
+                op_label( op_idivst )
+                pop( val );
+                g_oi.rres = (ioi_t) val / (ioi_t) g_oi.rres;
+                dispatch_next( 1 );
+            }
+            case 0xc0: /* ret */
+            {
+                op_label( op_ret )
+                pop( g_oi.rpc );
+                pop( g_oi.rframe );
+                dispatch_jump();
+            }
+            case 0xc8: /* natwid */
+            {
+                op_label( op_natwid )
+                g_oi.rres = sizeof( oi_t );
+                dispatch_next( 1 );
+            }
+            case 0xcc: case 0xd0: case 0xd4: case 0xd8: case 0xdc: /* shr r */
+            {
+                op_label( op_shr )
+                set_reg_from_op( op, get_reg_from_op( op ) >> 1 );
+                dispatch_next( 1 );
+            }
+            case 0xec: case 0xf0: case 0xf4: case 0xf8: case 0xfc: /* inv r */
+            {
+                op_label( op_inv )
+                set_reg_from_op( op, ! get_reg_from_op( op ) );
+                dispatch_next( 1 );
+            }
+            case 0xe0: /* andst */
+            {
+                op_label( op_andst )
+                pop( val );
+                g_oi.rres &= val;
+                dispatch_next( 1 );
+            }
+            case 0x06: case 0x0a: case 0x0e: /* ld r, [address] */
+            case 0x12: case 0x16: case 0x1a: case 0x1e:
+            {
+                op_label( op_ld )
+                set_reg_from_op( op, read_imgword( read_imgword( g_oi.rpc + 1 ) ) );
+                dispatch_next( THREE_BYTE_LEN );
+            }
+            case 0x26: case 0x2a: case 0x2e: /* ldi r, value */
+            case 0x32: case 0x36: case 0x3a: case 0x3e:
+            {
+                op_label( op_ldi )
+                set_reg_from_op( op, read_imgword( g_oi.rpc + 1 ) );
+                dispatch_next( THREE_BYTE_LEN );
+            }
+            case 0x42: case 0x46: case 0x4a: case 0x4e: /* st [address], r */
+            case 0x52: case 0x56: case 0x5a: case 0x5e:
+            {
+                op_label( op_st )
+                write_imgword( read_imgword( g_oi.rpc + 1 ), get_reg_from_op( op ) );
+                dispatch_next( THREE_BYTE_LEN );
+            }
+            case 0x62: case 0x66: case 0x6a: case 0x6e: /* jmp address */
+            case 0x72: case 0x76: case 0x7a: case 0x7e:
+            {
+                op_label( op_jmp )
+                g_oi.rpc = read_imgword( g_oi.rpc + 1 ) + ( sizeof( oi_t ) * get_reg_from_op( op ) );
+                dispatch_jump();
+            }
+            case 0x82: case 0x86: case 0x8a: case 0x8e: /* inc [address] */
+            case 0x92: case 0x96: case 0x9a: case 0x9e:
+            {
+                op_label( op_incmem )
+#ifdef OI2
+                ( * (oi_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )++;
+#else
+                if ( 2 == IMAGE_WIDTH )
+                    ( * (uint16_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )++;
+                else if ( 4 == IMAGE_WIDTH )
+                    ( * (uint32_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )++;
+#ifdef OI8
+                else if ( 8 == IMAGE_WIDTH )
+                    ( * (uint64_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )++;
+#endif /* OI8 */
+#endif /* OI2 */
+                dispatch_next( THREE_BYTE_LEN );
+            }
+            case 0xa2: case 0xa6: case 0xaa: case 0xae: /* dec [address] */
+            case 0xb2: case 0xb6: case 0xba: case 0xbe: 
+            {
+                op_label( op_decmem )
+#ifdef OI2
+                ( * (oi_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )--;
+#else
+                if ( 2 == IMAGE_WIDTH )
+                    ( * (uint16_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )--;
+                else if ( 4 == IMAGE_WIDTH )
+                    ( * (uint32_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )--;
+#ifdef OI8
+                else if ( 8 == IMAGE_WIDTH )
+                    ( * (uint64_t *) ( ram_address( read_imgword( g_oi.rpc + 1 ) + get_reg_from_op( op ) ) ) )--;
+#endif /* OI8 */
+#endif /* OI2 */
+                dispatch_next( THREE_BYTE_LEN );
+            }
+            case 0xc2: case 0xc6: case 0xca: case 0xce: /* ldae rres (implied), address[ r ] */
+            case 0xd2: case 0xd6: case 0xda: case 0xde: 
+            {
+                op_label( op_ldae )
+                val = get_reg_from_op( op ); /* separate statement needed for HiSoft C on CP/M */
+                g_oi.rres = read_imgword( read_imgword( g_oi.rpc + 1 ) + ( IMAGE_WIDTH * val ) );
+                dispatch_next( THREE_BYTE_LEN );
+            }
+            case 0xe2: case 0xe6: case 0xea: case 0xee: /* call address / call reg0 + address */
+            case 0xf2: case 0xf6: case 0xfa: case 0xfe: 
+            {
+                op_label( op_call )
+                push( g_oi.rframe );
+                push( g_oi.rpc + 1 + IMAGE_WIDTH );
+                g_oi.rframe = g_oi.rsp - sizeof( oi_t ); /* point at first local variable (if any) */
+                g_oi.rpc = read_imgword( g_oi.rpc + 1 ) + ( IMAGE_WIDTH * get_reg_from_op( op ) );
+                dispatch_jump();
+            }
+            case 0x03: case 0x07: case 0x0b: case 0x0f: /* j / ji / jrelb / jrel */
+            case 0x13: case 0x17: case 0x1b: case 0x1f:
+            {
+                op_label( op_j )
+                op1 = get_op1();
+                switch( width_from_op( op1 ) )
+                {
+                    case 0: /* j rleft, rright, relation, offset. */
+                    {
+                        if ( CheckRelation( get_reg_from_op( op ), get_reg_from_op( op1 ), funct_from_op( op1 ) ) )
+                        {
+                            ival = (int16_t) get_word( g_oi.rpc + 2 );
+                            if ( (oi_t) ival <= (oi_t) 3 )
+                                jump_return( ival );
+                            else
+                                g_oi.rpc += ival;
+                            dispatch_jump();
+                        }
+                        break;
+                    }
+                    case 1: /* ji rleft, rrightCONSTANT, relation, offset. always native bit width. address extended to native width */
+                    {
+                        if ( CheckRelation( get_reg_from_op( op ), 1 + reg_from_op( op1 ), funct_from_op( op1 ) ) )
+                        {
+                            ival = (int16_t) get_word( g_oi.rpc + 2 );
+                            if ( (oi_t) ival <= (oi_t) 3 )
+                                jump_return( ival );
+                            else
+                                g_oi.rpc += ival;
+                            dispatch_jump();
+                        }
+                        break;
+                    }
+                    case 2: /* jrelb r0left, r1rightADDRESS, offset (from r1right), RELATION, (-128..127 pc offset) */
+                    {
+                        if ( CheckRelation( get_reg_from_op( op ), get_byte( get_reg_from_op( op1 ) + get_byte( g_oi.rpc + 2 ) ), funct_from_op( op1 ) ) )
+                        {
+                            ival = (ioi_t) (int8_t) get_byte( g_oi.rpc + 3 );
+                            if ( (oi_t) ival <= (oi_t) 3 )
+                                jump_return( ival );
+                            else
+                                g_oi.rpc += ival;
+                            dispatch_jump();
+                        }
+                        break;
+                    }
+                    default: /* case 3: */ /* jrel r0left, r1rightADDRESS, offset (from r1right), RELATION, (-128..127 pc offset) */
+                    {
+                        if ( jrel_do( op, op1 ) )
+                            dispatch_jump();
+                        break;
+                    }
+                }
+                dispatch_next( 4 );
+            }
+            case 0x23: case 0x27: case 0x2b: case 0x2f: /* stinc */
+            case 0x33: case 0x37: case 0x3b: case 0x3f:
+            {
+                op_label( op_stinc )
+                stinc_do( op );
+                dispatch_next( 4 );
+            }
+            case 0x47: case 0x4b: case 0x4f: /* ldinc reg0dst reg1offinc pc-relative-offset */
+            case 0x53: case 0x57: case 0x5b: case 0x5f:
+            {
+                op_label( op_ldinc )
+                ldinc_do( op );
+                dispatch_next( 4 );
+            }
+            case 0x63: case 0x67: case 0x6b: case 0x6f: /* call through function pointer table and callnf variants */
+            case 0x73: case 0x77: case 0x7b: case 0x7f:
+            {
+                op_label( op_calltable )
+                op1 = get_op1();
+                ival = (ioi_t) (int16_t) get_word( g_oi.rpc + 2 );
+                switch( funct_from_op( op1 ) )
+                {
+                    case 0: /* call address[ r0 ] */
+                    {
+                        push( g_oi.rframe );
+                        push( g_oi.rpc + 4 );
+                        g_oi.rframe = g_oi.rsp - sizeof( oi_t ); /* point at first local variable (if any) */
+                        val = get_reg_from_op( op );
+                        g_oi.rpc = read_imgword( g_oi.rpc + ival + ( IMAGE_WIDTH * val ) );
+                        dispatch_jump();
+                    }
+                    case 1: /* callnf address[ r0 ] */
+                    {
+                        push( g_oi.rpc + 4 );
+                        val = get_reg_from_op( op );
+                        g_oi.rpc = read_imgword( g_oi.rpc + ival + ( IMAGE_WIDTH * val ) );
+                        dispatch_jump();
+                    }
+                    default: /* case 2: */ /* callnf address */
+                    {
+                        push( g_oi.rpc + 4 );
+                        g_oi.rpc = g_oi.rpc + ival + ( IMAGE_WIDTH * get_reg_from_op( op ) );
+                        dispatch_jump();
+                    }
+                }
+            }
+            case 0x83: case 0x87: case 0x8b: case 0x8f: /* sto address[ r1 ], r0 -- address is signed and pc-relative */
+            case 0x93: case 0x97: case 0x9b: case 0x9f:
+            {
+                op_label( op_sto )
+                op1 = get_op1();
+                width = width_from_op( op1 );
+                val = g_oi.rpc + (ioi_t) (int16_t) get_word( g_oi.rpc + 2 );
+                if ( 0 == width )
+                    set_byte( val + get_reg_from_op( op1 ), (uint8_t) get_reg_from_op( op ) );
+                else if_1_is_width
+                    set_word( val + ( get_reg_from_op( op1 ) << 1 ), (uint16_t) get_reg_from_op( op ) );
+#ifndef OI2
+                else if_2_is_width
+                    set_dword( val + ( get_reg_from_op( op1 ) << 2 ), (uint32_t) get_reg_from_op( op ) );
+#ifdef OI8
+                else /* 3 == width */
+                    set_qword( val + ( get_reg_from_op( op1 ) << 3 ), get_reg_from_op( op ) );
+#endif /* OI8 */
+#endif /* OI2 */
+                dispatch_next( 4 );
+            }
+            case 0xa7: case 0xab: case 0xaf: /* ldo / ldob / ldoinc / ldoincb / ldiw */
+            case 0xb3: case 0xb7: case 0xbb: case 0xbf:
+            {
+                op_label( op_ldo )
+                ival = (ioi_t) (int16_t) get_word( g_oi.rpc + 2 );
+                op1 = get_op1();
+                funct1 = funct_from_op( op1 );
+            
+                if ( 2 == funct1 )
+                    set_reg_from_op( op, (oi_t) ival ); /* ldiw */
+                else /* funct1 is 0 or 1 for ldo variants */
+                {
+                    if ( 1 == funct1 ) /* pre-increment register for ldoinc variants */
+                        inc_reg_from_op( op1 );
+                
+                    width = (uint8_t) width_from_op( op1 );
+                
+                    if ( (oi_t) 0 == width )
+                        set_reg_from_op( op, get_byte( g_oi.rpc + ival + get_reg_from_op( op1 ) ) ); /* ldob */
+                    else if_1_is_width
+                    {
+                        reg1 = get_reg_from_op( op1 ); /* separate statement required for HiSoft C on CP/M */
+                        set_reg_from_op( op, get_word( g_oi.rpc + ival + ( reg1 << 1 ) ) ); /* ldow */
+                    }
+#ifndef OI2
+                    else if_2_is_width
+                        set_reg_from_op( op, get_dword( g_oi.rpc + ival + ( get_reg_from_op( op1 ) << 2 ) ) ); /* ldodw */
+#ifdef OI8
+                    else
+                        set_reg_from_op( op, get_qword( g_oi.rpc + ival + ( get_reg_from_op( op1 ) << 3 ) ) ); /* ldoqw */
+#endif /* OI8 */
+#endif /* OI2 */
+                }
+                dispatch_next( 4 );
+            }
+            case 0xc3: case 0xc7: case 0xcb: case 0xcf: /* ld / sti / stib / math / fzero / stoi / stor / ldor */
+            case 0xd3: case 0xd7: case 0xdb: case 0xdf:
+            {
+                op_label( op_c0_d0 )
+                op_c0_d0_do( op );
+                dispatch_next( 4 );
+            }
+            case 0xe3: case 0xe7: case 0xeb: case 0xef: /* cstf r0left, r1right, funct1REL, reg2FRAMEOFFSET */
+            case 0xf3: case 0xf7: case 0xfb: case 0xff: /* fourth byte is currently unused */
+            {
+                op_label( op_cstf )
+                cstf_do( op );
+                dispatch_next( 4 );
+            }
+            case 0x01: case 0x05: case 0x09: case 0x0d: /* math rdst/rleft, rright */
+            case 0x11: case 0x15: case 0x19: case 0x1d:
+            {
+                op_label( op_math )
+                op1 = get_op1();
+                set_reg_from_op( op, Math( get_reg_from_op( op ), get_reg_from_op( op1 ), funct_from_op( op1 ) ) );
+                dispatch_next( 2 );
+            }
+            case 0x25: case 0x29: case 0x2d: /* cmov r0dst, r1src, funct1REL */
+            case 0x31: case 0x35: case 0x39: case 0x3d:
+            {
+                op_label( op_cmov )
+                cmov_do( op );
+                dispatch_next( 2 );
+            }
+            case 0x41: case 0x45: case 0x49: case 0x4d: /* cmpst rdst, rright, relation */
+            case 0x51: case 0x55: case 0x59: case 0x5d:
+            {
+                op_label( op_cmpst )
+                /* set rdst to boolean of ( pop() RELATION rright ) */
+                op1 = get_op1();
+                pop( val );
+                set_reg_from_op( op, (oi_t) CheckRelation( val, get_reg_from_op( op1 ), funct_from_op( op1 ) ) );
+                dispatch_next( 2 );
+            }
+            case 0x61: case 0x65: case 0x69: case 0x6d: /* ldf / stf / ret x / ldib / signex / memf / stadd / moddiv */
+            case 0x71: case 0x75: case 0x79: case 0x7d:
+            {
+                op_label( op_60_70 )
+                op1 = get_op1();
+                switch( funct_from_op( op1 ) )
+                {
+                    case 0: /* ldf rdst, offset ( -4..3 ) */
+                    {
+                        set_reg_from_op( op, get_oiword( frame_offset( ( (int16_t) reg_from_op( op1 ) ) ) ) );
+                        break;
+                    }
+                    case 1: /* stf rdst, offset ( -4..3 ) */
+                    {
+                        set_oiword( frame_offset( (int16_t) reg_from_op( op1 ) ), get_reg_from_op( op ) );
+                        break;
+                    }
+                    case 2: /* ret x */
+                    {
+                        pop( g_oi.rpc );
+                        pop( g_oi.rframe );
+                        g_oi.rsp += ( sizeof( oi_t ) * ( 1 + reg_from_op( op1 ) ) );
+                        dispatch_jump();
+                    }
+                    case 3: /* ldib rdst x */
+                    {
+                        set_reg_from_op( op, sign_extend_oi( ( op1 & 0x1f ), 4 ) );
+                        break;
+                    }
+                    case 4: /* signex */
+                    {
+                        signex_do( op );
+                        break;
+                    }
+                    case 5: /* memf: memfill address in rarg1 with rtmp for rarg2 iterations (bytes or words ) */
+                    {
+                        width = width_from_op( op1 );
+                        if ( 0 == width )
+                            memfb_do();
+                        else if_1_is_width
+                            memfw_do();
+#ifndef OI2
+                        else if_2_is_width
+                            memfdw_do();
+#ifdef OI8
+                        else /* 3 == width */
+                            memfqw_do();
+#endif /* OI8 */
+#endif /* OI2 */
+                        break;
+                    }
+                    case 6: /* stadd: stb [ rtmp + rarg1 ] = 0. add rtmp, rarg2. loop if rtmp le rres */
+                    {
+                        width = width_from_op( op1 );
+                        if ( 0 == width )
+                            staddb_do();
+                        else if_1_is_width
+                            staddw_do();
+#ifndef OI2
+                        else if_2_is_width
+                            stadddw_do();
+#ifdef OI8
+                        else /* 3 == width */
+                            staddqw_do();
+#endif /* OI8 */
+#endif /* OI2 */
+                        break;
+                    }
+                    case 7: /* moddiv: push( r0 / r1 ). r0 = r0 % r1. */
+                    {
+                        moddiv_do( op, op1 );
+                        break;
+                    }
+                }
+                dispatch_next( 2 );
+            }
+            case 0x81: case 0x85: case 0x89: case 0x8d: /* syscall, pushf, stst, addimgw, subimgw, addnatw, subnatw */
+            case 0x91: case 0x95: case 0x99: case 0x9d:
+            {
+                op_label( op_80_90 )
+                if ( op_80_90_do( op ) )
+                    dispatch_jump();
+                dispatch_next( 2 );
+            }
+            case 0xa1: case 0xa5: case 0xa9: case 0xad: /* st [r0dst] r1src / ld r0dst [r1src] / pushtwo r0, r1 / poptwo r0, r1 / atomics */
+            case 0xb1: case 0xb5: case 0xb9: case 0xbd:
+            {
+                op_label( op_a0_b0 )
+                op_a0_b0_do( op );
+                dispatch_next( 2 );
+            }
+            case 0xa3: /* cpuinfo */
+            {
+                op_label( op_cpuinfo )
+                g_oi.rres = 1; /* version 1 */
+                g_oi.rtmp = 'd' + ( 'l' << 8 ); /* ID */
+                dispatch_next( 4 );
+            }
+            case 0xc5: case 0xc9: case 0xcd: /* mov r0dst r1src */
+            case 0xd1: case 0xd5: case 0xd9: case 0xdd:
+            {
+                op_label( op_mov )
+                set_reg_from_op( op, get_reg_from_op( get_op1() ) );
+                dispatch_next( 2 );
+            }
+            case 0xe1: case 0xe5: case 0xe9: case 0xed: /* mathst r0dst, r1src, Math */
+            case 0xf1: case 0xf5: case 0xf9: case 0xfd:
+            {
+                op_label( op_mathst )
+                op1 = get_op1();
+                pop( val );
+                set_reg_from_op( op, Math( val, get_reg_from_op( op1 ), funct_from_op( op1 ) ) );
+                dispatch_next( 2 );
+            }
+            default:
+                op_label( op_illegal )
+                illegal_instruction( op, get_op1() );
+        }
+
+#ifdef OI2
+        g_oi.rpc += ( 1 + byte_len_from_op( op ) );
+#else
+        byte_len = 1 + byte_len_from_op( op );
+        if ( 3 == byte_len )
+            byte_len = THREE_BYTE_LEN;
+        g_oi.rpc += (oi_t) byte_len;
+#endif /* OI2 */
+
+        continue; /* old compilers otherwise evaluate (true) each loop */
+    } while ( true );
+
+_all_done:
+    return instruction_count;
+} /* ExecuteOI */
@@ -33,189 +33,3636 @@ char * strchr( pc, c ) char * pc; char c;
 #include "oios.h"
 #include "trace.h"
 
+#ifdef OI_CONTEXT
+#include <pthread.h>
+#include <setjmp.h>
+#ifdef _WIN32
+#define sigjmp_buf jmp_buf
+#define sigsetjmp( env, save ) setjmp( env )
+#define siglongjmp( env, value ) longjmp( env, value )
+#endif /* _WIN32 */
+#endif /* OI_CONTEXT */
+
+/* checkpoints need OI_MMAP's dirty page tracking and the decode cache's StopOI() */
+#ifdef OI_MMAP
+#ifdef OI_PREDECODE
+#define OI_CHECKPOINT
+#include <signal.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif /* OI_PREDECODE */
+#endif /* OI_MMAP */
+
+/* serve mode keeps loaded images in OIContexts and forks runs from them */
+#ifdef OI_CONTEXT
+#ifdef OI_MMAP
+#define OI_SERVE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif /* OI_MMAP */
+#endif /* OI_CONTEXT */
+
+/* unix-like builds write console output with write() and writev() and can map guest files */
+#ifdef OI_MMAP
+#define OI_WRITEV
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#endif /* OI_MMAP */
+
+/* asynchronous guest I/O runs on a pool of pthreads with pread() and pwrite() */
+#ifdef OI_CONTEXT
+#ifdef OI_MMAP
+#define OI_AIO
+#endif /* OI_MMAP */
+#endif /* OI_CONTEXT */
+
+/* guest threads run on pthreads, each in an OIContext that shares the app's RAM */
+#ifdef OI_CONTEXT
+#ifdef OI_MMAP
+#define OI_THREADS
+#endif /* OI_MMAP */
+#endif /* OI_CONTEXT */
+
+/* gcc and clang builds have 64-bit integers and a monotonic clock for the timing syscalls */
+#ifdef __GNUC__
+#define OI_TIMING
+#include <time.h>
+#endif /* __GNUC__ */
+
+/* OI_TSC means an x86 host with a time stamp counter for syscall 21, since older compilers have no defined() */
+#ifdef __x86_64__
+#define OI_TSC
+#endif /* __x86_64__ */
+#ifdef __i386__
+#define OI_TSC
+#endif /* __i386__ */
+
 #define true 1
 #define false 0
 
-int g_halted = 0;
-uint8_t * ram = 0;
-uint32_t ram_size = 0;
-uint8_t image_width;
+oi_tls int g_halted = 0;
+oi_tls uint8_t * ram = 0;
+#ifdef OI_MMAP
+oi_tls uint64_t ram_size = 0;
+#else
+oi_tls uint32_t ram_size = 0;
+#endif
+oi_tls uint8_t image_width;
+
+/* the loaded image's header and starting stack pointer, for snapshots and checkpoints */
+static oi_tls struct OIHeader g_header;
+static oi_tls oi_t g_initial_sp;
+
+/* the app's break and heap allocator. guest threads share their creator's through g_heap. see StartHeapOI() */
+
+#define HEAP_SPAN 4096
+#define HEAP_MIN_BLOCK 16
+#define HEAP_CLASSES 8          /* 16 through 2048 */
+#define HEAP_RUNS HEAP_CLASSES  /* the class index of large runs */
+#define RUN_BINS 32             /* free runs of 2^n through 2^(n+1)-1 spans are in bin n */
+#define SPAN_NONE 0             /* not the allocator's */
+#define SPAN_LARGE 0xff         /* the first span of an allocated run */
+#define SPAN_LARGE_TAIL 0xfe    /* the other spans of a run */
+#define SPAN_FREE 0xfd          /* the first span of a free run */
+#define SPAN_FREE_TAIL 0xfc     /* the last span of a free run of more than one span */
+#define SPAN_NO_RUN 0xffffffff  /* the end of a bin's list */
+#define SPAN_BLOCKS ( HEAP_SPAN / HEAP_MIN_BLOCK )  /* the most blocks a span holds */
+
+struct OIFreeList
+{
+    oi_t * items;
+    size_t count;
+    size_t capacity;
+};
+
+struct OIHeap
+{
+    oi_t brk;
+    oi_t base;         /* the initial break */
+    oi_t limit;        /* the highest the break can go */
+    oi_t floor;        /* the end of the allocator's last span */
+    oi_t span_base;    /* the address of span 0 */
+    size_t spans;      /* the count of spans the allocator has taken */
+    uint8_t * span_class;
+    uint32_t * span_run;
+    uint8_t * block_used;  /* SPAN_BLOCKS bits per span, set for the allocated blocks of a small class */
+    uint32_t * run_next;   /* the links of the free runs' head spans in their bins */
+    uint32_t * run_prev;
+    uint32_t run_bins[ RUN_BINS ];
+    struct OIFreeList free[ HEAP_CLASSES ];
+};
+
+static oi_tls struct OIHeap g_heap_state;
+static oi_tls struct OIHeap * g_heap = 0;  /* & g_heap_state once FreeHeapOI() runs, or the creator's */
+
+static char * g_snapshot_name = 0;
+#ifdef OI_CHECKPOINT
+static char * g_checkpoint_name = 0;
+static char * g_resume_name = 0;
+#endif /* OI_CHECKPOINT */
 
 #ifdef AZTECCPM
 /* note that first two arguments are reversed */
 #define memcpy( dest, src, length ) movmem( src, dest, (int) length )
 #endif
 
+#ifdef OI_CONTEXT
+static oi_tls sigjmp_buf * g_job_abort = 0;   /* while RunJobOI() runs a job, where to end just that job */
+#endif /* OI_CONTEXT */
+
+/* illegal instructions and -g faults end the app here. the signal mask is restored for faults */
+
 void OIHardTermination()
 {
+    OIFlushOutput();
+#ifdef OI_CONTEXT
+    if ( 0 != g_job_abort )
+        siglongjmp( * g_job_abort, 1 );
+#endif /* OI_CONTEXT */
     exit( 1 );
 } /* OIHardTermination */
 
-#ifdef OLDCPU
-void OISyscall( function ) size_t function;
+/*  oios -snapshot:file runs the app until it makes syscall 3 (init done), writes file as a new image whose
+    initialized data is the app's RAM at that point and whose initial pc is just after the syscall, then exits.
+    Apps that fill tables at startup make the syscall after doing so, and runs of the new image skip that work.
+    Without -snapshot the syscall does nothing. Registers aren't saved, so the app must not depend on them
+    after the syscall, and the stack must be as it was when the app started.
+*/
+
+static void WriteSnapshotOI()
+{
+    struct OIHeader h;
+    FILE * fp;
+    size_t data_end, used, i;
+    oi_t pc;
+    bool ok;
+
+    OIFlushOutput();
+
+    if ( g_oi.rsp != g_initial_sp )
+    {
+        printf( "the init done syscall was made with items on the stack; can't write a snapshot\n" );
+        exit( 1 );
+    }
+
+    memcpy( & h, & g_header, sizeof( h ) );
+    h.flags &= ~OI_FLAG_COMPRESSED; /* snapshots are written uncompressed */
+
+    /* the allocator's metadata is host memory that an image can't hold */
+    if ( 0 != g_heap->spans )
+    {
+        printf( "the app allocated memory before the init done syscall; can't write a snapshot\n" );
+        exit( 1 );
+    }
+
+    /* memory the app took with brk or sbrk becomes data, and the break starts past it */
+    data_end = (size_t) h.cbCode + h.cbInitializedData + h.cbZeroFilledData;
+    if ( (size_t) g_heap->brk > data_end )
+    {
+        data_end = (size_t) g_heap->brk;
+        if ( ( 0 != h.loRamRequired ) && ( 0 == h.hiRamRequired ) && ( data_end + h.cbStack > h.loRamRequired ) )
+            h.loRamRequired = (uint32_t) ( data_end + h.cbStack );
+    }
+
+    /* trailing zeros of the zero-filled data stay zero-filled */
+    used = data_end;
+    while ( ( used > (size_t) h.cbCode + h.cbInitializedData ) && ( 0 == ram[ used - 1 ] ) )
+        used--;
+    used = ( used + image_width - 1 ) & ~ (size_t) ( image_width - 1 );
+    if ( used > data_end )
+        used = data_end;
+
+    h.cbInitializedData = (uint32_t) ( used - h.cbCode );
+    h.cbZeroFilledData = (uint32_t) ( data_end - used );
+    pc = g_oi.rpc + 2; /* past the syscall */
+    h.loInitialPC = (uint32_t) pc;
+    h.hiInitialPC = (uint32_t) ( ( pc >> 16 ) >> 16 );
+
+#ifdef AZTECCPM
+    fp = fopen( g_snapshot_name, "w" );
 #else
-void OISyscall( size_t function )
+    fp = fopen( g_snapshot_name, "wb" );
+#endif
+    if ( !fp )
+    {
+        printf( "can't create snapshot file '%s'\n", g_snapshot_name );
+        exit( 1 );
+    }
+
+    /* a version 2 snapshot keeps the page-aligned layout */
+    ok = ( 1 == fwrite( & h, sizeof( h ), 1, fp ) );
+    for ( i = sizeof( h ); ok && ( i < oi_code_offset( h ) ); i++ )
+        ok = ( 0 == putc( 0, fp ) );
+
+    if ( !ok || ( 1 != fwrite( ram, used, 1, fp ) ) )
+    {
+        printf( "can't write snapshot file '%s'\n", g_snapshot_name );
+        fclose( fp );
+        exit( 1 );
+    }
+
+    fclose( fp );
+    exit( 0 );
+} /* WriteSnapshotOI */
+
+/*  Console output from syscalls 1 and 2 collects in a buffer rather than going through printf. The buffer is
+    written when it's full, when the app halts or terminates, and after every g_flush_lines newlines, where 0
+    means never. -flush:N sets that; by default it's 1 for a terminal and 0 otherwise. A string that doesn't fit
+    is written by writev() straight from guest RAM along with the buffer.
+*/
+
+#ifdef OI2
+#define OUTPUT_BUFFER_SIZE 256
+#else
+#define OUTPUT_BUFFER_SIZE 65536
 #endif
+
+static oi_tls char g_output[ OUTPUT_BUFFER_SIZE ];
+static oi_tls size_t g_output_len = 0;
+static oi_tls size_t g_output_lines = 0;
+static int g_flush_option = -1;
+static size_t g_flush_lines = 1;
+
+#ifdef OI_WRITEV
+static void WriteAllOI( struct iovec * iov, int count )
 {
-    switch( function )
+    ssize_t written;
+
+    while ( count > 0 )
     {
-        case 0:
+        written = writev( 1, iov, count );
+        if ( written < 0 )
         {
-            /* this results in a halt instruction, which calls OIHalt(), which sets g_halted = true */
-            g_oi.rpc = 0;
-            break;
+            if ( EINTR == errno )
+                continue;
+            return;
         }
-        case 1:
+
+        while ( ( count > 0 ) && ( (size_t) written >= iov->iov_len ) )
         {
-            printf( "%s", ram + g_oi.rarg1 );
-#ifndef NDEBUG
-            trace( "syscall string: %s\n", ram + g_oi.rarg1 );
-#endif
-            break;
+            written -= (ssize_t) iov->iov_len;
+            iov++;
+            count--;
         }
-        case 2:
+
+        if ( count > 0 )
         {
-            if ( 2 == image_width )
-            {
-                printf( "%d", (int16_t) g_oi.rarg1 );
-#ifndef NDEBUG
-                trace( "syscall integer: %d\n", (int16_t) g_oi.rarg1 );
+            iov->iov_base = (char *) iov->iov_base + written;
+            iov->iov_len -= (size_t) written;
+        }
+    }
+} /* WriteAllOI */
+#endif /* OI_WRITEV */
+
+/* call before running an app, once stdout is where its output goes */
+
+static void StartOutputOI()
+{
+    g_output_len = 0;
+    g_output_lines = 0;
+    if ( g_flush_option >= 0 )
+        g_flush_lines = (size_t) g_flush_option;
+#ifdef OI_WRITEV
+    else
+        g_flush_lines = isatty( 1 ) ? 1 : 0;
 #endif
-            }
-            else if ( 4 == image_width )
-            {
-#ifdef MSC6
-                printf( "%ld", (int32_t) g_oi.rarg1 );
-#ifndef NDEBUG
-                trace( "syscall integer: %ld\n", (int32_t) g_oi.rarg1 );
+} /* StartOutputOI */
+
+void OIFlushOutput()
+{
+#ifdef OI_WRITEV
+    struct iovec iov;
 #endif
-#else /* MSC6 */
-                printf( "%d", (int32_t) g_oi.rarg1 );
-#ifndef NDEBUG
-                trace( "syscall integer: %d\n", (int32_t) g_oi.rarg1 );
+
+    if ( 0 == g_output_len )
+        return;
+
+#ifdef OI_WRITEV
+    iov.iov_base = g_output;
+    iov.iov_len = g_output_len;
+    WriteAllOI( & iov, 1 );
+#else
+    fwrite( g_output, 1, g_output_len, stdout );
+    fflush( stdout );
 #endif
-#endif /* MSC6 */
-            }
 
-#ifdef OI8
-            else if ( 8 == image_width )
-            {
-                printf( "%lld", (int64_t) g_oi.rarg1 );
-#ifndef NDEBUG
-                trace( "syscall integer: %lld\n", (int64_t) g_oi.rarg1 );
+    g_output_len = 0;
+    g_output_lines = 0;
+} /* OIFlushOutput */
+
+#ifdef OLDCPU
+static void OutputOI( p, length ) char * p; size_t length;
+#else
+static void OutputOI( const char * p, size_t length )
 #endif
-            }
+{
+    size_t i;
+#ifdef OI_WRITEV
+    struct iovec iov[ 2 ];
+#endif
+
+    if ( length > sizeof( g_output ) - g_output_len )
+    {
+#ifdef OI_WRITEV
+        iov[ 0 ].iov_base = g_output;
+        iov[ 0 ].iov_len = g_output_len;
+        iov[ 1 ].iov_base = (char *) p;
+        iov[ 1 ].iov_len = length;
+        WriteAllOI( iov, 2 );
+        g_output_len = 0;
+        g_output_lines = 0;
+        return;
+#else
+        OIFlushOutput();
+        if ( length > sizeof( g_output ) )
+        {
+            fwrite( p, 1, length, stdout );
+            fflush( stdout );
+            return;
+        }
+#endif
+    }
+
+    memcpy( g_output + g_output_len, p, length );
+    g_output_len += length;
+
+    if ( 0 != g_flush_lines )
+    {
+        for ( i = 0; i < length; i++ )
+            if ( '\n' == p[ i ] )
+                g_output_lines++;
+        if ( g_output_lines >= g_flush_lines )
+            OIFlushOutput();
+    }
+} /* OutputOI */
+
+/* formats the integer without printf */
+
+#ifdef OLDCPU
+static void OutputIntegerOI( value ) ioi_t value;
+#else
+static void OutputIntegerOI( ioi_t value )
+#endif
+{
+    char digits[ 24 ], * p;
+    oi_t magnitude;
+
+    p = digits + sizeof( digits );
+    magnitude = ( value < 0 ) ? (oi_t) 0 - (oi_t) value : (oi_t) value;
+    do
+    {
+        * --p = (char) ( '0' + (int) ( magnitude % 10 ) );
+        magnitude /= 10;
+    } while ( 0 != magnitude );
+
+    if ( value < 0 )
+        * --p = '-';
+
+    OutputOI( p, (size_t) ( digits + sizeof( digits ) - p ) );
+} /* OutputIntegerOI */
+
+/*  Guest files. Each is a host FILE with a large buffer, so small reads and writes are copies and large ones
+    go directly between the file and guest RAM. Open files aren't saved in snapshots or checkpoints.
+*/
+
+#ifdef OI2
+#define MAX_FILES 8
+#define guest_unsigned( x ) ( x )
+#else
+#define MAX_FILES 32
+#define FILE_BUFFER_SIZE 65536
+#define guest_unsigned( x ) ( ( x ) & g_oi.address_mask )
+#endif
+
+#define FILE_ERROR ( (oi_t) -1 )
+
+static oi_tls FILE * g_files[ MAX_FILES ];
+
+#ifdef OLDCPU
+static ioi_t GuestSignedOI( x ) oi_t x;
+#else
+static ioi_t GuestSignedOI( oi_t x )
+#endif
+{
+    if ( 2 == image_width )
+        return (ioi_t) (int16_t) x;
+#ifndef OI2
+    if ( 4 == image_width )
+        return (ioi_t) (int32_t) x;
+#endif
+    return (ioi_t) x;
+} /* GuestSignedOI */
+
+#ifdef OLDCPU
+static bool GuestBufferOI( address, length ) oi_t address; oi_t length;
+#else
+static bool GuestBufferOI( oi_t address, oi_t length )
+#endif
+{
+    return ( address <= ram_size ) && ( length <= ram_size - address );
+} /* GuestBufferOI */
+
+/* fd 1 goes through the console buffer, so it has no FILE here */
+
+#ifdef OLDCPU
+static FILE * GuestFileOI( fd ) oi_t fd;
+#else
+static FILE * GuestFileOI( oi_t fd )
+#endif
+{
+    if ( 0 == fd )
+        return stdin;
+    if ( 2 == fd )
+        return stderr;
+    if ( ( fd >= 3 ) && ( fd < MAX_FILES ) )
+        return g_files[ fd ];
+    return 0;
+} /* GuestFileOI */
+
+#ifdef OLDCPU
+static oi_t OpenFileOI( name, mode ) oi_t name; oi_t mode;
+#else
+static oi_t OpenFileOI( oi_t name, oi_t mode )
 #endif
+{
+    static const char * modes[ 4 ] = { "rb", "wb", "ab", "r+b" };
+    char path[ 256 ];
+    size_t i;
+    int fd;
+
+    for ( i = 0; ; i++ )
+    {
+        if ( ( i >= sizeof( path ) ) || ( name >= ram_size ) || ( i >= ram_size - name ) )
+            return FILE_ERROR;
+        path[ i ] = (char) ram[ name + i ];
+        if ( 0 == path[ i ] )
             break;
+    }
+
+    if ( mode >= 4 )
+        return FILE_ERROR;
+
+    for ( fd = 3; ( fd < MAX_FILES ) && ( 0 != g_files[ fd ] ); fd++ )
+        continue;
+    if ( MAX_FILES == fd )
+        return FILE_ERROR;
+
+    g_files[ fd ] = fopen( path, modes[ mode ] );
+    if ( 0 == g_files[ fd ] )
+        return FILE_ERROR;
+
+#ifdef FILE_BUFFER_SIZE
+    setvbuf( g_files[ fd ], 0, _IOFBF, FILE_BUFFER_SIZE );
+#endif
+    return (oi_t) fd;
+} /* OpenFileOI */
+
+#ifdef OLDCPU
+static oi_t ReadFileOI( fd, address, length ) oi_t fd; oi_t address; oi_t length;
+#else
+static oi_t ReadFileOI( oi_t fd, oi_t address, oi_t length )
+#endif
+{
+    FILE * fp;
+    size_t got;
+#ifdef OI_MMAP
+    ssize_t count;
+#endif
+
+    fp = GuestFileOI( fd );
+    if ( ( 0 == fp ) || ( stderr == fp ) || !GuestBufferOI( address, length ) )
+        return FILE_ERROR;
+
+    /* a prompt the app printed has to show before it waits for input */
+    if ( stdin == fp )
+        OIFlushOutput();
+
+#ifdef OI_MMAP
+    /* the kernel can't write to pages that are protected to track dirty pages */
+    MarkDirtyOI( (uint64_t) address, (uint64_t) length );
+
+    /* fread() would wait to fill the length, but a line typed at a terminal should come back as a short read */
+    if ( stdin == fp )
+    {
+        do
+            count = read( 0, ram + address, (size_t) length );
+        while ( ( count < 0 ) && ( EINTR == errno ) );
+        if ( count < 0 )
+            return FILE_ERROR;
+        got = (size_t) count;
+    }
+    else
+#endif
+    got = fread( ram + address, 1, (size_t) length, fp );
+#ifdef OI_PREDECODE
+    if ( 0 != got )
+        InvalidateCodeOI( address, (oi_t) got );
+#endif
+
+    if ( ( got < (size_t) length ) && ferror( fp ) )
+    {
+        clearerr( fp );
+        if ( 0 == got )
+            return FILE_ERROR;
+    }
+
+    return (oi_t) got;
+} /* ReadFileOI */
+
+#ifdef OLDCPU
+static oi_t WriteFileOI( fd, address, length ) oi_t fd; oi_t address; oi_t length;
+#else
+static oi_t WriteFileOI( oi_t fd, oi_t address, oi_t length )
+#endif
+{
+    FILE * fp;
+    size_t written;
+
+    if ( !GuestBufferOI( address, length ) )
+        return FILE_ERROR;
+
+    if ( 1 == fd )
+    {
+        OutputOI( (char *) ram + address, (size_t) length );
+        return length;
+    }
+
+    fp = GuestFileOI( fd );
+    if ( ( 0 == fp ) || ( stdin == fp ) )
+        return FILE_ERROR;
+
+    written = fwrite( ram + address, 1, (size_t) length, fp );
+    if ( ( 0 == written ) && ( 0 != length ) )
+        return FILE_ERROR;
+    return (oi_t) written;
+} /* WriteFileOI */
+
+#ifdef OLDCPU
+static oi_t CloseFileOI( fd ) oi_t fd;
+#else
+static oi_t CloseFileOI( oi_t fd )
+#endif
+{
+    FILE * fp;
+
+    if ( ( fd < 3 ) || ( fd >= MAX_FILES ) || ( 0 == g_files[ fd ] ) )
+        return FILE_ERROR;
+
+    fp = g_files[ fd ];
+    g_files[ fd ] = 0;
+    return ( 0 == fclose( fp ) ) ? 0 : FILE_ERROR;
+} /* CloseFileOI */
+
+#ifdef OLDCPU
+static oi_t SeekFileOI( fd, offset, origin ) oi_t fd; oi_t offset; oi_t origin;
+#else
+static oi_t SeekFileOI( oi_t fd, oi_t offset, oi_t origin )
+#endif
+{
+    FILE * fp;
+    long position;
+
+    fp = GuestFileOI( fd );
+    if ( ( 0 == fp ) || ( stderr == fp ) || ( origin > 2 ) )
+        return FILE_ERROR;
+
+    if ( 0 != fseek( fp, (long) GuestSignedOI( offset ), ( 0 == origin ) ? SEEK_SET : ( 1 == origin ) ? SEEK_CUR : SEEK_END ) )
+        return FILE_ERROR;
+
+    position = ftell( fp );
+    return ( position < 0 ) ? FILE_ERROR : (oi_t) position;
+} /* SeekFileOI */
+
+#ifdef OI_MMAP
+
+/*  Guest file mappings. Syscall 9 maps part of an open file into the space MapFileOI() manages past the end of
+    guest RAM, so 8-byte apps can scan large files without copying them in with reads. Mappings are placed first
+    fit and aren't saved in snapshots or checkpoints.
+*/
+
+#define MAX_MAPS 64
+#define MAP_PAGE_SIZE 4096 /* oi.c's page size */
+
+struct OIFileMap
+{
+    uint64_t address; /* page-aligned guest address */
+    uint64_t length;  /* 0 if the entry is free */
+};
+
+static oi_tls struct OIFileMap g_maps[ MAX_MAPS ];
+
+static oi_t MapGuestFileOI( oi_t fd, oi_t offset, oi_t length, oi_t mode )
+{
+    struct stat st;
+    FILE * fp;
+    uint64_t space, space_length, delta, address, size;
+    int i, j;
+    bool moved;
+
+    fp = GuestFileOI( fd );
+    if ( ( fd < 3 ) || ( 0 == fp ) || ( mode > 1 ) || !MapSpaceOI( & space, & space_length ) )
+        return FILE_ERROR;
+
+    /* the mapping has to see what the app wrote */
+    if ( 0 != fflush( fp ) )
+        return FILE_ERROR;
+
+    if ( 0 == length )
+    {
+        if ( ( 0 != fstat( fileno( fp ), & st ) ) || ( (uint64_t) st.st_size <= (uint64_t) offset ) )
+            return FILE_ERROR;
+        length = (oi_t) ( st.st_size - offset );
+    }
+
+    delta = offset % MAP_PAGE_SIZE;
+    size = ( delta + length + MAP_PAGE_SIZE - 1 ) & ~ ( MAP_PAGE_SIZE - 1 );
+    if ( size < length )
+        return FILE_ERROR;
+
+    for ( i = 0; ( i < MAX_MAPS ) && ( 0 != g_maps[ i ].length ); i++ )
+        continue;
+    if ( MAX_MAPS == i )
+        return FILE_ERROR;
+
+    address = space;
+    do
+    {
+        moved = false;
+        for ( j = 0; j < MAX_MAPS; j++ )
+        {
+            if ( ( 0 != g_maps[ j ].length ) && ( address < g_maps[ j ].address + g_maps[ j ].length ) &&
+                 ( g_maps[ j ].address < address + size ) )
+            {
+                address = g_maps[ j ].address + g_maps[ j ].length;
+                moved = true;
+            }
+        }
+    } while ( moved );
+
+    if ( ( size > space_length ) || ( address - space > space_length - size ) ||
+         !MapFileOI( fileno( fp ), offset - delta, address, size, 1 == mode ) )
+        return FILE_ERROR;
+
+    g_maps[ i ].address = address;
+    g_maps[ i ].length = size;
+    return (oi_t) ( address + delta );
+} /* MapGuestFileOI */
+
+/* address is what syscall 9 returned */
+
+static oi_t UnmapGuestFileOI( oi_t address )
+{
+    int i;
+
+    for ( i = 0; i < MAX_MAPS; i++ )
+    {
+        if ( ( 0 != g_maps[ i ].length ) && ( address >= g_maps[ i ].address ) && ( address - g_maps[ i ].address < MAP_PAGE_SIZE ) )
+        {
+            UnmapFileOI( g_maps[ i ].address, g_maps[ i ].length );
+            g_maps[ i ].length = 0;
+            return 0;
         }
-        default: { printf( "unhandled syscall!\n" ); break; }
     }
-} /* OISyscall */
 
-void OIHalt()
+    return FILE_ERROR;
+} /* UnmapGuestFileOI */
+
+#ifdef OI_CHECKPOINT
+
+static bool FilesMappedOI()
+{
+    int i;
+
+    for ( i = 0; i < MAX_MAPS; i++ )
+        if ( 0 != g_maps[ i ].length )
+            return true;
+    return false;
+} /* FilesMappedOI */
+
+#endif /* OI_CHECKPOINT */
+
+#endif /* OI_MMAP */
+
+#ifdef OI_AIO
+
+/*  Asynchronous I/O. The app sets up a completion ring in its RAM with syscall 11, then posts reads and writes
+    with syscall 12 and carries on. A pool of AIO_THREADS host threads does the I/O with pread() and pwrite() at
+    the request's offset, bypassing the FILE's buffer, and appends { tag, result } to the ring. The app polls the
+    ring itself and only makes syscall 13 to wait. Words are the image width:
+
+        ring:     head, tail, then entries * { tag, result }. the app consumes at head, the host appends at tail.
+                  both count up and wrap at the image width, and entries is a power of 2
+        request:  op (0 read, 1 write), fd, buffer, length, offset, tag
+
+    Submissions fail while the completions in flight and unconsumed would overflow the ring. Writes to files
+    opened for append (mode 2) fail too, since pwrite() ignores the offset there. Buffers mustn't be code, and neither the ring nor requests in flight are saved in snapshots or checkpoints.
+*/
+
+#define AIO_THREADS 4
+
+struct OIAioRequest
+{
+    struct OIAioRequest * next;
+    struct OIAio * aio;
+    int fd;
+    bool write;
+    uint8_t * buffer;
+    size_t length;
+    off_t offset;
+    oi_t tag;
+};
+
+struct OIAio
+{
+    uint8_t * ring;   /* host address of the ring's head word, or 0 */
+    oi_t entries;
+    oi_t in_flight;   /* changed with g_aio_lock held */
+    uint8_t width;
+};
+
+static pthread_mutex_t g_aio_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_aio_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_aio_done = PTHREAD_COND_INITIALIZER;
+static struct OIAioRequest * g_aio_first = 0;
+static struct OIAioRequest * g_aio_last = 0;
+static pid_t g_aio_pid = 0; /* the process whose pool is running. forks start their own */
+static oi_tls struct OIAio g_aio;
+
+static oi_t GetWordOI( uint8_t * p, uint8_t width )
+{
+    uint16_t w;
+    uint32_t d;
+    uint64_t q;
+
+    if ( 2 == width )
+    {
+        memcpy( & w, p, sizeof( w ) );
+        return (oi_t) w;
+    }
+    if ( 4 == width )
+    {
+        memcpy( & d, p, sizeof( d ) );
+        return (oi_t) d;
+    }
+    memcpy( & q, p, sizeof( q ) );
+    return (oi_t) q;
+} /* GetWordOI */
+
+static void SetWordOI( uint8_t * p, uint8_t width, oi_t value )
+{
+    uint16_t w;
+    uint32_t d;
+    uint64_t q;
+
+    if ( 2 == width )
+    {
+        w = (uint16_t) value;
+        memcpy( p, & w, sizeof( w ) );
+    }
+    else if ( 4 == width )
+    {
+        d = (uint32_t) value;
+        memcpy( p, & d, sizeof( d ) );
+    }
+    else
+    {
+        q = (uint64_t) value;
+        memcpy( p, & q, sizeof( q ) );
+    }
+} /* SetWordOI */
+
+/* completions the app hasn't consumed yet */
+
+static oi_t AioAvailableOI( struct OIAio * aio )
+{
+    oi_t mask;
+
+    mask = ( 2 == aio->width ) ? (oi_t) 0xffff : ( 4 == aio->width ) ? (oi_t) 0xffffffff : (oi_t) -1;
+    return ( GetWordOI( aio->ring + aio->width, aio->width ) - GetWordOI( aio->ring, aio->width ) ) & mask;
+} /* AioAvailableOI */
+
+static void * AioWorkerOI( void * p )
+{
+    struct OIAioRequest * request;
+    struct OIAio * aio;
+    ssize_t done, total;
+    oi_t tail;
+    uint8_t * entry;
+
+    for ( ;; )
+    {
+        pthread_mutex_lock( & g_aio_lock );
+        while ( 0 == g_aio_first )
+            pthread_cond_wait( & g_aio_work, & g_aio_lock );
+        request = g_aio_first;
+        g_aio_first = request->next;
+        if ( 0 == g_aio_first )
+            g_aio_last = 0;
+        pthread_mutex_unlock( & g_aio_lock );
+
+        total = 0;
+        while ( (size_t) total < request->length )
+        {
+            if ( request->write )
+                done = pwrite( request->fd, request->buffer + total, request->length - (size_t) total, request->offset + total );
+            else
+                done = pread( request->fd, request->buffer + total, request->length - (size_t) total, request->offset + total );
+            if ( done < 0 && EINTR == errno )
+                continue;
+            if ( done <= 0 )
+            {
+                if ( 0 == total && done < 0 )
+                    total = -1;
+                break;
+            }
+            total += done;
+        }
+
+        /* the entry is written before the tail so an app polling the tail sees a complete entry */
+        aio = request->aio;
+        pthread_mutex_lock( & g_aio_lock );
+        tail = GetWordOI( aio->ring + aio->width, aio->width );
+        entry = aio->ring + aio->width * ( 2 + 2 * (size_t) ( tail & ( aio->entries - 1 ) ) );
+        SetWordOI( entry, aio->width, request->tag );
+        SetWordOI( entry + aio->width, aio->width, (oi_t) total );
+        __atomic_thread_fence( __ATOMIC_RELEASE );
+        SetWordOI( aio->ring + aio->width, aio->width, tail + 1 );
+        aio->in_flight--;
+        pthread_cond_broadcast( & g_aio_done );
+        pthread_mutex_unlock( & g_aio_lock );
+        free( request );
+    }
+
+    return p;
+} /* AioWorkerOI */
+
+/* syscall 11 */
+
+static oi_t AioRingOI( oi_t address, oi_t entries )
+{
+    oi_t words;
+
+    words = 2 + 2 * entries;
+    if ( ( 0 == entries ) || ( 0 != ( entries & ( entries - 1 ) ) ) || ( words < entries ) ||
+         ( 0 != ( address % image_width ) ) || !GuestBufferOI( address, words * image_width ) || ( words * image_width < words ) )
+        return FILE_ERROR;
+
+    /* the pool writes completions to the ring with the lock held */
+    pthread_mutex_lock( & g_aio_lock );
+    if ( 0 != g_aio.in_flight )
+    {
+        pthread_mutex_unlock( & g_aio_lock );
+        return FILE_ERROR;
+    }
+
+#ifdef OI_MMAP
+    MarkDirtyOI( (uint64_t) address, (uint64_t) words * image_width );
+#endif
+    g_aio.ring = ram + address;
+    g_aio.entries = entries;
+    g_aio.width = image_width;
+    SetWordOI( g_aio.ring, image_width, 0 );
+    SetWordOI( g_aio.ring + image_width, image_width, 0 );
+    pthread_mutex_unlock( & g_aio_lock );
+    return 0;
+} /* AioRingOI */
+
+/* syscall 12 */
+
+static oi_t AioSubmitOI( oi_t address )
+{
+    struct OIAioRequest * request;
+    pthread_t thread;
+    uint8_t * p;
+    FILE * fp;
+    oi_t op, fd, buffer, length, offset;
+    int i;
+
+    if ( ( 0 == g_aio.ring ) || !GuestBufferOI( address, 6 * (oi_t) image_width ) )
+        return FILE_ERROR;
+
+    p = ram + address;
+    op = GetWordOI( p, image_width );
+    fd = GetWordOI( p + image_width, image_width );
+    buffer = GetWordOI( p + 2 * image_width, image_width );
+    length = GetWordOI( p + 3 * image_width, image_width );
+    offset = GetWordOI( p + 4 * image_width, image_width );
+
+    fp = GuestFileOI( fd );
+    if ( ( op > 1 ) || ( fd < 3 ) || ( 0 == fp ) || !GuestBufferOI( buffer, length ) || ( 0 != fflush( fp ) ) )
+        return FILE_ERROR;
+    if ( ( 1 == op ) && ( 0 != ( fcntl( fileno( fp ), F_GETFL ) & O_APPEND ) ) )
+        return FILE_ERROR;
+
+    request = (struct OIAioRequest *) calloc( 1, sizeof( struct OIAioRequest ) );
+    if ( 0 == request )
+        return FILE_ERROR;
+
+    request->aio = & g_aio;
+    request->fd = fileno( fp );
+    request->write = ( 1 == op );
+    request->buffer = ram + buffer;
+    request->length = (size_t) length;
+    request->offset = (off_t) offset;
+    request->tag = GetWordOI( p + 5 * image_width, image_width );
+
+#ifdef OI_MMAP
+    /* the kernel and the pool can't fault in pages protected for dirty tracking */
+    if ( !request->write )
+        MarkDirtyOI( (uint64_t) buffer, (uint64_t) length );
+    MarkDirtyOI( (uint64_t) ( g_aio.ring - ram ), (uint64_t) ( 2 + 2 * g_aio.entries ) * image_width );
+#endif
+
+    pthread_mutex_lock( & g_aio_lock );
+    if ( g_aio.in_flight + AioAvailableOI( & g_aio ) >= g_aio.entries )
+    {
+        pthread_mutex_unlock( & g_aio_lock );
+        free( request );
+        return FILE_ERROR;
+    }
+
+    if ( getpid() != g_aio_pid )
+    {
+        g_aio_pid = getpid();
+        for ( i = 0; i < AIO_THREADS; i++ )
+            if ( 0 == pthread_create( & thread, 0, AioWorkerOI, 0 ) )
+                pthread_detach( thread );
+    }
+
+    g_aio.in_flight++;
+    if ( 0 == g_aio_last )
+        g_aio_first = request;
+    else
+        g_aio_last->next = request;
+    g_aio_last = request;
+    pthread_cond_signal( & g_aio_work );
+    pthread_mutex_unlock( & g_aio_lock );
+    return 0;
+} /* AioSubmitOI */
+
+/* syscall 13. waits for at least count unconsumed completions or until nothing is in flight */
+
+static oi_t AioWaitOI( oi_t count )
+{
+    oi_t available;
+
+    if ( 0 == g_aio.ring )
+        return FILE_ERROR;
+
+    pthread_mutex_lock( & g_aio_lock );
+    while ( ( AioAvailableOI( & g_aio ) < count ) && ( 0 != g_aio.in_flight ) )
+        pthread_cond_wait( & g_aio_done, & g_aio_lock );
+    available = AioAvailableOI( & g_aio );
+    pthread_mutex_unlock( & g_aio_lock );
+    return available;
+} /* AioWaitOI */
+
+/* waits for the app's requests to finish, since its RAM and files are about to go */
+
+static void AioDrainOI()
+{
+    pthread_mutex_lock( & g_aio_lock );
+    while ( 0 != g_aio.in_flight )
+        pthread_cond_wait( & g_aio_done, & g_aio_lock );
+    pthread_mutex_unlock( & g_aio_lock );
+    g_aio.ring = 0;
+} /* AioDrainOI */
+
+#endif /* OI_AIO */
+
+/* the app's files are closed and unmapped when it halts */
+
+static void CloseFilesOI()
+{
+    int fd;
+
+#ifdef OI_AIO
+    AioDrainOI();
+#endif /* OI_AIO */
+
+    for ( fd = 3; fd < MAX_FILES; fd++ )
+        CloseFileOI( (oi_t) fd );
+
+#ifdef OI_MMAP
+    for ( fd = 0; fd < MAX_MAPS; fd++ )
+    {
+        if ( 0 != g_maps[ fd ].length )
+        {
+            UnmapFileOI( g_maps[ fd ].address, g_maps[ fd ].length );
+            g_maps[ fd ].length = 0;
+        }
+    }
+#endif /* OI_MMAP */
+} /* CloseFilesOI */
+
+/*  The guest heap. The break starts just past the zero-filled data, rounded up to the image width, and can
+    grow to cbStack bytes below the top of the stack. Syscalls 14 and 15 move it like brk and sbrk.
+
+    Syscalls 16-18 are malloc, free, and realloc from a size-class allocator whose metadata is all host memory,
+    so each costs the app one instruction. The allocator takes HEAP_SPAN byte spans from the break. A span
+    either holds blocks of one small class (16 bytes up to half a span, in powers of 2) or is part of a run of
+    spans for one large block. Per span, span_class has the class and span_run the run length. Free small
+    blocks are on host stacks of guest addresses, one per class, so allocating pops and freeing pushes in O(1).
+    Free runs are on doubly linked lists in RUN_BINS power-of-2 bins. A large allocation takes the first fit
+    in its own bin or the head of a larger bin, so it checks at most RUN_BINS bins plus the runs of its own
+    size range, and splits off the excess. A freed run merges with free neighbours in O(1) using the head and
+    tail marks. block_used and the SPAN_LARGE and SPAN_FREE classes of runs say which blocks are allocated,
+    so freeing a block twice or an address that was never allocated returns -1 instead of corrupting the lists.
+    The break can't be moved below the allocator's last span.
+*/
+
+/* resets the calling thread's own heap */
+
+static void FreeHeapOI()
+{
+    int i;
+
+    g_heap = & g_heap_state;
+    free( g_heap->span_class );
+    free( g_heap->span_run );
+    free( g_heap->block_used );
+    free( g_heap->run_next );
+    free( g_heap->run_prev );
+    g_heap->span_class = 0;
+    g_heap->span_run = 0;
+    g_heap->block_used = 0;
+    g_heap->run_next = 0;
+    g_heap->run_prev = 0;
+    g_heap->spans = 0;
+    for ( i = 0; i < RUN_BINS; i++ )
+        g_heap->run_bins[ i ] = SPAN_NO_RUN;
+    for ( i = 0; i < HEAP_CLASSES; i++ )
+    {
+        free( g_heap->free[ i ].items );
+        g_heap->free[ i ].items = 0;
+        g_heap->free[ i ].count = 0;
+        g_heap->free[ i ].capacity = 0;
+    }
+} /* FreeHeapOI */
+
+/* call after ResetOI() with the address just above the stack */
+
+#ifdef OLDCPU
+static void StartHeapOI( stack_top ) oi_t stack_top;
+#else
+static void StartHeapOI( oi_t stack_top )
+#endif
+{
+    FreeHeapOI();
+    g_heap->base = (oi_t) g_header.cbCode + (oi_t) g_header.cbInitializedData + (oi_t) g_header.cbZeroFilledData;
+    g_heap->base = ( g_heap->base + image_width - 1 ) & ~ (oi_t) ( image_width - 1 );
+    g_heap->limit = ( stack_top - g_heap->base > (oi_t) g_header.cbStack ) ? stack_top - (oi_t) g_header.cbStack : g_heap->base;
+    g_heap->brk = g_heap->base;
+    g_heap->floor = g_heap->base;
+    g_heap->span_base = ( g_heap->base + HEAP_SPAN - 1 ) & ~ (oi_t) ( HEAP_SPAN - 1 );
+} /* StartHeapOI */
+
+/* syscall 14. 0 returns the break */
+
+#ifdef OLDCPU
+static oi_t SetBreakOI( address ) oi_t address;
+#else
+static oi_t SetBreakOI( oi_t address )
+#endif
+{
+    if ( 0 == address )
+        return g_heap->brk;
+
+    if ( ( address < g_heap->floor ) || ( address > g_heap->limit ) )
+        return FILE_ERROR;
+
+    g_heap->brk = address;
+    return g_heap->brk;
+} /* SetBreakOI */
+
+/* syscall 15. returns the old break */
+
+#ifdef OLDCPU
+static oi_t MoveBreakOI( increment ) oi_t increment;
+#else
+static oi_t MoveBreakOI( oi_t increment )
+#endif
+{
+    ioi_t delta;
+    oi_t old;
+
+    delta = GuestSignedOI( increment );
+    old = g_heap->brk;
+    if ( ( delta > 0 ) ? ( (oi_t) delta > g_heap->limit - g_heap->brk ) : ( (oi_t) -delta > g_heap->brk - g_heap->floor ) )
+        return FILE_ERROR;
+
+    g_heap->brk += (oi_t) delta;
+    return old;
+} /* MoveBreakOI */
+
+#ifdef OLDCPU
+static bool PushFreeOI( list, address ) struct OIFreeList * list; oi_t address;
+#else
+static bool PushFreeOI( struct OIFreeList * list, oi_t address )
+#endif
+{
+    oi_t * items;
+    size_t capacity;
+
+    if ( list->count == list->capacity )
+    {
+        capacity = ( 0 == list->capacity ) ? 64 : 2 * list->capacity;
+        items = (oi_t *) realloc( list->items, capacity * sizeof( oi_t ) );
+        if ( 0 == items )
+            return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+
+    list->items[ list->count++ ] = address;
+    return true;
+} /* PushFreeOI */
+
+/* takes count spans from the break. returns the first span's index or -1 */
+
+#ifdef OLDCPU
+static long NewSpansOI( count, kind ) size_t count; uint8_t kind;
+#else
+static long NewSpansOI( size_t count, uint8_t kind )
+#endif
+{
+    oi_t start;
+    size_t first, i, needed;
+    uint8_t * classes, * used;
+    uint32_t * runs, * links;
+
+    start = ( g_heap->brk + HEAP_SPAN - 1 ) & ~ (oi_t) ( HEAP_SPAN - 1 );
+    if ( ( start < g_heap->brk ) || ( start > g_heap->limit ) || ( count > (size_t) ( ( g_heap->limit - start ) / HEAP_SPAN ) ) )
+        return -1;
+
+    first = (size_t) ( ( start - g_heap->span_base ) / HEAP_SPAN );
+    needed = first + count;
+    if ( needed > g_heap->spans )
+    {
+        if ( needed < 2 * g_heap->spans )
+            needed = 2 * g_heap->spans;
+        classes = (uint8_t *) realloc( g_heap->span_class, needed );
+        if ( 0 == classes )
+            return -1;
+        g_heap->span_class = classes;
+        runs = (uint32_t *) realloc( g_heap->span_run, needed * sizeof( uint32_t ) );
+        if ( 0 == runs )
+            return -1;
+        g_heap->span_run = runs;
+        used = (uint8_t *) realloc( g_heap->block_used, needed * ( SPAN_BLOCKS / 8 ) );
+        if ( 0 == used )
+            return -1;
+        g_heap->block_used = used;
+        links = (uint32_t *) realloc( g_heap->run_next, needed * sizeof( uint32_t ) );
+        if ( 0 == links )
+            return -1;
+        g_heap->run_next = links;
+        links = (uint32_t *) realloc( g_heap->run_prev, needed * sizeof( uint32_t ) );
+        if ( 0 == links )
+            return -1;
+        g_heap->run_prev = links;
+        memset( g_heap->span_class + g_heap->spans, SPAN_NONE, needed - g_heap->spans );
+        memset( g_heap->span_run + g_heap->spans, 0, ( needed - g_heap->spans ) * sizeof( uint32_t ) );
+        memset( g_heap->block_used + g_heap->spans * ( SPAN_BLOCKS / 8 ), 0, ( needed - g_heap->spans ) * ( SPAN_BLOCKS / 8 ) );
+        g_heap->spans = needed;
+    }
+
+    for ( i = 0; i < count; i++ )
+        g_heap->span_class[ first + i ] = ( SPAN_LARGE == kind && 0 != i ) ? SPAN_LARGE_TAIL : kind;
+    g_heap->span_run[ first ] = (uint32_t) count;
+
+    g_heap->brk = start + (oi_t) count * HEAP_SPAN;
+    g_heap->floor = g_heap->brk;
+    return (long) first;
+} /* NewSpansOI */
+
+#define span_address( span ) ( g_heap->span_base + (oi_t) ( span ) * HEAP_SPAN )
+#define span_of( address ) ( (size_t) ( ( ( address ) - g_heap->span_base ) / HEAP_SPAN ) )
+
+/* the byte of block_used holding the bit of the small block at address, whose class has block bytes per block */
+
+#ifdef OLDCPU
+static uint8_t * BlockUsedOI( address, block, pmask ) oi_t address; oi_t block; uint8_t * pmask;
+#else
+static uint8_t * BlockUsedOI( oi_t address, oi_t block, uint8_t * pmask )
+#endif
+{
+    size_t span, index;
+
+    span = span_of( address );
+    index = (size_t) ( ( address - span_address( span ) ) / block );
+    * pmask = (uint8_t) ( 1 << ( index % 8 ) );
+    return g_heap->block_used + span * ( SPAN_BLOCKS / 8 ) + index / 8;
+} /* BlockUsedOI */
+
+/* the bin of free runs of length spans */
+
+#ifdef OLDCPU
+static int RunBinOI( length ) size_t length;
+#else
+static int RunBinOI( size_t length )
+#endif
+{
+    int bin;
+
+    for ( bin = 0; ( bin < RUN_BINS - 1 ) && ( length > 1 ); bin++ )
+        length >>= 1;
+    return bin;
+} /* RunBinOI */
+
+#ifdef OLDCPU
+static void UnlinkRunOI( span ) size_t span;
+#else
+static void UnlinkRunOI( size_t span )
+#endif
+{
+    uint32_t next, prev;
+
+    next = g_heap->run_next[ span ];
+    prev = g_heap->run_prev[ span ];
+    if ( SPAN_NO_RUN == prev )
+        g_heap->run_bins[ RunBinOI( g_heap->span_run[ span ] ) ] = next;
+    else
+        g_heap->run_next[ prev ] = next;
+    if ( SPAN_NO_RUN != next )
+        g_heap->run_prev[ next ] = prev;
+} /* UnlinkRunOI */
+
+/* marks the length spans at span as a free run and puts it in its bin */
+
+#ifdef OLDCPU
+static void FreeRunOI( span, length ) size_t span; size_t length;
+#else
+static void FreeRunOI( size_t span, size_t length )
+#endif
+{
+    uint32_t * pbin;
+
+    g_heap->span_class[ span ] = SPAN_FREE;
+    g_heap->span_run[ span ] = (uint32_t) length;
+    if ( length > 1 )
+    {
+        g_heap->span_class[ span + length - 1 ] = SPAN_FREE_TAIL;
+        g_heap->span_run[ span + length - 1 ] = (uint32_t) length;
+    }
+
+    pbin = & g_heap->run_bins[ RunBinOI( length ) ];
+    g_heap->run_next[ span ] = * pbin;
+    g_heap->run_prev[ span ] = SPAN_NO_RUN;
+    if ( SPAN_NO_RUN != * pbin )
+        g_heap->run_prev[ * pbin ] = (uint32_t) span;
+    * pbin = (uint32_t) span;
+} /* FreeRunOI */
+
+/* syscall 16. returns 0 if there's no room */
+
+#ifdef OLDCPU
+static oi_t AllocateOI( size ) oi_t size;
+#else
+static oi_t AllocateOI( oi_t size )
+#endif
+{
+    struct OIFreeList * list;
+    oi_t block, address;
+    size_t count, i, span;
+    uint32_t run;
+    long first;
+    uint8_t * pused, mask;
+    int c, bin;
+
+    for ( c = 0, block = HEAP_MIN_BLOCK; ( c < HEAP_CLASSES ) && ( size > block ); c++ )
+        block <<= 1;
+
+    if ( c < HEAP_CLASSES )
+    {
+        list = & g_heap->free[ c ];
+        if ( 0 == list->count )
+        {
+            first = NewSpansOI( 1, (uint8_t) ( c + 1 ) );
+            if ( first < 0 )
+                return 0;
+
+            /* the lowest address is handed out first */
+            address = span_address( first );
+            for ( i = HEAP_SPAN / (size_t) block; i > 0; i-- )
+                if ( !PushFreeOI( list, address + (oi_t) ( i - 1 ) * block ) )
+                    return 0;
+        }
+        address = list->items[ --list->count ];
+        pused = BlockUsedOI( address, block, & mask );
+        * pused |= mask;
+        return address;
+    }
+
+    /* a large block is a run of spans. take the first fit in its bin, else any run from a larger bin */
+    count = (size_t) ( size / HEAP_SPAN ) + ( ( 0 != size % HEAP_SPAN ) ? 1 : 0 );
+    if ( ( 0 == count ) || ( count != (uint32_t) count ) )
+        return 0;
+
+    bin = RunBinOI( count );
+    for ( run = g_heap->run_bins[ bin ]; ( SPAN_NO_RUN != run ) && ( g_heap->span_run[ run ] < count ); run = g_heap->run_next[ run ] )
+        continue;
+    while ( ( SPAN_NO_RUN == run ) && ( ++bin < RUN_BINS ) )
+        run = g_heap->run_bins[ bin ];
+
+    if ( SPAN_NO_RUN == run )
+    {
+        first = NewSpansOI( count, SPAN_LARGE );
+        return ( first < 0 ) ? 0 : span_address( first );
+    }
+
+    span = run;
+    UnlinkRunOI( span );
+    if ( g_heap->span_run[ span ] > count )
+        FreeRunOI( span + count, g_heap->span_run[ span ] - count );
+    g_heap->span_class[ span ] = SPAN_LARGE;
+    g_heap->span_run[ span ] = (uint32_t) count;
+    for ( i = 1; i < count; i++ )
+        g_heap->span_class[ span + i ] = SPAN_LARGE_TAIL;
+    return span_address( span );
+} /* AllocateOI */
+
+/* returns the usable size of the allocated block at address or 0 if it isn't one. sets the class index */
+
+#ifdef OLDCPU
+static oi_t BlockSizeOI( address, pclass ) oi_t address; int * pclass;
+#else
+static oi_t BlockSizeOI( oi_t address, int * pclass )
+#endif
+{
+    size_t span;
+    uint8_t kind, mask;
+    oi_t block;
+
+    if ( ( address < g_heap->span_base ) || ( address >= g_heap->floor ) )
+        return 0;
+
+    span = span_of( address );
+    if ( span >= g_heap->spans )
+        return 0;
+
+    kind = g_heap->span_class[ span ];
+    if ( SPAN_LARGE == kind )
+    {
+        * pclass = HEAP_RUNS;
+        return ( address == span_address( span ) ) ? (oi_t) g_heap->span_run[ span ] * HEAP_SPAN : 0;
+    }
+
+    if ( ( SPAN_NONE == kind ) || ( kind > HEAP_CLASSES ) )
+        return 0;
+
+    * pclass = kind - 1;
+    block = (oi_t) HEAP_MIN_BLOCK << ( kind - 1 );
+    if ( 0 != ( address - span_address( span ) ) % block )
+        return 0;
+    return ( * BlockUsedOI( address, block, & mask ) & mask ) ? block : 0;
+} /* BlockSizeOI */
+
+/* syscall 17 */
+
+#ifdef OLDCPU
+static oi_t FreeOI( address ) oi_t address;
+#else
+static oi_t FreeOI( oi_t address )
+#endif
+{
+    oi_t block;
+    uint8_t * pused, mask;
+    size_t span, length, end;
+    int c;
+
+    if ( 0 == address )
+        return 0;
+
+    block = BlockSizeOI( address, & c );
+    if ( 0 == block )
+        return FILE_ERROR;
+
+    if ( HEAP_RUNS != c )
+    {
+        if ( !PushFreeOI( & g_heap->free[ c ], address ) )
+            return FILE_ERROR;
+        pused = BlockUsedOI( address, block, & mask );
+        * pused &= (uint8_t) ~ mask;
+        return 0;
+    }
+
+    /* merge the run with the free runs on either side. the spans that stop being ends become interior */
+    span = span_of( address );
+    length = g_heap->span_run[ span ];
+    end = span + length;
+    if ( ( end < g_heap->spans ) && ( SPAN_FREE == g_heap->span_class[ end ] ) )
+    {
+        UnlinkRunOI( end );
+        length += g_heap->span_run[ end ];
+        g_heap->span_class[ end ] = SPAN_LARGE_TAIL;
+        g_heap->span_class[ end - 1 ] = SPAN_LARGE_TAIL;
+    }
+    if ( ( span > 0 ) && ( ( SPAN_FREE == g_heap->span_class[ span - 1 ] ) || ( SPAN_FREE_TAIL == g_heap->span_class[ span - 1 ] ) ) )
+    {
+        g_heap->span_class[ span ] = SPAN_LARGE_TAIL;
+        g_heap->span_class[ span - 1 ] = SPAN_LARGE_TAIL;
+        span -= g_heap->span_run[ span - 1 ];
+        UnlinkRunOI( span );
+        length += g_heap->span_run[ span ];
+    }
+    FreeRunOI( span, length );
+    return 0;
+} /* FreeOI */
+
+/* syscall 18. returns 0 if there's no room, in which case the old block is still allocated */
+
+#ifdef OLDCPU
+static oi_t ReallocateOI( address, size ) oi_t address; oi_t size;
+#else
+static oi_t ReallocateOI( oi_t address, oi_t size )
+#endif
+{
+    oi_t old_size, moved;
+    int c;
+
+    if ( 0 == address )
+        return AllocateOI( size );
+
+    old_size = BlockSizeOI( address, & c );
+    if ( 0 == old_size )
+        return 0;
+
+    if ( 0 == size )
+    {
+        FreeOI( address );
+        return 0;
+    }
+
+    if ( size <= old_size )
+        return address;
+
+    moved = AllocateOI( size );
+    if ( 0 == moved )
+        return 0;
+
+    memcpy( ram + moved, ram + address, (size_t) old_size );
+    FreeOI( address );
+    return moved;
+} /* ReallocateOI */
+
+#ifdef OI_TIMING
+
+/*  Syscalls 19-21 let apps time their own loops. Each returns its count in rres and, if rarg1 isn't 0, also
+    stores all 64 bits of it little-endian at rarg1, since rres of 2 and 4-byte images would wrap. The clock
+    and the cycle counter are read from the host and the instruction count from the engine only when asked.
+*/
+
+static oi_t TimingResultOI( uint64_t count )
+{
+    oi_t address;
+
+    address = guest_unsigned( g_oi.rarg1 );
+    if ( 0 != address )
+    {
+        if ( !GuestBufferOI( address, (oi_t) sizeof( count ) ) )
+            return FILE_ERROR;
+#ifdef OI_MMAP
+        MarkDirtyOI( (uint64_t) address, sizeof( count ) );
+#endif /* OI_MMAP */
+        memcpy( ram + address, & count, sizeof( count ) );
+#ifdef OI_PREDECODE
+        InvalidateCodeOI( address, (oi_t) sizeof( count ) );
+#endif /* OI_PREDECODE */
+    }
+
+    return (oi_t) count;
+} /* TimingResultOI */
+
+/* syscall 19 */
+
+static oi_t ClockOI()
+{
+    struct timespec ts;
+
+    if ( 0 != clock_gettime( CLOCK_MONOTONIC, & ts ) )
+        return FILE_ERROR;
+
+    return TimingResultOI( (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec );
+} /* ClockOI */
+
+/* syscall 20. see RetiredOI() */
+
+static oi_t InstructionsOI()
+{
+#ifdef OI_PREDECODE
+    uint64_t count;
+
+    if ( RetiredOI( & count ) )
+        return TimingResultOI( count );
+#endif /* OI_PREDECODE */
+
+    return FILE_ERROR;
+} /* InstructionsOI */
+
+/* syscall 21. x86 hosts have a time stamp counter */
+
+static oi_t CyclesOI()
+{
+#ifdef OI_TSC
+    return TimingResultOI( (uint64_t) __builtin_ia32_rdtsc() );
+#else
+    return FILE_ERROR;
+#endif /* OI_TSC */
+} /* CyclesOI */
+
+#endif /* OI_TIMING */
+
+#ifdef OI_THREADS
+
+/*  Guest threads. Syscall 22 starts a thread at rarg1 with rarg2 in its rarg1 and a stack of rres bytes (0 for
+    THREAD_STACK) allocated from the heap. The thread runs on its own host thread with its own registers and
+    decode cache and shares the app's RAM and heap. It ends when its entry returns or makes syscall 0, and
+    syscall 23 waits for that, frees the stack, and returns the thread's rres. Threads synchronize with the
+    atomic instructions (cas, xadd, xchg, and fence) and syscalls 24 and 25, which wait on and wake an
+    image-width word in RAM like a Linux futex.
+
+    Files, maps, and asynchronous I/O belong to the main thread, so other threads only have fds 0, 1, and 2 and
+    get -1 from syscalls 4 and 7-13. Each thread buffers its own console output. When the main thread halts it
+    waits for the others to end. Apps can't start threads with -snapshot, -checkpoint, or -resume, which only
+    save one thread's registers.
+*/
+
+#define MAX_GUEST_THREADS 64
+#define THREAD_STACK ( 2048 * (oi_t) image_width )  /* 2048 words of the image width, not the build width */
+#define FUTEX_BUCKETS 64
+
+struct OIThreads;
+
+struct OIGuestThread
+{
+    struct OIThreads * threads;
+    struct OIContext * context;
+    pthread_t host;
+    oi_t stack;       /* the heap block holding the stack */
+    oi_t result;
+    bool used;
+    bool joining;
+    bool done;
+};
+
+struct OIWaiter
+{
+    struct OIWaiter * next;
+    oi_t address;
+    bool woken;
+};
+
+/* one per app, made by its first syscall 22. everything below lock is changed with it held, as is the heap */
+
+struct OIThreads
+{
+    uint8_t * ram;
+    uint64_t ram_size;
+    uint8_t image_width;
+    struct OIHeap * heap;
+    pthread_mutex_t lock;
+    pthread_cond_t ended;
+    pthread_cond_t woken[ FUTEX_BUCKETS ];
+    struct OIWaiter * waiters[ FUTEX_BUCKETS ];
+    struct OIGuestThread thread[ MAX_GUEST_THREADS ];
+    size_t running;
+};
+
+static oi_tls struct OIThreads * g_threads = 0;
+static oi_tls struct OIGuestThread * g_thread = 0;  /* the guest thread on this host thread, or 0 for the main one */
+
+#define futex_bucket( address ) ( ( (size_t) ( address ) / sizeof( oi_t ) ) % FUTEX_BUCKETS )
+
+/* the heap syscalls hold the lock once the app has threads */
+
+static void LockHeapOI()
+{
+    if ( 0 != g_threads )
+        pthread_mutex_lock( & g_threads->lock );
+} /* LockHeapOI */
+
+static void UnlockHeapOI()
+{
+    if ( 0 != g_threads )
+        pthread_mutex_unlock( & g_threads->lock );
+} /* UnlockHeapOI */
+
+static void * ThreadMainOI( void * p )
+{
+    struct OIGuestThread * thread;
+
+    thread = (struct OIGuestThread *) p;
+    g_thread = thread;
+    g_threads = thread->threads;
+    g_heap = g_threads->heap;
+    ram = g_threads->ram;
+    ram_size = g_threads->ram_size;
+    image_width = g_threads->image_width;
+    g_halted = 0;
+
+    OISelect( thread->context );
+    do
+    {
+        ExecuteOI();
+    } while ( !g_halted );
+
+    thread->result = g_oi.rres;
+    OIDestroy( thread->context );
+    thread->context = 0;
+
+    pthread_mutex_lock( & g_threads->lock );
+    thread->done = true;
+    g_threads->running--;
+    pthread_cond_broadcast( & g_threads->ended );
+    pthread_mutex_unlock( & g_threads->lock );
+    return 0;
+} /* ThreadMainOI */
+
+static bool StartThreadsOI()
+{
+    size_t i;
+
+    g_threads = (struct OIThreads *) calloc( 1, sizeof( struct OIThreads ) );
+    if ( 0 == g_threads )
+        return false;
+
+    g_threads->ram = ram;
+    g_threads->ram_size = ram_size;
+    g_threads->image_width = image_width;
+    g_threads->heap = g_heap;
+    pthread_mutex_init( & g_threads->lock, 0 );
+    pthread_cond_init( & g_threads->ended, 0 );
+    for ( i = 0; i < FUTEX_BUCKETS; i++ )
+        pthread_cond_init( & g_threads->woken[ i ], 0 );
+    return true;
+} /* StartThreadsOI */
+
+/* syscall 22. returns the thread's id */
+
+static oi_t CreateThreadOI( oi_t pc, oi_t arg, oi_t stack_size )
+{
+    struct OIGuestThread * thread;
+    size_t i;
+
+    if ( 0 != g_snapshot_name )
+        return FILE_ERROR;
+#ifdef OI_CHECKPOINT
+    if ( ( 0 != g_checkpoint_name ) || ( 0 != g_resume_name ) )
+        return FILE_ERROR;
+#endif /* OI_CHECKPOINT */
+
+    if ( ( 0 == g_threads ) && !StartThreadsOI() )
+        return FILE_ERROR;
+
+    if ( 0 == stack_size )
+        stack_size = (oi_t) THREAD_STACK;
+    if ( ( pc >= ram_size ) || ( stack_size < (oi_t) ( 4 * sizeof( oi_t ) ) ) )
+        return FILE_ERROR;
+
+    pthread_mutex_lock( & g_threads->lock );
+    for ( i = 0; ( i < MAX_GUEST_THREADS ) && g_threads->thread[ i ].used; i++ )
+        continue;
+
+    if ( MAX_GUEST_THREADS == i )
+    {
+        pthread_mutex_unlock( & g_threads->lock );
+        return FILE_ERROR;
+    }
+
+    thread = & g_threads->thread[ i ];
+    memset( thread, 0, sizeof( * thread ) );
+    thread->threads = g_threads;
+    thread->stack = AllocateOI( stack_size );
+    if ( 0 != thread->stack )
+        thread->context = OIThread( pc, thread->stack + ( stack_size & ~ (oi_t) ( sizeof( oi_t ) - 1 ) ), arg );
+
+    if ( ( 0 == thread->context ) || ( 0 != pthread_create( & thread->host, 0, ThreadMainOI, thread ) ) )
+    {
+        OIDestroy( thread->context );
+        if ( 0 != thread->stack )
+            FreeOI( thread->stack );
+        pthread_mutex_unlock( & g_threads->lock );
+        return FILE_ERROR;
+    }
+
+    thread->used = true;
+    g_threads->running++;
+    pthread_mutex_unlock( & g_threads->lock );
+    return (oi_t) ( i + 1 );
+} /* CreateThreadOI */
+
+/* syscall 23 */
+
+static oi_t JoinThreadOI( oi_t id )
+{
+    struct OIGuestThread * thread;
+    oi_t result;
+
+    if ( ( 0 == g_threads ) || ( 0 == id ) || ( id > MAX_GUEST_THREADS ) )
+        return FILE_ERROR;
+
+    thread = & g_threads->thread[ id - 1 ];
+    pthread_mutex_lock( & g_threads->lock );
+    if ( !thread->used || thread->joining || ( thread == g_thread ) )
+    {
+        pthread_mutex_unlock( & g_threads->lock );
+        return FILE_ERROR;
+    }
+
+    thread->joining = true;
+    while ( !thread->done )
+        pthread_cond_wait( & g_threads->ended, & g_threads->lock );
+    pthread_mutex_unlock( & g_threads->lock );
+
+    pthread_join( thread->host, 0 );
+
+    pthread_mutex_lock( & g_threads->lock );
+    FreeOI( thread->stack );
+    result = thread->result;
+    thread->used = false;
+    pthread_mutex_unlock( & g_threads->lock );
+    return result;
+} /* JoinThreadOI */
+
+/* syscall 24. returns 1 right away if the word at address isn't expected, or 0 once woken by syscall 25 */
+
+static oi_t FutexWaitOI( oi_t address, oi_t expected )
+{
+    struct OIWaiter waiter, ** pp;
+    size_t bucket;
+
+    if ( ( 0 == g_threads ) || !GuestBufferOI( address, (oi_t) image_width ) )
+        return FILE_ERROR;
+
+    bucket = futex_bucket( address );
+    pthread_mutex_lock( & g_threads->lock );
+    if ( GetWordOI( ram + address, image_width ) != guest_unsigned( expected ) )
+    {
+        pthread_mutex_unlock( & g_threads->lock );
+        return 1;
+    }
+
+    waiter.address = address;
+    waiter.woken = false;
+    waiter.next = g_threads->waiters[ bucket ];
+    g_threads->waiters[ bucket ] = & waiter;
+
+    while ( !waiter.woken )
+        pthread_cond_wait( & g_threads->woken[ bucket ], & g_threads->lock );
+
+    for ( pp = & g_threads->waiters[ bucket ]; * pp != & waiter; pp = & ( * pp )->next )
+        continue;
+    * pp = waiter.next;
+    pthread_mutex_unlock( & g_threads->lock );
+    return 0;
+} /* FutexWaitOI */
+
+/* syscall 25. wakes up to count waiters on address, or all of them if count is 0. returns the number woken */
+
+static oi_t FutexWakeOI( oi_t address, oi_t count )
+{
+    struct OIWaiter * waiter;
+    size_t bucket;
+    oi_t woken;
+
+    if ( 0 == g_threads )
+        return 0;
+
+    bucket = futex_bucket( address );
+    woken = 0;
+    pthread_mutex_lock( & g_threads->lock );
+    for ( waiter = g_threads->waiters[ bucket ]; 0 != waiter; waiter = waiter->next )
+    {
+        if ( ( address == waiter->address ) && !waiter->woken )
+        {
+            waiter->woken = true;
+            woken++;
+            if ( woken == count )
+                break;
+        }
+    }
+
+    if ( 0 != woken )
+        pthread_cond_broadcast( & g_threads->woken[ bucket ] );
+    pthread_mutex_unlock( & g_threads->lock );
+    return woken;
+} /* FutexWakeOI */
+
+/* called when the main thread halts. waits for the app's other threads to end */
+
+static void EndThreadsOI()
+{
+    size_t i;
+
+    if ( 0 == g_threads )
+        return;
+
+    pthread_mutex_lock( & g_threads->lock );
+    while ( 0 != g_threads->running )
+        pthread_cond_wait( & g_threads->ended, & g_threads->lock );
+    pthread_mutex_unlock( & g_threads->lock );
+
+    for ( i = 0; i < MAX_GUEST_THREADS; i++ )
+        if ( g_threads->thread[ i ].used )
+            pthread_join( g_threads->thread[ i ].host, 0 );
+
+    for ( i = 0; i < FUTEX_BUCKETS; i++ )
+        pthread_cond_destroy( & g_threads->woken[ i ] );
+    pthread_cond_destroy( & g_threads->ended );
+    pthread_mutex_destroy( & g_threads->lock );
+    free( g_threads );
+    g_threads = 0;
+} /* EndThreadsOI */
+
+#endif /* OI_THREADS */
+
+/*  syscalls. arguments are in rarg1, rarg2, and rres. results are returned in rres, where -1 is an error
+        0  exit
+        1  print the string at rarg1
+        2  print the integer in rarg1
+        3  init done. see WriteSnapshotOI()
+        4  open the file named at rarg1 with mode rarg2: 0 read, 1 write, 2 append, 3 read and write. returns a fd
+        5  read up to rres bytes from fd rarg1 to rarg2. returns the count, which is less only at end of file
+        6  write rres bytes at rarg2 to fd rarg1. returns the count
+        7  close fd rarg1
+        8  seek fd rarg1 to offset rarg2 from rres: 0 the start, 1 the current offset, 2 the end. returns the offset
+        9  map rres bytes of fd rarg1 from offset rarg2, or to the end of the file if rres is 0. rtmp is 0 for
+           read-only or 1 for copy-on-write. returns the address. 8-byte images on unix-like systems only
+       10  unmap the mapping at address rarg1
+       11  use the asynchronous I/O completion ring at rarg1 with rarg2 entries. see AioRingOI()
+       12  submit the asynchronous I/O request at rarg1. writes to files opened for append fail
+       13  wait until there are at least rarg1 completions in the ring or none in flight. returns the number there
+       14  set the break to rarg1, or if it's 0 just return the break. returns the break
+       15  move the break by rarg1. returns the old break
+       16  allocate rarg1 bytes. returns the address or 0
+       17  free the block at rarg1
+       18  resize the block at rarg1 to rarg2 bytes. returns the new address or 0 if the old block is unchanged
+       19  nanoseconds from a monotonic clock. see TimingResultOI() for rarg1
+       20  instructions retired since the app started. returns -1 unless oios -n counts them, which -d can't
+       21  host cpu cycles from the time stamp counter. x86 hosts only
+       22  start a thread at rarg1 with rarg2 in its rarg1 and an rres byte stack, 0 for the default. returns its id
+       23  wait for thread rarg1 to end. returns its rres
+       24  wait until woken if the image-width word at rarg1 is rarg2. returns 1 if it isn't, else 0 once woken
+       25  wake up to rarg2 threads waiting on rarg1, all if rarg2 is 0. returns the number woken
+    fds 0, 1, and 2 are stdin, stdout, and stderr. writes to fd 1 share the console buffer with syscalls 1 and 2.
+    syscalls 22-25 are for unix-like systems only. see CreateThreadOI()
+*/
+
+#ifdef OLDCPU
+void OISyscall( function ) size_t function;
+#else
+void OISyscall( size_t function )
+#endif
+{
+#ifdef OI_THREADS
+    /* files, maps, and asynchronous I/O belong to the main thread */
+    if ( ( 0 != g_thread ) && ( ( 4 == function ) || ( ( function >= 7 ) && ( function <= 13 ) ) ) )
+    {
+        g_oi.rres = FILE_ERROR;
+        return;
+    }
+#endif /* OI_THREADS */
+
+    switch( function )
+    {
+        case 0:
+        {
+            /* this results in a halt instruction, which calls OIHalt(), which sets g_halted = true */
+            g_oi.rpc = 0;
+            break;
+        }
+        case 1:
+        {
+            OutputOI( (char *) ram + g_oi.rarg1, strlen( (char *) ram + g_oi.rarg1 ) );
+#ifndef NDEBUG
+            trace( "syscall string: %s\n", ram + g_oi.rarg1 );
+#endif
+            break;
+        }
+        case 2:
+        {
+            if ( 2 == image_width )
+            {
+                OutputIntegerOI( (ioi_t) (int16_t) g_oi.rarg1 );
+#ifndef NDEBUG
+                trace( "syscall integer: %d\n", (int16_t) g_oi.rarg1 );
+#endif
+            }
+            else if ( 4 == image_width )
+            {
+                OutputIntegerOI( (ioi_t) (int32_t) g_oi.rarg1 );
+#ifdef MSC6
+#ifndef NDEBUG
+                trace( "syscall integer: %ld\n", (int32_t) g_oi.rarg1 );
+#endif
+#else /* MSC6 */
+#ifndef NDEBUG
+                trace( "syscall integer: %d\n", (int32_t) g_oi.rarg1 );
+#endif
+#endif /* MSC6 */
+            }
+
+#ifdef OI8
+            else if ( 8 == image_width )
+            {
+                OutputIntegerOI( (ioi_t) g_oi.rarg1 );
+#ifndef NDEBUG
+                trace( "syscall integer: %lld\n", (int64_t) g_oi.rarg1 );
+#endif
+            }
+#endif
+            break;
+        }
+        case 3:
+        {
+            /* init done. see WriteSnapshotOI() */
+            if ( 0 != g_snapshot_name )
+                WriteSnapshotOI();
+            break;
+        }
+        case 4:
+        {
+            g_oi.rres = OpenFileOI( guest_unsigned( g_oi.rarg1 ), guest_unsigned( g_oi.rarg2 ) );
+            break;
+        }
+        case 5:
+        {
+            g_oi.rres = ReadFileOI( guest_unsigned( g_oi.rarg1 ), guest_unsigned( g_oi.rarg2 ), guest_unsigned( g_oi.rres ) );
+            break;
+        }
+        case 6:
+        {
+            g_oi.rres = WriteFileOI( guest_unsigned( g_oi.rarg1 ), guest_unsigned( g_oi.rarg2 ), guest_unsigned( g_oi.rres ) );
+            break;
+        }
+        case 7:
+        {
+            g_oi.rres = CloseFileOI( guest_unsigned( g_oi.rarg1 ) );
+            break;
+        }
+        case 8:
+        {
+            g_oi.rres = SeekFileOI( guest_unsigned( g_oi.rarg1 ), g_oi.rarg2, guest_unsigned( g_oi.rres ) );
+            break;
+        }
+        case 9:
+        {
+#ifdef OI_MMAP
+            g_oi.rres = MapGuestFileOI( guest_unsigned( g_oi.rarg1 ), guest_unsigned( g_oi.rarg2 ), guest_unsigned( g_oi.rres ),
+                                        guest_unsigned( g_oi.rtmp ) );
+#else
+            g_oi.rres = FILE_ERROR;
+#endif /* OI_MMAP */
+            break;
+        }
+        case 10:
+        {
+#ifdef OI_MMAP
+            g_oi.rres = UnmapGuestFileOI( guest_unsigned( g_oi.rarg1 ) );
+#else
+            g_oi.rres = FILE_ERROR;
+#endif /* OI_MMAP */
+            break;
+        }
+        case 11:
+        case 12:
+        case 13:
+        {
+#ifdef OI_AIO
+            if ( 11 == function )
+                g_oi.rres = AioRingOI( guest_unsigned( g_oi.rarg1 ), guest_unsigned( g_oi.rarg2 ) );
+            else if ( 12 == function )
+                g_oi.rres = AioSubmitOI( guest_unsigned( g_oi.rarg1 ) );
+            else
+                g_oi.rres = AioWaitOI( guest_unsigned( g_oi.rarg1 ) );
+#else
+            g_oi.rres = FILE_ERROR;
+#endif /* OI_AIO */
+            break;
+        }
+        case 14:
+        case 15:
+        case 16:
+        case 17:
+        case 18:
+        {
+#ifdef OI_THREADS
+            LockHeapOI();
+#endif /* OI_THREADS */
+            if ( 14 == function )
+                g_oi.rres = SetBreakOI( guest_unsigned( g_oi.rarg1 ) );
+            else if ( 15 == function )
+                g_oi.rres = MoveBreakOI( g_oi.rarg1 );
+            else if ( 16 == function )
+                g_oi.rres = AllocateOI( guest_unsigned( g_oi.rarg1 ) );
+            else if ( 17 == function )
+                g_oi.rres = FreeOI( guest_unsigned( g_oi.rarg1 ) );
+            else
+                g_oi.rres = ReallocateOI( guest_unsigned( g_oi.rarg1 ), guest_unsigned( g_oi.rarg2 ) );
+#ifdef OI_THREADS
+            UnlockHeapOI();
+#endif /* OI_THREADS */
+            break;
+        }
+        case 19:
+        case 20:
+        case 21:
+        {
+#ifdef OI_TIMING
+            if ( 19 == function )
+                g_oi.rres = ClockOI();
+            else if ( 20 == function )
+                g_oi.rres = InstructionsOI();
+            else
+                g_oi.rres = CyclesOI();
+#else
+            g_oi.rres = FILE_ERROR;
+#endif /* OI_TIMING */
+            break;
+        }
+        case 22:
+        case 23:
+        case 24:
+        case 25:
+        {
+#ifdef OI_THREADS
+            if ( 22 == function )
+                g_oi.rres = CreateThreadOI( guest_unsigned( g_oi.rarg1 ), g_oi.rarg2, guest_unsigned( g_oi.rres ) );
+            else if ( 23 == function )
+                g_oi.rres = JoinThreadOI( guest_unsigned( g_oi.rarg1 ) );
+            else if ( 24 == function )
+                g_oi.rres = FutexWaitOI( guest_unsigned( g_oi.rarg1 ), g_oi.rarg2 );
+            else
+                g_oi.rres = FutexWakeOI( guest_unsigned( g_oi.rarg1 ), guest_unsigned( g_oi.rarg2 ) );
+#else
+            g_oi.rres = FILE_ERROR;
+#endif /* OI_THREADS */
+            break;
+        }
+        default:
+        {
+            OIFlushOutput();
+            printf( "unhandled syscall!\n" );
+            fflush( stdout );
+            break;
+        }
+    }
+} /* OISyscall */
+
+void OIHalt()
+{
+    g_halted = 1;
+    OIFlushOutput();
+#ifdef OI_THREADS
+    if ( 0 != g_thread )
+        return;
+    EndThreadsOI();
+#endif /* OI_THREADS */
+    CloseFilesOI();
+} /* OIHalt */
+
+#ifdef OLDCPU
+static size_t round_up( x, multiple ) size_t x; size_t multiple;
+#else
+static size_t round_up( size_t x, size_t multiple )
+#endif
+{
+    size_t remainder;
+
+    if ( (size_t) 0 == multiple )
+        return x;
+
+    remainder = x % multiple;
+    if ( (size_t) 0 == remainder )
+        return x;
+
+    return x + multiple - remainder;
+} /* round_up */
+
+#ifdef OLDCPU
+size_t size_args_env( appname, argc, argv, pchild_argc, first_child_arg )
+    char * appname; int argc; char * argv[]; int *pchild_argc; int first_child_arg;
+#else
+size_t size_args_env( char * appname, int argc, char * argv[], int *pchild_argc, int first_child_arg )
+#endif
+{
+    size_t len, head_len;
+    int i;
+
+    len = strlen( appname );
+    head_len = (int) ( 6 * sizeof( oi_t ) + ( 1 + len ) );
+
+    if ( -1 != first_child_arg )
+    {
+        *pchild_argc = 1 + ( argc - first_child_arg );
+        for ( i = first_child_arg; i < argc; i++ )
+            head_len += (int) ( sizeof( oi_t ) + ( 1 + strlen( argv[ i ] ) ) );
+    }
+
+    /* make sure the stack is image width aligned */
+    head_len = round_up( head_len, sizeof( oi_t ) );
+    return head_len;
+} /* size_args_env */
+
+#ifdef OLDCPU
+void init_args_env( appname, argc, argv, child_argc, first_child_arg, head_len )
+    char * appname; int argc; char * argv[]; int child_argc; int first_child_arg; size_t head_len;
+#else
+void init_args_env( char * appname, int argc, char * argv[], int child_argc, int first_child_arg, size_t head_len )
+#endif
+{
+    int i;
+    oi_t offset, x;
+
+    offset = (oi_t) ( ram_size - head_len );
+    x = (oi_t) child_argc;
+    memcpy( &ram[ offset ], &x, sizeof( oi_t ) );                           /* argc */
+    offset += sizeof( oi_t );
+    x = offset + ( 2 * sizeof( oi_t ) );                                    /* get past argv and penv to argv array */
+    memcpy( & ram[ offset ], &x, sizeof( oi_t ) );                          /* argv */
+    offset += sizeof( oi_t );
+    x = offset + (oi_t) ( ( child_argc + 2 ) * sizeof( oi_t ) );
+    memcpy( & ram[ offset ], &x, sizeof( oi_t ) );                          /* penv */
+    x += sizeof( oi_t );                                                    /* reserve 1 blank environment entry */
+    offset += sizeof( oi_t );
+
+    strcpy( (char *) & ram[ x ], appname );
+    memcpy( & ram[ offset ], &x, sizeof( oi_t ) );                          /* argv[0] */
+    offset += sizeof( oi_t );
+    x += (oi_t) ( 1 + strlen( appname ) );
+
+    if ( -1 != first_child_arg )
+    {
+        for ( i = first_child_arg; i < argc; i++ )
+        {
+            strcpy( (char *) & ram[ x ], argv[ i ] );
+            memcpy( & ram[ offset ], &x, sizeof( oi_t ) );                  /* argv[1..n] */
+            offset += sizeof( oi_t );
+            x += (oi_t) ( 1 + strlen( argv[ i ] ) );
+        }
+    }
+
+    x = 0;
+    memcpy( & ram[ offset ], &x, sizeof( oi_t ) );                          /* 0 terminator to argv array */
+    offset += sizeof( oi_t );
+    memcpy( & ram[ offset ], &x, sizeof( oi_t ) );                          /* 0 terminator to env array */
+    offset += sizeof( oi_t );
+
+#ifndef NDEBUG
+    trace( "argument and environment information:\n" );
+    trace_binary_data( & ram[ ram_size - head_len ], head_len, 2 );
+#endif
+} /* init_args_env */
+
+/* the error message returned by LoadOI() when it has to be formatted */
+
+static oi_tls char g_load_error[ 160 ];
+
+/* the loaders return char * for compilers without const, so fixed messages are copied to g_load_error too */
+
+#ifdef OLDCPU
+static char * LoadErrorOI( message ) char * message;
+#else
+static char * LoadErrorOI( const char * message )
+#endif
+{
+    strcpy( g_load_error, message );
+    return g_load_error;
+} /* LoadErrorOI */
+
+/* reads and checks an image header and sets image_width. returns 0 or an error */
+
+#ifdef OLDCPU
+static char * ReadHeaderOI( fp, show_image_header, ph ) FILE * fp; bool show_image_header; struct OIHeader * ph;
+#else
+static char * ReadHeaderOI( FILE * fp, bool show_image_header, struct OIHeader * ph )
+#endif
+{
+    if ( 1 != fread( ph, sizeof( * ph ), 1, fp ) )
+        return LoadErrorOI( "can't read image file header" );
+
+    if ( show_image_header )
+    {
+        printf( "  signature:                %c%c\n", ph->sig0, ph->sig1 );
+        printf( "  version:                  %u\n", ph->version );
+        printf( "  flags:                    %04xh\n", ph->flags );
+        printf( "  ram required:             %u\n", ph->loRamRequired );
+        printf( "  code size:                %u\n", ph->cbCode );
+        printf( "  initialized data size:    %u\n", ph->cbInitializedData );
+        printf( "  zero-filled data size:    %u\n", ph->cbZeroFilledData );
+        printf( "  stack size:               %u\n", ph->cbStack );
+        printf( "  initial PC:               %u\n", ph->loInitialPC );
+        exit( 0 );
+    }
+
+    if ( 'O' != ph->sig0 || 'I' != ph->sig1 )
+        return LoadErrorOI( "image signature isn't the expected OI" );
+
+    image_width = ph->flags & OI_FLAG_WIDTH;
+    if ( 0 == image_width )
+        image_width = 2;
+    else if ( 1 == image_width )
+        image_width = 4;
+    else if ( 2 == image_width )
+        image_width = 8;
+    else
+        return LoadErrorOI( "image width in header is malformed" );
+
+#ifndef NDEBUG
+    trace( "  signature:                %c%c\n", ph->sig0, ph->sig1 );
+    trace( "  version:                  %u\n", ph->version );
+    trace( "  flags:                    %04xh\n", ph->flags );
+    trace( "  ram required:             %u\n", ph->loRamRequired );
+    trace( "  code size:                %u\n", ph->cbCode );
+    trace( "  initialized data size:    %u\n", ph->cbInitializedData );
+    trace( "  zero-filled data size:    %u\n", ph->cbZeroFilledData );
+    trace( "  stack size:               %u\n", ph->cbStack );
+    trace( "  initial PC:               %u\n", ph->loInitialPC );
+    trace( "image width: %d\n", image_width );
+#endif
+
+#ifdef OI2
+    if ( 2 != image_width )
+    {
+        sprintf( g_load_error, "this version of oios only supports 2-byte image width binaries, and this one has %u", image_width );
+        return g_load_error;
+    }
+#endif
+#ifdef OI4
+    if ( image_width > 4 )
+    {
+        sprintf( g_load_error, "this version of oios only supports 2- and 4-byte image width binaries, and this one has %u", image_width );
+        return g_load_error;
+    }
+#endif
+
+    return 0;
+} /* ReadHeaderOI */
+
+/* decompresses an OI_FLAG_COMPRESSED image's code and data from fp into p. returns false if the data is malformed */
+
+#ifdef OLDCPU
+static bool ReadCompressedOI( fp, p, length ) FILE * fp; uint8_t * p; size_t length;
+#else
+static bool ReadCompressedOI( FILE * fp, uint8_t * p, size_t length )
+#endif
+{
+    size_t out, distance, count;
+    int flags, bit, c, c2;
+
+    out = 0;
+    while ( out < length )
+    {
+        flags = getc( fp );
+        if ( EOF == flags )
+            return false;
+
+        for ( bit = 0; ( bit < 8 ) && ( out < length ); bit++ )
+        {
+            c = getc( fp );
+            if ( EOF == c )
+                return false;
+
+            if ( 0 == ( flags & ( 1 << bit ) ) )
+                p[ out++ ] = (uint8_t) c;
+            else
+            {
+                c2 = getc( fp );
+                if ( EOF == c2 )
+                    return false;
+
+                distance = (size_t) c | ( (size_t) ( c2 & 0xf0 ) << 4 );
+                count = (size_t) ( c2 & 0x0f ) + 3;
+                if ( ( 0 == distance ) || ( distance > out ) || ( count > length - out ) )
+                    return false;
+
+                /* byte by byte, since a match can overlap what it produces */
+                for ( ; 0 != count; count-- )
+                {
+                    p[ out ] = p[ out - distance ];
+                    out++;
+                }
+            }
+        }
+    }
+
+    return true;
+} /* ReadCompressedOI */
+
+/* returns the ':' in a bundle entry name like apps.oib:tttoi, or 0 if path names an ordinary image file */
+
+#ifdef OLDCPU
+static char * BundleSeparatorOI( path ) char * path;
+#else
+static char * BundleSeparatorOI( const char * path )
+#endif
+{
+    const char * p;
+
+    for ( p = strchr( path, ':' ); 0 != p; p = strchr( p + 1, ':' ) )
+        if ( ( p - path >= 4 ) && !strncmp( p - 4, ".oib", 4 ) )
+            return (char *) p;
+    return 0;
+} /* BundleSeparatorOI */
+
+/*  opens the image file, or the bundle holding the entry apps.oib:name, and positions it at the image's header.
+    * pbase is set to the header's file offset. returns the file or 0 with g_load_error set
+*/
+
+#ifdef OLDCPU
+static FILE * OpenImageOI( appname, pbase ) char * appname; long * pbase;
+#else
+static FILE * OpenImageOI( char * appname, long * pbase )
+#endif
+{
+    struct OIBundleHeader bh;
+    struct OIBundleEntry e;
+    FILE * fp;
+    char * sep;
+    long lo, hi, mid;
+    int cmp;
+
+    * pbase = 0;
+    sep = BundleSeparatorOI( appname );
+    if ( 0 != sep )
+        * sep = 0;
+
+#ifdef AZTECCPM
+    fp = fopen( appname, "r" );
+#else
+    fp = fopen( appname, "rb" );
+#endif
+    if ( 0 != sep )
+        * sep = ':';
+    if ( !fp )
+    {
+        sprintf( g_load_error, "can't open image file '%.100s'", appname );
+        return 0;
+    }
+
+    if ( 0 == sep )
+        return fp;
+
+    if ( ( 1 != fread( & bh, sizeof( bh ), 1, fp ) ) || ( 'O' != bh.sig0 ) || ( 'I' != bh.sig1 ) || ( 'B' != bh.sig2 ) )
+    {
+        fclose( fp );
+        sprintf( g_load_error, "'%.100s' isn't an OI bundle", appname );
+        return 0;
+    }
+
+    /* binary search of the sorted index */
+    lo = 0;
+    hi = (long) bh.count - 1;
+    while ( lo <= hi )
+    {
+        mid = ( lo + hi ) / 2;
+        fseek( fp, (long) sizeof( bh ) + mid * (long) sizeof( e ), SEEK_SET );
+        if ( 1 != fread( & e, sizeof( e ), 1, fp ) )
+            break;
+
+        e.name[ sizeof( e.name ) - 1 ] = 0;
+        cmp = strcmp( sep + 1, e.name );
+        if ( 0 == cmp )
+        {
+            * pbase = (long) e.loOffset + ( ( (long) e.hiOffset << 16 ) << 16 );
+            fseek( fp, * pbase, SEEK_SET );
+            return fp;
+        }
+
+        if ( cmp < 0 )
+            hi = mid - 1;
+        else
+            lo = mid + 1;
+    }
+
+    fclose( fp );
+    sprintf( g_load_error, "no image named '%.60s' in the bundle", sep + 1 );
+    return 0;
+} /* OpenImageOI */
+
+/* loads appname's image into RAM, writes the arguments above the stack, and resets the registers. returns 0 or an error */
+
+#ifdef OLDCPU
+static char * LoadOI( appname, argc, argv, first_child_arg, show_image_header, pcode_size )
+    char * appname; int argc; char * argv[]; int first_child_arg; bool show_image_header; uint32_t * pcode_size;
+#else
+static char * LoadOI( char * appname, int argc, char * argv[], int first_child_arg, bool show_image_header, uint32_t * pcode_size )
+#endif
+{
+    size_t result, head_len;
+    FILE * fp;
+    int child_argc;
+    bool mapped;
+    char * error;
+    long base;
+#ifdef OI_MMAP
+    uint64_t ram_requirement;
+#else
+    uint32_t ram_requirement;
+#endif
+    struct OIHeader h;
+
+    child_argc = 1;
+    mapped = false;
+
+    fp = OpenImageOI( appname, & base );
+    if ( !fp )
+        return g_load_error;
+
+#ifndef NDEBUG
+    trace( "app: '%s'\n", appname );
+#endif
+
+    error = ReadHeaderOI( fp, show_image_header, & h );
+    if ( 0 != error )
+    {
+        fclose( fp );
+        return error;
+    }
+
+    head_len = size_args_env( appname, argc, argv, & child_argc, first_child_arg );
+#ifdef OI_MMAP
+    ram_requirement = (uint64_t) h.loRamRequired + head_len;
+    if ( 8 == image_width )
+        ram_requirement += (uint64_t) h.hiRamRequired << 32;
+    ram_size = ReserveRamOI( ram_requirement, & ram, image_width );
+    if ( 0 == ram )
+    {
+        fclose( fp );
+        sprintf( g_load_error, "insufficient RAM for this application. required %llu, available %llu",
+                 (unsigned long long) ram_requirement, (unsigned long long) ram_size );
+        return g_load_error;
+    }
+
+    /* with shared code enabled or a version 2 image the code and initialized data are mapped rather than read */
+    if ( 0 == ( h.flags & OI_FLAG_COMPRESSED ) )
+        mapped = MapCodeOI( fileno( fp ), base + oi_code_offset( h ), h.cbCode, h.cbInitializedData, & ram );
+#else
+    ram_requirement = (uint32_t) ( h.loRamRequired + head_len );
+    ram_size = RamInformationOI( ram_requirement, & ram, image_width );
+    if ( 0 == ram )
+    {
+        fclose( fp );
+        sprintf( g_load_error, "insufficient RAM for this application. required %u, available %u", (int) ram_requirement, (int) ram_size );
+        return g_load_error;
+    }
+#endif
+
+    /* write the environment and argument info above where the top of stack will be */
+    init_args_env( appname, argc, argv, child_argc, first_child_arg, head_len );
+
+    ResetOI( (oi_t) h.loRamRequired, (oi_t) h.loInitialPC, (oi_t) ( ram_size - head_len ), image_width );
+    memcpy( & g_header, & h, sizeof( h ) );
+    g_initial_sp = g_oi.rsp;
+    StartHeapOI( (oi_t) ( ram_size - head_len ) );
+
+    result = 1;
+    if ( !mapped )
+    {
+        fseek( fp, base + (long) oi_code_offset( h ), SEEK_SET );
+        if ( h.flags & OI_FLAG_COMPRESSED )
+            result = ReadCompressedOI( fp, ram, (size_t) ( h.cbCode + h.cbInitializedData ) ) ? 1 : 0;
+        else
+            result = fread( ram, (int) ( h.cbCode + h.cbInitializedData ), 1, fp );
+    }
+    fclose( fp );
+    if ( 1 != result )
+        return LoadErrorOI( "can't read image file" );
+
+    * pcode_size = h.cbCode;
+    return 0;
+} /* LoadOI */
+
+#ifdef OI_CHECKPOINT
+
+/*  oios -checkpoint:file[,seconds] appends the app's registers and RAM to file when oios gets SIGUSR1 and, with
+    seconds, on that interval. The first checkpoint has all of the RAM in use. Later ones have only the pages
+    written since the one before, which TrackDirtyPagesOI() finds by write-protecting RAM, so their size follows
+    the working set. Each checkpoint ends with the heap allocator's state and a trailer, and one cut short by a
+    crash is ignored.
+    oios -resume:file[,seconds] rebuilds RAM from the complete checkpoints, continues the app from the last one,
+    and appends later checkpoints to the same file. Checkpoints are taken at the next instruction the decode
+    cache runs, so -d and -sim can't make them, and neither can -j since hot loops stay in native code.
+*/
+
+#define CHECKPOINT_SIG "OICK"
+#define CHECKPOINT_HEAP "OIHP"
+#define CHECKPOINT_END "OIEN"
+
+struct OICheckpoint
+{
+    char sig[ 4 ];
+    uint16_t state_size;  /* sizeof( struct OneImage ), which depends on the build */
+    uint8_t image_width;
+    uint8_t unused;
+    uint64_t ram_size;
+    uint64_t pages;       /* count of OICheckpointPage records that follow */
+    struct OIHeader header;
+    struct OneImage state;
+};
+
+struct OICheckpointPage
+{
+    uint64_t offset;
+    uint64_t length;      /* bytes of RAM that follow */
+};
+
+struct OICheckpointHeap
+{
+    char sig[ 4 ];
+    uint32_t unused;
+    uint64_t brk;
+    uint64_t heap_base;
+    uint64_t heap_limit;
+    uint64_t heap_floor;
+    uint64_t span_base;
+    uint64_t spans;                      /* span classes, span runs, then SPAN_BLOCKS / 8 used bytes per span */
+    uint64_t free[ HEAP_CLASSES ];       /* then the small classes' free lists. the free runs are found from the span classes */
+};
+
+struct OICheckpointEnd
+{
+    char sig[ 4 ];
+    uint32_t unused;
+    uint64_t pages;
+};
+
+static FILE * g_checkpoint_fp = 0;
+static int g_checkpoint_seconds = 0;
+static volatile sig_atomic_t g_checkpoint_due = 0;
+
+static void CheckpointSignalOI( int sig )
+{
+    (void) sig;
+    g_checkpoint_due = 1;
+    StopOI();
+} /* CheckpointSignalOI */
+
+/* true if the page is dirty and holds part of the app's RAM, which it then clips the range to */
+
+static bool CheckpointPageOI( uint64_t page, uint64_t * poffset, uint64_t * plength, bool * pmore )
+{
+    * pmore = DirtyPageOI( page, poffset, plength );
+    if ( !* pmore || ( 0 == * plength ) || ( * poffset >= ram_size ) )
+        return false;
+
+    if ( * poffset + * plength > ram_size )
+        * plength = ram_size - * poffset;
+    return true;
+} /* CheckpointPageOI */
+
+static bool WriteHeapOI( FILE * fp )
+{
+    struct OICheckpointHeap hp;
+    size_t i;
+    bool ok;
+
+    memset( & hp, 0, sizeof( hp ) );
+    memcpy( hp.sig, CHECKPOINT_HEAP, 4 );
+    hp.brk = g_heap->brk;
+    hp.heap_base = g_heap->base;
+    hp.heap_limit = g_heap->limit;
+    hp.heap_floor = g_heap->floor;
+    hp.span_base = g_heap->span_base;
+    hp.spans = g_heap->spans;
+    for ( i = 0; i < HEAP_CLASSES; i++ )
+        hp.free[ i ] = g_heap->free[ i ].count;
+
+    ok = ( 1 == fwrite( & hp, sizeof( hp ), 1, fp ) );
+    if ( ok && ( 0 != g_heap->spans ) )
+        ok = ( 1 == fwrite( g_heap->span_class, g_heap->spans, 1, fp ) ) && ( 1 == fwrite( g_heap->span_run, g_heap->spans * sizeof( uint32_t ), 1, fp ) ) &&
+             ( 1 == fwrite( g_heap->block_used, g_heap->spans * ( SPAN_BLOCKS / 8 ), 1, fp ) );
+    for ( i = 0; ok && ( i < HEAP_CLASSES ); i++ )
+        if ( 0 != g_heap->free[ i ].count )
+            ok = ( 1 == fwrite( g_heap->free[ i ].items, g_heap->free[ i ].count * sizeof( oi_t ), 1, fp ) );
+    return ok;
+} /* WriteHeapOI */
+
+/* reads the heap record, replacing the allocator's state if apply is true */
+
+static bool ReadHeapOI( FILE * fp, uint64_t ram_bytes, bool apply )
+{
+    struct OICheckpointHeap hp;
+    struct OIFreeList * list;
+    size_t i;
+
+    if ( ( 1 != fread( & hp, sizeof( hp ), 1, fp ) ) || memcmp( hp.sig, CHECKPOINT_HEAP, 4 ) || ( hp.spans > ram_bytes / HEAP_SPAN + 1 ) )
+        return false;
+    for ( i = 0; i < HEAP_CLASSES; i++ )
+        if ( hp.free[ i ] > ram_bytes / HEAP_MIN_BLOCK )
+            return false;
+
+    if ( !apply )
+    {
+        if ( 0 != fseeko( fp, (off_t) ( hp.spans * ( 1 + sizeof( uint32_t ) + SPAN_BLOCKS / 8 ) ), SEEK_CUR ) )
+            return false;
+        for ( i = 0; i < HEAP_CLASSES; i++ )
+            if ( 0 != fseeko( fp, (off_t) ( hp.free[ i ] * sizeof( oi_t ) ), SEEK_CUR ) )
+                return false;
+        return true;
+    }
+
+    FreeHeapOI();
+    g_heap->brk = (oi_t) hp.brk;
+    g_heap->base = (oi_t) hp.heap_base;
+    g_heap->limit = (oi_t) hp.heap_limit;
+    g_heap->floor = (oi_t) hp.heap_floor;
+    g_heap->span_base = (oi_t) hp.span_base;
+
+    if ( 0 != hp.spans )
+    {
+        g_heap->span_class = (uint8_t *) malloc( (size_t) hp.spans );
+        g_heap->span_run = (uint32_t *) malloc( (size_t) hp.spans * sizeof( uint32_t ) );
+        g_heap->block_used = (uint8_t *) malloc( (size_t) hp.spans * ( SPAN_BLOCKS / 8 ) );
+        g_heap->run_next = (uint32_t *) malloc( (size_t) hp.spans * sizeof( uint32_t ) );
+        g_heap->run_prev = (uint32_t *) malloc( (size_t) hp.spans * sizeof( uint32_t ) );
+        if ( ( 0 == g_heap->span_class ) || ( 0 == g_heap->span_run ) || ( 0 == g_heap->block_used ) || ( 0 == g_heap->run_next ) || ( 0 == g_heap->run_prev ) ||
+             ( 1 != fread( g_heap->span_class, (size_t) hp.spans, 1, fp ) ) || ( 1 != fread( g_heap->span_run, (size_t) hp.spans * sizeof( uint32_t ), 1, fp ) ) ||
+             ( 1 != fread( g_heap->block_used, (size_t) hp.spans * ( SPAN_BLOCKS / 8 ), 1, fp ) ) )
+            return false;
+        g_heap->spans = (size_t) hp.spans;
+
+        for ( i = 0; i < g_heap->spans; i++ )
+        {
+            if ( SPAN_FREE != g_heap->span_class[ i ] )
+                continue;
+            if ( ( 0 == g_heap->span_run[ i ] ) || ( g_heap->span_run[ i ] > g_heap->spans - i ) )
+                return false;
+            FreeRunOI( i, g_heap->span_run[ i ] );
+        }
+    }
+
+    for ( i = 0; i < HEAP_CLASSES; i++ )
+    {
+        list = & g_heap->free[ i ];
+        if ( 0 == hp.free[ i ] )
+            continue;
+        list->items = (oi_t *) malloc( (size_t) hp.free[ i ] * sizeof( oi_t ) );
+        if ( ( 0 == list->items ) || ( 1 != fread( list->items, (size_t) hp.free[ i ] * sizeof( oi_t ), 1, fp ) ) )
+            return false;
+        list->count = (size_t) hp.free[ i ];
+        list->capacity = list->count;
+    }
+
+    return true;
+} /* ReadHeapOI */
+
+static void WriteCheckpointOI()
+{
+    struct OICheckpoint ck;
+    struct OICheckpointPage pg;
+    struct OICheckpointEnd end;
+    uint64_t page, offset, length;
+    bool ok, more;
+
+    g_checkpoint_due = 0;
+
+    /* a resumed app couldn't see its mapped files or get its I/O completions, so wait for the next checkpoint */
+    if ( FilesMappedOI() )
+        return;
+#ifdef OI_AIO
+    if ( 0 != g_aio.in_flight )
+        return;
+#endif /* OI_AIO */
+
+    memset( & ck, 0, sizeof( ck ) );
+    memcpy( ck.sig, CHECKPOINT_SIG, 4 );
+    ck.state_size = (uint16_t) sizeof( struct OneImage );
+    ck.image_width = image_width;
+    ck.ram_size = ram_size;
+    memcpy( & ck.header, & g_header, sizeof( ck.header ) );
+    memcpy( & ck.state, & g_oi, sizeof( ck.state ) );
+    for ( page = 0, more = true; more; page++ )
+        if ( CheckpointPageOI( page, & offset, & length, & more ) )
+            ck.pages++;
+
+    /* output the app made before the checkpoint isn't repeated after a resume, so don't lose it in a crash */
+    OIFlushOutput();
+
+    ok = ( 1 == fwrite( & ck, sizeof( ck ), 1, g_checkpoint_fp ) );
+    for ( page = 0, more = true; ok && more; page++ )
+    {
+        if ( CheckpointPageOI( page, & offset, & length, & more ) )
+        {
+            pg.offset = offset;
+            pg.length = length;
+            ok = ( 1 == fwrite( & pg, sizeof( pg ), 1, g_checkpoint_fp ) ) &&
+                 ( 1 == fwrite( ram + offset, (size_t) length, 1, g_checkpoint_fp ) );
+        }
+    }
+
+    ok = ok && WriteHeapOI( g_checkpoint_fp );
+
+    memset( & end, 0, sizeof( end ) );
+    memcpy( end.sig, CHECKPOINT_END, 4 );
+    end.pages = ck.pages;
+    ok = ok && ( 1 == fwrite( & end, sizeof( end ), 1, g_checkpoint_fp ) ) &&
+         ( 0 == fflush( g_checkpoint_fp ) ) && ( 0 == fsync( fileno( g_checkpoint_fp ) ) );
+    if ( !ok )
+    {
+        printf( "can't write checkpoint file '%s'\n", g_checkpoint_name );
+        exit( 1 );
+    }
+
+    if ( !TrackDirtyPagesOI() )
+    {
+        printf( "can't track dirty pages for checkpoints\n" );
+        exit( 1 );
+    }
+} /* WriteCheckpointOI */
+
+/* reads a checkpoint, copying its pages into RAM and loading the heap state if apply is true. returns false unless it's complete */
+
+static bool ReadCheckpointOI( FILE * fp, struct OICheckpoint * pck, bool apply )
+{
+    struct OICheckpointPage pg;
+    struct OICheckpointEnd end;
+    uint64_t i;
+
+    if ( ( 1 != fread( pck, sizeof( * pck ), 1, fp ) ) || memcmp( pck->sig, CHECKPOINT_SIG, 4 ) )
+        return false;
+
+    for ( i = 0; i < pck->pages; i++ )
+    {
+        if ( ( 1 != fread( & pg, sizeof( pg ), 1, fp ) ) || ( pg.offset > pck->ram_size ) || ( pg.length > pck->ram_size - pg.offset ) )
+            return false;
+
+        if ( apply )
+        {
+            if ( 1 != fread( ram + pg.offset, (size_t) pg.length, 1, fp ) )
+                return false;
+        }
+        else if ( 0 != fseeko( fp, (off_t) pg.length, SEEK_CUR ) )
+            return false;
+    }
+
+    if ( !ReadHeapOI( fp, pck->ram_size, apply ) )
+        return false;
+
+    return ( 1 == fread( & end, sizeof( end ), 1, fp ) ) && !memcmp( end.sig, CHECKPOINT_END, 4 ) && ( end.pages == pck->pages );
+} /* ReadCheckpointOI */
+
+/* loads the app's RAM and registers from the resume file and leaves it open for more checkpoints. returns 0 or an error */
+
+static char * ResumeOI( uint32_t * pcode_size )
+{
+    struct OICheckpoint ck, last;
+    FILE * fp;
+    off_t good;
+    uint64_t i, count;
+
+    fp = fopen( g_resume_name, "r+b" );
+    if ( !fp )
+    {
+        sprintf( g_load_error, "can't open checkpoint file '%s'", g_resume_name );
+        return g_load_error;
+    }
+
+    /* find the last complete checkpoint. anything after it was cut short */
+    good = 0;
+    count = 0;
+    while ( ReadCheckpointOI( fp, & ck, false ) )
+    {
+        good = ftello( fp );
+        memcpy( & last, & ck, sizeof( last ) );
+        count++;
+    }
+
+    /* records have the build's struct OneImage, so another build's file doesn't parse */
+    if ( 0 == count )
+    {
+        fseeko( fp, 0, SEEK_SET );
+        if ( ( 1 == fread( & ck, 8, 1, fp ) ) && !memcmp( ck.sig, CHECKPOINT_SIG, 4 ) && ( sizeof( struct OneImage ) != ck.state_size ) )
+            last.state_size = 0;
+        else
+        {
+            fclose( fp );
+            return LoadErrorOI( "the checkpoint file has no complete checkpoints" );
+        }
+    }
+
+    if ( ( sizeof( struct OneImage ) != last.state_size ) || ( last.image_width > sizeof( oi_t ) ) )
+    {
+        fclose( fp );
+        return LoadErrorOI( "the checkpoint was written by a different build of oios" );
+    }
+
+    image_width = last.image_width;
+    ram_size = ReserveRamOI( last.ram_size, & ram, image_width );
+    if ( ( 0 == ram ) || ( ram_size != last.ram_size ) )
+    {
+        fclose( fp );
+        sprintf( g_load_error, "can't reserve the checkpoint's %llu bytes of RAM", (unsigned long long) last.ram_size );
+        return g_load_error;
+    }
+
+    /* set up the engine for the image width, then replace RAM and the registers */
+    ResetOI( (oi_t) last.header.loRamRequired, last.state.rpc, last.state.rsp, image_width );
+
+    fseeko( fp, 0, SEEK_SET );
+    for ( i = 0; i < count; i++ )
+    {
+        if ( !ReadCheckpointOI( fp, & ck, true ) )
+        {
+            fclose( fp );
+            return LoadErrorOI( "can't read checkpoint file" );
+        }
+    }
+
+    memcpy( & g_oi, & last.state, sizeof( g_oi ) );
+    memcpy( & g_header, & last.header, sizeof( g_header ) );
+
+    /* later checkpoints replace the partial one, if any */
+    if ( ( 0 != ftruncate( fileno( fp ), good ) ) || ( 0 != fseeko( fp, good, SEEK_SET ) ) )
+    {
+        fclose( fp );
+        return LoadErrorOI( "can't truncate checkpoint file" );
+    }
+
+    g_checkpoint_fp = fp;
+    g_checkpoint_name = g_resume_name;
+    * pcode_size = last.header.cbCode;
+    return 0;
+} /* ResumeOI */
+
+/* starts dirty page tracking and the checkpoint signal and timer. resumed says the app's RAM came from a checkpoint */
+
+static void StartCheckpointsOI( bool resumed )
+{
+    struct sigaction sa;
+    struct itimerval timer;
+
+    if ( !TrackDirtyPagesOI() )
+    {
+        printf( "can't track dirty pages for checkpoints\n" );
+        exit( 1 );
+    }
+
+    /* the first checkpoint of a new run has the image and the arguments and stack above it */
+    if ( !resumed )
+    {
+        MarkDirtyOI( 0, (uint64_t) g_header.cbCode + g_header.cbInitializedData );
+        MarkDirtyOI( g_oi.rsp, ram_size - g_oi.rsp );
+    }
+
+    memset( & sa, 0, sizeof( sa ) );
+    sa.sa_handler = CheckpointSignalOI;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset( & sa.sa_mask );
+    sigaction( SIGUSR1, & sa, 0 );
+
+    if ( 0 != g_checkpoint_seconds )
+    {
+        sigaction( SIGALRM, & sa, 0 );
+        memset( & timer, 0, sizeof( timer ) );
+        timer.it_value.tv_sec = g_checkpoint_seconds;
+        timer.it_interval.tv_sec = g_checkpoint_seconds;
+        setitimer( ITIMER_REAL, & timer, 0 );
+    }
+} /* StartCheckpointsOI */
+
+/* parses file[,seconds] in place. returns the file name or 0 if the argument is malformed */
+
+static char * CheckpointArgOI( char * parg )
+{
+    char * comma;
+
+    comma = strchr( parg, ',' );
+    if ( 0 != comma )
+    {
+        * comma = 0;
+        g_checkpoint_seconds = atoi( comma + 1 );
+        if ( g_checkpoint_seconds < 1 )
+            return 0;
+    }
+
+    return ( 0 == * parg ) ? 0 : parg;
+} /* CheckpointArgOI */
+
+#endif /* OI_CHECKPOINT */
+
+#ifdef OI_CONTEXT
+
+/*  -parallel:N runs each line of a jobs file ("app arg1 arg2 ...") as its own guest in its own OIContext, N at a
+    time on a pool of threads. Blank lines and lines starting with # are skipped. Guests share stdout. A job that
+    can't load, runs an illegal instruction, or faults under -g is reported and ends without stopping the others,
+    and oios then exits with 1.
+*/
+
+#define MAX_JOB_ARGS 32
+#define MAX_THREADS 256
+
+struct OIJobs
+{
+    char ** lines;
+    int count;
+    int next;
+    int failed;
+    bool decode_cache;
+    pthread_mutex_t lock;
+};
+
+/* loads and runs a job in the selected context. returns false if it can't be loaded or OIHardTermination() ends it */
+
+static bool LoadJobOI( struct OIJobs * jobs, int job, char * appname, int argc, char * args[] )
+{
+    char * error;
+    uint32_t code_size;
+    sigjmp_buf abort;
+
+    g_job_abort = & abort;
+    if ( 0 != sigsetjmp( abort, 1 ) )
+    {
+        /* OIHardTermination() came back here after the error was printed */
+        g_job_abort = 0;
+        printf( "job %d: ended by an error\n", job + 1 );
+        OIHalt();
+        return false;
+    }
+
+    error = LoadOI( appname, argc, args, ( argc > 1 ) ? 1 : -1, false, & code_size );
+    if ( 0 == error )
+    {
+#ifdef OI_PREDECODE
+        if ( jobs->decode_cache )
+            EnableDecodeCacheOI( (oi_t) code_size );
+#endif
+        do
+        {
+            ExecuteOI();
+        } while ( !g_halted );
+    }
+    g_job_abort = 0;
+
+    if ( 0 != error )
+        printf( "job %d: %s\n", job + 1, error );
+    return ( 0 == error );
+} /* LoadJobOI */
+
+/* returns false if the job failed */
+
+static bool RunJobOI( struct OIJobs * jobs, int job, char * line )
+{
+    char * args[ MAX_JOB_ARGS ];
+    char appname[ 80 ];
+    int argc;
+    struct OIContext * context;
+    bool ok;
+
+    argc = 0;
+    while ( argc < MAX_JOB_ARGS )
+    {
+        while ( isspace( (unsigned char) * line ) )
+            line++;
+        if ( 0 == * line )
+            break;
+        args[ argc++ ] = line;
+        while ( ( 0 != * line ) && !isspace( (unsigned char) * line ) )
+            line++;
+        if ( 0 != * line )
+            * line++ = 0;
+    }
+
+    if ( ( 0 == argc ) || ( '#' == args[ 0 ][ 0 ] ) )
+        return true;
+
+    if ( strlen( args[ 0 ] ) >= sizeof( appname ) - 3 )
+    {
+        printf( "job %d: app name is too long\n", job + 1 );
+        return false;
+    }
+
+    strcpy( appname, args[ 0 ] );
+    if ( !strchr( appname, '.' ) )
+        strcat( appname, ".oi" );
+
+    context = OICreate( 0 );
+    if ( 0 == context )
+    {
+        printf( "job %d: can't allocate RAM for the app\n", job + 1 );
+        return false;
+    }
+
+    OISelect( context );
+    g_halted = 0;
+    StartOutputOI();
+
+    ok = LoadJobOI( jobs, job, appname, argc, args );
+    OIDestroy( context );
+    return ok;
+} /* RunJobOI */
+
+static void * JobWorkerOI( void * p )
+{
+    struct OIJobs * jobs;
+    int job;
+    bool ok;
+
+    jobs = (struct OIJobs *) p;
+    ok = true;
+    for ( ;; )
+    {
+        pthread_mutex_lock( & jobs->lock );
+        if ( !ok )
+            jobs->failed++;
+        job = jobs->next++;
+        pthread_mutex_unlock( & jobs->lock );
+
+        if ( job >= jobs->count )
+            break;
+        ok = RunJobOI( jobs, job, jobs->lines[ job ] );
+    }
+
+    return 0;
+} /* JobWorkerOI */
+
+/* runs every job in the file jobs_name on threads threads. returns the process exit code: 1 if any job failed */
+
+static int RunParallelOI( const char * jobs_name, int threads, bool decode_cache )
+{
+    FILE * fp;
+    char * text, * p;
+    long length;
+    int i, created;
+    struct OIJobs jobs;
+    pthread_t workers[ MAX_THREADS ];
+
+    fp = fopen( jobs_name, "rb" );
+    if ( !fp )
+    {
+        printf( "can't open jobs file '%s'\n", jobs_name );
+        return 1;
+    }
+
+    fseek( fp, 0, SEEK_END );
+    length = ftell( fp );
+    fseek( fp, 0, SEEK_SET );
+    text = (char *) malloc( (size_t) length + 1 );
+    if ( ( 0 == text ) || ( 1 != fread( text, (size_t) length, 1, fp ) && 0 != length ) )
+    {
+        printf( "can't read jobs file '%s'\n", jobs_name );
+        fclose( fp );
+        free( text );
+        return 1;
+    }
+    fclose( fp );
+    text[ length ] = 0;
+
+    /* one job per line */
+    jobs.count = 0;
+    for ( p = text; 0 != * p; p++ )
+        if ( '\n' == * p )
+            jobs.count++;
+    jobs.lines = (char **) malloc( sizeof( char * ) * ( jobs.count + 1 ) );
+    if ( 0 == jobs.lines )
+    {
+        free( text );
+        return 1;
+    }
+
+    jobs.count = 0;
+    for ( p = text; 0 != * p; )
+    {
+        jobs.lines[ jobs.count++ ] = p;
+        while ( ( 0 != * p ) && ( '\n' != * p ) )
+            p++;
+        if ( 0 != * p )
+            * p++ = 0;
+    }
+
+    jobs.next = 0;
+    jobs.failed = 0;
+    jobs.decode_cache = decode_cache;
+    pthread_mutex_init( & jobs.lock, 0 );
+
+    if ( threads > jobs.count )
+        threads = jobs.count;
+    for ( created = 0; created < threads; created++ )
+        if ( 0 != pthread_create( & workers[ created ], 0, JobWorkerOI, & jobs ) )
+            break;
+
+    /* if no thread could be started, run the jobs here */
+    if ( 0 == created )
+        JobWorkerOI( & jobs );
+
+    for ( i = 0; i < created; i++ )
+        pthread_join( workers[ i ], 0 );
+
+    pthread_mutex_destroy( & jobs.lock );
+    free( jobs.lines );
+    free( text );
+    return ( 0 == jobs.failed ) ? 0 : 1;
+} /* RunParallelOI */
+
+#endif /* OI_CONTEXT */
+
+#ifdef OI_SERVE
+
+/*  oios -serve:socket keeps images loaded and runs them for oios -client:socket app [args] requests, so a run
+    doesn't pay for starting oios and reading the image. Each cached image has its own OIContext whose RAM holds
+    the code and initialized data with room above for the arguments. For a request the server forks a child with
+    that context selected, and the child forks the guest, which starts with the loaded RAM copy-on-write, writes
+    its arguments, resets the registers, and runs with the client's stdout (passed over the socket) as its own.
+    The child then sends the guest's exit status back to the client. An image whose file's mtime or size has
+    changed is reloaded, and the least recently used image is dropped when the cache is full.
+
+    A request is a uint32_t byte count, sent with the client's stdout as SCM_RIGHTS, then that many bytes of
+    null-terminated strings: the image's absolute path, argv[ 0 ], and the app's arguments.
+*/
+
+#define SERVE_IMAGES 32
+#define SERVE_ARG_ROOM 16384       /* RAM reserved above an image for a request's arguments */
+#define SERVE_MAX_REQUEST 8192
+#define SERVE_MAX_ARGS 128
+
+struct OIServeImage
+{
+    char path[ 256 ];
+    time_t mtime;
+    off_t size;
+    uint64_t last_used;
+    struct OIContext * context;
+    struct OIHeader header;
+    uint8_t image_width;
+    uint8_t * ram;      /* oios's copies of the context's RAM globals, restored when the image is reused */
+    uint64_t ram_size;
+};
+
+static struct OIServeImage g_serve_images[ SERVE_IMAGES ];
+static uint64_t g_serve_requests = 0;
+
+/* loads path's image into a new context for image, which becomes the thread's guest. returns 0 or an error */
+
+static const char * ServeLoadOI( struct OIServeImage * image, const char * path, struct stat * pst )
+{
+    FILE * fp;
+    const char * error;
+    uint64_t required;
+    size_t length;
+    long base;
+    bool mapped;
+
+    OIDestroy( image->context );
+    memset( image, 0, sizeof( * image ) );
+    image->context = OICreate( 0 );
+    if ( 0 == image->context )
+        return "can't allocate a context for the app";
+    OISelect( image->context );
+
+    strcpy( image->path, path );
+    fp = OpenImageOI( image->path, & base );
+    if ( !fp )
+    {
+        image->path[ 0 ] = 0;
+        return g_load_error;
+    }
+
+    error = ReadHeaderOI( fp, false, & image->header );
+    if ( 0 == error )
+    {
+        required = (uint64_t) image->header.loRamRequired + SERVE_ARG_ROOM;
+        if ( 8 == image_width )
+            required += (uint64_t) image->header.hiRamRequired << 32;
+        else if ( ( 2 == image_width ) && ( required > 65536 ) )
+            required = 65536;
+
+        ram_size = ReserveRamOI( required, & ram, image_width );
+        if ( 0 == ram )
+            error = "insufficient RAM for this application";
+    }
+
+    /* the RAM stays fresh, so the guest's ResetOI() won't clear the code and data read here */
+    if ( 0 == error )
+    {
+        length = (size_t) ( image->header.cbCode + image->header.cbInitializedData );
+        mapped = ( 0 == ( image->header.flags & OI_FLAG_COMPRESSED ) ) &&
+                 MapCodeOI( fileno( fp ), base + oi_code_offset( image->header ), image->header.cbCode, image->header.cbInitializedData, & ram );
+        if ( !mapped )
+        {
+            fseek( fp, base + (long) oi_code_offset( image->header ), SEEK_SET );
+            if ( ( image->header.flags & OI_FLAG_COMPRESSED ) ? !ReadCompressedOI( fp, ram, length ) : ( 1 != fread( ram, length, 1, fp ) ) )
+                error = "can't read image file";
+        }
+    }
+    fclose( fp );
+
+    if ( 0 != error )
+    {
+        OIDestroy( image->context );
+        memset( image, 0, sizeof( * image ) );
+        return error;
+    }
+
+    image->mtime = pst->st_mtime;
+    image->size = pst->st_size;
+    image->image_width = image_width;
+    image->ram = ram;
+    image->ram_size = ram_size;
+    return 0;
+} /* ServeLoadOI */
+
+/* finds or loads path's image and makes it the thread's guest. returns 0 or an error */
+
+static const char * ServeImageOI( const char * path, struct OIServeImage ** pimage )
+{
+    struct OIServeImage * image;
+    struct stat st;
+    char file[ sizeof( image->path ) ];
+    const char * error;
+    char * sep;
+    int i;
+
+    /* a bundle entry is reloaded when the bundle changes */
+    if ( strlen( path ) < sizeof( file ) )
+    {
+        strcpy( file, path );
+        sep = BundleSeparatorOI( file );
+        if ( 0 != sep )
+            * sep = 0;
+    }
+
+    if ( ( strlen( path ) >= sizeof( file ) ) || ( 0 != stat( file, & st ) ) )
+    {
+        sprintf( g_load_error, "can't open image file '%.100s'", path );
+        return g_load_error;
+    }
+
+    image = & g_serve_images[ 0 ];
+    for ( i = 0; i < SERVE_IMAGES; i++ )
+    {
+        if ( !strcmp( g_serve_images[ i ].path, path ) )
+        {
+            image = & g_serve_images[ i ];
+            break;
+        }
+        if ( g_serve_images[ i ].last_used < image->last_used )
+            image = & g_serve_images[ i ];
+    }
+
+    if ( strcmp( image->path, path ) || ( image->mtime != st.st_mtime ) || ( image->size != st.st_size ) )
+    {
+        error = ServeLoadOI( image, path, & st );
+        if ( 0 != error )
+            return error;
+    }
+    else
+        OISelect( image->context );
+
+    image->last_used = ++g_serve_requests;
+    image_width = image->image_width;
+    ram = image->ram;
+    ram_size = image->ram_size;
+    * pimage = image;
+    return 0;
+} /* ServeImageOI */
+
+/* runs in the guest process: sets up the arguments and registers and runs the app. doesn't return */
+
+static void ServeRunOI( struct OIServeImage * image, int argc, char * argv[], bool decode_cache, bool jit )
+{
+    size_t head_len;
+    int child_argc, first_child_arg;
+
+    StartOutputOI();
+    child_argc = 1;
+    first_child_arg = ( argc > 1 ) ? 1 : -1;
+    head_len = size_args_env( argv[ 0 ], argc, argv, & child_argc, first_child_arg );
+    if ( (uint64_t) image->header.loRamRequired + head_len > ram_size )
+    {
+        printf( "the arguments don't fit in the app's RAM\n" );
+        fflush( stdout );
+        _exit( 1 );
+    }
+
+    init_args_env( argv[ 0 ], argc, argv, child_argc, first_child_arg, head_len );
+    ResetOI( (oi_t) image->header.loRamRequired, (oi_t) image->header.loInitialPC, (oi_t) ( ram_size - head_len ), image_width );
+    memcpy( & g_header, & image->header, sizeof( g_header ) );
+    g_initial_sp = g_oi.rsp;
+    StartHeapOI( (oi_t) ( ram_size - head_len ) );
+
+#ifdef OI_PREDECODE
+    if ( decode_cache )
+    {
+        EnableDecodeCacheOI( (oi_t) image->header.cbCode );
+#ifdef OI_JIT
+        if ( jit )
+            EnableJitOI();
+#endif
+    }
+#endif
+
+    g_halted = 0;
+    do
+    {
+        ExecuteOI();
+    } while ( !g_halted );
+
+    fflush( stdout );
+    _exit( 0 );
+} /* ServeRunOI */
+
+/* reads exactly length bytes. returns false on error or end of file */
+
+static bool ReadAllOI( int fd, char * p, size_t length )
 {
-    g_halted = 1;
-} /* OIHalt */
+    ssize_t got;
 
-#ifdef OLDCPU
-static size_t round_up( x, multiple ) size_t x; size_t multiple;
-#else
-static size_t round_up( size_t x, size_t multiple )
-#endif
+    while ( 0 != length )
+    {
+        got = read( fd, p, length );
+        if ( got < 0 && EINTR == errno )
+            continue;
+        if ( got <= 0 )
+            return false;
+        p += got;
+        length -= (size_t) got;
+    }
+    return true;
+} /* ReadAllOI */
+
+/* handles one client connection. the server returns right after forking, so runs overlap */
+
+static void ServeRequestOI( int conn, int listener, bool decode_cache, bool jit )
 {
-    size_t remainder;
+    static char request[ SERVE_MAX_REQUEST + 1 ];
+    char * args[ SERVE_MAX_ARGS ];
+    char control[ CMSG_SPACE( sizeof( int ) ) ];
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr * cmsg;
+    struct OIServeImage * image;
+    const char * error;
+    uint32_t length;
+    int32_t status;
+    int out, in, argc, wait_status;
+    size_t i;
+    pid_t guest;
 
-    if ( (size_t) 0 == multiple )
-        return x;
+    memset( & msg, 0, sizeof( msg ) );
+    iov.iov_base = & length;
+    iov.iov_len = sizeof( length );
+    msg.msg_iov = & iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof( control );
+    if ( sizeof( length ) != recvmsg( conn, & msg, 0 ) )
+        return;
 
-    remainder = x % multiple;
-    if ( (size_t) 0 == remainder )
-        return x;
+    cmsg = CMSG_FIRSTHDR( & msg );
+    if ( ( 0 == cmsg ) || ( SOL_SOCKET != cmsg->cmsg_level ) || ( SCM_RIGHTS != cmsg->cmsg_type ) )
+        return;
+    memcpy( & out, CMSG_DATA( cmsg ), sizeof( out ) );
 
-    return x + multiple - remainder;
-} /* round_up */
+    error = 0;
+    if ( ( length > SERVE_MAX_REQUEST ) || ( 0 == length ) || !ReadAllOI( conn, request, length ) || ( 0 != request[ length - 1 ] ) )
+        error = "malformed request";
 
-#ifdef OLDCPU
-size_t size_args_env( appname, argc, argv, pchild_argc, first_child_arg )
-    char * appname; int argc; char * argv[]; int *pchild_argc; int first_child_arg;
-#else
-size_t size_args_env( char * appname, int argc, char * argv[], int *pchild_argc, int first_child_arg )
-#endif
+    /* the image path, then the app's argv */
+    argc = -1;
+    for ( i = 0; ( 0 == error ) && ( i < length ); i += strlen( request + i ) + 1 )
+    {
+        if ( argc >= SERVE_MAX_ARGS )
+            error = "too many arguments";
+        else if ( argc >= 0 )
+            args[ argc ] = request + i;
+        argc++;
+    }
+
+    if ( ( 0 == error ) && ( argc < 1 ) )
+        error = "malformed request";
+
+    if ( 0 == error )
+        error = ServeImageOI( request, & image );
+
+    if ( 0 != error )
+    {
+        dprintf( out, "%s\n", error );
+        close( out );
+        status = 1;
+        write( conn, & status, sizeof( status ) );
+        return;
+    }
+
+    fflush( stdout );
+    if ( 0 != fork() )
+    {
+        close( out );
+        return;
+    }
+
+    /* this child waits for the guest and reports its status */
+    close( listener );
+    signal( SIGCHLD, SIG_DFL );
+    guest = fork();
+    if ( 0 == guest )
+    {
+        /* the client only sends its stdout, so guest reads of stdin see end of file */
+        in = open( "/dev/null", O_RDONLY );
+        if ( in >= 0 )
+            dup2( in, 0 );
+        dup2( out, 1 );
+        close( out );
+        close( conn );
+        ServeRunOI( image, argc, args, decode_cache, jit );
+    }
+
+    close( out );
+    status = 1;
+    if ( ( guest > 0 ) && ( guest == waitpid( guest, & wait_status, 0 ) ) )
+        status = WIFEXITED( wait_status ) ? WEXITSTATUS( wait_status ) : 128 + WTERMSIG( wait_status );
+    write( conn, & status, sizeof( status ) );
+    _exit( 0 );
+} /* ServeRequestOI */
+
+static int ServeOI( const char * socket_name, bool decode_cache, bool jit )
 {
-    size_t len, head_len;
-    int i;
+    struct sockaddr_un address;
+    int listener, conn;
 
-    len = strlen( appname );
-    head_len = (int) ( 6 * sizeof( oi_t ) + ( 1 + len ) );
+    memset( & address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    if ( strlen( socket_name ) >= sizeof( address.sun_path ) )
+    {
+        printf( "socket name '%s' is too long\n", socket_name );
+        return 1;
+    }
+    strcpy( address.sun_path, socket_name );
 
-    if ( -1 != first_child_arg )
+    listener = socket( AF_UNIX, SOCK_STREAM, 0 );
+    unlink( socket_name );
+    if ( ( listener < 0 ) || ( 0 != bind( listener, (struct sockaddr *) & address, sizeof( address ) ) ) || ( 0 != listen( listener, 64 ) ) )
     {
-        *pchild_argc = 1 + ( argc - first_child_arg );
-        for ( i = first_child_arg; i < argc; i++ )
-            head_len += (int) ( sizeof( oi_t ) + ( 1 + strlen( argv[ i ] ) ) );
+        printf( "can't listen on socket '%s'\n", socket_name );
+        return 1;
     }
 
-    /* make sure the stack is image width aligned */
-    head_len = round_up( head_len, sizeof( oi_t ) );
-    return head_len;
-} /* size_args_env */
+    /* the children that report each run's status aren't waited for */
+    signal( SIGCHLD, SIG_IGN );
 
-#ifdef OLDCPU
-void init_args_env( appname, argc, argv, child_argc, first_child_arg, head_len )
-    char * appname; int argc; char * argv[]; int child_argc; int first_child_arg; size_t head_len;
-#else
-void init_args_env( char * appname, int argc, char * argv[], int child_argc, int first_child_arg, size_t head_len )
-#endif
+    for ( ;; )
+    {
+        conn = accept( listener, 0, 0 );
+        if ( conn < 0 )
+        {
+            if ( EINTR == errno )
+                continue;
+            printf( "can't accept connections on socket '%s'\n", socket_name );
+            return 1;
+        }
+
+        ServeRequestOI( conn, listener, decode_cache, jit );
+        close( conn );
+    }
+} /* ServeOI */
+
+/* sends a run request for appname to the server and returns the app's exit status */
+
+static int ClientOI( const char * socket_name, char * appname, int argc, char * argv[], int first_child_arg )
 {
-    int i;
-    oi_t offset, x;
+    static char request[ SERVE_MAX_REQUEST ];
+    char control[ CMSG_SPACE( sizeof( int ) ) ];
+    struct sockaddr_un address;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr * cmsg;
+    char * path, * sep, * arg;
+    uint32_t length;
+    int32_t status;
+    int conn, out, i;
+    size_t arg_len;
 
-    offset = (oi_t) ( ram_size - head_len );
-    x = (oi_t) child_argc;
-    memcpy( &ram[ offset ], &x, sizeof( oi_t ) );                           /* argc */
-    offset += sizeof( oi_t );
-    x = offset + ( 2 * sizeof( oi_t ) );                                    /* get past argv and penv to argv array */
-    memcpy( & ram[ offset ], &x, sizeof( oi_t ) );                          /* argv */
-    offset += sizeof( oi_t );
-    x = offset + (oi_t) ( ( child_argc + 2 ) * sizeof( oi_t ) );
-    memcpy( & ram[ offset ], &x, sizeof( oi_t ) );                          /* penv */
-    x += sizeof( oi_t );                                                    /* reserve 1 blank environment entry */
-    offset += sizeof( oi_t );
+    /* the server has its own working directory, so send the absolute path of the image or bundle */
+    sep = BundleSeparatorOI( appname );
+    if ( 0 != sep )
+        * sep = 0;
+    path = realpath( appname, 0 );
+    if ( 0 != sep )
+        * sep = ':';
+    if ( 0 == path )
+    {
+        printf( "can't open image file '%s'\n", appname );
+        return 1;
+    }
 
-    strcpy( (char *) & ram[ x ], appname );
-    memcpy( & ram[ offset ], &x, sizeof( oi_t ) );                          /* argv[0] */
-    offset += sizeof( oi_t );
-    x += (oi_t) ( 1 + strlen( appname ) );
+    if ( strlen( path ) + ( ( 0 != sep ) ? strlen( sep ) : 0 ) >= sizeof( request ) )
+    {
+        printf( "the image path is too long to send\n" );
+        return 1;
+    }
 
-    if ( -1 != first_child_arg )
+    strcpy( request, path );
+    if ( 0 != sep )
+        strcat( request, sep );
+    length = (uint32_t) strlen( request ) + 1;
+    free( path );
+
+    /* then argv[ 0 ] and the arguments */
+    for ( i = -1; i < argc; i++ )
     {
-        for ( i = first_child_arg; i < argc; i++ )
+        if ( ( i >= 0 ) && ( ( -1 == first_child_arg ) || ( i < first_child_arg ) ) )
+            continue;
+        arg = ( -1 == i ) ? appname : argv[ i ];
+        arg_len = strlen( arg ) + 1;
+        if ( length + arg_len > sizeof( request ) )
         {
-            strcpy( (char *) & ram[ x ], argv[ i ] );
-            memcpy( & ram[ offset ], &x, sizeof( oi_t ) );                  /* argv[1..n] */
-            offset += sizeof( oi_t );
-            x += (oi_t) ( 1 + strlen( argv[ i ] ) );
+            printf( "the arguments are too long to send\n" );
+            return 1;
         }
+        memcpy( request + length, arg, arg_len );
+        length += (uint32_t) arg_len;
     }
 
-    x = 0;
-    memcpy( & ram[ offset ], &x, sizeof( oi_t ) );                          /* 0 terminator to argv array */
-    offset += sizeof( oi_t );
-    memcpy( & ram[ offset ], &x, sizeof( oi_t ) );                          /* 0 terminator to env array */
-    offset += sizeof( oi_t );
+    memset( & address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    strncpy( address.sun_path, socket_name, sizeof( address.sun_path ) - 1 );
+    conn = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( ( conn < 0 ) || ( 0 != connect( conn, (struct sockaddr *) & address, sizeof( address ) ) ) )
+    {
+        printf( "can't connect to oios -serve on socket '%s'\n", socket_name );
+        return 1;
+    }
 
-#ifndef NDEBUG
-    trace( "argument and environment information:\n" );
-    trace_binary_data( & ram[ ram_size - head_len ], head_len, 2 );
-#endif
-} /* init_args_env */
+    fflush( stdout );
+    out = 1;
+    memset( & msg, 0, sizeof( msg ) );
+    memset( control, 0, sizeof( control ) );
+    iov.iov_base = & length;
+    iov.iov_len = sizeof( length );
+    msg.msg_iov = & iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof( control );
+    cmsg = CMSG_FIRSTHDR( & msg );
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN( sizeof( int ) );
+    memcpy( CMSG_DATA( cmsg ), & out, sizeof( out ) );
+
+    if ( ( sizeof( length ) != sendmsg( conn, & msg, 0 ) ) || ( (ssize_t) length != write( conn, request, length ) ) ||
+         !ReadAllOI( conn, (char *) & status, sizeof( status ) ) )
+    {
+        printf( "the request to oios -serve failed\n" );
+        return 1;
+    }
+
+    close( conn );
+    return status;
+} /* ClientOI */
+
+#endif /* OI_SERVE */
 
 static void usage()
 {
     printf( "usage: oios [flags] <appname.oi>\n" );
     printf( "    OneImage Operating System.\n" );
     printf( "    flags:\n" );
+#ifdef OI_PREDECODE
+    printf( "        -d      Disable the decode cache and interpret instructions from RAM\n" );
+#endif
+#ifdef OI_MMAP
+    printf( "        -g      Put guard pages around guest RAM and report out of range loads and stores\n" );
+    printf( "                RAM is at least 8MB (64k for 2-byte images) and only accesses past it fault\n" );
+#endif
     printf( "        -h      Show image headers then exit\n" );
+#ifdef OI_JIT
+    printf( "        -j      Compile hot functions and loops to native x86-64 code\n" );
+#endif
+#ifdef OI_MMAP
+    printf( "        -l      Ask for transparent huge pages for large guest RAM\n" );
+    printf( "        -m      Map code and data from the image file so instances share it. writes unshare a page\n" );
+    printf( "        -r      Like -m, but writing to the code is an error\n" );
+#endif
+#ifdef OI_PREDECODE
+    printf( "        -n      Count retired instructions for syscall 20, with -j and superinstructions off\n" );
+    printf( "        -s      Show the most frequent instructions, pairs, and triples when the app ends\n" );
+#endif
+#ifdef OI_CONTEXT
+    printf( "        -parallel:N  <appname.oi> is a file of app command lines to run N at a time\n" );
+#endif
+#ifdef OI_SERVE
+    printf( "        -serve:S     Keep images loaded and run them for -client requests on unix socket S\n" );
+    printf( "        -client:S    Run <appname.oi> with oios -serve on unix socket S\n" );
+#endif
+#ifdef OI_SIM
+    printf( "        -sim[:I,D,L2]  Simulate L1I, L1D, and L2 caches and branch prediction and report them at the end\n" );
+    printf( "                each cache is size/ways/line. the default is 32k/8/64,32k/8/64,1m/16/64\n" );
+#endif
+    printf( "        -flush:N     Write console output every N lines, or with 0 only when the buffer fills and at exit\n" );
+    printf( "                the default is 1 for a terminal and 0 otherwise\n" );
+    printf( "        -snapshot:F  Run the app to its init done syscall, write its RAM to image F, and exit\n" );
+#ifdef OI_CHECKPOINT
+    printf( "        -checkpoint:F[,S]  Append a checkpoint to F on SIGUSR1 and every S seconds\n" );
+    printf( "        -resume:F[,S]  Continue the app from checkpoint file F, then checkpoint like -checkpoint\n" );
+#endif
 #ifndef NDEBUG
     printf( "        -i      Enable instruction tracing if tracing is enabled\n" );
     printf( "        -p      Show performance information\n" );
@@ -230,13 +3677,20 @@ int main( argc, argv ) int argc; char * argv[];
 int cdecl main( int argc, char * argv[] )
 #endif
 {
-    size_t result, head_len;
     char * input, * pc, * parg, c, ca;
-    FILE * fp;
-    int i, first_child_arg, child_argc;
-    bool show_image_header, tracing, instruction_tracing, show_perf;
-    uint32_t total_instructions, ram_requirement;
-    struct OIHeader h;
+    char * error;
+    int i, first_child_arg, parallel;
+#ifdef OI_SERVE
+    char * serve_name, * client_name;
+#endif
+    bool show_image_header, tracing, instruction_tracing, show_perf, decode_cache, profile;
+#ifdef OI_JIT
+    bool jit;
+#endif
+#ifdef OI_SIM
+    bool simulate;
+#endif
+    uint32_t total_instructions, code_size;
     static char appname[ 80 ];
 
     total_instructions = 0;
@@ -245,9 +3699,20 @@ int cdecl main( int argc, char * argv[] )
     instruction_tracing = false;
     show_image_header = false;
     show_perf = false;
+    decode_cache = true;
+    profile = false;
+#ifdef OI_JIT
+    jit = false;
+#endif
+#ifdef OI_SIM
+    simulate = false;
+#endif
     first_child_arg = -1;
-    child_argc = 1;
-    head_len = 0;
+    parallel = 0;
+#ifdef OI_SERVE
+    serve_name = 0;
+    client_name = 0;
+#endif
 
     for ( i = 1; i < argc; i++ )
     {
@@ -257,8 +3722,86 @@ int cdecl main( int argc, char * argv[] )
         if ( ( 0 == input ) && ( '-' == c ) )
         {
             ca = (char) tolower( parg[1] );
+#ifdef OI_CONTEXT
+            if ( !strncmp( parg, "-parallel:", 10 ) )
+            {
+                parallel = atoi( parg + 10 );
+                if ( parallel < 1 || parallel > MAX_THREADS )
+                    usage();
+                continue;
+            }
+#endif
+#ifdef OI_SERVE
+            if ( !strncmp( parg, "-serve:", 7 ) && ( 0 != parg[ 7 ] ) )
+            {
+                serve_name = parg + 7;
+                continue;
+            }
+            if ( !strncmp( parg, "-client:", 8 ) && ( 0 != parg[ 8 ] ) )
+            {
+                client_name = parg + 8;
+                continue;
+            }
+#endif
+            if ( !strncmp( parg, "-flush:", 7 ) && isdigit( (unsigned char) parg[ 7 ] ) )
+            {
+                g_flush_option = atoi( parg + 7 );
+                continue;
+            }
+            if ( !strncmp( parg, "-snapshot:", 10 ) && ( 0 != parg[ 10 ] ) )
+            {
+                g_snapshot_name = parg + 10;
+                continue;
+            }
+#ifdef OI_CHECKPOINT
+            if ( !strncmp( parg, "-checkpoint:", 12 ) )
+            {
+                g_checkpoint_name = CheckpointArgOI( parg + 12 );
+                if ( 0 == g_checkpoint_name )
+                    usage();
+                continue;
+            }
+            if ( !strncmp( parg, "-resume:", 8 ) )
+            {
+                g_resume_name = CheckpointArgOI( parg + 8 );
+                if ( 0 == g_resume_name )
+                    usage();
+                continue;
+            }
+#endif
+#ifdef OI_SIM
+            if ( !strcmp( parg, "-sim" ) || !strncmp( parg, "-sim:", 5 ) )
+            {
+                if ( !EnableSimOI( ( ':' == parg[ 4 ] ) ? parg + 5 : 0 ) )
+                    usage();
+                simulate = true;
+                continue;
+            }
+#endif
             if ( 'h' == ca )
                 show_image_header = true;
+#ifdef OI_PREDECODE
+            else if ( 'd' == ca )
+                decode_cache = false;
+            else if ( 'n' == ca )
+                EnableRetiredCountOI();
+            else if ( 's' == ca )
+                profile = true;
+#endif
+#ifdef OI_JIT
+            else if ( 'j' == ca )
+                jit = true;
+#endif
+#ifdef OI_MMAP
+            else if ( 'g' == ca )
+                EnableGuardPagesOI();
+            else if ( 'l' == ca )
+                EnableHugePagesOI();
+            else if ( 'm' == ca )
+                EnableSharedCodeOI( false );
+            else if ( 'r' == ca )
+                EnableSharedCodeOI( true );
+#endif
 #ifndef NDEBUG
             else if ( 'i' == ca )
                 instruction_tracing = true;
@@ -279,6 +3822,38 @@ int cdecl main( int argc, char * argv[] )
         }
     }
 
+#ifdef FILE_BUFFER_SIZE
+    setvbuf( stdin, 0, _IOFBF, FILE_BUFFER_SIZE );
+#endif
+
+#ifdef OI_SERVE
+    /* the server runs apps named by its clients */
+    if ( 0 != serve_name )
+    {
+        if ( ( 0 != input ) || ( 0 != client_name ) || ( 0 != parallel ) || profile || show_image_header || ( 0 != g_snapshot_name ) )
+            usage();
+#ifdef OI_CHECKPOINT
+        if ( ( 0 != g_checkpoint_name ) || ( 0 != g_resume_name ) )
+            usage();
+#endif
+#ifdef OI_SIM
+        if ( simulate )
+            usage();
+#endif
+#ifdef OI_JIT
+        return ServeOI( serve_name, decode_cache, jit );
+#else
+        return ServeOI( serve_name, decode_cache, false );
+#endif
+    }
+#endif
+
+#ifdef OI_CHECKPOINT
+    /* the checkpoint file stands in for the app and its arguments */
+    if ( ( 0 != g_resume_name ) && ( 0 == input ) )
+        input = g_resume_name;
+#endif
+
     if ( 0 == input )
     {
         printf( "no input filename specified\n" );
@@ -290,123 +3865,137 @@ int cdecl main( int argc, char * argv[] )
         enable_trace( "oios.log" );
 #endif
 
-    strcpy( appname, input );
-    pc = strchr( appname, '.' );
-    if ( !pc )
-        strcat( appname, ".oi" );
-
-#ifdef AZTECCPM
-    fp = fopen( appname, "r" );
-#else
-    fp = fopen( appname, "rb" );
-#endif
-    if ( !fp )
+#ifdef OI_CHECKPOINT
+    if ( ( 0 != g_checkpoint_name ) || ( 0 != g_resume_name ) )
     {
-        printf( "can't open image file '%s'\n", appname );
-        usage();
+        if ( ( 0 != g_checkpoint_name ) && ( 0 != g_resume_name ) )
+            usage();
+        if ( !decode_cache || show_image_header || ( 0 != parallel ) || ( 0 != g_snapshot_name ) )
+            usage();
+        if ( ( 0 != g_resume_name ) && ( ( input != g_resume_name ) || ( -1 != first_child_arg ) ) )
+            usage();
+#ifdef OI_SIM
+        if ( simulate )
+            usage();
+#endif
+#ifdef OI_JIT
+        if ( jit )
+            usage();
+#endif
     }
+#endif
 
-    result = fread( &h, sizeof( h ), 1, fp );
-    if ( 1 != result )
+#ifdef OI_CONTEXT
+    if ( 0 != parallel )
     {
-        printf( "can't read image file header\n" );
-        usage();
+        if ( profile || show_image_header || ( -1 != first_child_arg ) || ( 0 != g_snapshot_name ) )
+            usage();
+#ifdef OI_JIT
+        if ( jit )
+            usage();
+#endif
+#ifdef OI_SIM
+        if ( simulate )
+            usage();
+#endif
+        return RunParallelOI( input, parallel, decode_cache );
     }
+#endif
 
-    if ( show_image_header )
-    {
-        printf( "  signature:                %c%c\n", h.sig0, h.sig1 );
-        printf( "  version:                  %u\n", h.version );
-        printf( "  flags:                    %04xh\n", h.flags );
-        printf( "  ram required:             %u\n", h.loRamRequired );
-        printf( "  code size:                %u\n", h.cbCode );
-        printf( "  initialized data size:    %u\n", h.cbInitializedData );
-        printf( "  zero-filled data size:    %u\n", h.cbZeroFilledData );
-        printf( "  stack size:               %u\n", h.cbStack );
-        printf( "  initial PC:               %u\n", h.loInitialPC );
-        exit( 0 );
-    }
+    strcpy( appname, input );
+    pc = strchr( appname, '.' );
+    if ( !pc )
+        strcat( appname, ".oi" );
 
-    if ( 'O' != h.sig0 || 'I' != h.sig1 )
-    {
-        printf( "image signature isn't the expected OI\n" );
-        usage();
-    }
+#ifdef OI_SERVE
+    /* the other flags are the server's */
+    if ( 0 != client_name )
+        return ClientOI( client_name, appname, argc, argv, first_child_arg );
+#endif
 
-    image_width = h.flags;
-    if ( 0 == image_width )
-        image_width = 2;
-    else if ( 1 == image_width )
-        image_width = 4;
-    else if ( 2 == image_width )
-        image_width = 8;
+#ifdef OI_CHECKPOINT
+    if ( 0 != g_resume_name )
+        error = ResumeOI( & code_size );
     else
+#endif
+    error = LoadOI( appname, argc, argv, first_child_arg, show_image_header, & code_size );
+    if ( 0 != error )
     {
-        printf( "image width in header is malformed\n" );
+        printf( "%s\n", error );
         usage();
     }
 
-#ifndef NDEBUG
-    trace( "app: '%s'\n", appname );
-    trace( "  signature:                %c%c\n", h.sig0, h.sig1 );
-    trace( "  version:                  %u\n", h.version );
-    trace( "  flags:                    %04xh\n", h.flags );
-    trace( "  ram required:             %u\n", h.loRamRequired );
-    trace( "  code size:                %u\n", h.cbCode );
-    trace( "  initialized data size:    %u\n", h.cbInitializedData );
-    trace( "  zero-filled data size:    %u\n", h.cbZeroFilledData );
-    trace( "  stack size:               %u\n", h.cbStack );
-    trace( "  initial PC:               %u\n", h.loInitialPC );
-    trace( "image width: %d\n", image_width );
-#endif
-
-#ifdef OI2
-    if ( 2 != image_width )
-    {
-        printf( "this version of oios only supports 2-byte image width binaries, and this one has %u\n", image_width );
-        exit( 1 );
-    }
-#endif
-#ifdef OI4
-    if ( image_width > 4 )
+#ifdef OI_CHECKPOINT
+    if ( ( 0 != g_checkpoint_name ) && ( 0 == g_checkpoint_fp ) )
     {
-        printf( "this version of oios only supports 2- and 4-byte image width binaries, and this one has %u\n", image_width );
-        exit( 1 );
+        g_checkpoint_fp = fopen( g_checkpoint_name, "wb" );
+        if ( !g_checkpoint_fp )
+        {
+            printf( "can't create checkpoint file '%s'\n", g_checkpoint_name );
+            return 1;
+        }
     }
 #endif
 
-    head_len = size_args_env( appname, argc, argv, & child_argc, first_child_arg );
-    ram_requirement = (uint32_t) ( h.loRamRequired + head_len );
-    ram_size = RamInformationOI( ram_requirement, & ram, image_width );
-    if ( 0 == ram )
-    {
-        printf( "insufficient RAM for this application. required %u, available %u\n", (int) ram_requirement, (int) ram_size );
-        usage();
-    }
-
-    /* write the environment and argument info above where the top of stack will be */
-    init_args_env( appname, argc, argv, child_argc, first_child_arg, head_len );
-
-    ResetOI( (oi_t) h.loRamRequired, (oi_t) h.loInitialPC, (oi_t) ( ram_size - head_len ), image_width );
+#ifdef OI_SIM
+    /* the simulator runs its own copy of the plain interpreter */
+    if ( simulate )
+        decode_cache = false;
+#endif
 
-    result = fread( ram, (int) ( h.cbCode + h.cbInitializedData ), 1, fp );
-    if ( 1 != result )
+#ifdef OI_PREDECODE
+    if ( decode_cache )
     {
-        printf( "can't read image file\n" );
-        usage();
+        EnableDecodeCacheOI( (oi_t) code_size );
+        if ( profile )
+            EnableProfileOI();
+#ifdef OI_JIT
+        if ( jit )
+            EnableJitOI();
+#endif
     }
+#endif
 
-    fclose( fp );
+#ifdef OI_CHECKPOINT
+    if ( 0 != g_checkpoint_fp )
+        StartCheckpointsOI( 0 != g_resume_name );
+#endif
 
 #ifndef NDEBUG
     TraceInstructionsOI( instruction_tracing );
 #endif
 
+    StartOutputOI();
     do
     {
+#ifdef OI_SIM
+        if ( simulate )
+            total_instructions += ExecuteSimOI();
+        else
+#endif
         total_instructions += ExecuteOI();
+#ifdef OI_CHECKPOINT
+        if ( g_checkpoint_due && !g_halted )
+            WriteCheckpointOI();
+#endif
     } while ( !g_halted );
 
+#ifdef OI_PREDECODE
+    if ( profile )
+        ShowProfileOI();
+#endif
+
+#ifdef OI_SIM
+    if ( simulate )
+        ShowSimOI();
+#endif
+
+    if ( 0 != g_snapshot_name )
+    {
+        printf( "the app ended without making the init done syscall\n" );
+        return 1;
+    }
+
 #ifndef NDEBUG
     if ( show_perf )
         printf( "total instructions executed: %lu\n", total_instructions );
@@ -8,10 +8,10 @@ struct OIHeader
 {
     uint8_t sig0;               /* O */
     uint8_t sig1;               /* I */
-    uint8_t version;
-    uint8_t flags;              /* lower two bits: 00 16-bit. 01: 32-bit. 10: 64-bit image width */
+    uint8_t version;            /* 1, or 2 for the page-aligned layout below */
+    uint8_t flags;              /* lower two bits: 00 16-bit. 01: 32-bit. 10: 64-bit image width. see OI_FLAG_ below */
     uint32_t unused;            /* for future use and to get the header to a multiple of 8 bytes */
-    uint32_t cbCode;            /* count of bytes for code. code in file begins after the header */
+    uint32_t cbCode;            /* count of bytes for code. code in file begins after the header, or at OI_V2_ALIGN */
     uint32_t cbInitializedData; /* count of bytes for initialized data. initialized data in file begins just after code */
     uint32_t cbZeroFilledData;  /* count of bytes for zero-filled data. brk is set immediately after this */
     uint32_t cbStack;           /* # of bytes required for stack from top of RAM down to end of zero-filled data */
@@ -24,4 +24,46 @@ struct OIHeader
     /* initialized data loaded immediately after code, and should be at least image width aligned */
 };
 
+/*  Version 2 images put the code at file offset OI_V2_ALIGN instead of just after the header, and oia pads
+    cbCode to a multiple of OI_V2_ALIGN. The code and the initialized data then both start on a page boundary
+    in the file and in guest RAM, so oios can map them instead of reading them.
+*/
+
+#define OI_V2_ALIGN 4096
+
+/*  With OI_FLAG_COMPRESSED (oia -z) the code and initialized data are LZSS compressed. Each flag byte is followed by
+    up to 8 items, one per bit starting with the low bit. A clear bit is a literal byte. A set bit is a 2-byte match
+    that copies ( second byte & 0xf ) + 3 bytes from distance bytes back in the output, where distance is the
+    first byte plus the high 4 bits of the second shifted to bits 8..11. The stream ends once cbCode +
+    cbInitializedData bytes have been produced.
+*/
+
+#define OI_FLAG_WIDTH 0x03
+#define OI_FLAG_COMPRESSED 0x80
+
+/*  A bundle (.oib, written by oib) holds many images in one file. An OIBundleHeader is followed by count
+    OIBundleEntry records sorted by name with strcmp, then the images. Each image is exactly what its .oi file
+    held and starts at a multiple of OI_V2_ALIGN, so version 2 images in a bundle can still be mapped. oios runs
+    an entry named as bundle.oib:name.
+*/
+
+struct OIBundleHeader
+{
+    uint8_t sig0;               /* O */
+    uint8_t sig1;               /* I */
+    uint8_t sig2;               /* B */
+    uint8_t version;            /* 1 */
+    uint32_t count;             /* count of OIBundleEntry records */
+};
+
+struct OIBundleEntry
+{
+    char name[ 52 ];            /* null-terminated image name without the .oi */
+    uint32_t length;            /* bytes in the image */
+    uint32_t loOffset;          /* file offset of the image's OIHeader */
+    uint32_t hiOffset;
+};
+
+#define oi_code_offset( h ) ( ( 2 == ( h ).version ) ? (uint32_t) OI_V2_ALIGN : (uint32_t) sizeof( struct OIHeader ) )
+
 
@@ -8,6 +8,9 @@ set _applist=sieveoi eoi tttoi testoi
 
 set _basiclist=e sieve ttt tp texp tcpm tfor tcomp tgosub tmul test tparen tneg tneg1 ta2dim
 
+rem the syscall tests check themselves and print "name done", so their baselines are checked in
+set _syscalllist=fileoi heapoi atomicoi
+
 ( for %%a in (%_applist%) do ( call :appRun %%a ) )
 
 ( for %%a in (%_basiclist%) do ( call :basicRun %%a ) )
@@ -20,6 +23,46 @@ oios4 tttoi 13 >>%outputfile%
 echo %date% %time% >>%outputfile%
 diff baseline_%outputfile% %outputfile%
 
+set outputfile=test_syscalls.txt
+type nul >%outputfile%
+
+( for %%a in (%_syscalllist%) do ( call :appRun %%a ) )
+
+diff -i -B -w baseline_%outputfile% %outputfile%
+
+rem run tttoi and sieveoi through the image features and compare their output with plain runs
+oia -w:8 tttoi.s
+copy /y tttoi.oi ttt8.oi 1>nul
+oios ttt8 10 >plain_ttt8.txt
+oia -w:4 sieveoi.s
+copy /y sieveoi.oi sieve4.oi 1>nul
+oios sieve4 >plain_sieve4.txt
+
+echo test -snapshot
+oios -snapshot:snap_ttt8.oi ttt8
+oios snap_ttt8 10 >feature.txt
+diff plain_ttt8.txt feature.txt || echo -snapshot failed
+
+echo test version 2 images
+oia -p -w:8 tttoi.s
+oios tttoi 10 >feature.txt
+diff plain_ttt8.txt feature.txt || echo oia -p failed
+
+echo test compressed images
+oia -z -w:8 tttoi.s
+oios tttoi 10 >feature.txt
+diff plain_ttt8.txt feature.txt || echo oia -z failed
+oia -z -w:4 sieveoi.s
+oios sieveoi >feature.txt
+diff plain_sieve4.txt feature.txt || echo oia -z sieveoi failed
+
+echo test bundles
+oib -c oios_test.oib ttt8.oi sieve4.oi
+oios oios_test.oib:ttt8 10 >feature.txt
+diff plain_ttt8.txt feature.txt || echo oib ttt8 failed
+oios oios_test.oib:sieve4 >feature.txt
+diff plain_sieve4.txt feature.txt || echo oib sieve4 failed
+
 goto :eof
 
 :basicRun
@@ -39,6 +82,7 @@ oia -w:2 %~1.s >>%outputfile%
 oios2 %~1 >>%outputfile%
 oios4 %~1 >>%outputfile%
 oios8 %~1 >>%outputfile%
+oios %~1 >>%outputfile%
 rem rvos ..\rvos\debianrv\oios2 %~1 >>%outputfile%
 
 echo   test %~1 as 4-bytes
@@ -46,12 +90,14 @@ echo test %~1 as 4-bytes >>%outputfile%
 oia -w:4 %~1.s >>%outputfile%
 oios4 %~1 >>%outputfile%
 oios8 %~1 >>%outputfile%
+oios %~1 >>%outputfile%
 rem rvos ..\rvos\debianrv\oios4 %~1 >>%outputfile%
 
 echo   test %~1 as 8-bytes
 echo test %~1 as 8-bytes >>%outputfile%
 oia -w:8 %~1.s >>%outputfile%
 oios8 %~1 >>%outputfile%
+oios %~1 >>%outputfile%
 rem rvos ..\rvos\debianrv\oios8 %~1 >>%outputfile%
 
 exit /b 0
@@ -6,6 +6,11 @@ echo $(date) >$outputfile
 declare -a _applist=( sieveoi eoi tttoi testoi )
 declare -a _basiclist=( e sieve ttt tp texp tcpm tfor tcomp tgosub tmul test tparen tneg tneg1 ta2dim )
 
+# the syscall tests check themselves and print "name done", so their baselines are checked in
+declare -a _syscalllist=( fileoi heapoi atomicoi )
+# these need the gcc builds' mmap and pthreads, so runall.bat doesn't run them
+declare -a _unixlist=( mapoi aiooi timeoi threadoi )
+
 test_app()
 {
     echo test $1
@@ -17,17 +22,20 @@ test_app()
     oios2 $1 >>$outputfile
     oios4 $1 >>$outputfile
     oios8 $1 >>$outputfile
+    oios $1 >>$outputfile
 
     echo   test $1 as 4-bytes
     echo test $1 as 4-bytes >>$outputfile
     oia -w:4 $1.s >>$outputfile
     oios4 $1 >>$outputfile
     oios8 $1 >>$outputfile
+    oios $1 >>$outputfile
 
     echo   test $1 as 8-bytes
     echo test $1 as 8-bytes >>$outputfile
     oia -w:8 $1.s >>$outputfile
     oios8 $1 >>$outputfile
+    oios $1 >>$outputfile
 }
 
 test_basic_app()
@@ -55,3 +63,141 @@ oios4 tttoi 13 >>$outputfile
 
 echo $(date) >>$outputfile
 diff -i -B -w baseline_$outputfile $outputfile
+
+outputfile="test_syscalls.txt"
+echo -n >$outputfile
+
+for app in ${_syscalllist[*]}
+do
+    test_app $app
+done
+
+diff -i -B -w baseline_$outputfile $outputfile
+
+outputfile="test_syscalls_unix.txt"
+echo -n >$outputfile
+
+for app in ${_unixlist[*]}
+do
+    test_app $app
+done
+
+diff -i -B -w baseline_$outputfile $outputfile
+
+# oios -n counts retired instructions from the start, and timeoi fails without a count when given an argument
+for w in 2 4 8
+do
+    oia -w:$w timeoi.s
+    oios -n timeoi count | grep -q "timeoi done" || echo oios -n timeoi as $w-bytes failed
+done
+
+# the first guest thread turns oios -j's JIT off
+for w in 2 4 8
+do
+    oia -w:$w threadoi.s >/dev/null
+    oios -j threadoi | grep -q "threadoi done" || echo oios -j threadoi as $w-bytes failed
+done
+
+# oios -g names the faulting load or store, with and without the decode cache
+outputfile="test_guard.txt"
+oia -w:8 guardoi.s >$outputfile
+for flags in "-g" "-g -d" "-g -j"
+do
+    echo oios $flags guardoi >>$outputfile
+    oios $flags guardoi >>$outputfile
+    oios $flags guardoi store >>$outputfile
+done
+
+diff -i -B -w baseline_$outputfile $outputfile
+
+# runs the test apps at each width with oios flags $1 and compares their output with the plain interpreter's.
+# output after the apps' own, like -s's profile, is ignored. $2 has any oia flags
+test_engine()
+{
+    echo test oios $1 $2
+    for app in sieveoi eoi tttoi testoi
+    do
+        for w in 2 4 8
+        do
+            oia $2 -w:$w $app.s >/dev/null
+            oios -d $app >plain_engine.txt
+            oios $1 $app | head -n $(wc -l <plain_engine.txt) | diff plain_engine.txt - >/dev/null || echo oios $1 $app as $w-bytes failed
+        done
+    done
+}
+
+test_engine -j
+test_engine -s
+test_engine -m
+test_engine -m -p
+test_engine -r -p
+test_engine -sim
+
+# builds each app's oi2c translation the way oi2c's header comment says and compares it with the interpreter
+echo test oi2c
+for app in sieveoi tttoi testoi
+do
+    for w in 2 4 8
+    do
+        oia -w:$w $app.s >/dev/null
+        oios -d $app >plain_oi2c.txt
+        oi2c $app >/dev/null && g++ -O2 -fno-strict-aliasing -D OI8 -D OI2C -D NDEBUG -I . oios.c $app.c trace.c oidis.c -o oi2c_$app -pthread || echo oi2c $app as $w-bytes failed to build
+        ./oi2c_$app $app.oi | diff plain_oi2c.txt - >/dev/null || echo oi2c $app as $w-bytes failed
+    done
+done
+
+# run tttoi and sieveoi through the image features and compare their output with plain runs
+oia -w:8 tttoi.s
+cp tttoi.oi ttt8.oi
+oios ttt8 10 >plain_ttt8.txt
+oia -w:4 sieveoi.s
+cp sieveoi.oi sieve4.oi
+oios sieve4 >plain_sieve4.txt
+
+echo test -snapshot
+oios -snapshot:snap_ttt8.oi ttt8
+oios snap_ttt8 10 | diff plain_ttt8.txt - || echo -snapshot failed
+
+echo test -checkpoint and -resume
+rm -f ttt8.ck
+oios ttt8 3000 >plain_ttt8_long.txt
+oios -checkpoint:ttt8.ck ttt8 3000 >/dev/null &
+sleep 0.5
+kill -USR1 $!
+wait
+oios -resume:ttt8.ck | diff plain_ttt8_long.txt - || echo -checkpoint and -resume failed
+
+echo test -serve and -client
+oios -serve:oios_test.sock &
+serve_pid=$!
+sleep 0.5
+oios -client:oios_test.sock ttt8.oi 10 | diff plain_ttt8.txt - || echo -client ttt8 failed
+oios -client:oios_test.sock sieve4.oi | diff plain_sieve4.txt - || echo -client sieve4 failed
+oios -client:oios_test.sock ttt8.oi 10 | diff plain_ttt8.txt - || echo -client with a cached ttt8 failed
+kill $serve_pid
+wait
+
+echo test -parallel
+printf "ttt8 10\nsieve4\nttt8 10\n" >oios_test_jobs.txt
+cat plain_ttt8.txt plain_sieve4.txt plain_ttt8.txt | sort >plain_jobs.txt
+oios -parallel:2 oios_test_jobs.txt | sort | diff plain_jobs.txt - || echo -parallel failed
+echo nosuchapp >>oios_test_jobs.txt
+oios -parallel:2 oios_test_jobs.txt >/dev/null && echo -parallel with a missing app exited with 0
+printf "guardoi\nttt8 10\n" >oios_test_jobs.txt
+oios -g -parallel:2 oios_test_jobs.txt | grep -q "10 iterations" || echo -parallel stopped at a -g fault
+
+echo test version 2 images
+oia -p -w:8 tttoi.s
+oios tttoi 10 | diff plain_ttt8.txt - || echo oia -p failed
+oios -m tttoi 10 | diff plain_ttt8.txt - || echo oia -p with oios -m failed
+
+echo test compressed images
+oia -z -w:8 tttoi.s
+oios tttoi 10 | diff plain_ttt8.txt - || echo oia -z failed
+oia -z -w:4 sieveoi.s
+oios sieveoi | diff plain_sieve4.txt - || echo oia -z sieveoi failed
+
+echo test bundles
+oib -c oios_test.oib ttt8.oi sieve4.oi
+oios oios_test.oib:ttt8 10 | diff plain_ttt8.txt - || echo oib ttt8 failed
+oios oios_test.oib:sieve4 | diff plain_sieve4.txt - || echo oib sieve4 failed
@@ -0,0 +1,166 @@
+; tests guest threads and futexes, syscalls 22-25, with the atomic instructions
+; build with oia:    oia threadoi
+; run with oios:     oios threadoi
+
+define syscall_exit           0
+define syscall_print_string   1
+define syscall_print_integer  2
+define syscall_malloc         16
+define syscall_free           17
+define syscall_thread         22
+define syscall_join           23
+define syscall_futex_wait     24
+define syscall_futex_wake     25
+
+define workers 4
+define iterations 5000
+
+.data
+    string  str_done "threadoi done\n"
+    string  str_nl "\n"
+    string  str_failure "threadoi failure in test "
+    image_t g_counter
+    image_t g_flag
+    image_t g_sum
+    image_t g_waiter
+    image_t g_count
+.dataend
+
+.code
+start:
+    ldi     rarg1, waiter
+    zero    rarg2
+    zero    rres
+    syscall syscall_thread
+    ldi     rtmp, -1
+    j       rres, rtmp, eq, test_fail_1
+    st      [g_waiter], rres
+
+    ldi     rarg1, g_flag                 ; waiting when the word isn't the expected value returns 1 right away
+    ldi     rarg2, 5
+    syscall syscall_futex_wait
+    ldi     rtmp, 1
+    j       rres, rtmp, ne, test_fail_2
+
+    ldi     rtmp, workers                 ; worker n gets n in rarg1. their ids go on the stack
+    st      [g_count], rtmp
+  _start_next:
+    ldi     rarg1, worker
+    ld      rarg2, [g_count]
+    zero    rres
+    syscall syscall_thread
+    ldi     rtmp, -1
+    j       rres, rtmp, eq, test_fail_3
+    push    rres
+    ld      rtmp, [g_count]
+    dec     rtmp
+    st      [g_count], rtmp
+    j       rtmp, rzero, ne, _start_next
+
+    ldi     rtmp, workers                 ; join returns each worker's rres, 2 * n
+  _join_next:
+    st      [g_count], rtmp
+    pop     rarg1
+    syscall syscall_join
+    ld      rtmp, [g_sum]
+    add     rtmp, rres
+    st      [g_sum], rtmp
+    ld      rtmp, [g_count]
+    dec     rtmp
+    j       rtmp, rzero, ne, _join_next
+
+    ld      rtmp, [g_counter]             ; no increments were lost
+    ldi     rarg2, 20000
+    j       rtmp, rarg2, ne, test_fail_4
+    ld      rtmp, [g_sum]
+    ldi     rarg2, 20
+    j       rtmp, rarg2, ne, test_fail_5
+
+    ldi     rarg1, g_flag                 ; set the flag and wake the waiter
+    ldi     rtmp, 1
+    xchg    [rarg1], rtmp
+    ldi     rarg1, g_flag
+    zero    rarg2
+    syscall syscall_futex_wake
+    ld      rarg1, [g_waiter]
+    syscall syscall_join
+    ldi     rtmp, 77
+    j       rres, rtmp, ne, test_fail_6
+
+    ld      rarg1, [g_waiter]             ; a thread can only be joined once
+    syscall syscall_join
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, test_fail_7
+
+    ldi     rarg1, str_done
+    syscall syscall_print_string
+    ret
+
+worker:
+    push    rarg1
+    ldi     rtmp, iterations
+  _work:
+    ldi     rarg2, g_counter
+    ldi     rres, 1
+    xadd    [rarg2], rres
+    push    rtmp                          ; the heap is shared, so malloc and free take its lock
+    ldi     rarg1, 40
+    syscall syscall_malloc
+    mov     rarg1, rres
+    syscall syscall_free
+    pop     rtmp
+    dec     rtmp
+    j       rtmp, rzero, ne, _work
+    pop     rres
+    add     rres, rres
+    ret
+
+waiter:
+  _wait:
+    ldi     rarg1, g_flag
+    zero    rarg2
+    syscall syscall_futex_wait
+    ld      rtmp, [g_flag]
+    j       rtmp, rzero, eq, _wait
+    ldi     rres, 77
+    ret
+
+test_fail_1:
+    ldi    rarg1, 1
+    jmp    failure
+
+test_fail_2:
+    ldi    rarg1, 2
+    jmp    failure
+
+test_fail_3:
+    ldi    rarg1, 3
+    jmp    failure
+
+test_fail_4:
+    ldi    rarg1, 4
+    jmp    failure
+
+test_fail_5:
+    ldi    rarg1, 5
+    jmp    failure
+
+test_fail_6:
+    ldi    rarg1, 6
+    jmp    failure
+
+test_fail_7:
+    ldi    rarg1, 7
+    jmp    failure
+
+failure:
+    mov    rarg2, rarg1
+    ldi    rarg1, str_failure
+    syscall syscall_print_string
+    mov    rarg1, rarg2
+    syscall syscall_print_integer
+    ldi    rarg1, str_nl
+    syscall syscall_print_string
+
+    syscall syscall_exit
+.codeend
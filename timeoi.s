@@ -0,0 +1,157 @@
+; tests the timing syscalls 19-21: the clock, retired instructions, and cycles
+; build with oia:    oia timeoi
+; run with oios:     oios timeoi, or oios -n timeoi count to require a retired instruction count
+; each count is also stored as 64 bits so it can be compared whatever the image width
+
+define syscall_exit           0
+define syscall_print_string   1
+define syscall_print_integer  2
+define syscall_clock          19
+define syscall_instructions   20
+define syscall_cycles         21
+
+define spins 100
+
+.data
+    string  str_done "timeoi done\n"
+    string  str_nl "\n"
+    string  str_failure "timeoi failure in test "
+    image_t g_first
+    byte    g_before[ 8 ]
+    byte    g_after[ 8 ]
+.dataend
+
+.code
+start:
+    ldi     rarg1, g_before               ; the clock moves forward
+    syscall syscall_clock
+    call    spin
+    ldi     rarg1, g_after
+    syscall syscall_clock
+    ldi     rarg1, g_before
+    ldi     rarg2, g_after
+    call    later
+    j       rres, rzero, eq, test_fail_1
+
+    ldi     rarg1, g_before               ; so does the instruction count, by about the spin loop's.
+    syscall syscall_instructions          ; unless oios -n counts them both are -1
+    st      [g_first], rres
+    call    spin
+    ldi     rarg1, g_after
+    syscall syscall_instructions
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, _instructions
+    ld      rarg1, [g_first]
+    j       rarg1, rtmp, ne, _instructions
+    ldf     rarg1, 0                      ; with an argument the count is required
+    ldi     rtmp, 1
+    j       rarg1, rtmp, ne, test_fail_6
+    jmp     _no_instructions
+  _instructions:
+    ld      rtmp, [g_first]               ; counting starts with the app, not the first syscall
+    j       rtmp, rzero, eq, test_fail_7
+    sub     rres, rtmp
+    ldi     rtmp, spins
+    add     rtmp, rtmp
+    j       rres, rtmp, lt, test_fail_2
+    ldi     rtmp, 1000
+    j       rres, rtmp, gt, test_fail_3
+    ldi     rarg1, g_before
+    ldi     rarg2, g_after
+    call    later
+    j       rres, rzero, eq, test_fail_4
+
+  _no_instructions:
+    ldi     rarg1, g_before               ; hosts without a cycle counter return -1 for both
+    syscall syscall_cycles
+    st      [g_first], rres
+    call    spin
+    ldi     rarg1, g_after
+    syscall syscall_cycles
+    ldi     rtmp, -1
+    j       rres, rtmp, ne, _cycles
+    ld      rres, [g_first]
+    j       rres, rtmp, eq, _done
+  _cycles:
+    ldi     rarg1, g_before
+    ldi     rarg2, g_after
+    call    later
+    j       rres, rzero, eq, test_fail_5
+
+  _done:
+    ldi     rarg1, str_done
+    syscall syscall_print_string
+    ret
+
+spin:
+    ldi     rtmp, spins
+  _spin:
+    dec     rtmp
+    j       rtmp, rzero, ne, _spin
+    ret
+
+later:                                    ; rres = 1 if the 64 bits at rarg2 are more than those at rarg1
+    ldi     rres, 7
+    add     rarg1, rres
+    add     rarg2, rres
+    ldi     rres, 8
+  _later_byte:
+    push    rres
+    ldb     rtmp, [rarg2]
+    ldb     rres, [rarg1]
+    j       rtmp, rres, gt, _later_yes
+    j       rtmp, rres, lt, _later_no
+    pop     rres
+    dec     rarg1
+    dec     rarg2
+    dec     rres
+    j       rres, rzero, ne, _later_byte
+    ret
+  _later_yes:
+    pop     rres
+    ldi     rres, 1
+    ret
+  _later_no:
+    pop     rres
+    zero    rres
+    ret
+
+test_fail_1:
+    ldi    rarg1, 1
+    jmp    failure
+
+test_fail_2:
+    ldi    rarg1, 2
+    jmp    failure
+
+test_fail_3:
+    ldi    rarg1, 3
+    jmp    failure
+
+test_fail_4:
+    ldi    rarg1, 4
+    jmp    failure
+
+test_fail_5:
+    ldi    rarg1, 5
+    jmp    failure
+
+test_fail_6:
+    ldi    rarg1, 6
+    jmp    failure
+
+test_fail_7:
+    ldi    rarg1, 7
+    jmp    failure
+
+failure:
+    mov    rarg2, rarg1
+    ldi    rarg1, str_failure
+    syscall syscall_print_string
+    mov    rarg1, rarg2
+    syscall syscall_print_integer
+    ldi    rarg1, str_nl
+    syscall syscall_print_string
+
+    syscall syscall_exit
+.codeend
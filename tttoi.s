@@ -19,6 +19,7 @@ define iterations 1
 define syscall_exit           0
 define syscall_print_string   1
 define syscall_print_integer  2
+define syscall_init_done      3
 
 .data
     align                                   ; align with no value aligns to image width
@@ -34,21 +35,6 @@ define syscall_print_integer  2
 
 .code
 start:
-    ldiw    rtmp, iterations
-    st      [loop_count], rtmp
-
-    ldf     rarg1, 0
-    ji      rarg1, 2, ne, _no_argument
-    ldf     rarg1, 1
-    natwid
-    add     rarg1, rres
-    ld      rarg1, [rarg1]
-
-    call    atou
-    j       rres, rzero, eq, _no_argument
-    st      [loop_count], rres
-
-  _no_argument:
     ldi     rtmp, procs
     ldi     rarg1, proc0
     stinc   rtmp, rarg1
@@ -68,7 +54,23 @@ start:
     stinc   rtmp, rarg1
     ldi     rarg1, proc8
     stinc   rtmp, rarg1
+    syscall syscall_init_done               ; oios -snapshot saves RAM here. the snapshot starts after this
 
+    ldiw    rtmp, iterations
+    st      [loop_count], rtmp
+
+    ldf     rarg1, 0
+    ji      rarg1, 2, ne, _no_argument
+    ldf     rarg1, 1
+    natwid
+    add     rarg1, rres
+    ld      rarg1, [rarg1]
+
+    call    atou
+    j       rres, rzero, eq, _no_argument
+    st      [loop_count], rres
+
+  _no_argument:
   _start_again:
     st      [move_count], rzero
 